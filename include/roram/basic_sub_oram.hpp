@@ -0,0 +1,250 @@
+#pragma once
+
+#include "roram/header_scan.hpp"
+#include "roram/sub_oram.hpp"
+#include <array>
+#include <cstring>
+#include <memory>
+
+namespace roram {
+
+// Sub-ORAM core specialized at compile time for Z blocks per bucket and ℓ = ELL, on a
+// Storage with MemoryStorage's plaintext interface (read_plain / plain_run / seal_run),
+// called without virtual dispatch. Serialized buckets are parsed and built in place:
+// headers go into std::array records with fixed offsets and unrolled loops, and only the
+// blocks a ReadRange returns or a merge keeps become Block objects, so no Bucket is
+// allocated on the hot path. Block choice, stash order and stored bytes are the same as
+// the dynamic SubORAM's. Use make_sub_oram to get one when the configuration is covered.
+template <int Z, int ELL, class Storage>
+class BasicSubORAM final : public SubORAM {
+ public:
+  static constexpr int kTags = ELL + 1;
+
+  // Header of one serialized block: data[B] comes first, then a, ver and the path tags.
+  struct Header {
+    uint64_t a;
+    uint64_t ver;
+    std::array<uint64_t, kTags> p;
+  };
+  static_assert(sizeof(Header) == (2 + kTags) * sizeof(uint64_t), "Header must match the serialized layout");
+  using BucketHeaders = std::array<Header, Z>;
+
+  BasicSubORAM(const Params& params, int i, Storage* storage, CryptoProvider* crypto,
+               std::unique_ptr<PathORAM> pm_backing = nullptr)
+      : SubORAM(params, i, storage, crypto, std::move(pm_backing)),
+        storage_t_(storage),
+        block_size_(params.B + sizeof(Header)),
+        stride_(storage->bucket_byte_size()) {}
+
+  void ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start) override;
+  // In memory a second read costs no round trip, so this is the two calls.
+  void ReadRangePair(uint64_t a0, uint64_t a1, std::vector<Block>& result0, uint64_t& new_path0,
+                     std::vector<Block>& result1, uint64_t& new_path1) override {
+    ReadRange(a0, result0, new_path0);
+    ReadRange(a1, result1, new_path1);
+  }
+  void BatchEvict(uint64_t k, uint64_t cnt) override;
+  bool specialized() const override { return true; }
+
+ private:
+  Storage* storage_t_;
+  size_t block_size_;  // B + a + ver + kTags tags
+  uint64_t stride_;    // stored bucket: Z blocks plus the crypto tag
+
+  static uint64_t load_u64(const uint8_t* in) {
+    uint64_t v;
+    std::memcpy(&v, in, sizeof(v));
+    return v;
+  }
+  const uint8_t* block_at(const uint8_t* bucket, int z) const { return bucket + static_cast<size_t>(z) * block_size_; }
+  void load_headers(const uint8_t* bucket, BucketHeaders& out) const {
+    for (int z = 0; z < Z; ++z) std::memcpy(&out[static_cast<size_t>(z)], block_at(bucket, z) + params_.B, sizeof(Header));
+  }
+  void load_block(const uint8_t* in, Block& b) const {
+    b.data.assign(in, in + params_.B);
+    Header h;
+    std::memcpy(&h, in + params_.B, sizeof(h));
+    b.a = h.a;
+    b.ver = h.ver;
+    b.p.assign(h.p.begin(), h.p.end());
+  }
+  void store_block(const Block& b, uint8_t* out) const {
+    std::memcpy(out, b.data.data(), params_.B);
+    Header h;
+    h.a = b.a;
+    h.ver = b.ver;
+    for (int t = 0; t < kTags; ++t) h.p[static_cast<size_t>(t)] = b.p[static_cast<size_t>(t)];
+    std::memcpy(out + params_.B, &h, sizeof(h));
+  }
+  void store_dummy(uint8_t* out) const {
+    std::memset(out, 0, block_size_);
+    const uint64_t invalid = INVALID_ADDR;
+    std::memcpy(out + params_.B, &invalid, sizeof(invalid));
+  }
+};
+
+template <int Z, int ELL, class Storage>
+void BasicSubORAM<Z, ELL, Storage>::ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start) {
+  ScopedPhase timer(stats_, Phase::ReadRange, i_);
+  const uint64_t range_len = 1ULL << i_;
+  const uint64_t U_end = a + range_len;
+
+  result.clear();
+  RangeIndex seen;
+  seen.reserve(static_cast<size_t>(range_len) * 2 + 8);
+  stash_range(a, U_end, result, seen);
+  const uint64_t p = remap_range(a, new_path_start);
+
+  std::vector<BucketExtent> extents;
+  for (int j = 0; j <= params_.h; ++j) add_level_extents(p, range_len, j, extents);
+  uint64_t n_buckets = 0;
+  for (const BucketExtent& e : extents) n_buckets += e.count;
+  const uint8_t* plain = storage_t_->Storage::read_plain(extents);
+
+  {
+    ScopedPhase t(stats_, Phase::Serialize);
+    t.set_count(n_buckets);
+    std::vector<uint64_t> addrs(static_cast<size_t>(n_buckets) * Z);
+    for (uint64_t b = 0; b < n_buckets; ++b)
+      for (int z = 0; z < Z; ++z)
+        addrs[static_cast<size_t>(b) * Z + static_cast<size_t>(z)] = load_u64(block_at(plain + b * stride_, z) + params_.B);
+    std::vector<uint64_t> mask(mask_words(addrs.size()));
+    if (scan_in_range(addrs.data(), addrs.size(), a, U_end, mask.data()) > 0) {
+      for_each_match(mask.data(), mask.size(), [&](size_t k) {
+        const uint8_t* in = block_at(plain + (k / Z) * stride_, static_cast<int>(k % Z));
+        auto it = seen.find(addrs[k]);
+        if (it == seen.end()) {
+          seen.emplace(addrs[k], result.size());
+          result.emplace_back();
+          load_block(in, result.back());
+        } else if (load_u64(in + params_.B + sizeof(uint64_t)) > result[it->second].ver) {
+          load_block(in, result[it->second]);  // an older copy was met first
+        }
+      });
+    }
+  }
+  complete_range(a, U_end, new_path_start, result, seen);
+}
+
+template <int Z, int ELL, class Storage>
+void BasicSubORAM<Z, ELL, Storage>::BatchEvict(uint64_t k, uint64_t cnt) {
+  const int h = params_.h;
+  const uint64_t range_size = 1ULL << i_;
+
+  std::vector<BucketExtent> extents;
+  for (int j = 0; j <= h; ++j) add_level_extents(cnt, k, j, extents);
+  uint64_t n_buckets = 0;
+  for (const BucketExtent& e : extents) n_buckets += e.count;
+  const uint8_t* plain;
+  {
+    ScopedPhase t(stats_, Phase::EvictRead);
+    plain = storage_t_->Storage::read_plain(extents);
+  }
+  {
+    // merge_into_stash on the serialized headers: stale and older copies are dropped
+    // without building a Block.
+    ScopedPhase t(stats_, Phase::StashMerge);
+    std::vector<uint64_t> addrs;
+    addrs.reserve(stash_.size() + static_cast<size_t>(n_buckets) * Z);
+    for (const Block& s : stash_) addrs.push_back(s.a);
+    MergeLookup lookup(pm_);
+    BucketHeaders headers;
+    for (uint64_t b = 0; b < n_buckets; ++b) {
+      const uint8_t* bucket = plain + b * stride_;
+      load_headers(bucket, headers);
+      for (int z = 0; z < Z; ++z) {
+        const Header& hd = headers[static_cast<size_t>(z)];
+        if (hd.a == INVALID_ADDR) {
+          lookup.skip();
+          continue;
+        }
+        const uint64_t a0 = (hd.a / range_size) * range_size;
+        if (hd.p[static_cast<size_t>(i_)] != lookup.query(a0) + (hd.a - a0)) continue;
+        const size_t at = scan_find(addrs.data(), addrs.size(), hd.a);
+        if (at == addrs.size()) {
+          stash_.emplace_back();
+          load_block(block_at(bucket, z), stash_.back());
+          addrs.push_back(hd.a);
+        } else if (hd.ver > stash_[at].ver) {
+          load_block(block_at(bucket, z), stash_[at]);
+        }
+      }
+    }
+    note_stash_peak();
+    peak_evict_buckets_ = std::max<uint64_t>(peak_evict_buckets_, n_buckets);
+  }
+
+  // Write phase: choose every level's blocks from the leaves up against one packed tag
+  // array, then serialize straight from the stash into the runs and compact it once.
+  const size_t n = stash_.size();
+  std::vector<uint64_t> taken(mask_words(n), 0);
+  std::vector<size_t> slots(static_cast<size_t>(n_buckets) * Z);
+  extents.clear();
+  {
+    ScopedPhase t(stats_, Phase::EvictAssign);
+    std::vector<uint64_t> tags(n);
+    for (size_t s = 0; s < n; ++s) tags[s] = stash_[s].p[static_cast<size_t>(i_)];
+    size_t base = 0;
+    for (int j = h; j >= 0; --j) {
+      const uint64_t level_buckets = num_buckets_at_level(j);
+      const uint64_t num_needed = std::min(k, level_buckets);
+      select_level(tags.data(), n, level_buckets, cnt % level_buckets, num_needed, Z, taken.data(),
+                   slots.data() + base);
+      base += static_cast<size_t>(num_needed) * Z;
+      add_level_extents(cnt, k, j, extents);
+    }
+  }
+  {
+    ScopedPhase t(stats_, Phase::EvictWrite);
+    size_t slot = 0;
+    for (const BucketExtent& e : extents) {
+      uint8_t* out = storage_t_->Storage::plain_run(e.level, e.start, e.count);
+      {
+        ScopedPhase s(stats_, Phase::Serialize);
+        s.set_count(e.count);
+        for (uint64_t b = 0; b < e.count; ++b) {
+          for (int z = 0; z < Z; ++z, ++slot) {
+            uint8_t* dst = out + b * stride_ + static_cast<size_t>(z) * block_size_;
+            if (slots[slot] == kNoSlot)
+              store_dummy(dst);
+            else
+              store_block(stash_[slots[slot]], dst);
+          }
+        }
+      }
+      storage_t_->Storage::seal_run(e.level, e.start, e.count);
+    }
+  }
+  remove_taken(stash_, taken.data());
+}
+
+// Pre-instantiated in basic_sub_oram.cpp for in-memory trees: Z = 4, ℓ = 0..13 (L up to 8192).
+#define RORAM_BASIC_SUB_ORAM(ELL) extern template class BasicSubORAM<4, ELL, MemoryStorage>;
+RORAM_BASIC_SUB_ORAM(0)
+RORAM_BASIC_SUB_ORAM(1)
+RORAM_BASIC_SUB_ORAM(2)
+RORAM_BASIC_SUB_ORAM(3)
+RORAM_BASIC_SUB_ORAM(4)
+RORAM_BASIC_SUB_ORAM(5)
+RORAM_BASIC_SUB_ORAM(6)
+RORAM_BASIC_SUB_ORAM(7)
+RORAM_BASIC_SUB_ORAM(8)
+RORAM_BASIC_SUB_ORAM(9)
+RORAM_BASIC_SUB_ORAM(10)
+RORAM_BASIC_SUB_ORAM(11)
+RORAM_BASIC_SUB_ORAM(12)
+RORAM_BASIC_SUB_ORAM(13)
+#undef RORAM_BASIC_SUB_ORAM
+
+// Process-wide switch read by make_sub_oram (default on; RORAM_GENERIC_CORE=1 in the
+// environment turns it off), so the two cores can be compared on one binary.
+bool sub_oram_specialization();
+void set_sub_oram_specialization(bool on);
+
+// A pre-instantiated BasicSubORAM when specialization is on, storage is exactly a
+// MemoryStorage (not a subclass or decorator such as TracingStorage) and (Z, ℓ) is
+// covered; the dynamic SubORAM otherwise.
+std::unique_ptr<SubORAM> make_sub_oram(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto,
+                                       std::unique_ptr<PathORAM> pm_backing = nullptr);
+
+}  // namespace roram
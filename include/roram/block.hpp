@@ -6,10 +6,15 @@
 
 namespace roram {
 
-// Physical block: data[B], logical address a, path tags p0..p_ell for sub-ORAMs R0..R_ell
+// Physical block: data[B], logical address a, version, path tags p0..p_ell for sub-ORAMs R0..R_ell.
+// Serialized as data[B], then a, ver and the ℓ+1 tags as little-endian u64s.
 struct Block {
   std::vector<uint8_t> data;  // B bytes
   uint64_t a;                 // logical address (INVALID_ADDR = dummy)
+  // Version stamped by the rORAM access that last touched the block. A block moved
+  // through R_j keeps its old tag in every other R_i, so an older copy can still sit on
+  // the R_i path it is read from; when copies of a collide the larger version is current.
+  uint64_t ver;
   std::vector<uint64_t> p;    // p.size() = ell+1; p[j] = leaf index in R_j
 
   Block() = default;
@@ -17,7 +22,8 @@ struct Block {
 
   bool valid() const { return a != INVALID_ADDR; }
   void set_dummy();
-  size_t serialized_size(const Params& params) const;
+  // B + 16 + 8 * (ℓ + 1) bytes.
+  static size_t serialized_size(const Params& params);
   void serialize(uint8_t* out, const Params& params) const;
   void deserialize(const uint8_t* in, const Params& params);
 };
@@ -44,4 +44,22 @@ class NoOpCrypto : public CryptoProvider {
   uint64_t seed_;
 };
 
+// Non-owning view of another provider. Lets auxiliary ORAMs (e.g. an outsourced
+// position map) share the parent's keys and RNG without taking ownership.
+class CryptoRef : public CryptoProvider {
+ public:
+  explicit CryptoRef(CryptoProvider* inner) : inner_(inner) {}
+  size_t tag_size() const override { return inner_->tag_size(); }
+  void encrypt(uint8_t* data, size_t len, uint64_t block_id, uint8_t* tag_out) override {
+    inner_->encrypt(data, len, block_id, tag_out);
+  }
+  void decrypt(uint8_t* data, size_t len, uint64_t block_id, const uint8_t* tag_in) override {
+    inner_->decrypt(data, len, block_id, tag_in);
+  }
+  uint64_t random_path(uint64_t N) override { return inner_->random_path(N); }
+
+ private:
+  CryptoProvider* inner_;
+};
+
 }  // namespace roram
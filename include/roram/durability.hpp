@@ -0,0 +1,149 @@
+#pragma once
+
+#include "roram/block.hpp"
+#include "roram/crypto.hpp"
+#include "roram/storage.hpp"
+#include "roram/types.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace roram {
+
+// When rORAM's accesses survive a crash (see rORAM::set_durability). While a mode is on,
+// every tree's writes are held in a BufferedStorage. A commit appends one
+// ClientStateRecord to the client-state log and fdatasyncs it: the record carries the
+// position-map entries remapped since the previous commit, the whole stashes, the
+// counters and the buffered bucket writes, sealed with the trees' crypto, and is the
+// commit point. Only then are the buckets written to the trees and the trees synced, so
+// a tree file never holds a write the log cannot account for. rORAM::recover rebuilds the
+// newest commit from the log.
+enum class Durability {
+  None,    // writes reach the trees' page cache only; nothing is recoverable (default)
+  Access,  // every Access / access_batch / scan chunk commits before it returns
+  Group,   // commit every group_size accesses and on rORAM::commit(); ORAMFrontend
+           // commits each batch before completing its futures. A crash loses the
+           // accesses since the last commit.
+};
+
+const char* durability_name(Durability d);
+// "none" | "access" | "group"; throws std::runtime_error otherwise.
+Durability parse_durability(const std::string& name);
+
+// One sub-ORAM's part of a ClientStateRecord.
+struct TreeState {
+  // Snapshot records: the whole packed position map (PositionMap::packed()). Other
+  // records: the entries remapped since the previous record, as (entry index, leaf).
+  std::vector<uint64_t> pm_words;
+  std::vector<std::pair<uint64_t, uint64_t>> pm_updates;
+  std::vector<Block> stash;  // the whole stash
+  // The commit's bucket writes: heap indices ((2^level - 1) + bucket), ascending, and
+  // the buckets. They reach the tree after the record is durable; recovery writes them
+  // again in case that was cut short.
+  std::vector<uint64_t> bucket_ids;
+  std::vector<Bucket> buckets;
+};
+
+// Client state at a commit.
+struct ClientStateRecord {
+  uint64_t seq = 0;       // commit number, from 1; a snapshot has that of the last commit it holds
+  uint64_t cnt = 0;       // rORAM eviction counter: next path to evict
+  uint64_t version = 0;   // last version stamped on a block
+  uint64_t accesses = 0;  // accesses this commit covers (0 for snapshots)
+  bool snapshot = false;  // pm_words rather than pm_updates
+  std::vector<TreeState> trees;  // one per sub-ORAM R_0..R_ℓ
+
+  uint64_t stashed() const;  // blocks in all stashes
+};
+
+// Append-only log of the ClientStateRecords of one rORAM, starting with a snapshot. File =
+// "RORAMWL3", then per record a u64 body length, the body and a u64 FNV-1a of the body
+// (torn-write detection). The body is a u64 nonce, the sealed payload and its tag: the
+// payload is encrypted with the trees' CryptoProvider under the nonce, a random id with
+// the top bit set, so it never repeats a bucket's. It holds little-endian u64s: seq, cnt,
+// version, accesses, snapshot, tree count, then per tree a counted list of map words (or
+// index, leaf pairs), a counted list of serialized stash blocks, and a counted list of
+// heap indices followed by their serialized buckets. Only record sizes are in the clear.
+class ClientStateLog {
+ public:
+  // Starts the log at path with base (a snapshot) as its only record. An existing log is
+  // replaced atomically: the new one is written beside it, synced and renamed over it.
+  // crypto seals the records and must outlive the log.
+  ClientStateLog(const std::string& path, const Params& params, CryptoProvider* crypto, const ClientStateRecord& base);
+  ~ClientStateLog();
+  ClientStateLog(const ClientStateLog&) = delete;
+  ClientStateLog& operator=(const ClientStateLog&) = delete;
+
+  // Writes rec and fdatasyncs the log. If that fails, the log is cut back to its previous
+  // records before the error is rethrown; if even that fails, every later append throws
+  // until reset().
+  void append(const ClientStateRecord& rec);
+  // Compaction: replaces the log with base alone, as the constructor does.
+  void reset(const ClientStateRecord& base);
+  // Records written since construction, the base included (not the compaction snapshots).
+  uint64_t appended() const { return appended_; }
+  uint64_t bytes() const { return bytes_; }            // log file size
+  uint64_t base_bytes() const { return base_bytes_; }  // size right after the last reset
+  const std::string& path() const { return path_; }
+
+  // Records in order, stopping at the first torn or corrupt one (a crash mid-append).
+  // Throws if an intact record does not open under crypto (wrong key).
+  static std::vector<ClientStateRecord> read(const std::string& path, const Params& params, CryptoProvider* crypto);
+
+ private:
+  std::string path_;
+  Params params_;
+  CryptoProvider* crypto_;
+  int fd_{-1};
+  bool broken_{false};
+  uint64_t appended_{0};
+  uint64_t bytes_{0};
+  uint64_t base_bytes_{0};
+
+  void start(const ClientStateRecord& base);
+};
+
+// No-steal write buffer over one tree of a durable rORAM. Writes are kept, and served to
+// later reads, until rORAM has logged them and written them to the tree; reads still go to
+// the backend, so it sees the same requests as without the buffer. Pending buckets count
+// as scratch_bytes().
+class BufferedStorage : public StorageBackend {
+ public:
+  BufferedStorage(std::unique_ptr<StorageBackend> inner, const Params& params);
+  void read_buckets(int level, uint64_t start_bucket, uint64_t count, std::vector<Bucket>& out) override;
+  void write_buckets(int level, uint64_t start_bucket, const std::vector<Bucket>& buckets) override;
+  void read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) override;
+  void write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) override;
+  uint64_t bucket_byte_size() const override { return inner_->bucket_byte_size(); }
+  uint64_t get_seek_count() const override { return inner_->get_seek_count(); }
+  void set_stats(Stats* stats) override { inner_->set_stats(stats); }
+  const IoStats& io_stats() const override { return inner_->io_stats(); }
+  void reset_io_stats() override { inner_->reset_io_stats(); }
+  uint64_t scratch_bytes() const override;
+  void sync() override { inner_->sync(); }
+
+  // Copies the pending writes out, by heap index ascending. They stay pending until
+  // clear_pending(), so a failed commit loses nothing.
+  void pending(std::vector<uint64_t>& ids, std::vector<Bucket>& buckets) const;
+  void clear_pending() { pending_.clear(); }
+  bool empty() const { return pending_.empty(); }
+  StorageBackend& inner() { return *inner_; }
+  // Hands the backend back; nothing may be pending.
+  std::unique_ptr<StorageBackend> release();
+
+ private:
+  std::unique_ptr<StorageBackend> inner_;
+  Params params_;
+  std::map<uint64_t, Bucket> pending_;  // heap index -> newest write
+
+  void overlay(int level, uint64_t start_bucket, uint64_t count, Bucket* out) const;
+};
+
+// Writes buckets[k] at heap index ids[k] (ascending) in one batched request, one extent
+// per run of consecutive buckets on a level.
+void write_heap_buckets(StorageBackend& storage, const std::vector<uint64_t>& ids, const std::vector<Bucket>& buckets);
+
+}  // namespace roram
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "roram/roram.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace roram {
+
+struct FrontendOptions {
+  size_t max_batch = 8;       // ranges per rORAM::access_batch call
+  size_t max_per_client = 2;  // fairness: per-client share of one batch (0 = unlimited)
+  bool parallel_evict = true; // evict sub-ORAMs concurrently inside each batch
+};
+
+// Thread-safe front-end for one rORAM. Any number of threads submit requests tagged
+// with a client id; a single scheduler thread drains them in batches, taking clients
+// round-robin (at most max_per_client each per batch) so one busy client cannot
+// starve the rest. Requests of the same client run in submission order.
+class ORAMFrontend {
+ public:
+  using Result = std::vector<std::vector<uint8_t>>;
+
+  explicit ORAMFrontend(std::unique_ptr<rORAM> oram, FrontendOptions opts = FrontendOptions());
+  ~ORAMFrontend();  // serves everything already queued, then stops
+  ORAMFrontend(const ORAMFrontend&) = delete;
+  ORAMFrontend& operator=(const ORAMFrontend&) = delete;
+
+  // Enqueue a range request; the future yields the read data (empty for writes) or
+  // rethrows the error raised while serving it.
+  std::future<Result> submit(uint64_t client, RangeRequest req);
+  // Blocking convenience wrapper with rORAM::Access semantics.
+  Result Access(uint64_t client, uint64_t a, uint64_t r, const std::string& op,
+                const std::vector<std::vector<uint8_t>>* D = nullptr);
+  // Block until every request submitted so far has completed.
+  void drain();
+
+  const Params& params() const { return oram_->params(); }
+  uint64_t batches_served() const;
+  uint64_t requests_served() const;
+  // Direct access to the wrapped ORAM; only safe while the front-end is idle (after drain()).
+  rORAM& oram() { return *oram_; }
+
+ private:
+  struct Pending {
+    RangeRequest req;
+    std::promise<Result> done;
+  };
+
+  std::unique_ptr<rORAM> oram_;
+  FrontendOptions opts_;
+  mutable std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::map<uint64_t, std::deque<Pending>> queues_;  // per-client FIFO
+  uint64_t next_client_{0};                          // round-robin cursor
+  size_t queued_{0};
+  bool busy_{false};
+  bool stop_{false};
+  uint64_t batches_{0};
+  uint64_t served_{0};
+  std::thread worker_;
+
+  void run();
+  std::vector<Pending> take_batch();  // mu_ held
+};
+
+}  // namespace roram
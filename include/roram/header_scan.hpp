@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace roram {
+
+// Filters over block headers packed one uint64_t per block (addresses or path tags), used by
+// ReadRange, the stash merge and BatchEvict's assignment. Each kernel writes a match mask,
+// bit k of mask[k / 64] for v[k], over mask_words(n) words (bits past n are cleared), and
+// returns the number of matches. AVX2 and AVX-512 versions are compiled in on x86-64 and
+// picked at run time from CPUID; every ISA gives bit-identical masks.
+
+enum class ScanIsa { Scalar, AVX2, AVX512 };
+
+const char* scan_isa_name(ScanIsa isa);
+// "scalar" | "avx2" | "avx512"; throws std::runtime_error otherwise.
+ScanIsa parse_scan_isa(const std::string& name);
+// Widest ISA this CPU (and build) supports.
+ScanIsa best_scan_isa();
+bool scan_isa_supported(ScanIsa isa);
+// ISA the kernels dispatch to: best_scan_isa(), or RORAM_SCAN_ISA from the environment when
+// set, clamped to what is supported.
+ScanIsa scan_isa();
+// Overrides the dispatch (benchmarks, tests) and returns the ISA actually selected.
+ScanIsa set_scan_isa(ScanIsa isa);
+
+inline size_t mask_words(size_t n) { return (n + 63) / 64; }
+
+// lo <= v[k] < hi (unsigned). Dummy blocks (INVALID_ADDR) never match a range that ends
+// below it.
+size_t scan_in_range(const uint64_t* v, size_t n, uint64_t lo, uint64_t hi, uint64_t* mask);
+// (v[k] & sel) == want; with sel = 2^j - 1 this is "path tag passes bucket want of level j".
+size_t scan_masked_equal(const uint64_t* v, size_t n, uint64_t sel, uint64_t want, uint64_t* mask);
+// Index of the first v[k] == x, or n.
+size_t scan_find(const uint64_t* v, size_t n, uint64_t x);
+
+// Calls f(k) for every set bit k of the first words words of a scan mask, in increasing order.
+template <typename F>
+void for_each_match(const uint64_t* mask, size_t words, F&& f) {
+  for (size_t w = 0; w < words; ++w) {
+    for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+      f(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+  }
+}
+
+}  // namespace roram
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace roram {
+
+// HDR-style log-bucketed latency histogram (nanoseconds). Values below 128 are exact; above,
+// each power-of-two octave is split into 64 linear sub-buckets, so a recorded value is off by
+// at most 1/64 (~1.6%) while the whole 64-bit range fits in a few thousand counters. Not
+// thread-safe: one recorder, or merge per-thread histograms with operator+=.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void record(uint64_t ns, uint64_t count = 1);
+  void reset();
+  LatencyHistogram& operator+=(const LatencyHistogram& other);
+
+  uint64_t count() const { return total_; }
+  uint64_t min() const { return total_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const { return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0; }
+  // Smallest bucket upper bound covering fraction p of the samples (p in [0, 1]), clamped to
+  // max(); 0 when empty.
+  uint64_t value_at(double p) const;
+
+  // Non-empty buckets in increasing order, for percentile-distribution export.
+  struct Bucket {
+    uint64_t lo;     // smallest value mapped to this bucket
+    uint64_t hi;     // largest value mapped to this bucket
+    uint64_t count;
+  };
+  std::vector<Bucket> buckets() const;
+
+ private:
+  std::vector<uint64_t> counts_;
+  uint64_t total_{0};
+  uint64_t sum_{0};
+  uint64_t min_{0};
+  uint64_t max_{0};
+
+  static size_t index_of(uint64_t ns);
+  static uint64_t lowest_of(size_t idx);
+  static uint64_t highest_of(size_t idx);
+};
+
+}  // namespace roram
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace roram {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// How a PageBuffer asks for 2 MiB pages.
+enum class HugePages {
+  Off,          // regular 4 KiB pages
+  Transparent,  // 2 MiB-aligned mapping with madvise(MADV_HUGEPAGE); THP may or may not back it
+  Explicit,     // MAP_HUGETLB from the reserved pool (vm.nr_hugepages); falls back to Transparent
+};
+
+const char* huge_pages_name(HugePages mode);
+// "off" | "thp" | "explicit"; throws std::runtime_error otherwise.
+HugePages parse_huge_pages(const std::string& name);
+
+// Zero-filled anonymous mapping. Buffers under kHugePageSize always use regular pages.
+// Falls back one step at a time (Explicit -> Transparent -> Off) when the kernel refuses,
+// so construction only throws when no mapping can be made at all.
+class PageBuffer {
+ public:
+  PageBuffer() = default;
+  PageBuffer(size_t bytes, HugePages mode);
+  ~PageBuffer();
+  PageBuffer(PageBuffer&& other) noexcept;
+  PageBuffer& operator=(PageBuffer&& other) noexcept;
+  PageBuffer(const PageBuffer&) = delete;
+  PageBuffer& operator=(const PageBuffer&) = delete;
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  HugePages requested() const { return requested_; }
+  // What the mapping got: Explicit only when MAP_HUGETLB succeeded, Transparent when
+  // madvise was accepted (whether THP actually backs it is up to the kernel).
+  HugePages backing() const { return backing_; }
+  // Grow to at least bytes, keeping the contents (remapped under the same mode).
+  void grow(size_t bytes);
+
+ private:
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t mapped_ = 0;  // length passed to munmap
+  HugePages requested_ = HugePages::Off;
+  HugePages backing_ = HugePages::Off;
+
+  void release();
+};
+
+// Bytes of this process's anonymous memory backed by huge pages, transparent and explicit
+// (AnonHugePages + Hugetlb in /proc/self/smaps_rollup); 0 where that file is unavailable.
+uint64_t process_huge_page_bytes();
+
+// dTLB load misses and page faults of the calling thread, from perf_event_open. The dTLB
+// counter needs a hardware PMU (absent in many VMs and containers); page faults are a
+// software event and are nearly always available. Unavailable counters read as zero.
+class TlbCounters {
+ public:
+  TlbCounters();
+  ~TlbCounters();
+  TlbCounters(const TlbCounters&) = delete;
+  TlbCounters& operator=(const TlbCounters&) = delete;
+
+  void start();  // reset and enable
+  void stop();
+  bool has_dtlb() const { return dtlb_fd_ >= 0; }
+  bool has_faults() const { return fault_fd_ >= 0; }
+  uint64_t dtlb_misses() const;
+  uint64_t page_faults() const;
+
+ private:
+  int dtlb_fd_ = -1;
+  int fault_fd_ = -1;
+};
+
+}  // namespace roram
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "roram/types.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace roram {
+
+// Client RAM held by an ORAM, by where it lives. Stash bytes are estimated from block
+// counts (Block object + payload + ℓ+1 path tags per block); the buckets of in-memory
+// storage are the server's data and are not counted.
+struct MemoryUsage {
+  uint64_t position_map = 0;   // packed maps; an outsourced map counts its ORAM's client total
+  uint64_t stash_blocks = 0;   // Block objects and their path tags
+  uint64_t stash_payload = 0;  // B bytes per stashed block
+  uint64_t scratch = 0;        // buffers kept between calls (storage read scratch)
+  // Peaks only: deserialized buckets of one eviction (or path read). rORAM trees evict one
+  // at a time, so a whole-ORAM peak counts the largest tree's once; with parallel eviction
+  // every tree holds its own at the same time.
+  uint64_t evict_buffers = 0;
+  uint64_t stashed = 0;        // blocks in the stash(es); a count, not part of total()
+  std::vector<MemoryUsage> trees;  // rORAM: one entry per sub-ORAM R_i; empty otherwise
+
+  uint64_t total() const { return position_map + stash_blocks + stash_payload + scratch + evict_buffers; }
+  // Sums the byte fields and stashed, except evict_buffers, which takes the larger (the
+  // callers sum it themselves for concurrent evictions); trees are left alone.
+  MemoryUsage& operator+=(const MemoryUsage& other);
+
+  // In-memory size of one Block / one Bucket of Z blocks under params.
+  static uint64_t block_bytes(const Params& params);
+  static uint64_t bucket_bytes(const Params& params);
+  // Adds blocks stashed blocks to stash_blocks / stash_payload / stashed.
+  void add_stash(uint64_t blocks, const Params& params);
+};
+
+// Buckets BatchEvict touches for k consecutive paths of a height-h tree: sum_j min(k, 2^j).
+uint64_t eviction_buckets(uint64_t k, int h);
+
+// Projected peak client footprint before provisioning, using the same accounting as
+// peak_memory_usage(). An access of the largest range stages 2*2^ℓ blocks in every stash,
+// and BatchEvict then merges the real blocks of its k = 2*2^ℓ paths on top, taken at the
+// tree's average occupancy (eviction_buckets(k, h) * Z * N / ((2N-1) * Z)). stash_slack is
+// the blocks each stash carries between accesses; that residual depends on the workload,
+// so take it from a measured run (workload's "now" row, stashed / (ℓ+1)) when it matters.
+// Position maps larger than pm_cutoff entries (0 = never) are projected as their backing
+// PathORAM, as rORAM builds them. parallel_evict sums the trees' eviction buffers, as
+// rORAM::peak_memory_usage() does when its trees evict concurrently.
+MemoryUsage project_roram_memory(const Params& params, uint64_t pm_cutoff = 0, uint64_t stash_slack = 64,
+                                 bool parallel_evict = false);
+// Path ORAM (L = 1): one path of real blocks on top of stash_slack blocks.
+MemoryUsage project_path_oram_memory(const Params& params, uint64_t stash_slack = 64);
+
+}  // namespace roram
@@ -4,34 +4,88 @@
 #include "roram/block.hpp"
 #include "roram/storage.hpp"
 #include "roram/crypto.hpp"
+#include "roram/position_map.hpp"
+#include "roram/memory_usage.hpp"
+#include "roram/stats.hpp"
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace roram {
 
+// Recursive position map: when pm_client_budget > 0 and the packed map is larger than
+// that many bytes, the map is stored in a backing PathORAM with pm_block_size-byte blocks
+// (default B), which recurses with the same budget until its map fits on the client.
+// Each access then performs one read-modify-write per recursion level.
 class PathORAM {
  public:
   PathORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto,
            bool use_memory_storage = true, const std::string& file_path = "",
-           bool count_seeks = false);
+           bool count_seeks = false, uint64_t pm_client_budget = 0, size_t pm_block_size = 0);
+  // Tree storage from a factory (name "" for the tree, "_pm" prefixed per recursion level).
+  PathORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, const StorageFactory& storage,
+           uint64_t pm_client_budget = 0, size_t pm_block_size = 0);
   ~PathORAM() = default;
 
   std::vector<uint8_t> Access(uint64_t block_id, const std::string& op,
                               const std::vector<uint8_t>* write_data = nullptr);
+  // Accesses ids together: the union of their paths is read level by level in one batched
+  // request (shared upper buckets once) and evicted in one batched write. Returns the
+  // payloads in ids order, as Access would.
+  std::vector<std::vector<uint8_t>> AccessBatch(const std::vector<uint64_t>& ids, const std::string& op = "read",
+                                                const std::vector<std::vector<uint8_t>>* write_data = nullptr);
+  // Read-modify-write of one block in a single access: fn edits the block payload in place.
+  void Update(uint64_t block_id, const std::function<void(std::vector<uint8_t>&)>& fn);
+  // Seeks on the data tree and on every position-map level.
   uint64_t get_seek_count() const;
   uint64_t debug_position(uint64_t block_id) const;
+  uint64_t num_blocks() const { return params_.N; }
+  size_t block_size() const { return params_.B; }
+  // Number of Access/Update calls served so far.
+  uint64_t access_count() const { return accesses_; }
+  // Client-resident bytes: packed position map plus stashed blocks.
+  uint64_t client_bytes() const;
+  // Client RAM now and its peak since construction or reset_peak_memory() (largest stash
+  // plus the buckets of one path read or eviction); an outsourced map reports its ORAM's
+  // total as position_map.
+  MemoryUsage memory_usage() const;
+  MemoryUsage peak_memory_usage() const;
+  void reset_peak_memory();
+  uint64_t position_map_bytes() const { return position_map_.client_bytes(); }
+  // Position-map ORAM levels below this one (0 = map held on the client).
+  int recursion_depth() const;
+  // Oblivious accesses issued to all position-map levels.
+  uint64_t position_map_accesses() const;
+  // Per-phase time and counts since construction or reset_stats(), every position-map
+  // level included: the path read is ReadRange (level 0), stash insertion StashMerge and
+  // eviction EvictAssign + EvictWrite (see stats.hpp; zero under RORAM_NO_STATS).
+  StatsSnapshot stats() const;
+  void reset_stats();
+  // Per-level I/O of the data tree (position-map levels excluded).
+  const IoStats& io_stats() const { return storage_->io_stats(); }
+  void reset_io_stats() { storage_->reset_io_stats(); }
+  // StorageBackend::sync() on the data tree and every position-map level.
+  void sync();
 
  private:
   Params params_;
   std::unique_ptr<CryptoProvider> crypto_;
   std::unique_ptr<StorageBackend> storage_;
-  std::vector<uint64_t> position_map_;
+  PositionMap position_map_;  // per-block map (range_exp 0), bit-packed
   std::vector<Block> stash_;
+  uint64_t accesses_{0};
+  Stats stats_;
+  size_t peak_stash_{0};
+  uint64_t peak_path_buckets_{0};
 
-  void read_path_into_stash(uint64_t leaf);
-  void evict_path(uint64_t leaf);
-  static bool block_on_path(uint64_t block_leaf, uint64_t access_leaf, int level, int h);
+  std::vector<Block>::iterator stash_block(uint64_t block_id);  // created zero-filled if absent
+  std::vector<Block>::iterator fetch_block(uint64_t block_id, uint64_t& old_leaf);
+  // Buckets on the union of the paths to leaves, root first (so a live block is met before
+  // any zero-filled never-written bucket below it), contiguous runs merged.
+  std::vector<BucketExtent> path_extents(const std::vector<uint64_t>& leaves) const;
+  void read_paths_into_stash(const std::vector<BucketExtent>& extents);
+  void evict_paths(const std::vector<BucketExtent>& extents);
 };
 
 }  // namespace roram
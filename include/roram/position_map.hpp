@@ -2,22 +2,66 @@
 
 #include "roram/types.hpp"
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace roram {
 
+class PathORAM;
+
 // Position map for sub-ORAM R_i: maps range start address (multiple of 2^i) to leaf index.
-// Client-side: array of size ceil(N/2^i). Index for range_start is range_start >> i.
+// Client-side: ceil(N/2^i) entries bit-packed at ceil(log2 N) bits each (leaves are < N).
+// Index for range_start is range_start >> i. With range_exp = 0 it is a per-block map,
+// which is how PathORAM uses it.
+// Outsourced: entries are packed the same way into the blocks of a backing PathORAM, and
+// every query/update is one oblivious access to it (entries past the end included); only
+// the backing ORAM's own (much smaller) map and stash stay on the client.
 class PositionMap {
  public:
   // N = number of blocks, range_exp = i (range length 2^i)
-  PositionMap(uint64_t N, int range_exp);
+  PositionMap(uint64_t N, int range_exp, std::unique_ptr<PathORAM> backing = nullptr);
+  ~PositionMap();
+  PositionMap(PositionMap&&) noexcept;
+  PositionMap& operator=(PositionMap&&) noexcept;
+
   uint64_t query(uint64_t range_start) const;
   void update(uint64_t range_start, uint64_t leaf_index);
+  // update() returning the previous leaf: a single backing access when outsourced.
+  uint64_t exchange(uint64_t range_start, uint64_t leaf_index);
+  // Sets every entry, in index order, to next_leaf(); one backing access per block.
+  void fill(const std::function<uint64_t()>& next_leaf);
+  // One backing access the server cannot tell from a query(); nothing when client-side.
+  // Pads lookups whose number would depend on the data to a fixed count.
+  void dummy_access() const;
+
+  uint64_t num_entries() const { return num_entries_; }
+  int bits_per_entry() const { return width_; }
+  bool outsourced() const { return backing_ != nullptr; }
+  // Bytes this map keeps on the client (includes the backing ORAM's client state).
+  uint64_t client_bytes() const;
+  // Oblivious accesses issued to the backing ORAM (0 when client-side).
+  uint64_t backing_accesses() const;
+  uint64_t backing_seek_count() const;
+  const PathORAM* backing() const { return backing_.get(); }
+  PathORAM* backing() { return backing_.get(); }
+  // Client-side maps only: the packed entries, for rORAM's durability snapshots, and
+  // their restore (words must be a packed() of a map of the same shape).
+  const std::vector<uint64_t>& packed() const;
+  void load_packed(const std::vector<uint64_t>& words);
+
+  // Blocks a backing ORAM with block size B needs to hold ceil(N/2^range_exp) packed entries.
+  static uint64_t backing_blocks(uint64_t N, int range_exp, size_t B);
+  // Client bytes of the packed map when kept client-side.
+  static uint64_t packed_bytes(uint64_t N, int range_exp);
 
  private:
   int range_exp_;
-  std::vector<uint64_t> positions_;
+  int width_;  // bits per entry
+  uint64_t num_entries_;
+  std::vector<uint64_t> words_;  // packed entries (client-side only)
+  std::unique_ptr<PathORAM> backing_;
+  uint64_t entries_per_block_{0};
 };
 
 }  // namespace roram
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "roram/roram.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace roram {
+
+struct ReadAheadOptions {
+  size_t depth = 2;             // ranges fetched ahead of a stream's next address
+  uint64_t trigger = 2;         // back-to-back reads before a stream is prefetched
+  size_t max_streams = 4;       // streams tracked at once (least recently used dropped)
+  uint64_t max_buffer_blocks = 0;  // blocks buffered or in flight over all streams (0 = depth * L * max_streams)
+};
+
+// Counters since construction or reset_stats().
+struct ReadAheadStats {
+  uint64_t reads = 0;
+  uint64_t writes = 0;
+  uint64_t hit_blocks = 0;   // read blocks served from prefetched ranges
+  uint64_t miss_blocks = 0;  // read blocks fetched on demand
+  uint64_t prefetches = 0;   // speculative accesses issued
+  uint64_t wasted = 0;       // prefetched ranges dropped before any block was served (including ones cancelled before they ran)
+  uint64_t failed = 0;       // prefetches that threw; the reads needing them went on demand
+  uint64_t peak_buffered = 0;  // most blocks held or in flight at once, over all streams
+};
+
+// Speculative sequential read-ahead over an rORAM. A read that starts where an earlier
+// read ended continues that stream; once a stream has trigger reads, the next depth
+// ranges (each as long as its last read, capped by L and N) are read by a background
+// thread while the caller consumes the current one, and later reads are served from
+// that bounded buffer, falling back to a normal Access for any part not buffered. A
+// prefetch that failed is dropped when a read reaches it and that part is read on
+// demand, so its error surfaces only if the on-demand Access fails too.
+//
+// Every prefetch is an ordinary rORAM::Access of a range of size up to L, so each
+// physical access stays oblivious; what read-ahead adds is accesses whose count and
+// timing follow the client's sequential pattern, including wasted ones when a stream
+// stops. A write drops every buffered or in-flight range it overlaps before it runs, so
+// reads through this layer always see it. Accesses made directly on the rORAM bypass
+// the buffer and may be shadowed by it. Not thread-safe: one caller at a time. The
+// rORAM must outlive this object.
+class ReadAheadORAM {
+ public:
+  using Result = std::vector<std::vector<uint8_t>>;
+
+  explicit ReadAheadORAM(rORAM& oram, ReadAheadOptions opts = ReadAheadOptions());
+  ~ReadAheadORAM();  // cancels queued prefetches and waits for the running one
+  ReadAheadORAM(const ReadAheadORAM&) = delete;
+  ReadAheadORAM& operator=(const ReadAheadORAM&) = delete;
+
+  // rORAM::Access semantics.
+  Result Access(uint64_t a, uint64_t r, const std::string& op, const std::vector<std::vector<uint8_t>>* D = nullptr);
+  // Block until no prefetch is queued or running.
+  void drain();
+
+  const ReadAheadStats& stats() const { return stats_; }
+  void reset_stats() { stats_ = ReadAheadStats(); }
+  // Blocks held or in flight right now, over all streams.
+  uint64_t buffered_blocks() const;
+
+ private:
+  struct Job {
+    uint64_t a;
+    uint64_t r;
+    std::promise<Result> done;
+    bool cancelled = false;  // guarded by mu_
+  };
+  struct Chunk {
+    uint64_t start;
+    uint64_t end;
+    std::shared_ptr<Job> job;
+    std::shared_future<Result> data;
+    bool used = false;
+  };
+  struct Stream {
+    uint64_t next;      // address right after the last read
+    uint64_t last_r;    // length of the last read
+    uint64_t run = 0;   // reads continuing this stream
+    uint64_t last_use = 0;
+    std::deque<Chunk> chunks;  // ascending, contiguous from the first chunk's start
+  };
+
+  rORAM& oram_;
+  ReadAheadOptions opts_;
+  ReadAheadStats stats_;
+  std::vector<Stream> streams_;
+  uint64_t clock_ = 0;
+
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::shared_ptr<Job>> queue_;
+  bool running_ = false;
+  bool stop_ = false;
+  std::thread worker_;
+
+  void run();
+  Stream& stream_for(uint64_t a);
+  void drop(Chunk& c);
+  void drop_overlapping(uint64_t a, uint64_t end);
+  void top_up(Stream& s);
+};
+
+}  // namespace roram
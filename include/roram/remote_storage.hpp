@@ -0,0 +1,104 @@
+#pragma once
+
+#include "roram/storage.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace roram {
+
+// Wire protocol, little-endian, one request in flight per connection:
+//   request  = u8 op, u64 payload_len, payload
+//   response = u8 status (0 = ok), u64 payload_len, payload (error text if status != 0)
+//   OPEN  : u16 name_len, name, u64 N, u64 L, u32 Z, u64 B, u32 tag_size -> empty
+//   READ  : u32 n, n x (u32 level, u64 start, u64 count)                 -> bucket bytes
+//   WRITE : u32 n, n x (u32 level, u64 start, u64 count), bucket bytes   -> empty
+//           (pipelined: the client collects the reply before its next request)
+//   SEEKS : empty                                                        -> u64 seek count
+//   SYNC  : empty                                                        -> empty, once the
+//           server's file is fdatasync'ed
+// Buckets travel sealed (serialized + encrypted by the client), so the server only
+// ever sees ciphertext. A READ/WRITE carries a whole path batch. A READ is one round
+// trip; a WRITE is not waited for. The server rejects a frame larger than the biggest
+// batch its tree allows (whole tree plus extent list) with an error and closes.
+enum class StorageOp : uint8_t { Open = 1, Read = 2, Write = 3, Seeks = 4, Sync = 5 };
+
+// Addresses are "unix:<socket path>" or "tcp:<host>:<port>".
+int connect_storage_address(const std::string& address);
+
+// Client backend for one tree stored on a StorageServer (server file <dir>/<name>).
+class RemoteStorage : public StorageBackend {
+ public:
+  // rtt_us: injected delay before every READ (and SYNC) round trip, to model a remote server.
+  RemoteStorage(const Params& params, const std::string& address, const std::string& name,
+                CryptoProvider* crypto = nullptr, uint64_t rtt_us = 0);
+  ~RemoteStorage();
+  RemoteStorage(const RemoteStorage&) = delete;
+  RemoteStorage& operator=(const RemoteStorage&) = delete;
+
+  void read_buckets(int level, uint64_t start_bucket, uint64_t count,
+                    std::vector<Bucket>& out) override;
+  void write_buckets(int level, uint64_t start_bucket,
+                     const std::vector<Bucket>& buckets) override;
+  void read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) override;
+  void write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) override;
+  uint64_t bucket_byte_size() const override { return bucket_storage_size_; }
+  // Seeks counted by the server's FileStorage (one extra, undelayed round trip).
+  uint64_t get_seek_count() const override;
+  // SYNC round trip, delayed by rtt_us like READ but not counted in round_trips(). Also
+  // surfaces an error from any earlier WRITE.
+  void sync() override;
+  // READ and WRITE requests issued so far (only READs are waited for).
+  uint64_t round_trips() const { return round_trips_; }
+
+ private:
+  Params params_;
+  uint64_t bucket_plain_size_;
+  uint64_t bucket_storage_size_;
+  CryptoProvider* crypto_;
+  uint64_t rtt_us_;
+  int fd_;
+  uint64_t round_trips_{0};
+  mutable uint64_t pending_writes_{0};  // WRITE replies not yet collected
+
+  // Sends op after collecting pending WRITE replies; returns the reply payload, which may
+  // be at most max(max_reply, a small frame) bytes.
+  std::vector<uint8_t> call(StorageOp op, const std::vector<uint8_t>& payload, uint64_t max_reply = 0) const;
+  std::vector<uint8_t> await_reply(uint64_t max_len) const;
+  void drain_writes() const;
+};
+
+// Serves tree files to RemoteStorage clients: one (detached) thread per connection,
+// each connection bound by OPEN to a FileStorage::opaque at <dir>/<name>.
+class StorageServer {
+ public:
+  StorageServer(const std::string& address, const std::string& dir, bool count_seeks = true);
+  ~StorageServer();  // stop()
+  StorageServer(const StorageServer&) = delete;
+  StorageServer& operator=(const StorageServer&) = delete;
+
+  void start();  // accept loop on a background thread
+  void serve();  // accept loop on the calling thread, until stop()
+  void stop();   // close the listener and all connections, wait for their threads
+  uint64_t requests_served() const { return requests_; }
+
+ private:
+  std::string address_;
+  std::string dir_;
+  bool count_seeks_;
+  int listen_fd_;
+  std::atomic<bool> stop_{false};
+  std::atomic<uint64_t> requests_{0};
+  std::thread acceptor_;
+  std::mutex mu_;
+  std::condition_variable idle_cv_;
+  std::vector<int> conn_fds_;  // open connections; a handler closes and removes its own
+
+  void handle(int fd);
+};
+
+}  // namespace roram
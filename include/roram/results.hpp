@@ -0,0 +1,51 @@
+#pragma once
+
+#include "roram/types.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace roram {
+
+// Machine-readable benchmark results shared by `compare` and `workload` (--json) and read
+// back by `diff`. Schema "roram-results/1":
+//   { "schema", "command", "git_rev", "backend", "crypto",
+//     "config": { flag: value, ... },
+//     "results": [ { "scheme", "case", "params": {N, L, Z, B, ell, h},
+//                    "metrics": { name: number, ... }, "samples_ms": [ ... ] }, ... ] }
+// A result is keyed by (scheme, case), e.g. ("rORAM", "r=64") or ("PathORAM", "fileserver").
+// samples_ms holds the per-trial or per-query latencies the metrics were computed from and is
+// empty for derived rows (closed-loop, open-loop), which only carry metrics.
+struct ResultRecord {
+  std::string scheme;
+  std::string label;
+  Params params;
+  std::vector<std::pair<std::string, double>> metrics;  // insertion order is kept
+  std::vector<double> samples_ms;
+
+  ResultRecord(std::string scheme_, std::string label_, const Params& params_)
+      : scheme(std::move(scheme_)), label(std::move(label_)), params(params_) {}
+  // Metric value, or nullptr when absent.
+  const double* metric(const std::string& name) const;
+};
+
+struct ResultSet {
+  std::string command;
+  std::string git_rev;
+  std::string backend;  // "memory", "file", "remote:<addr>"
+  std::string crypto;
+  std::vector<std::pair<std::string, std::string>> config;
+  std::vector<ResultRecord> results;
+
+  const ResultRecord* find(const std::string& scheme, const std::string& label) const;
+};
+
+// Revision the library was built from (RORAM_GIT_REV at build time; "unknown" without git).
+// The environment variable RORAM_GIT_REV, when set, overrides it at run time.
+std::string git_revision();
+
+void write_results_json(const std::string& path, const ResultSet& results);
+// Throws std::runtime_error on I/O errors, malformed JSON or a different schema.
+ResultSet read_results_json(const std::string& path);
+
+}  // namespace roram
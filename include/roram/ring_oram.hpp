@@ -0,0 +1,82 @@
+#pragma once
+
+#include "roram/types.hpp"
+#include "roram/block.hpp"
+#include "roram/storage.hpp"
+#include "roram/crypto.hpp"
+#include "roram/position_map.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace roram {
+
+struct RingOptions {
+  int S = 6;  // reserved dummy slots per bucket; a bucket is reshuffled after S reads
+  int A = 3;  // one EvictPath every A accesses
+};
+
+// Ring ORAM baseline (Ren et al., USENIX Security 2015), L=1. Buckets have Z real +
+// S dummy slots in random order over a tree of ~N/Z leaves; an access reads a single
+// slot per bucket on the path (the block, or an unread dummy), so online bandwidth is
+// tree_height()+1 blocks. Every A
+// accesses the next path in reverse-lexicographic order is evicted (with leaf % 2^j
+// bucket indexing that is simply consecutive leaves), and buckets read S times are
+// reshuffled early.
+//
+// Slot s of every bucket lives in its own StorageBackend (one block per "bucket"),
+// so a slot is read or written individually. Bucket metadata (slot -> address,
+// valid bits, read counts) is held client-side; the paper keeps it encrypted next to
+// each bucket, which costs one small extra read per bucket and is not modelled here.
+class RingORAM {
+ public:
+  RingORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, RingOptions opts = RingOptions(),
+           bool use_memory_storage = true, const std::string& file_path = "", bool count_seeks = false);
+  // Slot storages from a factory, named "_slot<s>".
+  RingORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, RingOptions opts,
+           const StorageFactory& storage);
+
+  std::vector<uint8_t> Access(uint64_t block_id, const std::string& op,
+                              const std::vector<uint8_t>* write_data = nullptr);
+  uint64_t get_seek_count() const;
+  const RingOptions& options() const { return opts_; }
+  int tree_height() const { return h_; }
+  // Blocks moved to/from storage: online (ReadPath) and in total (plus evictions, reshuffles).
+  uint64_t online_blocks() const { return online_blocks_; }
+  uint64_t total_blocks() const { return total_blocks_; }
+  uint64_t evictions() const { return evictions_; }
+  uint64_t early_reshuffles() const { return reshuffles_; }
+  size_t stash_size() const { return stash_.size(); }
+  // Client-resident bytes: position map, stash and bucket metadata.
+  uint64_t client_bytes() const;
+
+ private:
+  Params params_;
+  RingOptions opts_;
+  std::unique_ptr<CryptoProvider> crypto_;
+  int h_;               // tree height: ~N/Z leaves
+  Params slot_params_;  // 2^h_ leaves, one block per bucket
+  std::vector<std::unique_ptr<StorageBackend>> slots_;  // Z + S
+  PositionMap position_map_;
+  std::vector<Block> stash_;
+  std::vector<uint64_t> slot_addr_;  // per (bucket, slot): block address, INVALID_ADDR = dummy
+  std::vector<uint8_t> slot_valid_;  // slot not read since the bucket was last written
+  std::vector<uint32_t> reads_;      // per bucket: slots read since last written
+  uint64_t round_{0};
+  uint64_t evict_next_{0};
+  uint64_t online_blocks_{0};
+  uint64_t total_blocks_{0};
+  uint64_t evictions_{0};
+  uint64_t reshuffles_{0};
+
+  int slots_per_bucket() const { return params_.Z + opts_.S; }
+  static size_t bucket_id(int level, uint64_t b) { return static_cast<size_t>(((1ULL << level) - 1) + b); }
+  Block read_slot(int level, uint64_t b, int s);
+  void read_path(uint64_t leaf, uint64_t block_id);
+  void read_bucket_into_stash(int level, uint64_t b);  // reals, padded to Z slots with dummies
+  void write_bucket(int level, uint64_t b);  // up to Z stash blocks, freshly permuted
+  void evict_path();
+  void early_reshuffle(uint64_t leaf);
+};
+
+}  // namespace roram
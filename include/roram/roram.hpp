@@ -5,24 +5,118 @@
 #include "roram/storage.hpp"
 #include "roram/sub_oram.hpp"
 #include "roram/crypto.hpp"
+#include "roram/memory_usage.hpp"
+#include "roram/durability.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <string>
 
 namespace roram {
 
+// One range of an access_batch. op is "read" or "write"; for writes, data holds r blocks.
+struct RangeRequest {
+  uint64_t a;
+  uint64_t r;
+  std::string op;
+  std::vector<std::vector<uint8_t>> data;
+};
+
 class rORAM {
  public:
+  // pm_cutoff: position maps with more than pm_cutoff entries are outsourced to a
+  // PathORAM (same storage kind and crypto as the trees); 0 keeps every map client-side.
   rORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto,
         bool use_memory_storage = true, const std::string& file_path = "",
-        bool count_seeks = false);
-  ~rORAM() = default;
+        bool count_seeks = false, uint64_t pm_cutoff = 0);
+  // Tree storage from a factory: called with name "_tree<i>" for R_i and, for an
+  // outsourced position map, "_pm<i>" (its PathORAM's tree).
+  rORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, const StorageFactory& storage,
+        uint64_t pm_cutoff = 0);
+  ~rORAM();  // drains background eviction, if enabled, then commits what is pending
 
   // Access range [a, a+r): op is "read" or "write". For write, D provides new data for [a, a+r).
   // Returns read data when op is read (size r blocks).
   std::vector<std::vector<uint8_t>> Access(uint64_t a, uint64_t r, const std::string& op,
                                            const std::vector<std::vector<uint8_t>>* D = nullptr);
+  const Params& params() const { return params_; }
+  // Evict the ℓ+1 sub-ORAMs concurrently (one thread per tree). Ignored while any
+  // position map is outsourced, since those ORAMs share the crypto RNG.
+  void set_parallel_evict(bool on) { parallel_evict_ = on; }
+  // Serve several ranges with one eviction pass per sub-ORAM: every ReadRange (and write)
+  // is applied in order, then each tree runs a single BatchEvict over the summed path
+  // budget. Returns one result per request (empty for writes).
+  std::vector<std::vector<std::vector<uint8_t>>> access_batch(const std::vector<RangeRequest>& reqs);
+
+  using ScanCallback = std::function<void(uint64_t addr, const std::vector<uint8_t>& data)>;
+  // Stream [a, a+r) of any length to deliver, block by block in address order. Each
+  // chunk is one access of range size 2^ℓ and delivers the whole window that access
+  // reads (up to 2^(ℓ+1) blocks). The next chunk is fetched while deliver consumes the
+  // current one, and with background eviction also while the previous chunk is evicted.
+  // At most two chunks are held at once. Returns the number of accesses issued.
+  uint64_t scan(uint64_t a, uint64_t r, const ScanCallback& deliver);
+
+  // Deamortized mode: Access/access_batch return once the ranges are read and staged;
+  // their eviction debt is drained in cnt_ order by a background thread. The evictor
+  // holds the ORAM lock for one sub-ORAM's whole BatchEvict (read, merge and write-back)
+  // and drops it between sub-ORAMs, so a read phase waits for at most the tree being
+  // evicted, not for the whole access's eviction. New accesses block while any stash
+  // holds more than stash_limit blocks and debt is outstanding (back-pressure).
+  void enable_background_eviction(size_t stash_limit);
+  // Block until all outstanding eviction debt has been paid.
+  void drain_evictions();
+  // Largest sub-ORAM stash, in blocks.
+  size_t max_stash_size() const;
+  // Sub-ORAMs running a compile-time specialized core (see basic_sub_oram.hpp).
+  int specialized_trees() const;
+
+  // Crash safety (see durability.hpp). wal_path is the client-state log, required unless
+  // mode is None; group_size is the Group commit interval in accesses. Accesses still
+  // pending under the previous mode are committed first. Turning a mode on syncs the
+  // trees as they stand and starts the log afresh with a snapshot of the client state.
+  // Needs client-side position maps and the dynamic core (file or remote trees).
+  void set_durability(Durability mode, const std::string& wal_path = "", uint64_t group_size = 8);
+  Durability durability() const;
+  // Rebuild the state of the newest intact commit in wal_path after a crash, on a freshly
+  // constructed rORAM over the same trees (same Params, storage names and crypto keys):
+  // position maps, stashes and counters come from the log, and the commit's bucket
+  // writes are written to the trees again. Continues in mode (not None) with the log
+  // restarted from a snapshot. Returns the seq of the commit recovered.
+  uint64_t recover(const std::string& wal_path, Durability mode = Durability::Access, uint64_t group_size = 8);
+  // Make every access so far durable: append and sync its client-state record, then
+  // write the buffered buckets to the trees and sync them (concurrently when parallel
+  // eviction is on). Waits for outstanding background eviction first; a no-op when
+  // nothing is pending or the mode is None.
+  void commit();
+  // Client-state records appended since set_durability or recover started the log,
+  // its base snapshot included.
+  uint64_t commits() const;
+
+  // Includes seeks issued by outsourced position-map ORAMs.
   uint64_t get_seek_count() const;
+  // Client bytes held by all sub-ORAM position maps (outsourced maps count their ORAM client state).
+  uint64_t position_map_client_bytes() const;
+  // Oblivious accesses issued to outsourced position-map ORAMs.
+  uint64_t position_map_accesses() const;
+  // Per-phase time and counts since construction or reset_stats(), including the
+  // outsourced position-map ORAMs (see stats.hpp; zero under RORAM_NO_STATS).
+  StatsSnapshot stats() const;
+  void reset_stats();
+  // Per-level I/O of the ℓ+1 data trees, summed level by level (position-map ORAMs excluded).
+  IoStats io_stats() const;
+  void reset_io_stats();
+  // Client RAM now, split per sub-ORAM in trees (see memory_usage.hpp).
+  MemoryUsage memory_usage() const;
+  // Upper bound on the peak since construction or reset_peak_memory(): every tree at its
+  // own largest stash, as if all peaked together, plus the largest single eviction, or
+  // every tree's largest when they evict in parallel.
+  MemoryUsage peak_memory_usage() const;
+  void reset_peak_memory();
 
  private:
   Params params_;
@@ -30,6 +124,54 @@ class rORAM {
   std::vector<std::unique_ptr<StorageBackend>> storages_;
   std::vector<std::unique_ptr<SubORAM>> sub_orams_;
   uint64_t cnt_{0};  // global eviction counter
+  uint64_t version_{0};  // stamped on every block an Access touches
+  bool parallel_evict_{false};
+  bool pm_outsourced_{false};
+  Durability durability_{Durability::None};
+  uint64_t group_size_{8};
+  uint64_t uncommitted_{0};  // accesses evicted since the last commit
+  uint64_t seq_{0};          // last commit logged
+  std::unique_ptr<ClientStateLog> wal_;
+  std::vector<BufferedStorage*> buffers_;            // storages_ while durable, else empty
+  std::vector<std::vector<uint64_t>> pm_dirty_;      // per tree: map entries remapped since the last commit
+  Stats stats_;  // shared by every sub-ORAM and tree storage
+
+  // Guards all ORAM state against the background evictor.
+  mutable std::mutex mu_;
+  std::condition_variable debt_cv_;   // evictor: debt available / stop
+  std::condition_variable space_cv_;  // clients: debt paid (stash shrank)
+  std::deque<std::pair<uint64_t, uint64_t>> debt_;  // (k, cnt) per staged access
+  bool background_{false};
+  bool stop_{false};
+  size_t stash_limit_{0};
+  std::thread evictor_;
+
+  void check_range(uint64_t a, uint64_t r) const;
+  // Read phase of Access: fetch, retag, apply writes and stage blocks in every stash.
+  // Returns the eviction budget (paths per sub-ORAM) this range owes.
+  uint64_t read_and_stage(uint64_t a, uint64_t r, const std::string& op,
+                          const std::vector<std::vector<uint8_t>>* D,
+                          std::vector<std::vector<uint8_t>>& out);
+  // BatchEvict k paths on every sub-ORAM starting at cnt_, then advance cnt_.
+  // In background mode the debt is queued for the evictor instead.
+  void evict_all(uint64_t k);
+  void wait_for_stash_space(std::unique_lock<std::mutex>& lk);  // mu_ held
+  // Count accesses toward the next commit and commit when the mode asks for it.
+  void after_accesses(std::unique_lock<std::mutex>& lk, uint64_t accesses);
+  void commit_locked(std::unique_lock<std::mutex>& lk);
+  // Durable-mode plumbing (mu_ held): the preconditions, wrapping storages_ in
+  // BufferedStorage (and back), syncing every tree, and a snapshot record of seq_.
+  void check_durable() const;
+  void buffer_trees();
+  void unbuffer_trees();
+  void sync_trees();
+  ClientStateRecord snapshot_record() const;
+  size_t max_stash_size_locked() const;
+  // Whether evict_all runs the trees' BatchEvicts concurrently (set_parallel_evict and
+  // nothing ruling it out).
+  bool evicts_in_parallel() const { return parallel_evict_ && !pm_outsourced_ && !background_ && params_.ell > 0; }
+  MemoryUsage memory_usage_locked(bool peak) const;
+  void run_evictor();
 };
 
 }  // namespace roram
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "roram/frontend.hpp"
+#include "roram/roram.hpp"
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace roram {
+
+// Address-space sharding: [0, N) is cut into K contiguous shards, each an independent
+// rORAM (own trees, storage files and crypto) behind its own ORAMFrontend worker thread.
+// Shard length is a multiple of L, so a range of at most L blocks touches at most two
+// shards; such a range is split and the pieces run concurrently on both shards.
+class ShardedRORAM {
+ public:
+  using Result = ORAMFrontend::Result;
+  using CryptoFactory = std::function<std::unique_ptr<CryptoProvider>(int shard)>;
+
+  // file_path: per-shard files are file_path + "_shard<k>" (+ the usual rORAM suffixes).
+  ShardedRORAM(const Params& params, int shards, const CryptoFactory& crypto_factory,
+               bool use_memory_storage = true, const std::string& file_path = "",
+               bool count_seeks = false, FrontendOptions opts = FrontendOptions());
+
+  // Asynchronous range access; pieces on different shards proceed in parallel.
+  // Requests from the same client are served in submission order on every shard.
+  std::future<Result> submit(uint64_t client, RangeRequest req);
+  Result Access(uint64_t a, uint64_t r, const std::string& op,
+                const std::vector<std::vector<uint8_t>>* D = nullptr);
+  void drain();
+
+  int num_shards() const { return static_cast<int>(shards_.size()); }
+  uint64_t shard_length() const { return shard_len_; }
+  int shard_of(uint64_t addr) const { return static_cast<int>(addr / shard_len_); }
+  const Params& params() const { return params_; }
+  // Sum over shards; call after drain() for a stable value.
+  uint64_t get_seek_count();
+
+ private:
+  Params params_;
+  uint64_t shard_len_;
+  std::vector<std::unique_ptr<ORAMFrontend>> shards_;
+};
+
+}  // namespace roram
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace roram {
+
+// Per-phase latency breakdown. Counters are relaxed atomics (evictions may run on other
+// threads) and a phase is only timed when a Stats sink is attached, so an unobserved
+// backend pays one null check. Build with RORAM_NO_STATS to compile all timing out.
+//
+// Phases nest: Serialize, Encrypt, Decrypt and RawIO are measured inside the storage
+// calls made by ReadRange, EvictRead and EvictWrite, so rows do not sum to the total.
+enum class Phase {
+  ReadRange,    // SubORAM::ReadRange / PathORAM path read (also split per sub-ORAM)
+  StashMerge,   // tree buckets and staged blocks merged into stashes
+  PathTags,     // rORAM: path tags recomputed for every sub-ORAM of a fetched range
+  EvictRead,    // BatchEvict read of the k evicted paths
+  EvictAssign,  // assigning stash blocks to buckets
+  EvictWrite,   // writing the evicted paths back
+  Serialize,    // Bucket serialize/deserialize
+  Encrypt,
+  Decrypt,
+  RawIO,        // memcpy / pread / pwrite / remote round trip
+  Sync,         // fdatasync of tree files and the client-state log (durability modes)
+  Count
+};
+
+constexpr int kNumPhases = static_cast<int>(Phase::Count);
+constexpr int kMaxStatsLevels = 64;  // ReadRange split by sub-ORAM index (range 2^i)
+
+const char* phase_name(Phase p);
+
+struct PhaseTotals {
+  uint64_t count = 0;
+  uint64_t ns = 0;
+};
+
+struct StatsSnapshot {
+  std::array<PhaseTotals, kNumPhases> phases{};
+  // ReadRange per sub-ORAM index, trailing empty levels dropped (PathORAM uses level 0).
+  std::vector<PhaseTotals> read_range_levels;
+
+  const PhaseTotals& operator[](Phase p) const { return phases[static_cast<size_t>(p)]; }
+  StatsSnapshot& operator+=(const StatsSnapshot& other);
+};
+
+#ifndef RORAM_NO_STATS
+
+class Stats {
+ public:
+  Stats() { reset(); }
+  Stats(const Stats&) = delete;
+  Stats& operator=(const Stats&) = delete;
+
+  void add(Phase p, uint64_t ns, uint64_t count = 1) {
+    count_[static_cast<size_t>(p)].fetch_add(count, std::memory_order_relaxed);
+    ns_[static_cast<size_t>(p)].fetch_add(ns, std::memory_order_relaxed);
+  }
+  void add_level(int level, uint64_t ns, uint64_t count = 1) {
+    if (level < 0 || level >= kMaxStatsLevels) return;
+    level_count_[static_cast<size_t>(level)].fetch_add(count, std::memory_order_relaxed);
+    level_ns_[static_cast<size_t>(level)].fetch_add(ns, std::memory_order_relaxed);
+  }
+  StatsSnapshot snapshot() const;
+  void reset();
+
+  static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumPhases> count_;
+  std::array<std::atomic<uint64_t>, kNumPhases> ns_;
+  std::array<std::atomic<uint64_t>, kMaxStatsLevels> level_count_;
+  std::array<std::atomic<uint64_t>, kMaxStatsLevels> level_ns_;
+};
+
+// Times its scope into stats (no-op when stats is null) as one op, or as set_count ops
+// for a pass over several buckets; level >= 0 also records the time under that ReadRange
+// level.
+class ScopedPhase {
+ public:
+  ScopedPhase(Stats* stats, Phase phase, int level = -1)
+      : stats_(stats), phase_(phase), level_(level), start_(stats ? Stats::now_ns() : 0) {}
+  ~ScopedPhase() {
+    if (!stats_) return;
+    const uint64_t ns = Stats::now_ns() - start_;
+    stats_->add(phase_, ns, count_);
+    if (level_ >= 0) stats_->add_level(level_, ns, count_);
+  }
+  ScopedPhase(const ScopedPhase&) = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+  void set_count(uint64_t count) { count_ = count; }
+
+ private:
+  Stats* stats_;
+  Phase phase_;
+  int level_;
+  uint64_t start_;
+  uint64_t count_{1};
+};
+
+#else  // RORAM_NO_STATS
+
+class Stats {
+ public:
+  void add(Phase, uint64_t, uint64_t = 1) {}
+  void add_level(int, uint64_t, uint64_t = 1) {}
+  StatsSnapshot snapshot() const { return StatsSnapshot(); }
+  void reset() {}
+};
+
+class ScopedPhase {
+ public:
+  ScopedPhase(Stats*, Phase, int = -1) {}
+  void set_count(uint64_t) {}
+};
+
+#endif  // RORAM_NO_STATS
+
+}  // namespace roram
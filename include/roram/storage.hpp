@@ -3,12 +3,48 @@
 #include "roram/types.hpp"
 #include "roram/block.hpp"
 #include "roram/crypto.hpp"
+#include "roram/stats.hpp"
+#include "roram/huge_pages.hpp"
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace roram {
 
+// A run of count consecutive buckets on one level.
+struct BucketExtent {
+  int level;
+  uint64_t start;
+  uint64_t count;
+};
+
+// I/O counters of one tree level. Bytes are stored bytes (auth tags included). A seek is a
+// request that does not start where the previous one (on any level) ended; its distance
+// is the number of bytes jumped. max_run_buckets is the longest run of back-to-back
+// sequential requests that ended on this level.
+struct LevelIoStats {
+  uint64_t read_requests = 0;
+  uint64_t write_requests = 0;
+  uint64_t buckets_read = 0;
+  uint64_t buckets_written = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t seeks = 0;
+  uint64_t seek_distance = 0;
+  uint64_t max_run_buckets = 0;
+
+  LevelIoStats& operator+=(const LevelIoStats& other);  // sums; max_run_buckets takes the max
+};
+
+// Per-level I/O of one backend (or, summed, of several trees of the same height).
+struct IoStats {
+  std::vector<LevelIoStats> levels;  // index = tree level
+
+  LevelIoStats total() const;
+  IoStats& operator+=(const IoStats& other);
+};
+
 // Abstract storage: read/write buckets by (level, bucket_index). Level j has 2^j buckets.
 class StorageBackend {
  public:
@@ -17,21 +53,75 @@ class StorageBackend {
                             std::vector<Bucket>& out) = 0;
   virtual void write_buckets(int level, uint64_t start_bucket,
                              const std::vector<Bucket>& buckets) = 0;
+  // Batched form used by the ORAMs for whole paths: out (resp. buckets) is the
+  // concatenation of all extents in order. The default issues one call per extent;
+  // RemoteStorage sends the whole batch in a single round trip.
+  virtual void read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out);
+  virtual void write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets);
   virtual uint64_t bucket_byte_size() const = 0;
   // Optional: increment seek count when read/write is non-sequential
   virtual uint64_t get_seek_count() const { return 0; }
+  // Sink for the Serialize/Encrypt/Decrypt/RawIO phases (null: not timed).
+  virtual void set_stats(Stats* stats) { stats_ = stats; }
+  // Requests, buckets, bytes and seeks by level since construction or reset_io_stats().
+  // Local backends count their own layout; RemoteStorage counts the layout it requests.
+  // Decorators (TracingStorage) forward these three to the wrapped backend.
+  virtual const IoStats& io_stats() const { return io_; }
+  virtual void reset_io_stats();
+  // Client buffers kept between calls (MemoryStorage's read scratch); see MemoryUsage.
+  virtual uint64_t scratch_bytes() const { return 0; }
+  // Make every completed write durable (FileStorage: fdatasync; RemoteStorage: on the
+  // server). A no-op for MemoryStorage. Timed as Phase::Sync.
+  virtual void sync() {}
+
+ protected:
+  Stats* stats_ = nullptr;
+  // Record one request of count buckets starting at byte off of the backend's linear
+  // layout (levels stored root first). Returns true when it was a seek.
+  bool account_io(int level, bool write, uint64_t off, uint64_t count);
+
+ private:
+  IoStats io_;
+  uint64_t last_end_ = UINT64_MAX;  // byte after the previous request
+  uint64_t run_buckets_ = 0;        // buckets in the current sequential run
 };
 
-// In-memory storage: one contiguous buffer per level; optionally counts seeks (non-sequential access)
+// Creates the backend of one tree. name tells apart the trees of one ORAM
+// ("" for PathORAM, "_tree<i>" / "_pm<i>" for rORAM) and is appended to file paths.
+using StorageFactory = std::function<std::unique_ptr<StorageBackend>(
+    const Params& params, const std::string& name, CryptoProvider* crypto)>;
+
+// MemoryStorage (its arenas mapped per huge_pages), or FileStorage at path_prefix + name.
+StorageFactory local_storage_factory(bool use_memory_storage, const std::string& path_prefix,
+                                     bool count_seeks = false, HugePages huge_pages = HugePages::Off);
+
+// In-memory storage: every level in one contiguous arena, root first, so a deep level
+// spanning gigabytes can be backed by 2 MiB pages (huge_pages) and random paths take far
+// fewer TLB misses; the read scratch is mapped the same way. Counts seeks.
 class MemoryStorage : public StorageBackend {
  public:
-  MemoryStorage(const Params& params, CryptoProvider* crypto = nullptr);
+  MemoryStorage(const Params& params, CryptoProvider* crypto = nullptr, HugePages huge_pages = HugePages::Off);
   void read_buckets(int level, uint64_t start_bucket, uint64_t count,
                     std::vector<Bucket>& out) override;
   void write_buckets(int level, uint64_t start_bucket,
                     const std::vector<Bucket>& buckets) override;
   uint64_t bucket_byte_size() const override { return bucket_storage_size_; }
-  uint64_t get_seek_count() const override { return seek_count_; }
+  uint64_t get_seek_count() const override { return io_stats().total().seeks; }
+  uint64_t scratch_bytes() const override { return scratch_.size(); }
+  // Pages the tree arena actually got (see PageBuffer::backing).
+  HugePages huge_pages() const { return arena_.backing(); }
+
+  // Plaintext access for the specialized cores (BasicSubORAM), which parse and build
+  // serialized buckets in place instead of going through Bucket objects. I/O accounting
+  // and phase timing are those of read_extents / write_extents; extents must lie within
+  // their level.
+  // Decrypted buckets of every extent back to back, bucket_byte_size() apart (the plain
+  // bucket, then its tag); valid until the next read.
+  const uint8_t* read_plain(const std::vector<BucketExtent>& extents);
+  // Stored bytes of a run, to be filled with count serialized buckets and then sealed
+  // (encrypted in place) by seal_run.
+  uint8_t* plain_run(int level, uint64_t start_bucket, uint64_t count);
+  void seal_run(int level, uint64_t start_bucket, uint64_t count);
 
  private:
   Params params_;
@@ -39,14 +129,14 @@ class MemoryStorage : public StorageBackend {
   uint64_t bucket_storage_size_;
   size_t tag_size_;
   CryptoProvider* crypto_;
-  std::vector<std::vector<uint8_t>> level_data_;
-  mutable uint64_t seek_count_{0};
-  mutable uint64_t last_offset_{static_cast<uint64_t>(-1)};  // byte after last request
-  // Opt 2: precomputed level byte offsets — avoids O(h) sum on every read/write.
+  // Opt 2: precomputed level byte offsets into arena_ — avoids O(h) sum on every read/write.
   std::vector<uint64_t> level_offsets_;
+  PageBuffer arena_;
   // Opt 4: reusable scratch buffer — eliminates per-bucket heap allocation in read_buckets.
-  mutable std::vector<uint8_t> scratch_;
+  PageBuffer scratch_;
   uint64_t level_offset(int j) const;
+  // Accounts, copies and decrypts the in-level part of a run into dst; returns its buckets.
+  uint64_t fetch_run(int level, uint64_t start_bucket, uint64_t count, uint8_t* dst);
 };
 
 // File-backed storage: single file or one file per level; optional seek counting
@@ -54,15 +144,25 @@ class FileStorage : public StorageBackend {
  public:
   FileStorage(const Params& params, const std::string& path, bool count_seeks = false,
               CryptoProvider* crypto = nullptr);
+  // Opaque store for StorageServer: buckets arrive already sealed by the client, each
+  // tag_size bytes longer than its plaintext; use read_raw/write_raw only.
+  static std::unique_ptr<FileStorage> opaque(const Params& params, const std::string& path,
+                                             bool count_seeks, size_t tag_size);
   ~FileStorage();
   void read_buckets(int level, uint64_t start_bucket, uint64_t count,
                     std::vector<Bucket>& out) override;
   void write_buckets(int level, uint64_t start_bucket,
                     const std::vector<Bucket>& buckets) override;
+  // Stored bytes of count buckets (count * bucket_byte_size()), no (de)serialization.
+  void read_raw(int level, uint64_t start_bucket, uint64_t count, uint8_t* out);
+  void write_raw(int level, uint64_t start_bucket, uint64_t count, const uint8_t* in);
   uint64_t bucket_byte_size() const override { return bucket_storage_size_; }
   uint64_t get_seek_count() const override { return seek_count_; }
+  void sync() override;
 
  private:
+  FileStorage(const Params& params, const std::string& path, bool count_seeks,
+              CryptoProvider* crypto, size_t tag_size);
   Params params_;
   uint64_t bucket_plain_size_;
   uint64_t bucket_storage_size_;
@@ -72,7 +172,6 @@ class FileStorage : public StorageBackend {
   bool count_seeks_;
   mutable uint64_t seek_count_;
   int fd_;
-  uint64_t last_offset_;
   uint64_t level_offset(int j) const;
   void ensure_open();
 };
@@ -5,40 +5,125 @@
 #include "roram/storage.hpp"
 #include "roram/position_map.hpp"
 #include "roram/crypto.hpp"
+#include "roram/stats.hpp"
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace roram {
 
 // Single sub-ORAM R_i: supports ReadRange(a) for range [a, a+2^i) and BatchEvict(k).
 // Uses locality-aware layout: at level j, bucket index r is at offset r (consecutive on disk).
+// This is the dynamic core, for any Z, ℓ and backend; BasicSubORAM (basic_sub_oram.hpp)
+// overrides ReadRange and BatchEvict for fixed ones.
 class SubORAM {
  public:
-  SubORAM(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto);
+  // pm_backing: optional ORAM holding this tree's position map (see PositionMap).
+  SubORAM(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto,
+          std::unique_ptr<PathORAM> pm_backing = nullptr);
+  virtual ~SubORAM() = default;
   // ReadRange: a must be multiple of 2^i. Returns blocks in [a, a+2^i) and new path p' for start.
-  void ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start);
+  virtual void ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start);
+  // ReadRange(a0) then ReadRange(a1), for two different ranges, with both paths fetched in
+  // one batched read (one round trip on remote storage). Results, remaps and I/O match
+  // the two calls.
+  virtual void ReadRangePair(uint64_t a0, uint64_t a1, std::vector<Block>& result0, uint64_t& new_path0,
+                             std::vector<Block>& result1, uint64_t& new_path1);
   // BatchEvict(k): evict next k paths (using global cnt); caller must advance cnt after.
-  void BatchEvict(uint64_t k, uint64_t cnt);
+  virtual void BatchEvict(uint64_t k, uint64_t cnt);
+  // True for a compile-time specialized core.
+  virtual bool specialized() const { return false; }
   // Merge blocks from tree into stash (for BatchEvict read phase). Replace by address.
   void merge_into_stash(const std::vector<Bucket>& buckets);
+  // BatchEvict write-phase assignment: move up to Z stash blocks whose R_i path passes
+  // bucket r of a level with n_buckets buckets into dst, padding it with dummies.
+  static void assign_bucket(std::vector<Block>& stash, int i, uint64_t n_buckets, uint64_t r, int Z, Bucket& dst);
+  // The same for count buckets of one level at once: dst[b] takes bucket (first + b) mod
+  // n_buckets. n_buckets must be a power of two and count <= n_buckets. Block order and
+  // choice match count successive assign_bucket calls.
+  static void assign_level(std::vector<Block>& stash, int i, uint64_t n_buckets, uint64_t first, uint64_t count,
+                           int Z, Bucket* dst);
+  static constexpr size_t kNoSlot = SIZE_MAX;
+  // assign_level's choice without moving anything: slots[b * Z + z] is the index in tags
+  // (the stash's R_i tags, packed) of block z of bucket b, or kNoSlot for a dummy. taken
+  // (mask_words(n) words) marks chosen blocks; set bits are skipped, so calling this for
+  // the levels from the leaves up with one taken mask equals assign_level level by level.
+  static void select_level(const uint64_t* tags, size_t n, uint64_t n_buckets, uint64_t first, uint64_t count,
+                           int Z, uint64_t* taken, size_t* slots);
+  // Drops the blocks marked in taken, keeping the order of the rest.
+  static void remove_taken(std::vector<Block>& stash, const uint64_t* taken);
   // Stash access for rORAM Access protocol
   std::vector<Block>& stash() { return stash_; }
   const std::vector<Block>& stash() const { return stash_; }
   PositionMap& position_map() { return pm_; }
+  const PositionMap& position_map() const { return pm_; }
   int range_exp() const { return i_; }
+  // Points the dynamic core at another backend (rORAM's durability buffers). The
+  // specialized cores keep the MemoryStorage they were built for.
+  void set_storage(StorageBackend* storage) { storage_ = storage; }
+  // Sink for ReadRange (split by range_exp), StashMerge and the BatchEvict phases.
+  void set_stats(Stats* stats) { stats_ = stats; }
+  // High-water marks since construction or reset_peaks(): stash size (sampled after
+  // BatchEvict's merge and by rORAM after staging) and buckets of one BatchEvict read.
+  size_t peak_stash_size() const { return peak_stash_; }
+  uint64_t peak_evict_buckets() const { return peak_evict_buckets_; }
+  void note_stash_peak() { peak_stash_ = std::max(peak_stash_, stash_.size()); }
+  void reset_peaks() { peak_stash_ = stash_.size(); peak_evict_buckets_ = 0; }
+
+ protected:
+  using RangeIndex = std::unordered_map<uint64_t, size_t>;  // address -> index in result
 
- private:
   Params params_;
   int i_;                          // this sub-ORAM index; range size = 2^i_
   StorageBackend* storage_;
   CryptoProvider* crypto_;
   PositionMap pm_;
   std::vector<Block> stash_;
+  Stats* stats_ = nullptr;
+  size_t peak_stash_ = 0;
+  uint64_t peak_evict_buckets_ = 0;
 
   uint64_t num_buckets_at_level(int j) const { return 1ULL << j; }
-  void merge_bucket_into_stash(std::vector<Block>& stash, const Bucket& bucket);
-  void read_paths_level(uint64_t p, uint64_t count, int j, std::vector<Bucket>& out);
-  void write_paths_level(uint64_t cnt, uint64_t k, int j, const std::vector<Bucket>& buckets);
+  // The position-map side of the merge's stale-copy check, one call per bucket slot. A
+  // client-side map is queried once per run of blocks from the same range. An outsourced
+  // map gets exactly one backing access per slot (a dummy for empty slots and repeats),
+  // so the server sees Z map accesses per evicted bucket whatever the buckets hold.
+  class MergeLookup {
+   public:
+    explicit MergeLookup(const PositionMap& pm) : pm_(pm) {}
+    uint64_t query(uint64_t a0) {
+      if (a0 != a0_) {
+        a0_ = a0;
+        value_ = pm_.query(a0);
+      } else {
+        pm_.dummy_access();
+      }
+      return value_;
+    }
+    void skip() { pm_.dummy_access(); }
+
+   private:
+    const PositionMap& pm_;
+    uint64_t a0_ = UINT64_MAX;
+    uint64_t value_ = 0;
+  };
+  // addrs holds the stash's addresses in stash order and is kept in step with it.
+  void merge_bucket_into_stash(std::vector<Block>& stash, std::vector<uint64_t>& addrs, const Bucket& bucket,
+                               MergeLookup& lookup);
+  // Append the level-j extent(s) covering count consecutive paths from p (two if it wraps).
+  void add_level_extents(uint64_t p, uint64_t count, int j, std::vector<BucketExtent>& out) const;
+  // ReadRange steps shared with the specialized cores: copy the stash blocks in [a, end)
+  // into result; move range a to a fresh random path (returns the old one); then add zero
+  // blocks for the addresses nothing held and sort result by address.
+  void stash_range(uint64_t a, uint64_t end, std::vector<Block>& result, RangeIndex& seen) const;
+  uint64_t remap_range(uint64_t a, uint64_t& new_path_start);
+  // Append the blocks of count fetched buckets that lie in [a, end) to result (the newer
+  // copy wins when an address was already seen).
+  void collect_range(const Bucket* buckets, size_t count, uint64_t a, uint64_t end, std::vector<Block>& result,
+                     RangeIndex& seen) const;
+  void complete_range(uint64_t a, uint64_t end, uint64_t new_path_start, std::vector<Block>& result,
+                      RangeIndex& seen) const;
 };
 
 }  // namespace roram
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "roram/storage.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace roram {
+
+// Physical I/O trace: every bucket run a backend reads or writes, in issue order.
+// File = "RORAMIO1", then 32-byte little-endian records:
+//   u64 t_ns (since the writer opened), u64 start, u64 bytes, u32 count, u16 tree,
+//   u8 level, u8 op (0 read, 1 write, 2 name, 3 sync)
+// A name record (count = name length, followed by the name zero-padded to 8 bytes)
+// introduces each tree id before its first I/O. The run's byte offset in its tree is
+// ((2^level - 1) + start) * (bytes / count), the layout MemoryStorage/FileStorage use.
+// A sync record (count = bytes = 0) marks a StorageBackend::sync() of its tree.
+enum class IoTraceOp : uint8_t { Read = 0, Write = 1, Name = 2, Sync = 3 };
+
+struct IoTraceRecord {
+  uint64_t t_ns;
+  uint64_t start;
+  uint64_t bytes;
+  uint32_t count;
+  uint16_t tree;
+  uint8_t level;
+  IoTraceOp op;
+
+  uint64_t offset() const { return (((1ULL << level) - 1) + start) * (count ? bytes / count : 0); }
+};
+
+// Shared by the TracingStorage of every tree; thread-safe, buffered.
+class IoTraceWriter {
+ public:
+  explicit IoTraceWriter(const std::string& path);
+  ~IoTraceWriter();
+  IoTraceWriter(const IoTraceWriter&) = delete;
+  IoTraceWriter& operator=(const IoTraceWriter&) = delete;
+
+  uint16_t register_tree(const std::string& name);
+  void record(uint16_t tree, IoTraceOp op, int level, uint64_t start, uint64_t count, uint64_t bytes);
+  void flush();
+  uint64_t records() const;
+
+ private:
+  mutable std::mutex mu_;
+  std::FILE* f_;
+  uint64_t t0_ns_;
+  uint16_t next_tree_{0};
+  uint64_t records_{0};
+  std::vector<uint8_t> buf_;
+
+  void put_record(const IoTraceRecord& r);  // mu_ held
+};
+
+// Decorator recording each extent of every call, then forwarding to the wrapped backend.
+class TracingStorage : public StorageBackend {
+ public:
+  TracingStorage(std::unique_ptr<StorageBackend> inner, std::shared_ptr<IoTraceWriter> writer,
+                 const std::string& name);
+  void read_buckets(int level, uint64_t start_bucket, uint64_t count, std::vector<Bucket>& out) override;
+  void write_buckets(int level, uint64_t start_bucket, const std::vector<Bucket>& buckets) override;
+  void read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) override;
+  void write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) override;
+  uint64_t bucket_byte_size() const override { return inner_->bucket_byte_size(); }
+  uint64_t get_seek_count() const override { return inner_->get_seek_count(); }
+  void set_stats(Stats* stats) override { inner_->set_stats(stats); }
+  const IoStats& io_stats() const override { return inner_->io_stats(); }
+  void reset_io_stats() override { inner_->reset_io_stats(); }
+  uint64_t scratch_bytes() const override { return inner_->scratch_bytes(); }
+  void sync() override;
+  StorageBackend& inner() { return *inner_; }
+
+ private:
+  std::unique_ptr<StorageBackend> inner_;
+  std::shared_ptr<IoTraceWriter> writer_;
+  uint16_t tree_;
+
+  void record(IoTraceOp op, int level, uint64_t start, uint64_t count);
+};
+
+// Wraps every backend inner creates in a TracingStorage registered as prefix + name.
+StorageFactory tracing_storage_factory(StorageFactory inner, std::shared_ptr<IoTraceWriter> writer,
+                                       const std::string& prefix = "");
+
+struct IoTrace {
+  std::vector<std::string> tree_names;  // index = tree id
+  std::vector<IoTraceRecord> records;   // reads, writes and syncs
+};
+
+IoTrace read_io_trace(const std::string& path);
+
+struct IoReplayOptions {
+  bool timed = false;  // sleep to reproduce the recorded issue times
+  bool sync = false;   // open the target O_DSYNC
+  std::string trees;   // replay only trees whose name contains this ("" = all)
+};
+
+struct IoReplayResult {
+  uint64_t reads = 0;
+  uint64_t writes = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t syncs = 0;  // fdatasync calls (one per recorded sync of a selected tree)
+  uint64_t target_bytes = 0;
+  double seconds = 0;
+  std::vector<double> latency_us;  // per replayed read or write
+};
+
+// Drives target (file or block device) with the trace's exact pattern and no ORAM work:
+// the selected trees are laid out back to back, each sized by its highest offset.
+IoReplayResult replay_io_trace(const IoTrace& trace, const std::string& target, const IoReplayOptions& opts);
+
+// Logical (query-level) trace for workload/tune, memory-mapped so large traces load
+// without parsing. File = "RORAMLT1", u64 n, then n x 16-byte little-endian records:
+//   u64 a, u32 r, u32 flags (bit 0 = write)
+struct LogicalOp {
+  uint64_t a;
+  uint64_t r;
+  bool is_write;
+};
+
+void write_logical_trace(const std::string& path, const std::vector<LogicalOp>& ops);
+
+class MappedLogicalTrace {
+ public:
+  explicit MappedLogicalTrace(const std::string& path);
+  ~MappedLogicalTrace();
+  MappedLogicalTrace(const MappedLogicalTrace&) = delete;
+  MappedLogicalTrace& operator=(const MappedLogicalTrace&) = delete;
+
+  uint64_t size() const { return n_; }
+  LogicalOp operator[](uint64_t i) const;
+  // True when path starts with the binary logical-trace magic.
+  static bool is_binary(const std::string& path);
+
+ private:
+  const uint8_t* data_{nullptr};
+  size_t len_{0};
+  uint64_t n_{0};
+};
+
+}  // namespace roram
@@ -35,8 +35,8 @@ Options:
   --seek-penalty-us <num>   Additional per-seek latency model (default: ${SEEK_PENALTY_US})
   --outdir <dir>            Output directory (default: ${OUTDIR})
   --backing-prefix <path>   File prefix for ORAM trees on SSD (default: ${BACKING_PREFIX})
-  --path-recursive-pm       Enable recursive-PM-style Path ORAM baseline emulation
-  --path-pm-accesses <num>  Override PM accesses per Path data access (default: auto)
+  --path-recursive-pm       Path ORAM baseline with a recursive position map
+  --path-pm-accesses <num>  Deprecated and ignored (recursion is no longer emulated)
   --no-cleanup              Keep backing tree files after run
   -h|--help                 Show this message
 EOF
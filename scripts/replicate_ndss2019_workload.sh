@@ -32,8 +32,8 @@ Options:
   --seek-penalty-us <num>   Per-seek delay model (default: ${SEEK_PENALTY_US})
   --outdir <dir>            Output directory (default: ${OUTDIR})
   --backing-prefix <path>   File-backed ORAM prefix (default: ${BACKING_PREFIX})
-  --path-recursive-pm       Enable recursive-PM-style Path ORAM baseline emulation
-  --path-pm-accesses <num>  Override PM accesses per Path data access (default: auto)
+  --path-recursive-pm       Path ORAM baseline with a recursive position map
+  --path-pm-accesses <num>  Deprecated and ignored (recursion is no longer emulated)
   --no-cleanup              Keep backing files after each run
   -h|--help                 Show this message
 EOF
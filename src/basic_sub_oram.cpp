@@ -0,0 +1,71 @@
+#include "roram/basic_sub_oram.hpp"
+#include "roram/path_oram.hpp"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+namespace roram {
+
+#define RORAM_BASIC_SUB_ORAM(ELL) template class BasicSubORAM<4, ELL, MemoryStorage>;
+RORAM_BASIC_SUB_ORAM(0)
+RORAM_BASIC_SUB_ORAM(1)
+RORAM_BASIC_SUB_ORAM(2)
+RORAM_BASIC_SUB_ORAM(3)
+RORAM_BASIC_SUB_ORAM(4)
+RORAM_BASIC_SUB_ORAM(5)
+RORAM_BASIC_SUB_ORAM(6)
+RORAM_BASIC_SUB_ORAM(7)
+RORAM_BASIC_SUB_ORAM(8)
+RORAM_BASIC_SUB_ORAM(9)
+RORAM_BASIC_SUB_ORAM(10)
+RORAM_BASIC_SUB_ORAM(11)
+RORAM_BASIC_SUB_ORAM(12)
+RORAM_BASIC_SUB_ORAM(13)
+#undef RORAM_BASIC_SUB_ORAM
+
+namespace {
+
+using Maker = std::unique_ptr<SubORAM> (*)(const Params&, int, MemoryStorage*, CryptoProvider*,
+                                           std::unique_ptr<PathORAM>);
+
+template <int ELL>
+std::unique_ptr<SubORAM> make_z4(const Params& params, int i, MemoryStorage* storage, CryptoProvider* crypto,
+                                 std::unique_ptr<PathORAM> pm_backing) {
+  return std::make_unique<BasicSubORAM<4, ELL, MemoryStorage>>(params, i, storage, crypto, std::move(pm_backing));
+}
+
+template <size_t... E>
+constexpr std::array<Maker, sizeof...(E)> z4_table(std::index_sequence<E...>) {
+  return {{&make_z4<static_cast<int>(E)>...}};
+}
+
+// Indexed by ℓ.
+constexpr std::array<Maker, 14> kZ4Makers = z4_table(std::make_index_sequence<14>());
+
+std::atomic<bool>& specialization_flag() {
+  static std::atomic<bool> on{[] {
+    const char* env = std::getenv("RORAM_GENERIC_CORE");
+    return !(env && *env && std::string(env) != "0");
+  }()};
+  return on;
+}
+
+}  // namespace
+
+bool sub_oram_specialization() { return specialization_flag().load(std::memory_order_relaxed); }
+
+void set_sub_oram_specialization(bool on) { specialization_flag().store(on, std::memory_order_relaxed); }
+
+std::unique_ptr<SubORAM> make_sub_oram(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto,
+                                       std::unique_ptr<PathORAM> pm_backing) {
+  if (sub_oram_specialization() && params.Z == 4 && params.ell >= 0 &&
+      static_cast<size_t>(params.ell) < kZ4Makers.size() && typeid(*storage) == typeid(MemoryStorage))
+    return kZ4Makers[static_cast<size_t>(params.ell)](params, i, static_cast<MemoryStorage*>(storage), crypto,
+                                                      std::move(pm_backing));
+  return std::make_unique<SubORAM>(params, i, storage, crypto, std::move(pm_backing));
+}
+
+}  // namespace roram
@@ -2,16 +2,17 @@
 
 namespace roram {
 
-Block::Block(size_t data_len, int num_orams) : data(data_len, 0), a(INVALID_ADDR), p(num_orams, 0) {}
+Block::Block(size_t data_len, int num_orams) : data(data_len, 0), a(INVALID_ADDR), ver(0), p(num_orams, 0) {}
 
 void Block::set_dummy() {
   a = INVALID_ADDR;
+  ver = 0;
   std::fill(data.begin(), data.end(), 0);
   std::fill(p.begin(), p.end(), 0);
 }
 
-size_t Block::serialized_size(const Params& params) const {
-  return params.B + 8 + (params.ell + 1) * 8;
+size_t Block::serialized_size(const Params& params) {
+  return params.B + 16 + (params.ell + 1) * 8;
 }
 
 void Block::serialize(uint8_t* out, const Params& params) const {
@@ -20,6 +21,8 @@ void Block::serialize(uint8_t* out, const Params& params) const {
   off += params.B;
   memcpy(out + off, &a, 8);
   off += 8;
+  memcpy(out + off, &ver, 8);
+  off += 8;
   for (size_t i = 0; i < p.size(); ++i) {
     memcpy(out + off, &p[i], 8);
     off += 8;
@@ -32,6 +35,8 @@ void Block::deserialize(const uint8_t* in, const Params& params) {
   off += params.B;
   memcpy(&a, in + off, 8);
   off += 8;
+  memcpy(&ver, in + off, 8);
+  off += 8;
   for (size_t i = 0; i < p.size(); ++i) {
     memcpy(&p[i], in + off, 8);
     off += 8;
@@ -0,0 +1,357 @@
+#include "roram/durability.hpp"
+#include "roram/memory_usage.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace roram {
+
+namespace {
+
+const char kLogMagic[8] = {'R', 'O', 'R', 'A', 'M', 'W', 'L', '3'};
+
+// Seal nonces have the top bit set; tree buckets are sealed under their heap index.
+constexpr uint64_t kSealIdBit = 1ULL << 63;
+
+void put_le(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint64_t get_le(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+uint64_t fnv1a(const uint8_t* p, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+void write_all(int fd, const uint8_t* p, size_t n, const std::string& path) {
+  while (n > 0) {
+    const ssize_t w = ::write(fd, p, n);
+    if (w <= 0) throw std::runtime_error("ClientStateLog: write failed: " + path);
+    p += w;
+    n -= static_cast<size_t>(w);
+  }
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+  const size_t at = out.size();
+  out.resize(at + 8);
+  put_le(out.data() + at, v);
+}
+
+// One framed record: length, nonce, sealed payload and tag, checksum.
+std::vector<uint8_t> encode(const ClientStateRecord& rec, const Params& params, CryptoProvider* crypto) {
+  const size_t block_bytes = Block::serialized_size(params);
+  const size_t bucket_bytes = static_cast<size_t>(params.Z) * block_bytes;
+  const uint64_t nonce = kSealIdBit | crypto->random_path(kSealIdBit);
+  std::vector<uint8_t> out;
+  put_u64(out, 0);  // body length, filled in below
+  put_u64(out, nonce);
+  const size_t sealed_at = out.size();
+  put_u64(out, rec.seq);
+  put_u64(out, rec.cnt);
+  put_u64(out, rec.version);
+  put_u64(out, rec.accesses);
+  put_u64(out, rec.snapshot ? 1 : 0);
+  put_u64(out, rec.trees.size());
+  for (const TreeState& t : rec.trees) {
+    if (rec.snapshot) {
+      put_u64(out, t.pm_words.size());
+      for (uint64_t w : t.pm_words) put_u64(out, w);
+    } else {
+      put_u64(out, t.pm_updates.size());
+      for (const auto& u : t.pm_updates) {
+        put_u64(out, u.first);
+        put_u64(out, u.second);
+      }
+    }
+    put_u64(out, t.stash.size());
+    size_t at = out.size();
+    out.resize(at + t.stash.size() * block_bytes);
+    for (const Block& b : t.stash) {
+      b.serialize(out.data() + at, params);
+      at += block_bytes;
+    }
+    put_u64(out, t.bucket_ids.size());
+    for (uint64_t id : t.bucket_ids) put_u64(out, id);
+    at = out.size();
+    out.resize(at + t.buckets.size() * bucket_bytes);
+    for (const Bucket& b : t.buckets) {
+      b.serialize(out.data() + at, params);
+      at += bucket_bytes;
+    }
+  }
+  const size_t sealed_len = out.size() - sealed_at;
+  out.resize(out.size() + crypto->tag_size());
+  crypto->encrypt(out.data() + sealed_at, sealed_len, nonce, out.data() + sealed_at + sealed_len);
+  put_le(out.data(), out.size() - 8);
+  put_u64(out, fnv1a(out.data() + 8, out.size() - 8));
+  return out;
+}
+
+// Bounds-checked cursor over one opened payload.
+class PayloadReader {
+ public:
+  PayloadReader(const uint8_t* p, size_t n) : p_(p), n_(n) {}
+  uint64_t u64() { return get_le(take(8)); }
+  // A count of items of item_bytes each that must fit in the rest of the payload.
+  uint64_t count(size_t item_bytes) {
+    const uint64_t c = u64();
+    if (c > (n_ - pos_) / item_bytes) malformed();
+    return c;
+  }
+  const uint8_t* take(size_t bytes) {
+    if (bytes > n_ - pos_) malformed();
+    const uint8_t* at = p_ + pos_;
+    pos_ += bytes;
+    return at;
+  }
+  bool done() const { return pos_ == n_; }
+  [[noreturn]] static void malformed() { throw std::runtime_error("ClientStateLog::read: malformed record"); }
+
+ private:
+  const uint8_t* p_;
+  size_t n_;
+  size_t pos_ = 0;
+};
+
+// Opens one record body (nonce, sealed payload, tag) whose checksum already matched.
+ClientStateRecord decode(const uint8_t* body, size_t body_len, const Params& params, CryptoProvider* crypto) {
+  const size_t block_bytes = Block::serialized_size(params);
+  const size_t bucket_bytes = static_cast<size_t>(params.Z) * block_bytes;
+  const size_t tag = crypto->tag_size();
+  if (body_len < 8 + tag) PayloadReader::malformed();
+  std::vector<uint8_t> payload(body + 8, body + body_len - tag);
+  crypto->decrypt(payload.data(), payload.size(), get_le(body), body + body_len - tag);
+  PayloadReader in(payload.data(), payload.size());
+  ClientStateRecord rec;
+  rec.seq = in.u64();
+  rec.cnt = in.u64();
+  rec.version = in.u64();
+  rec.accesses = in.u64();
+  rec.snapshot = in.u64() != 0;
+  const uint64_t trees = in.count(8 * 3);  // each tree has three counts
+  if (trees != static_cast<uint64_t>(params.ell + 1)) PayloadReader::malformed();
+  rec.trees.resize(static_cast<size_t>(trees));
+  for (TreeState& t : rec.trees) {
+    if (rec.snapshot) {
+      t.pm_words.resize(static_cast<size_t>(in.count(8)));
+      for (uint64_t& w : t.pm_words) w = in.u64();
+    } else {
+      t.pm_updates.resize(static_cast<size_t>(in.count(16)));
+      for (auto& u : t.pm_updates) {
+        u.first = in.u64();
+        u.second = in.u64();
+      }
+    }
+    t.stash.assign(static_cast<size_t>(in.count(block_bytes)), Block(params.B, params.ell + 1));
+    for (Block& b : t.stash) b.deserialize(in.take(block_bytes), params);
+    t.bucket_ids.resize(static_cast<size_t>(in.count(8 + bucket_bytes)));
+    for (uint64_t& id : t.bucket_ids) id = in.u64();
+    t.buckets.assign(t.bucket_ids.size(), Bucket(params.Z, params.B, params.ell + 1));
+    for (Bucket& b : t.buckets) b.deserialize(in.take(bucket_bytes), params);
+  }
+  if (!in.done()) PayloadReader::malformed();
+  return rec;
+}
+
+std::string parent_dir(const std::string& path) {
+  const size_t slash = path.rfind('/');
+  if (slash == std::string::npos) return ".";
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+int level_of(uint64_t heap_index) {
+  int level = 0;
+  while (((2ULL << level) - 1) <= heap_index) ++level;
+  return level;
+}
+
+}  // namespace
+
+const char* durability_name(Durability d) {
+  switch (d) {
+    case Durability::None: return "none";
+    case Durability::Access: return "access";
+    case Durability::Group: return "group";
+  }
+  return "?";
+}
+
+Durability parse_durability(const std::string& name) {
+  if (name == "none") return Durability::None;
+  if (name == "access") return Durability::Access;
+  if (name == "group") return Durability::Group;
+  throw std::runtime_error("parse_durability: expected none|access|group, got " + name);
+}
+
+uint64_t ClientStateRecord::stashed() const {
+  uint64_t n = 0;
+  for (const TreeState& t : trees) n += t.stash.size();
+  return n;
+}
+
+ClientStateLog::ClientStateLog(const std::string& path, const Params& params, CryptoProvider* crypto,
+                               const ClientStateRecord& base)
+    : path_(path), params_(params), crypto_(crypto) {
+  start(base);
+  appended_ = 1;
+}
+
+ClientStateLog::~ClientStateLog() {
+  if (fd_ >= 0) ::close(fd_);
+}
+
+void ClientStateLog::start(const ClientStateRecord& base) {
+  if (!base.snapshot) throw std::runtime_error("ClientStateLog: a log must start with a snapshot");
+  const std::string tmp = path_ + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  if (fd < 0) throw std::runtime_error("ClientStateLog: cannot open " + tmp);
+  std::vector<uint8_t> buf(kLogMagic, kLogMagic + sizeof(kLogMagic));
+  const std::vector<uint8_t> rec = encode(base, params_, crypto_);
+  buf.insert(buf.end(), rec.begin(), rec.end());
+  try {
+    write_all(fd, buf.data(), buf.size(), tmp);
+    if (fdatasync(fd) != 0) throw std::runtime_error("ClientStateLog: fdatasync failed: " + tmp);
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) throw std::runtime_error("ClientStateLog: rename failed: " + path_);
+    // The rename is durable once the directory is.
+    const int dir = ::open(parent_dir(path_).c_str(), O_RDONLY);
+    if (dir < 0 || fsync(dir) != 0) {
+      if (dir >= 0) ::close(dir);
+      throw std::runtime_error("ClientStateLog: cannot sync the directory of " + path_);
+    }
+    ::close(dir);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = fd;  // still the new file, now under path_
+  bytes_ = base_bytes_ = buf.size();
+  broken_ = false;
+}
+
+void ClientStateLog::append(const ClientStateRecord& rec) {
+  if (broken_) throw std::runtime_error("ClientStateLog: an earlier failed append could not be undone: " + path_);
+  const std::vector<uint8_t> buf = encode(rec, params_, crypto_);
+  try {
+    write_all(fd_, buf.data(), buf.size(), path_);
+    if (fdatasync(fd_) != 0) throw std::runtime_error("ClientStateLog: fdatasync failed: " + path_);
+  } catch (...) {
+    // Drop whatever part of the record got out, so the next append follows the last good one.
+    if (::ftruncate(fd_, static_cast<off_t>(bytes_)) != 0 || fdatasync(fd_) != 0) broken_ = true;
+    throw;
+  }
+  bytes_ += buf.size();
+  ++appended_;
+}
+
+void ClientStateLog::reset(const ClientStateRecord& base) { start(base); }
+
+std::vector<ClientStateRecord> ClientStateLog::read(const std::string& path, const Params& params,
+                                                    CryptoProvider* crypto) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("ClientStateLog::read: cannot open " + path);
+  std::vector<uint8_t> data;
+  uint8_t chunk[1 << 16];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+  std::fclose(f);
+  if (data.size() < sizeof(kLogMagic) || std::memcmp(data.data(), kLogMagic, sizeof(kLogMagic)) != 0)
+    throw std::runtime_error("ClientStateLog::read: not a client-state log: " + path);
+  std::vector<ClientStateRecord> out;
+  size_t pos = sizeof(kLogMagic);
+  while (data.size() - pos >= 16) {
+    const uint64_t len = get_le(data.data() + pos);
+    if (len > data.size() - pos - 16) break;  // torn
+    const uint8_t* body = data.data() + pos + 8;
+    if (get_le(body + len) != fnv1a(body, static_cast<size_t>(len))) break;
+    out.push_back(decode(body, static_cast<size_t>(len), params, crypto));
+    pos += 16 + static_cast<size_t>(len);
+  }
+  return out;
+}
+
+BufferedStorage::BufferedStorage(std::unique_ptr<StorageBackend> inner, const Params& params)
+    : inner_(std::move(inner)), params_(params) {}
+
+void BufferedStorage::overlay(int level, uint64_t start_bucket, uint64_t count, Bucket* out) const {
+  if (pending_.empty()) return;
+  const uint64_t first = ((1ULL << level) - 1) + start_bucket;
+  for (auto it = pending_.lower_bound(first); it != pending_.end() && it->first < first + count; ++it)
+    out[it->first - first] = it->second;
+}
+
+void BufferedStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count, std::vector<Bucket>& out) {
+  inner_->read_buckets(level, start_bucket, count, out);
+  overlay(level, start_bucket, count, out.data());
+}
+
+void BufferedStorage::read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) {
+  inner_->read_extents(extents, out);
+  size_t pos = 0;
+  for (const BucketExtent& e : extents) {
+    overlay(e.level, e.start, e.count, out.data() + pos);
+    pos += static_cast<size_t>(e.count);
+  }
+}
+
+void BufferedStorage::write_buckets(int level, uint64_t start_bucket, const std::vector<Bucket>& buckets) {
+  const uint64_t first = ((1ULL << level) - 1) + start_bucket;
+  for (size_t b = 0; b < buckets.size(); ++b) pending_.insert_or_assign(first + b, buckets[b]);
+}
+
+void BufferedStorage::write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) {
+  size_t pos = 0;
+  for (const BucketExtent& e : extents) {
+    const uint64_t first = ((1ULL << e.level) - 1) + e.start;
+    for (uint64_t b = 0; b < e.count; ++b) pending_.insert_or_assign(first + b, buckets[pos++]);
+  }
+}
+
+uint64_t BufferedStorage::scratch_bytes() const {
+  return inner_->scratch_bytes() + pending_.size() * MemoryUsage::bucket_bytes(params_);
+}
+
+void BufferedStorage::pending(std::vector<uint64_t>& ids, std::vector<Bucket>& buckets) const {
+  ids.clear();
+  buckets.clear();
+  ids.reserve(pending_.size());
+  buckets.reserve(pending_.size());
+  for (const auto& kv : pending_) {
+    ids.push_back(kv.first);
+    buckets.push_back(kv.second);
+  }
+}
+
+std::unique_ptr<StorageBackend> BufferedStorage::release() {
+  if (!pending_.empty()) throw std::runtime_error("BufferedStorage::release: writes pending");
+  return std::move(inner_);
+}
+
+void write_heap_buckets(StorageBackend& storage, const std::vector<uint64_t>& ids, const std::vector<Bucket>& buckets) {
+  if (ids.empty()) return;
+  std::vector<BucketExtent> extents;
+  for (size_t k = 0; k < ids.size(); ++k) {
+    const int level = level_of(ids[k]);
+    const uint64_t bucket = ids[k] - ((1ULL << level) - 1);
+    if (k > 0 && ids[k] == ids[k - 1] + 1 && extents.back().level == level)
+      ++extents.back().count;
+    else
+      extents.push_back(BucketExtent{level, bucket, 1});
+  }
+  storage.write_extents(extents, buckets);
+}
+
+}  // namespace roram
@@ -0,0 +1,119 @@
+#include "roram/frontend.hpp"
+#include <stdexcept>
+
+namespace roram {
+
+ORAMFrontend::ORAMFrontend(std::unique_ptr<rORAM> oram, FrontendOptions opts)
+    : oram_(std::move(oram)), opts_(opts) {
+  if (!oram_) throw std::runtime_error("ORAMFrontend: null ORAM");
+  if (opts_.max_batch == 0) opts_.max_batch = 1;
+  oram_->set_parallel_evict(opts_.parallel_evict);
+  worker_ = std::thread([this]() { run(); });
+}
+
+ORAMFrontend::~ORAMFrontend() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+std::future<ORAMFrontend::Result> ORAMFrontend::submit(uint64_t client, RangeRequest req) {
+  const Params& p = oram_->params();
+  if (req.op != "read" && req.op != "write")
+    throw std::runtime_error("ORAMFrontend::submit: op must be read/write");
+  if (req.r > p.L) throw std::runtime_error("ORAMFrontend::submit: r > L");
+  if (req.a + req.r > p.N) throw std::runtime_error("ORAMFrontend::submit: range out of bounds");
+  Pending pending{std::move(req), std::promise<Result>()};
+  std::future<Result> fut = pending.done.get_future();
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (stop_) throw std::runtime_error("ORAMFrontend::submit: front-end stopped");
+    queues_[client].push_back(std::move(pending));
+    ++queued_;
+  }
+  work_cv_.notify_one();
+  return fut;
+}
+
+ORAMFrontend::Result ORAMFrontend::Access(uint64_t client, uint64_t a, uint64_t r, const std::string& op,
+                                          const std::vector<std::vector<uint8_t>>* D) {
+  RangeRequest req{a, r, op, {}};
+  if (op == "write" && D) req.data = *D;
+  return submit(client, std::move(req)).get();
+}
+
+void ORAMFrontend::drain() {
+  std::unique_lock<std::mutex> lk(mu_);
+  idle_cv_.wait(lk, [this]() { return queued_ == 0 && !busy_; });
+}
+
+uint64_t ORAMFrontend::batches_served() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return batches_;
+}
+
+uint64_t ORAMFrontend::requests_served() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return served_;
+}
+
+std::vector<ORAMFrontend::Pending> ORAMFrontend::take_batch() {
+  std::vector<Pending> batch;
+  // Round-robin over clients starting after the last one served; repeat passes
+  // until the batch is full or every queue is empty.
+  while (batch.size() < opts_.max_batch && queued_ > 0) {
+    auto it = queues_.lower_bound(next_client_);
+    for (size_t visited = 0, n = queues_.size(); visited < n && batch.size() < opts_.max_batch; ++visited) {
+      if (it == queues_.end()) it = queues_.begin();
+      auto& q = it->second;
+      size_t take = opts_.max_per_client == 0 ? q.size() : std::min(q.size(), opts_.max_per_client);
+      take = std::min(take, opts_.max_batch - batch.size());
+      for (size_t t = 0; t < take; ++t) {
+        batch.push_back(std::move(q.front()));
+        q.pop_front();
+      }
+      queued_ -= take;
+      next_client_ = it->first + 1;
+      it = q.empty() ? queues_.erase(it) : std::next(it);
+    }
+  }
+  return batch;
+}
+
+void ORAMFrontend::run() {
+  for (;;) {
+    std::vector<Pending> batch;
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+      work_cv_.wait(lk, [this]() { return stop_ || queued_ > 0; });
+      if (queued_ == 0) return;  // stop_ and nothing left to serve
+      batch = take_batch();
+      busy_ = true;
+    }
+
+    std::vector<RangeRequest> reqs;
+    reqs.reserve(batch.size());
+    for (Pending& p : batch) reqs.push_back(std::move(p.req));
+    try {
+      auto results = oram_->access_batch(reqs);
+      // Group commit: the whole batch becomes durable before any request completes.
+      if (oram_->durability() == Durability::Group) oram_->commit();
+      for (size_t n = 0; n < batch.size(); ++n) batch[n].done.set_value(std::move(results[n]));
+    } catch (...) {
+      for (Pending& p : batch) p.done.set_exception(std::current_exception());
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      busy_ = false;
+      ++batches_;
+      served_ += batch.size();
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+}  // namespace roram
@@ -0,0 +1,247 @@
+#include "roram/header_scan.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RORAM_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace roram {
+
+namespace {
+
+constexpr uint64_t kSignBit = 1ULL << 63;
+
+// Scalar kernels, also the tails of the vector ones. Each handles v[begin, n) and sets bits
+// in mask words already holding the vector part's result.
+
+size_t in_range_scalar(const uint64_t* v, size_t begin, size_t n, uint64_t lo, uint64_t span, uint64_t* mask) {
+  size_t hits = 0;
+  for (size_t k = begin; k < n; ++k) {
+    const uint64_t bit = static_cast<uint64_t>(v[k] - lo < span);
+    mask[k / 64] |= bit << (k % 64);
+    hits += bit;
+  }
+  return hits;
+}
+
+size_t masked_equal_scalar(const uint64_t* v, size_t begin, size_t n, uint64_t sel, uint64_t want, uint64_t* mask) {
+  size_t hits = 0;
+  for (size_t k = begin; k < n; ++k) {
+    const uint64_t bit = static_cast<uint64_t>((v[k] & sel) == want);
+    mask[k / 64] |= bit << (k % 64);
+    hits += bit;
+  }
+  return hits;
+}
+
+size_t find_scalar(const uint64_t* v, size_t begin, size_t n, uint64_t x) {
+  for (size_t k = begin; k < n; ++k)
+    if (v[k] == x) return k;
+  return n;
+}
+
+#ifdef RORAM_SCAN_X86
+
+// AVX2 has only signed 64-bit compares: flipping the sign bit of both sides turns
+// (v - lo) <u span into a signed greater-than. Four lanes per compare, 16 per mask word.
+
+__attribute__((target("avx2"))) size_t in_range_avx2(const uint64_t* v, size_t n, uint64_t lo, uint64_t span,
+                                                     uint64_t* mask) {
+  const __m256i vlo = _mm256_set1_epi64x(static_cast<long long>(lo));
+  const __m256i vspan = _mm256_set1_epi64x(static_cast<long long>(span ^ kSignBit));
+  const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(kSignBit));
+  size_t hits = 0;
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + k));
+    const __m256i d = _mm256_xor_si256(_mm256_sub_epi64(x, vlo), sign);
+    const uint64_t bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(vspan, d))));
+    mask[k / 64] |= bits << (k % 64);
+    hits += static_cast<size_t>(__builtin_popcountll(bits));
+  }
+  return hits + in_range_scalar(v, k, n, lo, span, mask);
+}
+
+__attribute__((target("avx2"))) size_t masked_equal_avx2(const uint64_t* v, size_t n, uint64_t sel, uint64_t want,
+                                                         uint64_t* mask) {
+  const __m256i vsel = _mm256_set1_epi64x(static_cast<long long>(sel));
+  const __m256i vwant = _mm256_set1_epi64x(static_cast<long long>(want));
+  size_t hits = 0;
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + k));
+    const __m256i eq = _mm256_cmpeq_epi64(_mm256_and_si256(x, vsel), vwant);
+    const uint64_t bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    mask[k / 64] |= bits << (k % 64);
+    hits += static_cast<size_t>(__builtin_popcountll(bits));
+  }
+  return hits + masked_equal_scalar(v, k, n, sel, want, mask);
+}
+
+__attribute__((target("avx2"))) size_t find_avx2(const uint64_t* v, size_t n, uint64_t x) {
+  const __m256i vx = _mm256_set1_epi64x(static_cast<long long>(x));
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + k));
+    const int bits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(y, vx)));
+    if (bits) return k + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(bits)));
+  }
+  return find_scalar(v, k, n, x);
+}
+
+// AVX-512F compares unsigned lanes directly into a k-mask: eight lanes per compare.
+
+__attribute__((target("avx512f"))) size_t in_range_avx512(const uint64_t* v, size_t n, uint64_t lo, uint64_t span,
+                                                          uint64_t* mask) {
+  const __m512i vlo = _mm512_set1_epi64(static_cast<long long>(lo));
+  const __m512i vspan = _mm512_set1_epi64(static_cast<long long>(span));
+  size_t hits = 0;
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    const __m512i x = _mm512_loadu_si512(v + k);
+    const uint64_t bits = _mm512_cmplt_epu64_mask(_mm512_sub_epi64(x, vlo), vspan);
+    mask[k / 64] |= bits << (k % 64);
+    hits += static_cast<size_t>(__builtin_popcountll(bits));
+  }
+  return hits + in_range_scalar(v, k, n, lo, span, mask);
+}
+
+__attribute__((target("avx512f"))) size_t masked_equal_avx512(const uint64_t* v, size_t n, uint64_t sel,
+                                                              uint64_t want, uint64_t* mask) {
+  const __m512i vsel = _mm512_set1_epi64(static_cast<long long>(sel));
+  const __m512i vwant = _mm512_set1_epi64(static_cast<long long>(want));
+  size_t hits = 0;
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    const __m512i x = _mm512_loadu_si512(v + k);
+    const uint64_t bits = _mm512_cmpeq_epu64_mask(_mm512_and_si512(x, vsel), vwant);
+    mask[k / 64] |= bits << (k % 64);
+    hits += static_cast<size_t>(__builtin_popcountll(bits));
+  }
+  return hits + masked_equal_scalar(v, k, n, sel, want, mask);
+}
+
+__attribute__((target("avx512f"))) size_t find_avx512(const uint64_t* v, size_t n, uint64_t x) {
+  const __m512i vx = _mm512_set1_epi64(static_cast<long long>(x));
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    const unsigned bits = _mm512_cmpeq_epu64_mask(_mm512_loadu_si512(v + k), vx);
+    if (bits) return k + static_cast<size_t>(__builtin_ctz(bits));
+  }
+  return find_scalar(v, k, n, x);
+}
+
+#endif  // RORAM_SCAN_X86
+
+// Falls back one step at a time to what the CPU supports.
+ScanIsa clamp_isa(ScanIsa isa) {
+  if (isa == ScanIsa::AVX512 && !scan_isa_supported(isa)) isa = ScanIsa::AVX2;
+  if (isa == ScanIsa::AVX2 && !scan_isa_supported(isa)) isa = ScanIsa::Scalar;
+  return isa;
+}
+
+ScanIsa initial_isa() {
+  const char* env = std::getenv("RORAM_SCAN_ISA");
+  if (env && *env) {
+    try {
+      return clamp_isa(parse_scan_isa(env));
+    } catch (const std::exception&) {
+      // Unknown names fall through to the default.
+    }
+  }
+  return best_scan_isa();
+}
+
+std::atomic<ScanIsa>& current_isa() {
+  static std::atomic<ScanIsa> isa{initial_isa()};
+  return isa;
+}
+
+void clear_mask(size_t n, uint64_t* mask) {
+  for (size_t w = 0; w < mask_words(n); ++w) mask[w] = 0;
+}
+
+}  // namespace
+
+const char* scan_isa_name(ScanIsa isa) {
+  switch (isa) {
+    case ScanIsa::Scalar: return "scalar";
+    case ScanIsa::AVX2: return "avx2";
+    case ScanIsa::AVX512: return "avx512";
+  }
+  return "?";
+}
+
+ScanIsa parse_scan_isa(const std::string& name) {
+  if (name == "scalar") return ScanIsa::Scalar;
+  if (name == "avx2") return ScanIsa::AVX2;
+  if (name == "avx512") return ScanIsa::AVX512;
+  throw std::runtime_error("parse_scan_isa: unknown ISA " + name + " (scalar|avx2|avx512)");
+}
+
+bool scan_isa_supported(ScanIsa isa) {
+  switch (isa) {
+    case ScanIsa::Scalar: return true;
+#ifdef RORAM_SCAN_X86
+    case ScanIsa::AVX2: return __builtin_cpu_supports("avx2");
+    case ScanIsa::AVX512: return __builtin_cpu_supports("avx512f");
+#else
+    default: return false;
+#endif
+  }
+  return false;
+}
+
+ScanIsa best_scan_isa() {
+  static const ScanIsa best = scan_isa_supported(ScanIsa::AVX512) ? ScanIsa::AVX512
+                              : scan_isa_supported(ScanIsa::AVX2) ? ScanIsa::AVX2
+                                                                  : ScanIsa::Scalar;
+  return best;
+}
+
+ScanIsa scan_isa() { return current_isa().load(std::memory_order_relaxed); }
+
+ScanIsa set_scan_isa(ScanIsa isa) {
+  isa = clamp_isa(isa);
+  current_isa().store(isa, std::memory_order_relaxed);
+  return isa;
+}
+
+size_t scan_in_range(const uint64_t* v, size_t n, uint64_t lo, uint64_t hi, uint64_t* mask) {
+  clear_mask(n, mask);
+  if (hi <= lo) return 0;
+  const uint64_t span = hi - lo;
+  switch (scan_isa()) {
+#ifdef RORAM_SCAN_X86
+    case ScanIsa::AVX512: return in_range_avx512(v, n, lo, span, mask);
+    case ScanIsa::AVX2: return in_range_avx2(v, n, lo, span, mask);
+#endif
+    default: return in_range_scalar(v, 0, n, lo, span, mask);
+  }
+}
+
+size_t scan_masked_equal(const uint64_t* v, size_t n, uint64_t sel, uint64_t want, uint64_t* mask) {
+  clear_mask(n, mask);
+  switch (scan_isa()) {
+#ifdef RORAM_SCAN_X86
+    case ScanIsa::AVX512: return masked_equal_avx512(v, n, sel, want, mask);
+    case ScanIsa::AVX2: return masked_equal_avx2(v, n, sel, want, mask);
+#endif
+    default: return masked_equal_scalar(v, 0, n, sel, want, mask);
+  }
+}
+
+size_t scan_find(const uint64_t* v, size_t n, uint64_t x) {
+  switch (scan_isa()) {
+#ifdef RORAM_SCAN_X86
+    case ScanIsa::AVX512: return find_avx512(v, n, x);
+    case ScanIsa::AVX2: return find_avx2(v, n, x);
+#endif
+    default: return find_scalar(v, 0, n, x);
+  }
+}
+
+}  // namespace roram
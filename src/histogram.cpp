@@ -0,0 +1,81 @@
+#include "roram/histogram.hpp"
+#include <algorithm>
+
+namespace roram {
+
+namespace {
+constexpr int kSubBits = 7;                       // 128 exact values, then 64 per octave
+constexpr uint64_t kExact = 1ULL << kSubBits;
+constexpr uint64_t kHalf = kExact / 2;
+constexpr size_t kNumBuckets = kExact + (64 - kSubBits) * kHalf;
+
+int msb(uint64_t v) { return 63 - __builtin_clzll(v); }
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : counts_(kNumBuckets, 0) {}
+
+size_t LatencyHistogram::index_of(uint64_t ns) {
+  if (ns < kExact) return static_cast<size_t>(ns);
+  const int shift = msb(ns) - (kSubBits - 1);
+  const uint64_t top = ns >> shift;  // in [kHalf, kExact)
+  return static_cast<size_t>(kExact + static_cast<uint64_t>(shift - 1) * kHalf + (top - kHalf));
+}
+
+uint64_t LatencyHistogram::lowest_of(size_t idx) {
+  if (idx < kExact) return idx;
+  const uint64_t k = idx - kExact;
+  const int shift = static_cast<int>(k / kHalf) + 1;
+  return (k % kHalf + kHalf) << shift;
+}
+
+uint64_t LatencyHistogram::highest_of(size_t idx) {
+  if (idx < kExact) return idx;
+  const int shift = static_cast<int>((idx - kExact) / kHalf) + 1;
+  return lowest_of(idx) + ((1ULL << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t ns, uint64_t count) {
+  if (count == 0) return;
+  counts_[index_of(ns)] += count;
+  if (total_ == 0 || ns < min_) min_ = ns;
+  max_ = std::max(max_, ns);
+  total_ += count;
+  sum_ += ns * count;
+}
+
+void LatencyHistogram::reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  total_ = sum_ = min_ = max_ = 0;
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) {
+  if (other.total_ == 0) return *this;
+  for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+  if (total_ == 0 || other.min_ < min_) min_ = other.min_;
+  max_ = std::max(max_, other.max_);
+  total_ += other.total_;
+  sum_ += other.sum_;
+  return *this;
+}
+
+uint64_t LatencyHistogram::value_at(double p) const {
+  if (total_ == 0) return 0;
+  p = std::min(1.0, std::max(0.0, p));
+  // Rank of the sample at fraction p, 1-based, at least the first sample.
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(total_) + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(highest_of(i), max_);
+  }
+  return max_;
+}
+
+std::vector<LatencyHistogram::Bucket> LatencyHistogram::buckets() const {
+  std::vector<Bucket> out;
+  for (size_t i = 0; i < counts_.size(); ++i)
+    if (counts_[i]) out.push_back(Bucket{lowest_of(i), highest_of(i), counts_[i]});
+  return out;
+}
+
+}  // namespace roram
@@ -0,0 +1,177 @@
+#include "roram/huge_pages.hpp"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace roram {
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+void* map_anonymous(size_t len, int extra_flags) {
+  void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+int open_counter(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+uint64_t read_counter(int fd) {
+  uint64_t v = 0;
+  if (fd < 0 || ::read(fd, &v, sizeof(v)) != static_cast<ssize_t>(sizeof(v))) return 0;
+  return v;
+}
+
+}  // namespace
+
+const char* huge_pages_name(HugePages mode) {
+  switch (mode) {
+    case HugePages::Off: return "off";
+    case HugePages::Transparent: return "thp";
+    case HugePages::Explicit: return "explicit";
+  }
+  return "?";
+}
+
+HugePages parse_huge_pages(const std::string& name) {
+  if (name == "off") return HugePages::Off;
+  if (name == "thp") return HugePages::Transparent;
+  if (name == "explicit") return HugePages::Explicit;
+  throw std::runtime_error("parse_huge_pages: expected off|thp|explicit, got " + name);
+}
+
+PageBuffer::PageBuffer(size_t bytes, HugePages mode) : size_(bytes), requested_(mode) {
+  if (bytes == 0) return;
+  const bool huge = bytes >= kHugePageSize && mode != HugePages::Off;
+  if (huge && mode == HugePages::Explicit) {
+    int flags = MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+    flags |= MAP_HUGE_2MB;
+#endif
+    mapped_ = round_up(bytes, kHugePageSize);
+    if ((data_ = static_cast<uint8_t*>(map_anonymous(mapped_, flags)))) {
+      backing_ = HugePages::Explicit;
+      return;
+    }
+  }
+  if (huge) {
+    // Over-map by one huge page and trim, so the buffer starts on a 2 MiB boundary and
+    // every full huge page of it can be collapsed.
+    const size_t len = round_up(bytes, kHugePageSize);
+    uint8_t* raw = static_cast<uint8_t*>(map_anonymous(len + kHugePageSize, 0));
+    if (raw) {
+      uint8_t* aligned = reinterpret_cast<uint8_t*>(round_up(reinterpret_cast<uintptr_t>(raw), kHugePageSize));
+      if (aligned > raw) munmap(raw, static_cast<size_t>(aligned - raw));
+      const size_t tail = static_cast<size_t>((raw + len + kHugePageSize) - (aligned + len));
+      if (tail > 0) munmap(aligned + len, tail);
+      data_ = aligned;
+      mapped_ = len;
+#ifdef MADV_HUGEPAGE
+      if (madvise(data_, mapped_, MADV_HUGEPAGE) == 0) backing_ = HugePages::Transparent;
+#endif
+      return;
+    }
+  }
+  mapped_ = round_up(bytes, kPageSize);
+  data_ = static_cast<uint8_t*>(map_anonymous(mapped_, 0));
+  if (!data_) throw std::runtime_error("PageBuffer: mmap of " + std::to_string(bytes) + " bytes failed");
+}
+
+PageBuffer::~PageBuffer() { release(); }
+
+PageBuffer::PageBuffer(PageBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, 0)), requested_(other.requested_), backing_(other.backing_) {}
+
+PageBuffer& PageBuffer::operator=(PageBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, 0);
+    requested_ = other.requested_;
+    backing_ = other.backing_;
+  }
+  return *this;
+}
+
+void PageBuffer::release() {
+  if (data_) munmap(data_, mapped_);
+  data_ = nullptr;
+  size_ = mapped_ = 0;
+}
+
+void PageBuffer::grow(size_t bytes) {
+  if (bytes <= size_) return;
+  if (bytes <= mapped_) {  // the rounding slack is already mapped and zero
+    size_ = bytes;
+    return;
+  }
+  PageBuffer bigger(bytes, requested_);
+  if (size_) std::memcpy(bigger.data_, data_, size_);
+  *this = std::move(bigger);
+}
+
+uint64_t process_huge_page_bytes() {
+  std::ifstream in("/proc/self/smaps_rollup");
+  std::string line;
+  uint64_t kb_total = 0;
+  while (std::getline(in, line)) {
+    if (line.rfind("AnonHugePages:", 0) != 0 && line.rfind("Private_Hugetlb:", 0) != 0 &&
+        line.rfind("Shared_Hugetlb:", 0) != 0)
+      continue;
+    std::istringstream fields(line);
+    std::string key;
+    uint64_t kb = 0;
+    fields >> key >> kb;
+    kb_total += kb;
+  }
+  return kb_total * 1024;
+}
+
+TlbCounters::TlbCounters()
+    : dtlb_fd_(open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))),
+      fault_fd_(open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS)) {}
+
+TlbCounters::~TlbCounters() {
+  if (dtlb_fd_ >= 0) close(dtlb_fd_);
+  if (fault_fd_ >= 0) close(fault_fd_);
+}
+
+void TlbCounters::start() {
+  for (int fd : {dtlb_fd_, fault_fd_}) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void TlbCounters::stop() {
+  for (int fd : {dtlb_fd_, fault_fd_})
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t TlbCounters::dtlb_misses() const { return read_counter(dtlb_fd_); }
+uint64_t TlbCounters::page_faults() const { return read_counter(fault_fd_); }
+
+}  // namespace roram
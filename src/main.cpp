@@ -1,8 +1,18 @@
 #include "roram/roram.hpp"
+#include "roram/sharded_roram.hpp"
+#include "roram/remote_storage.hpp"
 #include "roram/path_oram.hpp"
+#include "roram/ring_oram.hpp"
 #include "roram/types.hpp"
 #include "roram/crypto.hpp"
 #include "roram/storage.hpp"
+#include "roram/stats.hpp"
+#include "roram/trace.hpp"
+#include "roram/histogram.hpp"
+#include "roram/huge_pages.hpp"
+#include "roram/basic_sub_oram.hpp"
+#include "roram/read_ahead.hpp"
+#include "roram/results.hpp"
 #include <iostream>
 #include <chrono>
 #include <cstring>
@@ -14,56 +24,104 @@
 #include <algorithm>
 #include <tuple>
 #include <sstream>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
 
 static void usage(const char* prog) {
-  std::cerr << "Usage: " << prog << " <init|read|write|bench|compare|workload> [options]\n"
+  std::cerr << "Usage: " << prog << " <init|read|write|bench|compare|workload|scan|tune|replay-io|trace-convert|diff|footprint> [options]\n"
             << "  init N L [Z] [B]     - init params (N blocks, L max range, Z bucket size, B block bytes)\n"
             << "  read N L a r         - read range [a, a+r) (params N, L)\n"
             << "  write N L a r        - write range [a, a+r) with zeros (params N, L)\n"
             << "  bench N L [trials]   - benchmark range sizes (default 5 trials)\n"
             << "  compare [--N N] [--L L] [--trials T] [--csv path] [--file path] [--seek-penalty-us N]\n"
-            << "          [--path-recursive-pm] [--path-pm-accesses K]\n"
+            << "          [--path-recursive-pm] [--path-pm-budget BYTES] [--path-pm-block B] [--path-batch]\n"
+            << "          [--pm-cutoff E] [--ring [--ring-s S] [--ring-a A]] [--stats-csv path]\n"
+            << "          [--io-heatmap] [--io-csv path] [--json path]\n"
             << "          - rORAM vs Path ORAM; use --seek-penalty-us to simulate seek cost (crossover)\n"
             << "  workload [--mode sequential|fileserver|videoserver] [--queries Q] [--N N] [--L L]\n"
             << "           [--seed S] [--seek-penalty-us N] [--file path] [--csv path] [--trace path]\n"
-            << "           [--path-recursive-pm] [--path-pm-accesses K]\n"
-            << "          - trace-driven synchronous throughput benchmark (queries/sec and MB/s)\n";
+            << "           [--path-recursive-pm] [--path-pm-budget BYTES] [--path-pm-block B] [--path-batch]\n"
+            << "           [--pm-cutoff E] [--batch K] [--bg-evict] [--stash-limit S] [--think-us T]\n"
+            << "           [--shards K] [--in-flight W] [--clients C1,C2,...] [--clients-csv path]\n"
+            << "           [--rate R1,R2,... [--arrival poisson|fixed] [--slo-p99-ms X] [--hdr-csv path]]\n"
+            << "           [--durability none,access,group [--group-size G] [--wal prefix]] [--huge-pages off|thp|explicit]\n"
+            << "           [--generic-core] [--read-ahead D]\n"
+            << "           [--remote unix:PATH|tcp:HOST:PORT] [--rtt-us N] [--ring [--ring-s S] [--ring-a A]]\n"
+            << "           [--stats-csv path] [--io-heatmap] [--io-csv path] [--io-trace path] [--json path]\n"
+            << "          - trace-driven synchronous throughput benchmark (queries/sec and MB/s)\n"
+            << "  scan [--N N] [--L L] [--a A] [--r R] [--file path] [--bg-evict]\n"
+            << "          - stream [a, a+r) (any length) with rORAM::scan vs. hand-chunked Access\n"
+            << "  tune [--N units] [--unit-bytes U] [--mode M | --trace path] [--queries Q] [--Z list] [--B list]\n"
+            << "       [--L list] [--budget-ms T] [--min-queries K] [--warmup W] [--file path | --remote ADDR]\n"
+            << "       [--seek-penalty-us N] [--max-client-bytes X] [--max-p95-ms P] [--max-overhead S] [--csv path]\n"
+            << "          - sweep Z, B, L on one workload; print the Pareto frontier and recommended Params\n"
+            << "  replay-io --trace path --target path [--trees SUBSTR] [--timed] [--sync]\n"
+            << "          - replay a workload --io-trace against a file or device (raw I/O only)\n"
+            << "  trace-convert in.csv out.bin\n"
+            << "          - convert a CSV trace to the binary format --trace loads via mmap\n"
+            << "  diff base.json new.json [--min-change PCT]\n"
+            << "          - compare two --json result files; exit 2 on a significant slowdown (default 5%)\n"
+            << "  footprint [--N N] [--L L] [--Z Z] [--B B] [--pm-cutoff E] [--stash-slack S] [--per-tree]\n"
+            << "            [--parallel-evict]\n"
+            << "          - projected peak client RAM (position maps, stashes, buffers) for rORAM and Path ORAM\n";
 }
 
 // Path ORAM: range read as r sequential Access(addr, "read"). Returns total time in ms.
-static double path_oram_range_read_ms(roram::PathORAM& ram, uint64_t a, uint64_t r,
-                                      roram::PathORAM* pm_oram = nullptr,
-                                      uint64_t pm_accesses_per_data = 0) {
+// With batched: the whole range as one PathORAM::AccessBatch (shared path buckets, one eviction).
+static double path_oram_range_read_ms(roram::PathORAM& ram, uint64_t a, uint64_t r, bool batched = false) {
   auto start = std::chrono::high_resolution_clock::now();
-  for (uint64_t i = 0; i < r; ++i) {
-    ram.Access(a + i, "read");
-    if (pm_oram && pm_accesses_per_data > 0) {
-      for (uint64_t k = 0; k < pm_accesses_per_data; ++k) {
-        pm_oram->Access((a + i + k) % (1ULL << 20), "read");
-      }
-    }
+  if (batched) {
+    std::vector<uint64_t> ids(static_cast<size_t>(r));
+    for (uint64_t i = 0; i < r; ++i) ids[static_cast<size_t>(i)] = a + i;
+    ram.AccessBatch(ids, "read");
+  } else {
+    for (uint64_t i = 0; i < r; ++i) ram.Access(a + i, "read");
   }
   auto end = std::chrono::high_resolution_clock::now();
   return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
 static double path_oram_range_write_ms(roram::PathORAM& ram, uint64_t a, uint64_t r,
-                                       const std::vector<std::vector<uint8_t>>& data,
-                                       roram::PathORAM* pm_oram = nullptr,
-                                       uint64_t pm_accesses_per_data = 0) {
+                                       const std::vector<std::vector<uint8_t>>& data, bool batched = false) {
+  auto start = std::chrono::high_resolution_clock::now();
+  if (batched) {
+    std::vector<uint64_t> ids(static_cast<size_t>(r));
+    for (uint64_t i = 0; i < r; ++i) ids[static_cast<size_t>(i)] = a + i;
+    ram.AccessBatch(ids, "write", &data);
+  } else {
+    for (uint64_t i = 0; i < r; ++i) ram.Access(a + i, "write", &data[static_cast<size_t>(i)]);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Ring ORAM: range as r sequential single-block accesses (writes when data is given). Returns ms.
+static double ring_oram_range_ms(roram::RingORAM& ram, uint64_t a, uint64_t r,
+                                 const std::vector<std::vector<uint8_t>>* data = nullptr) {
   auto start = std::chrono::high_resolution_clock::now();
   for (uint64_t i = 0; i < r; ++i) {
-    ram.Access(a + i, "write", &data[static_cast<size_t>(i)]);
-    if (pm_oram && pm_accesses_per_data > 0) {
-      for (uint64_t k = 0; k < pm_accesses_per_data; ++k) {
-        pm_oram->Access((a + i + k) % (1ULL << 20), "read");
-      }
-    }
+    if (data)
+      ram.Access(a + i, "write", &(*data)[static_cast<size_t>(i)]);
+    else
+      ram.Access(a + i, "read");
   }
   auto end = std::chrono::high_resolution_clock::now();
   return std::chrono::duration<double, std::milli>(end - start).count();
 }
 
+static void print_ring_summary(const roram::RingORAM& ram, uint64_t block_accesses) {
+  const double n = block_accesses > 0 ? static_cast<double>(block_accesses) : 1.0;
+  std::cout << "RingORAM: S=" << ram.options().S << " A=" << ram.options().A << std::setprecision(2)
+            << " online_blocks/access=" << ram.online_blocks() / n
+            << " total_blocks/access=" << ram.total_blocks() / n
+            << " early_reshuffles=" << ram.early_reshuffles() << " stash=" << ram.stash_size()
+            << "\n" << std::setprecision(3);
+}
+
 struct QueryOp {
   uint64_t a;
   uint64_t r;
@@ -130,6 +188,15 @@ static std::vector<QueryOp> make_workload_trace(uint64_t N, uint64_t L, uint64_t
   return trace;
 }
 
+static bool trace_op_in_range(const QueryOp& q, uint64_t N, uint64_t L) {
+  return q.r != 0 && q.r <= L && q.a <= N && q.r <= N - q.a;
+}
+
+static void check_trace_op(const QueryOp& q, uint64_t N, uint64_t L, const std::string& where) {
+  if (q.r == 0 || q.r > L) throw std::runtime_error("workload trace invalid range at " + where);
+  if (!trace_op_in_range(q, N, L)) throw std::runtime_error("workload trace out of bounds at " + where);
+}
+
 static std::vector<QueryOp> load_trace_csv(const std::string& path, uint64_t N, uint64_t L) {
   std::ifstream in(path);
   if (!in) throw std::runtime_error("workload: failed to open trace file: " + path);
@@ -152,14 +219,76 @@ static std::vector<QueryOp> load_trace_csv(const std::string& path, uint64_t N,
     bool is_write = (op_s == "w" || op_s == "W" || op_s == "write" || op_s == "WRITE");
     bool is_read = (op_s == "r" || op_s == "R" || op_s == "read" || op_s == "READ");
     if (!is_write && !is_read) throw std::runtime_error("workload trace invalid op at line " + std::to_string(lineno));
-    if (r == 0 || r > L) throw std::runtime_error("workload trace invalid range at line " + std::to_string(lineno));
-    if (a + r > N) throw std::runtime_error("workload trace out of bounds at line " + std::to_string(lineno));
     trace.push_back(QueryOp{a, r, is_write});
+    if (!trace_op_in_range(trace.back(), N, L)) check_trace_op(trace.back(), N, L, "line " + std::to_string(lineno));
   }
   if (trace.empty()) throw std::runtime_error("workload: empty trace file: " + path);
   return trace;
 }
 
+// A workload's queries: generated or CSV ops held in memory, or a binary trace (see
+// trace-convert) decoded in place from its mapping on every access.
+class Trace {
+ public:
+  struct const_iterator {
+    const Trace* trace;
+    size_t i;
+    QueryOp operator*() const { return (*trace)[i]; }
+    const_iterator& operator++() { ++i; return *this; }
+    bool operator!=(const const_iterator& o) const { return i != o.i; }
+  };
+
+  explicit Trace(std::vector<QueryOp> ops) : ops_(std::move(ops)) {}
+  explicit Trace(std::shared_ptr<const roram::MappedLogicalTrace> mapped) : mapped_(std::move(mapped)) {}
+
+  size_t size() const { return mapped_ ? static_cast<size_t>(mapped_->size()) : ops_.size(); }
+  QueryOp operator[](size_t i) const {
+    if (!mapped_) return ops_[i];
+    const roram::LogicalOp op = (*mapped_)[i];
+    return QueryOp{op.a, op.r, op.is_write};
+  }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, size()}; }
+
+ private:
+  std::vector<QueryOp> ops_;
+  std::shared_ptr<const roram::MappedLogicalTrace> mapped_;
+};
+
+// Binary traces are validated in one pass over the mapping and not copied; anything else
+// is parsed as CSV.
+static Trace load_trace(const std::string& path, uint64_t N, uint64_t L) {
+  if (!roram::MappedLogicalTrace::is_binary(path)) return Trace(load_trace_csv(path, N, L));
+  auto mapped = std::make_shared<const roram::MappedLogicalTrace>(path);
+  if (mapped->size() == 0) throw std::runtime_error("workload: empty trace file: " + path);
+  Trace trace(mapped);
+  for (size_t i = 0; i < trace.size(); ++i) {
+    const QueryOp q = trace[i];
+    if (!trace_op_in_range(q, N, L)) check_trace_op(q, N, L, "record " + std::to_string(i));
+  }
+  return trace;
+}
+
+static std::vector<uint64_t> parse_u64_list(const std::string& s) {
+  std::vector<uint64_t> out;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty()) out.push_back(std::stoull(item));
+  if (out.empty()) throw std::runtime_error("empty list: " + s);
+  return out;
+}
+
+// Two-sided 95% Student t quantile for df degrees of freedom; a handful of trials needs a
+// much wider interval than the normal 1.96.
+static double t95(size_t df) {
+  static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                 2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                 2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df == 0) return 0.0;
+  return df <= 30 ? table[df - 1] : 1.96;
+}
+
 static void mean_std_ci(const std::vector<double>& samples, double& mean, double& std_dev, double& ci_low, double& ci_high) {
   const size_t n = samples.size();
   if (n == 0) { mean = std_dev = ci_low = ci_high = 0; return; }
@@ -169,7 +298,7 @@ static void mean_std_ci(const std::vector<double>& samples, double& mean, double
   double var = 0;
   for (double x : samples) var += (x - mean) * (x - mean);
   std_dev = (n > 1) ? std::sqrt(var / (n - 1)) : 0;
-  const double ci_half = (n > 0) ? (1.96 * std_dev / std::sqrt(static_cast<double>(n))) : 0;
+  const double ci_half = t95(n - 1) * std_dev / std::sqrt(static_cast<double>(n));
   ci_low = mean - ci_half;
   ci_high = mean + ci_half;
 }
@@ -187,6 +316,433 @@ static double percentile(std::vector<double> samples, double p) {
   return samples[lo] * (1.0 - frac) + samples[hi] * frac;
 }
 
+struct ClosedLoopResult {
+  uint64_t clients;
+  double wall_s;
+  double qps;
+  double mbps;
+  double p50_ms, p95_ms, p99_ms;   // over every query of every client
+  double worst_client_p99_ms;      // fairness: the slowest client's own p99
+};
+
+// C closed-loop clients, one thread each: client c issues queries c, c+C, c+2C, ... of the
+// trace, each only after the previous one completed (plus think_us). Target is anything
+// with submit(client, RangeRequest) -> future (ORAMFrontend, ShardedRORAM).
+template <class Target>
+static ClosedLoopResult run_closed_loop(Target& target, const Trace& trace, uint64_t clients,
+                                        size_t B, uint64_t think_us) {
+  std::vector<std::vector<double>> lat_ms(static_cast<size_t>(clients));
+  std::vector<std::exception_ptr> errors(static_cast<size_t>(clients));
+  std::vector<std::thread> threads;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint64_t c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c]() {
+      try {
+        for (size_t n = static_cast<size_t>(c); n < trace.size(); n += static_cast<size_t>(clients)) {
+          const auto& q = trace[n];
+          roram::RangeRequest req{q.a, q.r, q.is_write ? "write" : "read", {}};
+          if (q.is_write) req.data.assign(q.r, std::vector<uint8_t>(B, 0));
+          auto t0 = std::chrono::high_resolution_clock::now();
+          target.submit(c, std::move(req)).get();
+          auto t1 = std::chrono::high_resolution_clock::now();
+          lat_ms[static_cast<size_t>(c)].push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+          if (think_us) std::this_thread::sleep_for(std::chrono::microseconds(think_us));
+        }
+      } catch (...) {
+        errors[static_cast<size_t>(c)] = std::current_exception();
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  auto end = std::chrono::high_resolution_clock::now();
+  for (const auto& e : errors)
+    if (e) std::rethrow_exception(e);
+
+  ClosedLoopResult res{};
+  res.clients = clients;
+  res.wall_s = std::chrono::duration<double>(end - start).count();
+  uint64_t logical_bytes = 0;
+  for (const auto& q : trace) logical_bytes += q.r * static_cast<uint64_t>(B);
+  res.qps = res.wall_s > 0 ? trace.size() / res.wall_s : 0.0;
+  res.mbps = res.wall_s > 0 ? (logical_bytes / 1048576.0) / res.wall_s : 0.0;
+  std::vector<double> all;
+  for (const auto& v : lat_ms) {
+    all.insert(all.end(), v.begin(), v.end());
+    res.worst_client_p99_ms = std::max(res.worst_client_p99_ms, percentile(v, 0.99));
+  }
+  res.p50_ms = percentile(all, 0.50);
+  res.p95_ms = percentile(all, 0.95);
+  res.p99_ms = percentile(all, 0.99);
+  return res;
+}
+
+struct OpenLoopResult {
+  double rate;          // target arrivals per second
+  double achieved_qps;  // completions / wall time (falls behind rate once saturated)
+  double mbps;
+  roram::LatencyHistogram hist;  // completion - intended send time, ns
+};
+
+// Open-loop load: query n is due at start + t_n, with gaps 1/rate (fixed) or exponential
+// with mean 1/rate (poisson), whether or not earlier queries have completed. A dispatcher
+// thread submits on schedule (each query as its own client, so the scheduler may batch them)
+// and latency runs from the intended send time, so queueing delay is charged to the queries
+// that waited instead of being hidden by a stalled sender (coordinated omission). Completions
+// are collected in submission order, which can only overstate a query that finished before
+// an older one.
+template <class Target>
+static OpenLoopResult run_open_loop(Target& target, const Trace& trace, double rate,
+                                    bool poisson, uint64_t seed, size_t B) {
+  using clock = std::chrono::steady_clock;
+  std::vector<clock::duration> due(trace.size());
+  double t_s = 0.0;
+  for (size_t n = 0; n < trace.size(); ++n) {
+    due[n] = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(t_s));
+    double gap = 1.0 / rate;
+    if (poisson) {
+      const double u = (static_cast<double>(lcg_next(seed) >> 11) + 0.5) / 9007199254740992.0;  // (0, 1)
+      gap = -std::log(u) / rate;
+    }
+    t_s += gap;
+  }
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::pair<std::future<typename Target::Result>, clock::time_point>> inflight;
+  std::exception_ptr error;
+  const clock::time_point start = clock::now();
+  std::thread dispatcher([&]() {
+    try {
+      for (size_t n = 0; n < trace.size(); ++n) {
+        const clock::time_point intended = start + due[n];
+        std::this_thread::sleep_until(intended);
+        const auto& q = trace[n];
+        roram::RangeRequest req{q.a, q.r, q.is_write ? "write" : "read", {}};
+        if (q.is_write) req.data.assign(q.r, std::vector<uint8_t>(B, 0));
+        auto fut = target.submit(n, std::move(req));
+        std::lock_guard<std::mutex> lock(mu);
+        inflight.emplace_back(std::move(fut), intended);
+        cv.notify_one();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mu);
+      error = std::current_exception();
+      cv.notify_one();
+    }
+  });
+
+  OpenLoopResult res{rate, 0.0, 0.0, roram::LatencyHistogram()};
+  uint64_t logical_bytes = 0;
+  std::exception_ptr collect_error;
+  try {
+    for (size_t done = 0; done < trace.size(); ++done) {
+      std::unique_lock<std::mutex> lock(mu);
+      cv.wait(lock, [&]() { return !inflight.empty() || error; });
+      if (inflight.empty()) break;  // dispatcher failed
+      auto next = std::move(inflight.front());
+      inflight.pop_front();
+      lock.unlock();
+      next.first.get();
+      res.hist.record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - next.second).count()));
+      logical_bytes += trace[done].r * static_cast<uint64_t>(B);
+    }
+  } catch (...) {
+    collect_error = std::current_exception();
+  }
+  dispatcher.join();
+  if (collect_error) std::rethrow_exception(collect_error);
+  if (error) std::rethrow_exception(error);
+  const double wall_s = std::chrono::duration<double>(clock::now() - start).count();
+  res.achieved_qps = wall_s > 0 ? res.hist.count() / wall_s : 0.0;
+  res.mbps = wall_s > 0 ? (logical_bytes / 1048576.0) / wall_s : 0.0;
+  return res;
+}
+
+static std::vector<double> parse_double_list(const std::string& s) {
+  std::vector<double> out;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty()) out.push_back(std::stod(item));
+  if (out.empty()) throw std::runtime_error("empty list: " + s);
+  return out;
+}
+
+static void print_open_loop(const std::vector<OpenLoopResult>& results, const std::string& target,
+                            const std::string& arrival, double slo_p99_ms) {
+  auto ms = [](uint64_t ns) { return ns / 1e6; };
+  std::cout << "rORAM open-loop (" << target << ", " << arrival << " arrivals; latency from intended send time):\n";
+  std::cout << std::setw(12) << "rate_qps" << std::setw(14) << "achieved_qps" << std::setw(12) << "mbps"
+            << std::setw(12) << "mean_ms" << std::setw(12) << "p50_ms" << std::setw(12) << "p99_ms"
+            << std::setw(12) << "p99.9_ms" << std::setw(12) << "max_ms" << "\n";
+  double sustainable = 0;
+  for (const auto& r : results) {
+    std::cout << std::setw(12) << r.rate << std::setw(14) << r.achieved_qps << std::setw(12) << r.mbps
+              << std::setw(12) << r.hist.mean() / 1e6 << std::setw(12) << ms(r.hist.value_at(0.50))
+              << std::setw(12) << ms(r.hist.value_at(0.99)) << std::setw(12) << ms(r.hist.value_at(0.999))
+              << std::setw(12) << ms(r.hist.max()) << "\n";
+    if (slo_p99_ms > 0 && ms(r.hist.value_at(0.99)) <= slo_p99_ms) sustainable = std::max(sustainable, r.rate);
+  }
+  if (slo_p99_ms > 0) {
+    std::cout << "Sustainable rate under p99 <= " << slo_p99_ms << " ms: ";
+    if (sustainable > 0) std::cout << sustainable << " qps\n";
+    else std::cout << "none of the tested rates\n";
+  }
+}
+
+// HDR-style percentile distribution, one row per non-empty histogram bucket and rate.
+static void write_hdr_csv(const std::string& path, const std::vector<OpenLoopResult>& results) {
+  if (path.empty() || results.empty()) return;
+  std::ofstream out(path);
+  if (!out) return;
+  out << "rate_qps,value_ms,percentile,count,total_count\n";
+  for (const auto& r : results) {
+    uint64_t seen = 0;
+    for (const auto& b : r.hist.buckets()) {
+      seen += b.count;
+      out << r.rate << "," << std::min(b.hi, r.hist.max()) / 1e6 << ","
+          << static_cast<double>(seen) / static_cast<double>(r.hist.count()) << "," << b.count << ","
+          << r.hist.count() << "\n";
+    }
+  }
+  std::cout << "Wrote " << path << "\n";
+}
+
+struct DurabilityResult {
+  roram::Durability mode;
+  double wall_s;
+  double qps;
+  double mbps;
+  double p50_ms;
+  double p99_ms;
+  uint64_t commits;
+  double sync_ms;  // Phase::Sync: tree fdatasyncs plus client-state log appends
+};
+
+// The trace on one file-backed rORAM under a durability mode, one query (or --batch
+// queries via access_batch) at a time. The final commit() is part of the wall time.
+static DurabilityResult run_durability(roram::rORAM& ram, roram::Durability mode, const Trace& trace,
+                                       uint64_t batch, size_t B) {
+  std::vector<double> per_query_ms;
+  per_query_ms.reserve(trace.size());
+  uint64_t logical_bytes = 0;
+  ram.reset_stats();
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t off = 0; off < trace.size(); off += batch) {
+    const size_t end_idx = std::min(trace.size(), off + static_cast<size_t>(batch));
+    std::vector<roram::RangeRequest> reqs;
+    for (size_t n = off; n < end_idx; ++n) {
+      const QueryOp& q = trace[n];
+      reqs.push_back(roram::RangeRequest{q.a, q.r, q.is_write ? "write" : "read", {}});
+      if (q.is_write) reqs.back().data.assign(q.r, std::vector<uint8_t>(B, 0));
+      logical_bytes += q.r * static_cast<uint64_t>(B);
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    if (reqs.size() == 1)
+      ram.Access(reqs[0].a, reqs[0].r, reqs[0].op, reqs[0].op == "write" ? &reqs[0].data : nullptr);
+    else
+      ram.access_batch(reqs);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    for (size_t n = off; n < end_idx; ++n) per_query_ms.push_back(ms / static_cast<double>(end_idx - off));
+  }
+  ram.commit();
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  DurabilityResult res{};
+  res.mode = mode;
+  res.wall_s = wall_s;
+  res.qps = wall_s > 0 ? trace.size() / wall_s : 0.0;
+  res.mbps = wall_s > 0 ? (logical_bytes / 1048576.0) / wall_s : 0.0;
+  res.p50_ms = percentile(per_query_ms, 0.50);
+  res.p99_ms = percentile(per_query_ms, 0.99);
+  res.commits = ram.commits();
+  res.sync_ms = ram.stats()[roram::Phase::Sync].ns / 1e6;
+  return res;
+}
+
+static void print_durability(const std::vector<DurabilityResult>& results, uint64_t group_size, uint64_t batch) {
+  std::cout << "rORAM durability (group_size=" << group_size << " batch=" << batch << "):\n";
+  std::cout << std::setw(10) << "mode" << std::setw(12) << "wall_s" << std::setw(14) << "qps" << std::setw(14)
+            << "mbps" << std::setw(12) << "p50_ms" << std::setw(12) << "p99_ms" << std::setw(10) << "commits"
+            << std::setw(12) << "sync_ms" << std::setw(14) << "qps_vs_none" << "\n";
+  const DurabilityResult* none = nullptr;
+  for (const auto& r : results)
+    if (r.mode == roram::Durability::None) none = &r;
+  for (const auto& r : results) {
+    std::cout << std::setw(10) << roram::durability_name(r.mode) << std::setw(12) << r.wall_s << std::setw(14) << r.qps
+              << std::setw(14) << r.mbps << std::setw(12) << r.p50_ms << std::setw(12) << r.p99_ms << std::setw(10)
+              << r.commits << std::setw(12) << r.sync_ms << std::setw(14);
+    if (none && none->qps > 0)
+      std::cout << r.qps / none->qps;
+    else
+      std::cout << "-";
+    std::cout << "\n";
+  }
+}
+
+// Client RAM rows (bytes): now / peak per scheme, plus the footprint projection for comparison.
+static void print_memory_usage(const std::vector<std::pair<std::string, roram::MemoryUsage>>& rows) {
+  std::cout << "Client memory (bytes; peak = per-tree high-water marks summed, an upper bound)\n";
+  std::cout << std::setw(22) << "" << std::setw(14) << "position_map" << std::setw(14) << "stash_blocks"
+            << std::setw(15) << "stash_payload" << std::setw(12) << "scratch" << std::setw(14) << "evict_bufs"
+            << std::setw(14) << "total"
+            << std::setw(10) << "MiB" << std::setw(10) << "stashed" << "\n";
+  for (const auto& row : rows) {
+    const roram::MemoryUsage& m = row.second;
+    std::cout << std::setw(22) << row.first << std::setw(14) << m.position_map << std::setw(14) << m.stash_blocks
+              << std::setw(15) << m.stash_payload << std::setw(12) << m.scratch << std::setw(14) << m.evict_buffers
+              << std::setw(14) << m.total()
+              << std::setw(10) << std::setprecision(2) << m.total() / 1048576.0 << std::setw(10) << m.stashed
+              << "\n" << std::setprecision(3);
+  }
+}
+
+// --json: the run's common header; commands append config entries and result rows.
+static roram::ResultSet make_result_set(const std::string& command, const std::string& file_path,
+                                        const std::string& remote = "") {
+  roram::ResultSet rs;
+  rs.command = command;
+  rs.git_rev = roram::git_revision();
+  rs.backend = !remote.empty() ? "remote:" + remote : (file_path.empty() ? "memory" : "file");
+  rs.crypto = "noop";  // the CLI always runs NoOpCrypto
+  return rs;
+}
+
+static void add_result(roram::ResultSet& rs, const std::string& scheme, const std::string& label,
+                       const roram::Params& params, const std::vector<double>& samples_ms,
+                       std::vector<std::pair<std::string, double>> metrics) {
+  roram::ResultRecord rec(scheme, label, params);
+  rec.metrics = std::move(metrics);
+  rec.samples_ms = samples_ms;
+  rs.results.push_back(std::move(rec));
+}
+
+static void print_pm_summary(const roram::rORAM& ram, const roram::PathORAM& path, uint64_t pm_cutoff) {
+  std::cout << "Position maps: rORAM client_bytes=" << ram.position_map_client_bytes();
+  if (pm_cutoff > 0) std::cout << " (maps > " << pm_cutoff << " entries outsourced)";
+  std::cout << "  PathORAM client_bytes=" << path.position_map_bytes();
+  if (path.recursion_depth() > 0) std::cout << " (recursive, depth=" << path.recursion_depth() << ")";
+  std::cout << "\n";
+}
+
+// --path-recursive-pm: PathORAM position map recursion under a client budget.
+struct PathPmOptions {
+  bool recursive = false;
+  uint64_t budget = 4096;   // client bytes for the innermost map
+  size_t block_size = 64;   // bytes per position-map block
+  uint64_t client_budget() const { return recursive ? budget : 0; }
+};
+
+static bool parse_path_pm_flag(const std::string& arg, int& i, int argc, char** argv, PathPmOptions& pm) {
+  if (arg == "--path-recursive-pm") { pm.recursive = true; return true; }
+  if (arg == "--path-pm-budget" && i + 1 < argc) { pm.budget = std::stoull(argv[++i]); return true; }
+  if (arg == "--path-pm-block" && i + 1 < argc) { pm.block_size = static_cast<size_t>(std::stoull(argv[++i])); return true; }
+  if (arg == "--path-pm-accesses" && i + 1 < argc) {
+    ++i;
+    std::cerr << "note: --path-pm-accesses is ignored; --path-recursive-pm now runs a real recursive map\n";
+    return true;
+  }
+  return false;
+}
+
+// Per-phase breakdown of one scheme; wall_ms is the measured operation time (no seek
+// penalty). Storage phases nest inside read_range and evict_*, so shares overlap.
+static void print_phase_breakdown(const std::string& scheme, const roram::StatsSnapshot& s, double wall_ms) {
+  bool any = false;
+  for (const auto& t : s.phases) any = any || t.count > 0;
+  if (!any) return;
+  std::cout << "Phase breakdown " << scheme << " (wall_ms=" << std::setprecision(1) << wall_ms
+            << "; serialize/encrypt/decrypt/raw_io nest inside read_range and evict_*)\n" << std::setprecision(3);
+  auto row = [wall_ms](const std::string& name, const roram::PhaseTotals& t) {
+    const double ms = t.ns / 1e6;
+    std::cout << std::setw(20) << name << std::setw(12) << t.count << std::setw(14) << ms
+              << std::setw(14) << (t.count > 0 ? double(t.ns) / t.count : 0.0) << std::setw(10)
+              << std::setprecision(1) << (wall_ms > 0 ? 100.0 * ms / wall_ms : 0.0) << "%\n" << std::setprecision(3);
+  };
+  std::cout << std::setw(20) << "phase" << std::setw(12) << "count" << std::setw(14) << "total_ms"
+            << std::setw(14) << "ns_per_op" << std::setw(11) << "wall" << "\n";
+  for (int k = 0; k < roram::kNumPhases; ++k) {
+    const roram::PhaseTotals& t = s.phases[static_cast<size_t>(k)];
+    if (t.count > 0) row(roram::phase_name(static_cast<roram::Phase>(k)), t);
+  }
+  for (size_t j = 0; j < s.read_range_levels.size(); ++j)
+    if (s.read_range_levels[j].count > 0) row("  read_range[i=" + std::to_string(j) + "]", s.read_range_levels[j]);
+}
+
+static void write_phase_csv(std::ofstream& csv, const std::string& scheme, const roram::StatsSnapshot& s,
+                            double wall_ms) {
+  auto row = [&](const std::string& phase, const std::string& level, const roram::PhaseTotals& t) {
+    const double ms = t.ns / 1e6;
+    csv << scheme << "," << phase << "," << level << "," << t.count << "," << ms << ","
+        << (t.count > 0 ? double(t.ns) / t.count : 0.0) << "," << (wall_ms > 0 ? ms / wall_ms : 0.0) << "\n";
+  };
+  for (int k = 0; k < roram::kNumPhases; ++k)
+    row(roram::phase_name(static_cast<roram::Phase>(k)), "", s.phases[static_cast<size_t>(k)]);
+  for (size_t j = 0; j < s.read_range_levels.size(); ++j)
+    row("read_range", std::to_string(j), s.read_range_levels[j]);
+}
+
+// --stats-csv: one row per (scheme, phase) plus read_range rows per sub-ORAM level.
+static void write_stats_csv(const std::string& path,
+                            const std::vector<std::tuple<std::string, roram::StatsSnapshot, double>>& schemes) {
+  if (path.empty()) return;
+  std::ofstream csv(path);
+  if (!csv) return;
+  csv << "scheme,phase,level,count,total_ms,ns_per_op,wall_share\n";
+  for (const auto& [scheme, snap, wall_ms] : schemes) write_phase_csv(csv, scheme, snap, wall_ms);
+  std::cout << "Wrote " << path << "\n";
+}
+
+// --io-heatmap: level-by-level I/O of one scheme's data trees; heat is the level's share
+// of the seeks. Amplification is stored bytes moved per logical byte requested.
+static void print_io_heatmap(const std::string& scheme, const roram::IoStats& io, uint64_t logical_bytes) {
+  const roram::LevelIoStats total = io.total();
+  uint64_t max_seeks = 0;
+  for (const auto& l : io.levels) max_seeks = std::max(max_seeks, l.seeks);
+  const double lb = logical_bytes > 0 ? static_cast<double>(logical_bytes) : 1.0;
+  std::cout << "I/O by level " << scheme << std::setprecision(2) << " (read_amp=" << total.bytes_read / lb
+            << " write_amp=" << total.bytes_written / lb << " seeks=" << total.seeks << ")\n";
+  std::cout << std::setw(6) << "level" << std::setw(10) << "reads" << std::setw(10) << "writes"
+            << std::setw(12) << "buckets_r" << std::setw(12) << "buckets_w" << std::setw(12) << "MB_read"
+            << std::setw(12) << "MB_written" << std::setw(10) << "seeks" << std::setw(14) << "avg_seek_KB"
+            << std::setw(10) << "max_run" << "  heat\n";
+  for (size_t j = 0; j < io.levels.size(); ++j) {
+    const roram::LevelIoStats& l = io.levels[j];
+    const int bar = max_seeks > 0 ? static_cast<int>((20 * l.seeks + max_seeks - 1) / max_seeks) : 0;
+    std::cout << std::setw(6) << j << std::setw(10) << l.read_requests << std::setw(10) << l.write_requests
+              << std::setw(12) << l.buckets_read << std::setw(12) << l.buckets_written
+              << std::setw(12) << l.bytes_read / 1048576.0 << std::setw(12) << l.bytes_written / 1048576.0
+              << std::setw(10) << l.seeks << std::setw(14) << (l.seeks > 0 ? l.seek_distance / 1024.0 / l.seeks : 0.0)
+              << std::setw(10) << l.max_run_buckets << "  " << std::string(static_cast<size_t>(bar), '#') << "\n";
+  }
+  std::cout << std::setprecision(3);
+}
+
+// --io-csv: one row per (scheme, level).
+static void write_io_csv(const std::string& path, const std::vector<std::pair<std::string, roram::IoStats>>& schemes) {
+  if (path.empty()) return;
+  std::ofstream csv(path);
+  if (!csv) return;
+  csv << "scheme,level,read_requests,write_requests,buckets_read,buckets_written,bytes_read,bytes_written,"
+         "seeks,seek_distance_bytes,max_run_buckets\n";
+  for (const auto& [scheme, io] : schemes) {
+    for (size_t j = 0; j < io.levels.size(); ++j) {
+      const roram::LevelIoStats& l = io.levels[j];
+      csv << scheme << "," << j << "," << l.read_requests << "," << l.write_requests << "," << l.buckets_read << ","
+          << l.buckets_written << "," << l.bytes_read << "," << l.bytes_written << "," << l.seeks << ","
+          << l.seek_distance << "," << l.max_run_buckets << "\n";
+    }
+  }
+  std::cout << "Wrote " << path << "\n";
+}
+
+static void print_path_pm_accesses(const roram::PathORAM& path, uint64_t queries) {
+  if (path.recursion_depth() == 0) return;
+  std::cout << "PathORAM position-map ORAM accesses: " << path.position_map_accesses() << " ("
+            << std::setprecision(2) << (queries > 0 ? double(path.position_map_accesses()) / queries : 0.0)
+            << " per query)\n" << std::setprecision(3);
+}
+
 int main_init(int argc, char** argv) {
   if (argc < 4) { usage(argv[0]); return 1; }
   uint64_t N = std::stoull(argv[2]);
@@ -261,19 +817,34 @@ static int main_compare(int argc, char** argv) {
   uint64_t L = 8192;
   int trials = 5;
   uint64_t seek_penalty_us = 0;
-  bool path_recursive_pm = false;
-  uint64_t path_pm_accesses = 0;
+  PathPmOptions path_pm;
+  bool path_batch = false;
+  uint64_t pm_cutoff = 0;
+  bool ring = false;
+  roram::RingOptions ring_opts;
   std::string csv_path;
+  std::string stats_csv_path;
+  std::string io_csv_path;
+  std::string json_path;
+  bool io_heatmap = false;
   std::string file_path;
   for (int i = 2; i < argc; ++i) {
     std::string arg = argv[i];
     if (arg == "--N" && i + 1 < argc) { N = std::stoull(argv[++i]); continue; }
     if (arg == "--L" && i + 1 < argc) { L = std::stoull(argv[++i]); continue; }
     if (arg == "--trials" && i + 1 < argc) { trials = std::stoi(argv[++i]); continue; }
+    if (arg == "--json" && i + 1 < argc) { json_path = argv[++i]; continue; }
     if (arg == "--seek-penalty-us" && i + 1 < argc) { seek_penalty_us = std::stoull(argv[++i]); continue; }
-    if (arg == "--path-recursive-pm") { path_recursive_pm = true; continue; }
-    if (arg == "--path-pm-accesses" && i + 1 < argc) { path_pm_accesses = std::stoull(argv[++i]); continue; }
+    if (parse_path_pm_flag(arg, i, argc, argv, path_pm)) continue;
+    if (arg == "--path-batch") { path_batch = true; continue; }
+    if (arg == "--pm-cutoff" && i + 1 < argc) { pm_cutoff = std::stoull(argv[++i]); continue; }
+    if (arg == "--ring") { ring = true; continue; }
+    if (arg == "--ring-s" && i + 1 < argc) { ring_opts.S = std::stoi(argv[++i]); continue; }
+    if (arg == "--ring-a" && i + 1 < argc) { ring_opts.A = std::stoi(argv[++i]); continue; }
     if (arg == "--csv" && i + 1 < argc) { csv_path = argv[++i]; continue; }
+    if (arg == "--stats-csv" && i + 1 < argc) { stats_csv_path = argv[++i]; continue; }
+    if (arg == "--io-heatmap") { io_heatmap = true; continue; }
+    if (arg == "--io-csv" && i + 1 < argc) { io_csv_path = argv[++i]; continue; }
     if (arg == "--file" && i + 1 < argc) { file_path = argv[++i]; continue; }
   }
   const int Z = 4;
@@ -284,21 +855,36 @@ static int main_compare(int argc, char** argv) {
   const bool count_seeks = use_file;  // enable seek counting when using file storage
   auto crypto1 = std::make_unique<roram::NoOpCrypto>();
   auto crypto2 = std::make_unique<roram::NoOpCrypto>();
-  auto crypto_pm = std::make_unique<roram::NoOpCrypto>();
-  roram::rORAM ram_roram(params_roram, std::move(crypto1), !use_file, use_file ? (file_path + "_roram") : "", count_seeks);
-  roram::PathORAM ram_path(params_path, std::move(crypto2), !use_file, use_file ? (file_path + "_path") : "", count_seeks);
-  std::unique_ptr<roram::PathORAM> ram_path_pm;
-  if (path_recursive_pm) {
-    if (path_pm_accesses == 0) path_pm_accesses = static_cast<uint64_t>(2 * (params_path.h + 1));
-    roram::Params params_pm(1ULL << 20, 1, Z, 64);
-    ram_path_pm = std::make_unique<roram::PathORAM>(params_pm, std::move(crypto_pm), !use_file,
-                                                     use_file ? (file_path + "_pathpm") : "", count_seeks);
+  roram::rORAM ram_roram(params_roram, std::move(crypto1), !use_file, use_file ? (file_path + "_roram") : "", count_seeks,
+                         pm_cutoff);
+  roram::PathORAM ram_path(params_path, std::move(crypto2), !use_file, use_file ? (file_path + "_path") : "", count_seeks,
+                           path_pm.client_budget(), path_pm.block_size);
+  std::unique_ptr<roram::RingORAM> ram_ring;
+  if (ring) {
+    ram_ring = std::make_unique<roram::RingORAM>(params_path, std::make_unique<roram::NoOpCrypto>(), ring_opts,
+                                                 !use_file, use_file ? (file_path + "_ring") : "", count_seeks);
   }
+  uint64_t ring_block_accesses = 0;
+  uint64_t logical_total = 0;  // bytes requested per scheme, for amplification
+  ram_roram.reset_stats();  // drop the position-map fill done at construction
+  ram_path.reset_stats();
+  ram_roram.reset_io_stats();
+  ram_path.reset_io_stats();
+  ram_roram.reset_peak_memory();
+  ram_path.reset_peak_memory();
+  double wall_ms_r = 0, wall_ms_p = 0;
 
   const int max_exp = std::min(params_roram.ell, 14);
+  roram::ResultSet results = make_result_set("compare", file_path);
+  results.config = {{"trials", std::to_string(trials)}, {"seek_penalty_us", std::to_string(seek_penalty_us)},
+                    {"path_batch", path_batch ? "1" : "0"}, {"pm_cutoff", std::to_string(pm_cutoff)},
+                    {"path_pm_budget", std::to_string(path_pm.client_budget())}};
   std::cout << "Compare rORAM vs Path ORAM  N=" << N << " L=" << L << " trials=" << trials;
   if (seek_penalty_us) std::cout << " seek_penalty_us=" << seek_penalty_us;
+  if (path_batch) std::cout << " path_batch=1";
+  std::cout << " core=" << (ram_roram.specialized_trees() > 0 ? "specialized" : "generic");
   std::cout << "\n";
+  print_pm_summary(ram_roram, ram_path, pm_cutoff);
   std::cout << std::string(120, '-') << "\n";
   std::cout << std::setw(12) << "range_size" << std::setw(12) << "scheme"
             << std::setw(14) << "mean_ms" << std::setw(12) << "p50_ms" << std::setw(12) << "p95_ms"
@@ -317,8 +903,8 @@ static int main_compare(int argc, char** argv) {
     if (r_size > N) break;
     uint64_t max_start = (N > r_size) ? (N - r_size) : 0;
 
-    std::vector<double> times_roram, times_path;
-    std::vector<uint64_t> seeks_roram, seeks_path;
+    std::vector<double> times_roram, times_path, times_ring;
+    std::vector<uint64_t> seeks_roram, seeks_path, seeks_ring;
     times_roram.reserve(static_cast<size_t>(trials));
     times_path.reserve(static_cast<size_t>(trials));
     seeks_roram.reserve(static_cast<size_t>(trials));
@@ -333,16 +919,25 @@ static int main_compare(int argc, char** argv) {
       double elapsed_r = std::chrono::duration<double, std::milli>(end - start).count();
       double reported_r = elapsed_r + (seek_penalty_us > 0 ? (seek_after_r - seek_before_r) * (seek_penalty_us / 1000.0) : 0);
       times_roram.push_back(reported_r);
+      wall_ms_r += elapsed_r;
       seeks_roram.push_back(seek_after_r - seek_before_r);
 
       uint64_t seek_before_p = ram_path.get_seek_count();
-      if (ram_path_pm) seek_before_p += ram_path_pm->get_seek_count();
-      double elapsed_p = path_oram_range_read_ms(ram_path, a, r_size, ram_path_pm.get(), path_pm_accesses);
+      double elapsed_p = path_oram_range_read_ms(ram_path, a, r_size, path_batch);
       uint64_t seek_after_p = ram_path.get_seek_count();
-      if (ram_path_pm) seek_after_p += ram_path_pm->get_seek_count();
       double reported_p = elapsed_p + (seek_penalty_us > 0 ? (seek_after_p - seek_before_p) * (seek_penalty_us / 1000.0) : 0);
       times_path.push_back(reported_p);
+      wall_ms_p += elapsed_p;
       seeks_path.push_back(seek_after_p - seek_before_p);
+
+      if (ram_ring) {
+        uint64_t seek_before_g = ram_ring->get_seek_count();
+        double elapsed_g = ring_oram_range_ms(*ram_ring, a, r_size);
+        uint64_t seek_after_g = ram_ring->get_seek_count();
+        times_ring.push_back(elapsed_g + (seek_penalty_us > 0 ? (seek_after_g - seek_before_g) * (seek_penalty_us / 1000.0) : 0));
+        seeks_ring.push_back(seek_after_g - seek_before_g);
+        ring_block_accesses += r_size;
+      }
     }
     double mean_r, std_r, ci_lo_r, ci_hi_r, mean_p, std_p, ci_lo_p, ci_hi_p;
     mean_std_ci(times_roram, mean_r, std_r, ci_lo_r, ci_hi_r);
@@ -354,6 +949,7 @@ static int main_compare(int argc, char** argv) {
     const double p50_p = percentile(times_path, 0.50);
     const double p95_p = percentile(times_path, 0.95);
     const uint64_t logical_bytes = r_size * static_cast<uint64_t>(B);
+    logical_total += logical_bytes * static_cast<uint64_t>(trials);
     uint64_t mean_seeks_r = 0, mean_seeks_p = 0;
     for (size_t i = 0; i < seeks_roram.size(); ++i) { mean_seeks_r += seeks_roram[i]; }
     for (size_t i = 0; i < seeks_path.size(); ++i) { mean_seeks_p += seeks_path[i]; }
@@ -374,8 +970,57 @@ static int main_compare(int argc, char** argv) {
       csv << "PathORAM," << exp << "," << r_size << "," << mean_p << "," << p50_p << "," << p95_p << "," << std_p
           << "," << per_block_p << "," << logical_bytes << "," << mean_seeks_p << "," << ci_lo_p << "," << ci_hi_p << "\n";
     }
+    const std::string label = "r=" + std::to_string(r_size);
+    add_result(results, "rORAM", label, params_roram, times_roram,
+               {{"mean_ms", mean_r}, {"p50_ms", p50_r}, {"p95_ms", p95_r}, {"std_ms", std_r},
+                {"time_per_block_ms", per_block_r}, {"mean_seeks", double(mean_seeks_r)}, {"ci_low", ci_lo_r}, {"ci_high", ci_hi_r}});
+    add_result(results, "PathORAM", label, params_path, times_path,
+               {{"mean_ms", mean_p}, {"p50_ms", p50_p}, {"p95_ms", p95_p}, {"std_ms", std_p},
+                {"time_per_block_ms", per_block_p}, {"mean_seeks", double(mean_seeks_p)}, {"ci_low", ci_lo_p}, {"ci_high", ci_hi_p}});
+    if (ram_ring) {
+      double mean_g, std_g, ci_lo_g, ci_hi_g;
+      mean_std_ci(times_ring, mean_g, std_g, ci_lo_g, ci_hi_g);
+      const double per_block_g = r_size > 0 ? mean_g / r_size : 0;
+      const double p50_g = percentile(times_ring, 0.50);
+      const double p95_g = percentile(times_ring, 0.95);
+      uint64_t mean_seeks_g = 0;
+      for (uint64_t v : seeks_ring) mean_seeks_g += v;
+      mean_seeks_g = (trials > 0) ? (mean_seeks_g + trials / 2) / trials : 0;
+      std::cout << std::setw(12) << r_size << std::setw(12) << "RingORAM"
+                << std::setw(14) << mean_g << std::setw(12) << p50_g << std::setw(12) << p95_g
+                << std::setw(20) << per_block_g << std::setw(14) << logical_bytes
+                << std::setw(14) << mean_seeks_g << std::setw(12) << ci_lo_g << std::setw(12) << ci_hi_g << "\n";
+      if (csv.is_open()) {
+        csv << "RingORAM," << exp << "," << r_size << "," << mean_g << "," << p50_g << "," << p95_g << "," << std_g
+            << "," << per_block_g << "," << logical_bytes << "," << mean_seeks_g << "," << ci_lo_g << "," << ci_hi_g << "\n";
+      }
+      add_result(results, "RingORAM", label, params_path, times_ring,
+                 {{"mean_ms", mean_g}, {"p50_ms", p50_g}, {"p95_ms", p95_g}, {"std_ms", std_g},
+                  {"time_per_block_ms", per_block_g}, {"mean_seeks", double(mean_seeks_g)}, {"ci_low", ci_lo_g}, {"ci_high", ci_hi_g}});
+    }
   }
+  if (pm_cutoff > 0) std::cout << "rORAM position-map ORAM accesses: " << ram_roram.position_map_accesses() << "\n";
+  print_path_pm_accesses(ram_path, static_cast<uint64_t>(trials) * static_cast<uint64_t>(max_exp + 1));
+  if (ram_ring) print_ring_summary(*ram_ring, ring_block_accesses);
+  const roram::StatsSnapshot stats_r = ram_roram.stats(), stats_p = ram_path.stats();
+  print_phase_breakdown("rORAM", stats_r, wall_ms_r);
+  print_phase_breakdown("PathORAM", stats_p, wall_ms_p);
   if (csv.is_open()) { csv.close(); std::cout << "Wrote " << csv_path << "\n"; }
+  write_stats_csv(stats_csv_path, {{"rORAM", stats_r, wall_ms_r}, {"PathORAM", stats_p, wall_ms_p}});
+  if (io_heatmap) {
+    print_io_heatmap("rORAM", ram_roram.io_stats(), logical_total);
+    print_io_heatmap("PathORAM", ram_path.io_stats(), logical_total);
+  }
+  write_io_csv(io_csv_path, {{"rORAM", ram_roram.io_stats()}, {"PathORAM", ram_path.io_stats()}});
+  print_memory_usage({{"rORAM now", ram_roram.memory_usage()},
+                      {"rORAM peak", ram_roram.peak_memory_usage()},
+                      {"rORAM projected", roram::project_roram_memory(params_roram, pm_cutoff)},
+                      {"PathORAM now", ram_path.memory_usage()},
+                      {"PathORAM peak", ram_path.peak_memory_usage()}});
+  if (!json_path.empty()) {
+    roram::write_results_json(json_path, results);
+    std::cout << "Wrote " << json_path << "\n";
+  }
   return 0;
 }
 
@@ -385,11 +1030,38 @@ static int main_workload(int argc, char** argv) {
   uint64_t queries = 1000;
   uint64_t seed = 0x123456789abcdef0ULL;
   uint64_t seek_penalty_us = 0;
-  bool path_recursive_pm = false;
-  uint64_t path_pm_accesses = 0;
+  PathPmOptions path_pm;
+  bool path_batch = false;
+  uint64_t pm_cutoff = 0;
+  uint64_t batch = 1;
+  bool bg_evict = false;
+  uint64_t stash_limit = 0;
+  uint64_t think_us = 0;
+  uint64_t read_ahead = 0;
+  uint64_t shards = 0;
+  uint64_t in_flight = 0;
+  std::vector<uint64_t> clients;
+  std::string clients_csv_path;
+  std::vector<double> rates;
+  std::string arrival = "poisson";
+  double slo_p99_ms = 0;
+  std::string hdr_csv_path;
+  std::vector<roram::Durability> durability;
+  uint64_t group_size = 8;
+  std::string wal_prefix;
+  std::string huge_pages_arg;
+  std::string json_path;
+  uint64_t rtt_us = 0;
+  std::string remote;
+  bool ring = false;
+  roram::RingOptions ring_opts;
   std::string mode = "fileserver";
   std::string trace_path;
   std::string csv_path;
+  std::string stats_csv_path;
+  std::string io_csv_path;
+  std::string io_trace_path;
+  bool io_heatmap = false;
   std::string file_path;
   for (int i = 2; i < argc; ++i) {
     std::string arg = argv[i];
@@ -398,16 +1070,62 @@ static int main_workload(int argc, char** argv) {
     if (arg == "--queries" && i + 1 < argc) { queries = std::stoull(argv[++i]); continue; }
     if (arg == "--seed" && i + 1 < argc) { seed = std::stoull(argv[++i]); continue; }
     if (arg == "--seek-penalty-us" && i + 1 < argc) { seek_penalty_us = std::stoull(argv[++i]); continue; }
-    if (arg == "--path-recursive-pm") { path_recursive_pm = true; continue; }
-    if (arg == "--path-pm-accesses" && i + 1 < argc) { path_pm_accesses = std::stoull(argv[++i]); continue; }
+    if (parse_path_pm_flag(arg, i, argc, argv, path_pm)) continue;
+    if (arg == "--path-batch") { path_batch = true; continue; }
+    if (arg == "--pm-cutoff" && i + 1 < argc) { pm_cutoff = std::stoull(argv[++i]); continue; }
     if (arg == "--mode" && i + 1 < argc) { mode = argv[++i]; continue; }
+    if (arg == "--batch" && i + 1 < argc) { batch = std::stoull(argv[++i]); continue; }
+    if (arg == "--bg-evict") { bg_evict = true; continue; }
+    if (arg == "--stash-limit" && i + 1 < argc) { stash_limit = std::stoull(argv[++i]); continue; }
+    if (arg == "--think-us" && i + 1 < argc) { think_us = std::stoull(argv[++i]); continue; }
+    if (arg == "--shards" && i + 1 < argc) { shards = std::stoull(argv[++i]); continue; }
+    if (arg == "--in-flight" && i + 1 < argc) { in_flight = std::stoull(argv[++i]); continue; }
+    if (arg == "--clients" && i + 1 < argc) { clients = parse_u64_list(argv[++i]); continue; }
+    if (arg == "--clients-csv" && i + 1 < argc) { clients_csv_path = argv[++i]; continue; }
+    if (arg == "--rate" && i + 1 < argc) { rates = parse_double_list(argv[++i]); continue; }
+    if (arg == "--arrival" && i + 1 < argc) { arrival = argv[++i]; continue; }
+    if (arg == "--slo-p99-ms" && i + 1 < argc) { slo_p99_ms = std::stod(argv[++i]); continue; }
+    if (arg == "--hdr-csv" && i + 1 < argc) { hdr_csv_path = argv[++i]; continue; }
+    if (arg == "--durability" && i + 1 < argc) {
+      std::stringstream ss(argv[++i]);
+      std::string item;
+      while (std::getline(ss, item, ','))
+        if (!item.empty()) durability.push_back(roram::parse_durability(item));
+      continue;
+    }
+    if (arg == "--group-size" && i + 1 < argc) { group_size = std::stoull(argv[++i]); continue; }
+    if (arg == "--wal" && i + 1 < argc) { wal_prefix = argv[++i]; continue; }
+    if (arg == "--huge-pages" && i + 1 < argc) { huge_pages_arg = argv[++i]; continue; }
+    if (arg == "--generic-core") { roram::set_sub_oram_specialization(false); continue; }
+    if (arg == "--read-ahead" && i + 1 < argc) { read_ahead = std::stoull(argv[++i]); continue; }
+    if (arg == "--json" && i + 1 < argc) { json_path = argv[++i]; continue; }
+    if (arg == "--remote" && i + 1 < argc) { remote = argv[++i]; continue; }
+    if (arg == "--rtt-us" && i + 1 < argc) { rtt_us = std::stoull(argv[++i]); continue; }
+    if (arg == "--ring") { ring = true; continue; }
+    if (arg == "--ring-s" && i + 1 < argc) { ring_opts.S = std::stoi(argv[++i]); continue; }
+    if (arg == "--ring-a" && i + 1 < argc) { ring_opts.A = std::stoi(argv[++i]); continue; }
     if (arg == "--trace" && i + 1 < argc) { trace_path = argv[++i]; continue; }
     if (arg == "--csv" && i + 1 < argc) { csv_path = argv[++i]; continue; }
+    if (arg == "--stats-csv" && i + 1 < argc) { stats_csv_path = argv[++i]; continue; }
+    if (arg == "--io-heatmap") { io_heatmap = true; continue; }
+    if (arg == "--io-csv" && i + 1 < argc) { io_csv_path = argv[++i]; continue; }
+    if (arg == "--io-trace" && i + 1 < argc) { io_trace_path = argv[++i]; continue; }
     if (arg == "--file" && i + 1 < argc) { file_path = argv[++i]; continue; }
   }
   if (mode != "sequential" && mode != "fileserver" && mode != "videoserver") {
     throw std::runtime_error("workload: mode must be sequential|fileserver|videoserver");
   }
+  for (uint64_t c : clients)
+    if (c == 0) throw std::runtime_error("workload: --clients entries must be >= 1");
+  for (double r : rates)
+    if (!(r > 0)) throw std::runtime_error("workload: --rate entries must be > 0");
+  if (arrival != "poisson" && arrival != "fixed") throw std::runtime_error("workload: arrival must be poisson|fixed");
+  if (!durability.empty() && file_path.empty() && remote.empty())
+    throw std::runtime_error("workload: --durability needs --file or --remote (memory trees have nothing to sync)");
+  if (batch == 0) batch = 1;
+  if (read_ahead > 0 && batch > 1) throw std::runtime_error("workload: --read-ahead needs --batch 1");
+  const roram::HugePages huge_pages = huge_pages_arg.empty() ? roram::HugePages::Off
+                                                             : roram::parse_huge_pages(huge_pages_arg);
 
   const int Z = 4;
   const size_t B = 4096;
@@ -415,80 +1133,276 @@ static int main_workload(int argc, char** argv) {
   roram::Params params_path(N, 1, Z, B);
   const bool use_file = !file_path.empty();
   const bool count_seeks = use_file;
-  auto trace = trace_path.empty() ? make_workload_trace(N, L, queries, mode, seed)
-                                  : load_trace_csv(trace_path, N, L);
+  const Trace trace = trace_path.empty() ? Trace(make_workload_trace(N, L, queries, mode, seed))
+                                         : load_trace(trace_path, N, L);
   queries = static_cast<uint64_t>(trace.size());
 
   auto crypto1 = std::make_unique<roram::NoOpCrypto>();
   auto crypto2 = std::make_unique<roram::NoOpCrypto>();
-  auto crypto_pm = std::make_unique<roram::NoOpCrypto>();
-  roram::rORAM ram_roram(params_roram, std::move(crypto1), !use_file, use_file ? (file_path + "_roram") : "", count_seeks);
-  roram::PathORAM ram_path(params_path, std::move(crypto2), !use_file, use_file ? (file_path + "_path") : "", count_seeks);
-  std::unique_ptr<roram::PathORAM> ram_path_pm;
-  if (path_recursive_pm) {
-    if (path_pm_accesses == 0) path_pm_accesses = static_cast<uint64_t>(2 * (params_path.h + 1));
-    roram::Params params_pm(1ULL << 20, 1, Z, 64);
-    ram_path_pm = std::make_unique<roram::PathORAM>(params_pm, std::move(crypto_pm), !use_file,
-                                                     use_file ? (file_path + "_pathpm") : "", count_seeks);
+  // --remote: every tree lives on a roram_storage_server; links are kept to count round trips.
+  std::vector<roram::RemoteStorage*> roram_links, path_links;
+  // --io-trace: every tree's bucket I/O is recorded, named e.g. "roram_tree3" or "path".
+  std::shared_ptr<roram::IoTraceWriter> io_trace;
+  if (!io_trace_path.empty()) io_trace = std::make_shared<roram::IoTraceWriter>(io_trace_path);
+  auto storage_for = [&](const std::string& prefix, std::vector<roram::RemoteStorage*>& links) -> roram::StorageFactory {
+    roram::StorageFactory f;
+    if (remote.empty()) {
+      f = roram::local_storage_factory(!use_file, use_file ? (file_path + prefix) : "", count_seeks, huge_pages);
+    } else {
+      std::vector<roram::RemoteStorage*>* out = &links;
+      f = [&, prefix, out](const roram::Params& p, const std::string& name, roram::CryptoProvider* c) {
+        auto s = std::make_unique<roram::RemoteStorage>(p, remote, prefix.substr(1) + name, c, rtt_us);
+        out->push_back(s.get());
+        return std::unique_ptr<roram::StorageBackend>(std::move(s));
+      };
+    }
+    return io_trace ? roram::tracing_storage_factory(f, io_trace, prefix.substr(1)) : f;
+  };
+  roram::rORAM ram_roram(params_roram, std::move(crypto1), storage_for("_roram", roram_links), pm_cutoff);
+  // Each remote tree has its own connection, so evicting the trees concurrently overlaps
+  // their eviction round trips.
+  if (!remote.empty()) ram_roram.set_parallel_evict(true);
+  if (bg_evict) {
+    // Default limit: a few maximal accesses' worth of staged blocks per stash.
+    if (stash_limit == 0) stash_limit = static_cast<uint64_t>(8 * params_roram.L);
+    ram_roram.enable_background_eviction(static_cast<size_t>(stash_limit));
   }
+  // --read-ahead D: the rORAM pass goes through a read-ahead layer D ranges deep.
+  std::unique_ptr<roram::ReadAheadORAM> ram_ahead;
+  if (read_ahead > 0) {
+    roram::ReadAheadOptions ra;
+    ra.depth = static_cast<size_t>(read_ahead);
+    ram_ahead = std::make_unique<roram::ReadAheadORAM>(ram_roram, ra);
+  }
+  roram::PathORAM ram_path(params_path, std::move(crypto2), storage_for("_path", path_links),
+                           path_pm.client_budget(), path_pm.block_size);
+  std::vector<roram::RemoteStorage*> ring_links;
+  std::unique_ptr<roram::RingORAM> ram_ring;
+  if (ring) {
+    ram_ring = std::make_unique<roram::RingORAM>(params_path, std::make_unique<roram::NoOpCrypto>(), ring_opts,
+                                                 storage_for("_ring", ring_links));
+  }
+
+  ram_roram.reset_stats();  // drop the position-map fill done at construction
+  ram_path.reset_stats();
+  ram_roram.reset_io_stats();
+  ram_path.reset_io_stats();
+  ram_roram.reset_peak_memory();
+  ram_path.reset_peak_memory();
+  double wall_ms_r = 0, wall_ms_p = 0;  // measured operation time, without seek penalty
 
   uint64_t logical_bytes = 0;
   for (const auto& q : trace) logical_bytes += q.r * static_cast<uint64_t>(B);
 
+  double p99_roram = 0.0;
+  size_t max_stash = 0;
+  std::vector<double> samples_r, samples_p, samples_g;  // per-query ms, kept for --json
   auto run_roram = [&]() {
+    std::vector<double> per_query_ms;
+    per_query_ms.reserve(trace.size());
+    uint64_t seek_total = 0;
+    if (batch > 1) {
+      // Amortized: each query in a batch is charged batch_time / batch_size.
+      for (size_t off = 0; off < trace.size(); off += batch) {
+        const size_t end_idx = std::min(trace.size(), off + static_cast<size_t>(batch));
+        std::vector<roram::RangeRequest> reqs;
+        reqs.reserve(end_idx - off);
+        for (size_t n = off; n < end_idx; ++n) {
+          const auto& q = trace[n];
+          reqs.push_back(roram::RangeRequest{q.a, q.r, q.is_write ? "write" : "read", {}});
+          if (q.is_write) reqs.back().data.assign(q.r, std::vector<uint8_t>(B, 0));
+        }
+        uint64_t seek_before = ram_roram.get_seek_count();
+        auto start = std::chrono::high_resolution_clock::now();
+        ram_roram.access_batch(reqs);
+        auto end = std::chrono::high_resolution_clock::now();
+        uint64_t seek_after = ram_roram.get_seek_count();
+        seek_total += (seek_after - seek_before);
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        wall_ms_r += ms;
+        ms += (seek_penalty_us > 0 ? (seek_after - seek_before) * (seek_penalty_us / 1000.0) : 0.0);
+        for (size_t n = off; n < end_idx; ++n) per_query_ms.push_back(ms / (end_idx - off));
+        if (bg_evict) max_stash = std::max(max_stash, ram_roram.max_stash_size());
+        if (think_us) std::this_thread::sleep_for(std::chrono::microseconds(think_us));
+      }
+    } else {
+      for (const auto& q : trace) {
+        uint64_t seek_before = ram_roram.get_seek_count();
+        auto start = std::chrono::high_resolution_clock::now();
+        if (q.is_write) {
+          std::vector<std::vector<uint8_t>> d(q.r, std::vector<uint8_t>(B, 0));
+          if (ram_ahead)
+            ram_ahead->Access(q.a, q.r, "write", &d);
+          else
+            ram_roram.Access(q.a, q.r, "write", &d);
+        } else if (ram_ahead) {
+          ram_ahead->Access(q.a, q.r, "read");
+        } else {
+          ram_roram.Access(q.a, q.r, "read");
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        uint64_t seek_after = ram_roram.get_seek_count();
+        seek_total += (seek_after - seek_before);
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        wall_ms_r += ms;
+        ms += (seek_penalty_us > 0 ? (seek_after - seek_before) * (seek_penalty_us / 1000.0) : 0.0);
+        per_query_ms.push_back(ms);
+        if (bg_evict) max_stash = std::max(max_stash, ram_roram.max_stash_size());
+        if (think_us) std::this_thread::sleep_for(std::chrono::microseconds(think_us));
+      }
+    }
+    if (ram_ahead) ram_ahead->drain();
+    if (bg_evict) ram_roram.drain_evictions();
+    p99_roram = percentile(per_query_ms, 0.99);
+    samples_r = per_query_ms;
+    double mean, stddev, ci_lo, ci_hi;
+    mean_std_ci(per_query_ms, mean, stddev, ci_lo, ci_hi);
+    return std::tuple<double, double, double, double, double, uint64_t>(
+        mean, percentile(per_query_ms, 0.50), percentile(per_query_ms, 0.95), ci_lo, ci_hi, seek_total);
+  };
+
+  auto run_path = [&]() {
     std::vector<double> per_query_ms;
     per_query_ms.reserve(trace.size());
     uint64_t seek_total = 0;
     for (const auto& q : trace) {
-      uint64_t seek_before = ram_roram.get_seek_count();
-      auto start = std::chrono::high_resolution_clock::now();
+      uint64_t seek_before = ram_path.get_seek_count();
+      double ms = 0.0;
       if (q.is_write) {
         std::vector<std::vector<uint8_t>> d(q.r, std::vector<uint8_t>(B, 0));
-        ram_roram.Access(q.a, q.r, "write", &d);
+        ms = path_oram_range_write_ms(ram_path, q.a, q.r, d, path_batch);
       } else {
-        ram_roram.Access(q.a, q.r, "read");
+        ms = path_oram_range_read_ms(ram_path, q.a, q.r, path_batch);
       }
-      auto end = std::chrono::high_resolution_clock::now();
-      uint64_t seek_after = ram_roram.get_seek_count();
+      uint64_t seek_after = ram_path.get_seek_count();
       seek_total += (seek_after - seek_before);
-      double ms = std::chrono::duration<double, std::milli>(end - start).count();
+      wall_ms_p += ms;
       ms += (seek_penalty_us > 0 ? (seek_after - seek_before) * (seek_penalty_us / 1000.0) : 0.0);
       per_query_ms.push_back(ms);
+      if (think_us) std::this_thread::sleep_for(std::chrono::microseconds(think_us));
     }
+    samples_p = per_query_ms;
     double mean, stddev, ci_lo, ci_hi;
     mean_std_ci(per_query_ms, mean, stddev, ci_lo, ci_hi);
     return std::tuple<double, double, double, double, double, uint64_t>(
         mean, percentile(per_query_ms, 0.50), percentile(per_query_ms, 0.95), ci_lo, ci_hi, seek_total);
   };
 
-  auto run_path = [&]() {
+  auto run_ring = [&]() {
     std::vector<double> per_query_ms;
     per_query_ms.reserve(trace.size());
     uint64_t seek_total = 0;
     for (const auto& q : trace) {
-      uint64_t seek_before = ram_path.get_seek_count();
-      if (ram_path_pm) seek_before += ram_path_pm->get_seek_count();
+      uint64_t seek_before = ram_ring->get_seek_count();
       double ms = 0.0;
       if (q.is_write) {
         std::vector<std::vector<uint8_t>> d(q.r, std::vector<uint8_t>(B, 0));
-        ms = path_oram_range_write_ms(ram_path, q.a, q.r, d, ram_path_pm.get(), path_pm_accesses);
+        ms = ring_oram_range_ms(*ram_ring, q.a, q.r, &d);
       } else {
-        ms = path_oram_range_read_ms(ram_path, q.a, q.r, ram_path_pm.get(), path_pm_accesses);
+        ms = ring_oram_range_ms(*ram_ring, q.a, q.r);
       }
-      uint64_t seek_after = ram_path.get_seek_count();
-      if (ram_path_pm) seek_after += ram_path_pm->get_seek_count();
+      uint64_t seek_after = ram_ring->get_seek_count();
       seek_total += (seek_after - seek_before);
       ms += (seek_penalty_us > 0 ? (seek_after - seek_before) * (seek_penalty_us / 1000.0) : 0.0);
       per_query_ms.push_back(ms);
+      if (think_us) std::this_thread::sleep_for(std::chrono::microseconds(think_us));
     }
+    samples_g = per_query_ms;
     double mean, stddev, ci_lo, ci_hi;
     mean_std_ci(per_query_ms, mean, stddev, ci_lo, ci_hi);
     return std::tuple<double, double, double, double, double, uint64_t>(
         mean, percentile(per_query_ms, 0.50), percentile(per_query_ms, 0.95), ci_lo, ci_hi, seek_total);
   };
 
+  // --huge-pages: dTLB misses and page faults of each scheme's run (this thread only).
+  roram::TlbCounters tlb;
+  tlb.start();
   auto [mean_r, p50_r, p95_r, ci_lo_r, ci_hi_r, seeks_r] = run_roram();
+  tlb.stop();
+  const uint64_t dtlb_r = tlb.dtlb_misses(), faults_r = tlb.page_faults();
+  tlb.start();
   auto [mean_p, p50_p, p95_p, ci_lo_p, ci_hi_p, seeks_p] = run_path();
+  tlb.stop();
+  const uint64_t dtlb_p = tlb.dtlb_misses(), faults_p = tlb.page_faults();
+  double mean_g = 0, p50_g = 0, p95_g = 0, ci_lo_g = 0, ci_hi_g = 0;
+  uint64_t seeks_g = 0;
+  if (ram_ring) std::tie(mean_g, p50_g, p95_g, ci_lo_g, ci_hi_g, seeks_g) = run_ring();
+
+  // Sharded rORAM: the same trace replayed against K independent shards with up to
+  // in_flight queries outstanding, so throughput is measured on the wall clock.
+  double sharded_wall_s = 0.0;
+  int sharded_count = 0;
+  if (shards > 0) {
+    if (in_flight == 0) in_flight = 2 * shards;
+    roram::ShardedRORAM sharded(params_roram, static_cast<int>(shards),
+                                [](int) { return std::make_unique<roram::NoOpCrypto>(); },
+                                !use_file, use_file ? (file_path + "_sharded") : "", count_seeks);
+    sharded_count = sharded.num_shards();
+    std::deque<std::future<roram::ShardedRORAM::Result>> window;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t n = 0; n < trace.size(); ++n) {
+      const auto& q = trace[n];
+      roram::RangeRequest req{q.a, q.r, q.is_write ? "write" : "read", {}};
+      if (q.is_write) req.data.assign(q.r, std::vector<uint8_t>(B, 0));
+      // Trace writes carry zeros, so queries are order-independent: each gets its own
+      // client id and the shard schedulers may batch them freely.
+      window.push_back(sharded.submit(n, std::move(req)));
+      if (window.size() >= in_flight) { window.front().get(); window.pop_front(); }
+    }
+    while (!window.empty()) { window.front().get(); window.pop_front(); }
+    auto end = std::chrono::high_resolution_clock::now();
+    sharded_wall_s = std::chrono::duration<double>(end - start).count();
+  }
+
+  // Concurrent drivers run against one long-lived target per mode: an ORAMFrontend over a
+  // fresh rORAM, or the ShardedRORAM instances when --shards is given.
+  std::vector<roram::RemoteStorage*> concurrent_links;
+  auto with_concurrent_target = [&](const std::string& suffix, auto&& run) {
+    if (shards > 0) {
+      roram::ShardedRORAM sharded(params_roram, static_cast<int>(shards),
+                                  [](int) { return std::make_unique<roram::NoOpCrypto>(); },
+                                  !use_file, use_file ? (file_path + suffix) : "", count_seeks);
+      run(sharded);
+    } else {
+      roram::ORAMFrontend frontend(std::make_unique<roram::rORAM>(params_roram, std::make_unique<roram::NoOpCrypto>(),
+                                                                  storage_for(suffix, concurrent_links), pm_cutoff));
+      run(frontend);
+    }
+  };
+  const std::string concurrent_target = shards > 0 ? "sharded, shards=" + std::to_string(shards) : "ORAMFrontend";
+
+  // --clients C1,C2,...: the trace again, split across C closed-loop client threads, for each C.
+  std::vector<ClosedLoopResult> closed_loop;
+  if (!clients.empty()) {
+    with_concurrent_target("_clients", [&](auto& target) {
+      for (uint64_t c : clients) closed_loop.push_back(run_closed_loop(target, trace, c, B, think_us));
+    });
+  }
+
+  // --rate R1,R2,...: the trace again as open-loop arrivals at each target rate.
+  std::vector<OpenLoopResult> open_loop;
+  if (!rates.empty()) {
+    with_concurrent_target("_openloop", [&](auto& target) {
+      for (double r : rates) open_loop.push_back(run_open_loop(target, trace, r, arrival == "poisson", seed, B));
+    });
+  }
+
+  // --durability M1,M2,...: the trace again on a fresh rORAM per mode, with the client-state
+  // log next to the trees (or at --wal PREFIX). Position maps stay client-side (the log
+  // holds them), whatever --pm-cutoff says.
+  std::vector<DurabilityResult> durable;
+  if (!durability.empty()) {
+    const std::string wal_base = !wal_prefix.empty() ? wal_prefix : (use_file ? file_path : std::string("roram"));
+    std::vector<roram::RemoteStorage*> durable_links;
+    for (roram::Durability m : durability) {
+      const std::string name = roram::durability_name(m);
+      const std::string wal = wal_base + "_" + name + ".wal";
+      std::remove(wal.c_str());
+      roram::rORAM ram(params_roram, std::make_unique<roram::NoOpCrypto>(), storage_for("_durable_" + name, durable_links));
+      ram.set_durability(m, wal, group_size);
+      durable.push_back(run_durability(ram, m, trace, batch, B));
+    }
+  }
 
   auto qps = [](double mean_ms) { return mean_ms > 0 ? (1000.0 / mean_ms) : 0.0; };
   auto mbps = [logical_bytes](double mean_ms) {
@@ -498,8 +1412,13 @@ static int main_workload(int argc, char** argv) {
   std::cout << "Workload throughput benchmark  mode=" << mode << " queries=" << queries
             << " N=" << N << " L=" << L;
   if (!trace_path.empty()) std::cout << " trace=" << trace_path;
+  if (batch > 1) std::cout << " batch=" << batch;
+  if (read_ahead) std::cout << " read_ahead=" << read_ahead;
   if (seek_penalty_us) std::cout << " seek_penalty_us=" << seek_penalty_us;
+  if (path_batch) std::cout << " path_batch=1";
+  std::cout << " core=" << (ram_roram.specialized_trees() > 0 ? "specialized" : "generic");
   std::cout << "\n";
+  print_pm_summary(ram_roram, ram_path, pm_cutoff);
   std::cout << std::string(132, '-') << "\n";
   std::cout << std::setw(12) << "scheme" << std::setw(12) << "mean_ms" << std::setw(12) << "p50_ms"
             << std::setw(12) << "p95_ms" << std::setw(14) << "qps" << std::setw(14) << "mbps"
@@ -512,6 +1431,160 @@ static int main_workload(int argc, char** argv) {
   std::cout << std::setw(12) << "PathORAM" << std::setw(12) << mean_p << std::setw(12) << p50_p
             << std::setw(12) << p95_p << std::setw(14) << qps(mean_p) << std::setw(14) << mbps(mean_p)
             << std::setw(14) << (queries > 0 ? (seeks_p / queries) : 0) << std::setw(12) << ci_lo_p << std::setw(12) << ci_hi_p << "\n";
+  if (ram_ring) {
+    std::cout << std::setw(12) << "RingORAM" << std::setw(12) << mean_g << std::setw(12) << p50_g
+              << std::setw(12) << p95_g << std::setw(14) << qps(mean_g) << std::setw(14) << mbps(mean_g)
+              << std::setw(14) << (queries > 0 ? (seeks_g / queries) : 0) << std::setw(12) << ci_lo_g << std::setw(12) << ci_hi_g << "\n";
+    uint64_t ring_blocks = 0;
+    for (const auto& q : trace) ring_blocks += q.r;
+    print_ring_summary(*ram_ring, ring_blocks);
+  }
+  if (bg_evict) {
+    std::cout << "rORAM background eviction: p50_ms=" << p50_r << " p99_ms=" << p99_roram
+              << " stash_limit=" << stash_limit << " max_stash=" << max_stash;
+    if (think_us) std::cout << " think_us=" << think_us;
+    std::cout << "\n";
+  }
+  if (ram_ahead) {
+    const roram::ReadAheadStats& ra = ram_ahead->stats();
+    const uint64_t served = ra.hit_blocks + ra.miss_blocks;
+    std::cout << "rORAM read-ahead: depth=" << read_ahead << " hit_blocks=" << ra.hit_blocks
+              << " miss_blocks=" << ra.miss_blocks << " hit_rate=" << std::setprecision(3)
+              << (served > 0 ? double(ra.hit_blocks) / served : 0.0) << " prefetches=" << ra.prefetches
+              << " wasted=" << ra.wasted << " failed=" << ra.failed
+              << " buffer_peak_bytes=" << ra.peak_buffered * params_roram.B << "\n";
+  }
+  if (!huge_pages_arg.empty()) {
+    const double qn = queries > 0 ? static_cast<double>(queries) : 1.0;
+    std::cout << "Huge pages: mode=" << roram::huge_pages_name(huge_pages)
+              << " huge_MB=" << std::setprecision(1) << roram::process_huge_page_bytes() / 1048576.0;
+    if (tlb.has_dtlb())
+      std::cout << " dtlb_misses/query rORAM=" << dtlb_r / qn << " PathORAM=" << dtlb_p / qn;
+    else
+      std::cout << " dtlb_misses=n/a (no PMU)";
+    std::cout << " page_faults/query rORAM=" << faults_r / qn << " PathORAM=" << faults_p / qn << "\n"
+              << std::setprecision(3);
+  }
+  if (!remote.empty()) {
+    auto trips = [](const std::vector<roram::RemoteStorage*>& links) {
+      uint64_t total = 0;
+      for (const auto* l : links) total += l->round_trips();
+      return total;
+    };
+    std::cout << "Remote storage: " << remote << " rtt_us=" << rtt_us << " round_trips/query rORAM="
+              << std::setprecision(1) << (queries > 0 ? double(trips(roram_links)) / queries : 0.0)
+              << " PathORAM=" << (queries > 0 ? double(trips(path_links)) / queries : 0.0);
+    if (ram_ring) std::cout << " RingORAM=" << (queries > 0 ? double(trips(ring_links)) / queries : 0.0);
+    std::cout << "\n" << std::setprecision(3);
+  }
+  if (shards > 0) {
+    const double wall_qps = sharded_wall_s > 0 ? queries / sharded_wall_s : 0.0;
+    const double wall_mbps = sharded_wall_s > 0 ? (logical_bytes / 1048576.0) / sharded_wall_s : 0.0;
+    std::cout << "rORAM sharded: shards=" << sharded_count << " in_flight=" << in_flight
+              << " wall_s=" << sharded_wall_s << " qps=" << wall_qps << " mbps=" << wall_mbps
+              << " (single instance qps=" << qps(mean_r) << ")\n";
+  }
+  if (!closed_loop.empty()) {
+    std::cout << "rORAM closed-loop clients (" << concurrent_target << "):\n";
+    std::cout << std::setw(10) << "clients" << std::setw(12) << "wall_s" << std::setw(14) << "qps"
+              << std::setw(14) << "mbps" << std::setw(12) << "p50_ms" << std::setw(12) << "p95_ms"
+              << std::setw(12) << "p99_ms" << std::setw(20) << "worst_client_p99" << "\n";
+    for (const auto& c : closed_loop) {
+      std::cout << std::setw(10) << c.clients << std::setw(12) << c.wall_s << std::setw(14) << c.qps
+                << std::setw(14) << c.mbps << std::setw(12) << c.p50_ms << std::setw(12) << c.p95_ms
+                << std::setw(12) << c.p99_ms << std::setw(20) << c.worst_client_p99_ms << "\n";
+    }
+    if (!clients_csv_path.empty()) {
+      std::ofstream out(clients_csv_path);
+      if (out) {
+        out << "target,mode,queries,N,L,shards,clients,wall_s,queries_per_sec,mb_per_sec,p50_ms,p95_ms,p99_ms,"
+               "worst_client_p99_ms\n";
+        for (const auto& c : closed_loop) {
+          out << (shards > 0 ? "sharded" : "frontend") << "," << mode << "," << queries << "," << N << "," << L
+              << "," << shards << "," << c.clients << "," << c.wall_s << "," << c.qps << "," << c.mbps << ","
+              << c.p50_ms << "," << c.p95_ms << "," << c.p99_ms << "," << c.worst_client_p99_ms << "\n";
+        }
+        std::cout << "Wrote " << clients_csv_path << "\n";
+      }
+    }
+  }
+  if (!open_loop.empty()) print_open_loop(open_loop, concurrent_target, arrival, slo_p99_ms);
+  write_hdr_csv(hdr_csv_path, open_loop);
+  if (!durable.empty()) print_durability(durable, group_size, batch);
+  if (pm_cutoff > 0) {
+    std::cout << "rORAM position-map ORAM accesses: " << ram_roram.position_map_accesses()
+              << " (" << std::setprecision(2) << (queries > 0 ? double(ram_roram.position_map_accesses()) / queries : 0.0)
+              << " per query)\n" << std::setprecision(3);
+  }
+  print_path_pm_accesses(ram_path, queries);
+  const roram::StatsSnapshot stats_r = ram_roram.stats(), stats_p = ram_path.stats();
+  print_phase_breakdown("rORAM", stats_r, wall_ms_r);
+  print_phase_breakdown("PathORAM", stats_p, wall_ms_p);
+  write_stats_csv(stats_csv_path, {{"rORAM", stats_r, wall_ms_r}, {"PathORAM", stats_p, wall_ms_p}});
+  if (io_heatmap) {
+    print_io_heatmap("rORAM", ram_roram.io_stats(), logical_bytes);
+    print_io_heatmap("PathORAM", ram_path.io_stats(), logical_bytes);
+  }
+  write_io_csv(io_csv_path, {{"rORAM", ram_roram.io_stats()}, {"PathORAM", ram_path.io_stats()}});
+  std::vector<std::pair<std::string, roram::MemoryUsage>> memory_rows{
+      {"rORAM now", ram_roram.memory_usage()},
+      {"rORAM peak", ram_roram.peak_memory_usage()},
+      {"rORAM projected", roram::project_roram_memory(params_roram, pm_cutoff, 64, !remote.empty())},
+      {"PathORAM now", ram_path.memory_usage()},
+      {"PathORAM peak", ram_path.peak_memory_usage()}};
+  if (ram_ahead) {
+    // The read-ahead buffer is client RAM the rORAM does not see: its peak blocks·B as scratch.
+    roram::MemoryUsage with_ahead = memory_rows[1].second;
+    with_ahead.trees.clear();
+    with_ahead.scratch += ram_ahead->stats().peak_buffered * params_roram.B;
+    memory_rows.insert(memory_rows.begin() + 2, {"rORAM peak+ahead", with_ahead});
+  }
+  print_memory_usage(memory_rows);
+  if (io_trace) {
+    io_trace->flush();
+    std::cout << "Wrote " << io_trace_path << " (" << io_trace->records() << " I/O records; replay with replay-io)\n";
+  }
+
+  if (!json_path.empty()) {
+    roram::ResultSet results = make_result_set("workload", file_path, remote);
+    results.config = {{"mode", mode}, {"queries", std::to_string(queries)}, {"trace", trace_path},
+                      {"seed", std::to_string(seed)}, {"batch", std::to_string(batch)},
+                      {"seek_penalty_us", std::to_string(seek_penalty_us)}, {"path_batch", path_batch ? "1" : "0"},
+                      {"pm_cutoff", std::to_string(pm_cutoff)}, {"bg_evict", bg_evict ? "1" : "0"},
+                      {"think_us", std::to_string(think_us)}, {"shards", std::to_string(shards)},
+                      {"rtt_us", std::to_string(rtt_us)}, {"group_size", std::to_string(group_size)},
+                      {"read_ahead", std::to_string(read_ahead)}};
+    auto row = [&](double mean, double p50, double p95, double ci_lo, double ci_hi, uint64_t seeks) {
+      return std::vector<std::pair<std::string, double>>{
+          {"mean_ms", mean}, {"p50_ms", p50}, {"p95_ms", p95}, {"qps", qps(mean)}, {"mbps", mbps(mean)},
+          {"mean_seeks", queries > 0 ? double(seeks / queries) : 0.0}, {"ci_low", ci_lo}, {"ci_high", ci_hi}};
+    };
+    add_result(results, "rORAM", mode, params_roram, samples_r, row(mean_r, p50_r, p95_r, ci_lo_r, ci_hi_r, seeks_r));
+    add_result(results, "PathORAM", mode, params_path, samples_p, row(mean_p, p50_p, p95_p, ci_lo_p, ci_hi_p, seeks_p));
+    if (ram_ring)
+      add_result(results, "RingORAM", mode, params_path, samples_g, row(mean_g, p50_g, p95_g, ci_lo_g, ci_hi_g, seeks_g));
+    const std::string concurrent_scheme = shards > 0 ? "rORAM-sharded" : "rORAM-frontend";
+    for (const auto& c : closed_loop) {
+      add_result(results, concurrent_scheme, mode + " clients=" + std::to_string(c.clients), params_roram, {},
+                 {{"qps", c.qps}, {"mbps", c.mbps}, {"p50_ms", c.p50_ms}, {"p95_ms", c.p95_ms}, {"p99_ms", c.p99_ms},
+                  {"worst_client_p99_ms", c.worst_client_p99_ms}});
+    }
+    for (const auto& o : open_loop) {
+      std::ostringstream label;
+      label << mode << " rate=" << o.rate << " " << arrival;
+      add_result(results, concurrent_scheme, label.str(), params_roram, {},
+                 {{"achieved_qps", o.achieved_qps}, {"mbps", o.mbps}, {"mean_ms", o.hist.mean() / 1e6},
+                  {"p50_ms", o.hist.value_at(0.50) / 1e6}, {"p99_ms", o.hist.value_at(0.99) / 1e6},
+                  {"p99.9_ms", o.hist.value_at(0.999) / 1e6}, {"max_ms", o.hist.max() / 1e6}});
+    }
+    for (const auto& d : durable) {
+      add_result(results, "rORAM-durable", mode + " durability=" + roram::durability_name(d.mode), params_roram, {},
+                 {{"qps", d.qps}, {"mbps", d.mbps}, {"p50_ms", d.p50_ms}, {"p99_ms", d.p99_ms},
+                  {"commits", static_cast<double>(d.commits)}, {"sync_ms", d.sync_ms}});
+    }
+    roram::write_results_json(json_path, results);
+    std::cout << "Wrote " << json_path << "\n";
+  }
 
   if (!csv_path.empty()) {
     std::ofstream csv(csv_path);
@@ -523,12 +1596,475 @@ static int main_workload(int argc, char** argv) {
       csv << "PathORAM," << mode << "," << queries << "," << N << "," << L << "," << mean_p << "," << p50_p << "," << p95_p
           << "," << qps(mean_p) << "," << mbps(mean_p) << "," << (queries > 0 ? (seeks_p / queries) : 0)
           << "," << ci_lo_p << "," << ci_hi_p << "\n";
+      if (ram_ring) {
+        csv << "RingORAM," << mode << "," << queries << "," << N << "," << L << "," << mean_g << "," << p50_g << "," << p95_g
+            << "," << qps(mean_g) << "," << mbps(mean_g) << "," << (queries > 0 ? (seeks_g / queries) : 0)
+            << "," << ci_lo_g << "," << ci_hi_g << "\n";
+      }
+      std::cout << "Wrote " << csv_path << "\n";
+    }
+  }
+  return 0;
+}
+
+static int main_scan(int argc, char** argv) {
+  uint64_t N = 4096;
+  uint64_t L = 64;
+  uint64_t a = 0;
+  uint64_t r = 0;
+  bool bg_evict = false;
+  std::string file_path;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--N" && i + 1 < argc) { N = std::stoull(argv[++i]); continue; }
+    if (arg == "--L" && i + 1 < argc) { L = std::stoull(argv[++i]); continue; }
+    if (arg == "--a" && i + 1 < argc) { a = std::stoull(argv[++i]); continue; }
+    if (arg == "--r" && i + 1 < argc) { r = std::stoull(argv[++i]); continue; }
+    if (arg == "--bg-evict") { bg_evict = true; continue; }
+    if (arg == "--file" && i + 1 < argc) { file_path = argv[++i]; continue; }
+  }
+  if (r == 0) r = N - std::min(a, N);  // default: to the end of the volume
+  const size_t B = 4096;
+  roram::Params params(N, L, 4, B);
+  const bool use_file = !file_path.empty();
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), !use_file, file_path, use_file);
+  if (bg_evict) ram.enable_background_eviction(static_cast<size_t>(8 * params.L));
+  const double mb = (r * static_cast<double>(B)) / 1048576.0;
+
+  // Baseline: what an application does today, L blocks at a time, one after another.
+  uint64_t chunked_accesses = 0;
+  uint64_t checksum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint64_t pos = a; pos < a + r; pos += L) {
+    auto out = ram.Access(pos, std::min(L, a + r - pos), "read");
+    for (const auto& d : out) checksum += d[0];
+    ++chunked_accesses;
+  }
+  if (bg_evict) ram.drain_evictions();
+  auto mid = std::chrono::high_resolution_clock::now();
+  uint64_t scan_accesses = ram.scan(a, r, [&](uint64_t, const std::vector<uint8_t>& d) { checksum += d[0]; });
+  if (bg_evict) ram.drain_evictions();
+  auto end = std::chrono::high_resolution_clock::now();
+
+  const double chunked_ms = std::chrono::duration<double, std::milli>(mid - start).count();
+  const double scan_ms = std::chrono::duration<double, std::milli>(end - mid).count();
+  std::cout << "Scan [" << a << ", " << a + r << ")  N=" << N << " L=" << L << (bg_evict ? " bg_evict" : "") << "\n"
+            << std::fixed << std::setprecision(3)
+            << std::setw(12) << "method" << std::setw(12) << "accesses" << std::setw(14) << "ms" << std::setw(14) << "mbps" << "\n"
+            << std::setw(12) << "chunked" << std::setw(12) << chunked_accesses << std::setw(14) << chunked_ms
+            << std::setw(14) << (chunked_ms > 0 ? mb / (chunked_ms / 1000.0) : 0.0) << "\n"
+            << std::setw(12) << "scan" << std::setw(12) << scan_accesses << std::setw(14) << scan_ms
+            << std::setw(14) << (scan_ms > 0 ? mb / (scan_ms / 1000.0) : 0.0) << "\n";
+  (void)checksum;
+  return 0;
+}
+
+// tune: one workload (in unit_bytes units) replayed against every (Z, B, L) candidate.
+struct TuneResult {
+  int Z;
+  size_t B;
+  uint64_t L;  // in blocks of B
+  uint64_t queries;
+  double mbps;
+  double p95_ms;
+  double storage_overhead;  // server bytes / logical bytes
+  uint64_t client_bytes;    // peak_memory_usage().total(): maps, stash, scratch, eviction buffers
+  bool pareto;
+};
+
+// a is at least as good as b everywhere and better somewhere.
+static bool tune_dominates(const TuneResult& a, const TuneResult& b) {
+  const bool ge = a.mbps >= b.mbps && a.p95_ms <= b.p95_ms && a.storage_overhead <= b.storage_overhead &&
+                  a.client_bytes <= b.client_bytes;
+  const bool gt = a.mbps > b.mbps || a.p95_ms < b.p95_ms || a.storage_overhead < b.storage_overhead ||
+                  a.client_bytes < b.client_bytes;
+  return ge && gt;
+}
+
+static int main_tune(int argc, char** argv) {
+  uint64_t N = 512;         // volume size in units
+  uint64_t unit_bytes = 4096;
+  uint64_t queries = 200;
+  uint64_t seed = 1;
+  std::string mode = "fileserver";
+  std::string trace_path, file_path, remote, csv_path;
+  uint64_t rtt_us = 0;
+  uint64_t seek_penalty_us = 0;
+  std::vector<uint64_t> Zs{3, 4, 6}, Bs{1024, 4096}, Ls{16, 64};  // L in units
+  uint64_t budget_ms = 300;
+  uint64_t min_queries = 5;
+  uint64_t warmup = 2;
+  uint64_t max_client_bytes = 0;
+  double max_p95_ms = 0;
+  double max_overhead = 0;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--N" && i + 1 < argc) { N = std::stoull(argv[++i]); continue; }
+    if (arg == "--unit-bytes" && i + 1 < argc) { unit_bytes = std::stoull(argv[++i]); continue; }
+    if (arg == "--mode" && i + 1 < argc) { mode = argv[++i]; continue; }
+    if (arg == "--queries" && i + 1 < argc) { queries = std::stoull(argv[++i]); continue; }
+    if (arg == "--seed" && i + 1 < argc) { seed = std::stoull(argv[++i]); continue; }
+    if (arg == "--trace" && i + 1 < argc) { trace_path = argv[++i]; continue; }
+    if (arg == "--file" && i + 1 < argc) { file_path = argv[++i]; continue; }
+    if (arg == "--remote" && i + 1 < argc) { remote = argv[++i]; continue; }
+    if (arg == "--rtt-us" && i + 1 < argc) { rtt_us = std::stoull(argv[++i]); continue; }
+    if (arg == "--seek-penalty-us" && i + 1 < argc) { seek_penalty_us = std::stoull(argv[++i]); continue; }
+    if (arg == "--Z" && i + 1 < argc) { Zs = parse_u64_list(argv[++i]); continue; }
+    if (arg == "--B" && i + 1 < argc) { Bs = parse_u64_list(argv[++i]); continue; }
+    if (arg == "--L" && i + 1 < argc) { Ls = parse_u64_list(argv[++i]); continue; }
+    if (arg == "--budget-ms" && i + 1 < argc) { budget_ms = std::stoull(argv[++i]); continue; }
+    if (arg == "--min-queries" && i + 1 < argc) { min_queries = std::stoull(argv[++i]); continue; }
+    if (arg == "--warmup" && i + 1 < argc) { warmup = std::stoull(argv[++i]); continue; }
+    if (arg == "--max-client-bytes" && i + 1 < argc) { max_client_bytes = std::stoull(argv[++i]); continue; }
+    if (arg == "--max-p95-ms" && i + 1 < argc) { max_p95_ms = std::stod(argv[++i]); continue; }
+    if (arg == "--max-overhead" && i + 1 < argc) { max_overhead = std::stod(argv[++i]); continue; }
+    if (arg == "--csv" && i + 1 < argc) { csv_path = argv[++i]; continue; }
+  }
+  if (unit_bytes == 0) throw std::runtime_error("tune: --unit-bytes must be > 0");
+  const uint64_t L_max = *std::max_element(Ls.begin(), Ls.end());
+  const Trace trace = trace_path.empty() ? Trace(make_workload_trace(N, L_max, queries, mode, seed))
+                                         : load_trace(trace_path, N, L_max);
+  const std::string backend = !remote.empty() ? "remote" : (!file_path.empty() ? "file" : "memory");
+
+  std::cout << "Tune  mode=" << (trace_path.empty() ? mode : "trace:" + trace_path) << " queries=" << trace.size()
+            << " N=" << N << " units of " << unit_bytes << "B  backend=" << backend
+            << " budget_ms=" << budget_ms << "\n";
+  std::cout << std::string(112, '-') << "\n";
+  std::cout << std::setw(6) << "Z" << std::setw(8) << "B" << std::setw(8) << "L" << std::setw(10) << "queries"
+            << std::setw(14) << "mbps" << std::setw(12) << "p95_ms" << std::setw(16) << "storage_x"
+            << std::setw(16) << "client_bytes" << std::setw(10) << "pareto" << "\n";
+  std::cout << std::string(112, '-') << "\n";
+
+  std::vector<TuneResult> results;
+  for (uint64_t Z : Zs) {
+    for (uint64_t B : Bs) {
+      for (uint64_t L_units : Ls) {
+        // Byte-addressed mapping: unit range [a, a+r) covers blocks [a*u/B, ceil((a+r)*u/B)).
+        const uint64_t volume_bytes = N * unit_bytes;
+        const uint64_t N_b = (volume_bytes + B - 1) / B;
+        const uint64_t L_b = std::max<uint64_t>(1, std::min(N_b, L_units * unit_bytes / B));
+        roram::Params params(N_b, L_b, static_cast<int>(Z), static_cast<size_t>(B));
+        const std::string tag = "_tune_Z" + std::to_string(Z) + "_B" + std::to_string(B) + "_L" + std::to_string(L_b);
+        std::vector<std::string> files;
+        roram::StorageFactory storage;
+        if (!remote.empty()) {
+          storage = [&remote, tag, rtt_us](const roram::Params& p, const std::string& name, roram::CryptoProvider* c) {
+            return std::unique_ptr<roram::StorageBackend>(
+                std::make_unique<roram::RemoteStorage>(p, remote, tag + name, c, rtt_us));
+          };
+        } else {
+          auto local = roram::local_storage_factory(file_path.empty(), file_path + tag, !file_path.empty());
+          storage = [local, &files, &file_path, tag](const roram::Params& p, const std::string& name,
+                                                     roram::CryptoProvider* c) {
+            if (!file_path.empty()) files.push_back(file_path + tag + name);
+            return local(p, name, c);
+          };
+        }
+
+        std::vector<double> per_query_ms;
+        uint64_t client_bytes = 0;
+        double total_ms = 0;
+        uint64_t logical_bytes = 0;
+        {
+          roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), storage);
+          auto run_query = [&](const QueryOp& q) {
+            const uint64_t first = q.a * unit_bytes / B;
+            const uint64_t end = std::min(N_b, ((q.a + q.r) * unit_bytes + B - 1) / B);
+            const uint64_t seeks_before = ram.get_seek_count();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t pos = first; pos < end; pos += L_b) {
+              const uint64_t r = std::min(L_b, end - pos);
+              if (q.is_write) {
+                std::vector<std::vector<uint8_t>> d(static_cast<size_t>(r), std::vector<uint8_t>(B, 0));
+                ram.Access(pos, r, "write", &d);
+              } else {
+                ram.Access(pos, r, "read");
+              }
+            }
+            auto stop = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            if (seek_penalty_us > 0) ms += (ram.get_seek_count() - seeks_before) * (seek_penalty_us / 1000.0);
+            return ms;
+          };
+          // Calibrated run: untimed warm-up, then queries until both the minimum count and
+          // the time budget are met (or the trace is exhausted).
+          size_t next = 0;
+          for (uint64_t w = 0; w < warmup && next < trace.size(); ++w) run_query(trace[next++]);
+          while (next < trace.size() && (per_query_ms.size() < min_queries || total_ms < static_cast<double>(budget_ms))) {
+            const QueryOp& q = trace[next++];
+            const double ms = run_query(q);
+            per_query_ms.push_back(ms);
+            total_ms += ms;
+            logical_bytes += q.r * unit_bytes;
+          }
+          // Same accounting as footprint and workload's memory table, warm-up included.
+          client_bytes = ram.peak_memory_usage().total();
+        }
+        for (const auto& f : files) std::remove(f.c_str());
+
+        TuneResult res{};
+        res.Z = static_cast<int>(Z);
+        res.B = static_cast<size_t>(B);
+        res.L = L_b;
+        res.queries = per_query_ms.size();
+        res.mbps = total_ms > 0 ? (logical_bytes / 1048576.0) / (total_ms / 1000.0) : 0.0;
+        res.p95_ms = percentile(per_query_ms, 0.95);
+        const uint64_t bucket_bytes = roram::Bucket(params.Z, params.B, params.ell + 1).serialized_size(params);
+        const double server_bytes = static_cast<double>(params.ell + 1) *
+                                    static_cast<double>((1ULL << (params.h + 1)) - 1) * static_cast<double>(bucket_bytes);
+        res.storage_overhead = server_bytes / static_cast<double>(volume_bytes);
+        res.client_bytes = client_bytes;
+        results.push_back(res);
+      }
+    }
+  }
+
+  for (auto& r : results) {
+    r.pareto = true;
+    for (const auto& o : results)
+      if (tune_dominates(o, r)) { r.pareto = false; break; }
+  }
+  std::cout << std::fixed << std::setprecision(3);
+  for (const auto& r : results) {
+    std::cout << std::setw(6) << r.Z << std::setw(8) << r.B << std::setw(8) << r.L << std::setw(10) << r.queries
+              << std::setw(14) << r.mbps << std::setw(12) << r.p95_ms << std::setw(16) << r.storage_overhead
+              << std::setw(16) << r.client_bytes << std::setw(10) << (r.pareto ? "*" : "") << "\n";
+  }
+  if (!csv_path.empty()) {
+    std::ofstream csv(csv_path);
+    if (csv) {
+      csv << "Z,B,L,queries,mbps,p95_ms,storage_overhead,client_bytes,pareto\n";
+      for (const auto& r : results)
+        csv << r.Z << "," << r.B << "," << r.L << "," << r.queries << "," << r.mbps << "," << r.p95_ms << ","
+            << r.storage_overhead << "," << r.client_bytes << "," << (r.pareto ? 1 : 0) << "\n";
       std::cout << "Wrote " << csv_path << "\n";
     }
   }
+
+  // Recommendation: the Pareto point with the highest throughput that meets the limits.
+  const TuneResult* best = nullptr;
+  for (const auto& r : results) {
+    if (!r.pareto) continue;
+    if (max_client_bytes && r.client_bytes > max_client_bytes) continue;
+    if (max_p95_ms > 0 && r.p95_ms > max_p95_ms) continue;
+    if (max_overhead > 0 && r.storage_overhead > max_overhead) continue;
+    if (!best || r.mbps > best->mbps || (r.mbps == best->mbps && r.storage_overhead < best->storage_overhead))
+      best = &r;
+  }
+  if (!best) {
+    std::cout << "No configuration meets the limits\n";
+    return 1;
+  }
+  const uint64_t N_b = (N * unit_bytes + best->B - 1) / best->B;
+  std::cout << "Recommended: roram::Params(" << N_b << ", " << best->L << ", " << best->Z << ", " << best->B
+            << ")  N=" << N_b << " L=" << best->L << " Z=" << best->Z << " B=" << best->B << "\n";
   return 0;
 }
 
+// replay-io: drive a file or device with a recorded --io-trace, without ORAM CPU cost.
+static int main_replay_io(int argc, char** argv) {
+  std::string trace_path, target;
+  roram::IoReplayOptions opts;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--trace" && i + 1 < argc) { trace_path = argv[++i]; continue; }
+    if (arg == "--target" && i + 1 < argc) { target = argv[++i]; continue; }
+    if (arg == "--trees" && i + 1 < argc) { opts.trees = argv[++i]; continue; }
+    if (arg == "--timed") { opts.timed = true; continue; }
+    if (arg == "--sync") { opts.sync = true; continue; }
+  }
+  if (trace_path.empty() || target.empty()) { usage(argv[0]); return 1; }
+  const roram::IoTrace trace = roram::read_io_trace(trace_path);
+  const roram::IoReplayResult res = roram::replay_io_trace(trace, target, opts);
+  const uint64_t ops = res.reads + res.writes;
+  std::cout << "Replay I/O  trace=" << trace_path << " target=" << target << " trees=";
+  int shown = 0;
+  for (const std::string& name : trace.tree_names)
+    if (name.find(opts.trees) != std::string::npos) std::cout << (shown++ ? "," : "") << name;
+  std::cout << " target_MB=" << std::fixed << std::setprecision(1) << res.target_bytes / 1048576.0;
+  if (opts.timed) std::cout << " timed=1";
+  if (opts.sync) std::cout << " sync=1";
+  std::cout << "\n" << std::string(120, '-') << "\n";
+  std::cout << std::setw(10) << "reads" << std::setw(10) << "writes" << std::setw(12) << "MB_read"
+            << std::setw(12) << "MB_written" << std::setw(12) << "seconds" << std::setw(12) << "mbps"
+            << std::setw(12) << "iops" << std::setw(12) << "mean_us" << std::setw(12) << "p50_us"
+            << std::setw(12) << "p99_us" << "\n" << std::string(120, '-') << "\n";
+  double mean_us = 0;
+  for (double v : res.latency_us) mean_us += v;
+  if (!res.latency_us.empty()) mean_us /= res.latency_us.size();
+  const double secs = res.seconds > 0 ? res.seconds : 1e-9;
+  std::cout << std::setprecision(3) << std::setw(10) << res.reads << std::setw(10) << res.writes
+            << std::setw(12) << res.bytes_read / 1048576.0 << std::setw(12) << res.bytes_written / 1048576.0
+            << std::setw(12) << res.seconds << std::setw(12) << (res.bytes_read + res.bytes_written) / 1048576.0 / secs
+            << std::setw(12) << ops / secs << std::setw(12) << mean_us
+            << std::setw(12) << percentile(res.latency_us, 0.50) << std::setw(12) << percentile(res.latency_us, 0.99) << "\n";
+  if (res.syncs) std::cout << "Replayed " << res.syncs << " syncs (fdatasync of the target)\n";
+  return 0;
+}
+
+// trace-convert: CSV logical trace -> memory-mappable binary trace for workload/tune --trace.
+static int main_trace_convert(int argc, char** argv) {
+  if (argc < 4) { usage(argv[0]); return 1; }
+  const auto start = std::chrono::steady_clock::now();
+  const std::vector<QueryOp> trace = load_trace_csv(argv[2], UINT64_MAX, UINT64_MAX);
+  std::vector<roram::LogicalOp> ops;
+  ops.reserve(trace.size());
+  for (const QueryOp& q : trace) ops.push_back(roram::LogicalOp{q.a, q.r, q.is_write});
+  roram::write_logical_trace(argv[3], ops);
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Wrote " << argv[3] << " (" << ops.size() << " queries, " << std::fixed << std::setprecision(1) << ms
+            << " ms)\n";
+  return 0;
+}
+
+// Projected client RAM for a volume before provisioning it (see project_roram_memory).
+static int main_footprint(int argc, char** argv) {
+  uint64_t N = 65536;
+  uint64_t L = 8192;
+  int Z = 4;
+  size_t B = 4096;
+  uint64_t pm_cutoff = 0;
+  uint64_t stash_slack = 64;
+  bool per_tree = false;
+  bool parallel_evict = false;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--N" && i + 1 < argc) { N = std::stoull(argv[++i]); continue; }
+    if (arg == "--L" && i + 1 < argc) { L = std::stoull(argv[++i]); continue; }
+    if (arg == "--Z" && i + 1 < argc) { Z = std::stoi(argv[++i]); continue; }
+    if (arg == "--B" && i + 1 < argc) { B = static_cast<size_t>(std::stoull(argv[++i])); continue; }
+    if (arg == "--pm-cutoff" && i + 1 < argc) { pm_cutoff = std::stoull(argv[++i]); continue; }
+    if (arg == "--stash-slack" && i + 1 < argc) { stash_slack = std::stoull(argv[++i]); continue; }
+    if (arg == "--per-tree") { per_tree = true; continue; }
+    if (arg == "--parallel-evict") { parallel_evict = true; continue; }
+  }
+  const roram::Params params(N, L, Z, B);
+  const roram::Params params_path(N, 1, Z, B);
+  const roram::MemoryUsage r = roram::project_roram_memory(params, pm_cutoff, stash_slack, parallel_evict);
+  std::cout << "Projected client footprint  N=" << N << " L=" << L << " Z=" << Z << " B=" << B
+            << " ell=" << params.ell << " h=" << params.h << " data=" << std::fixed << std::setprecision(2)
+            << (N * static_cast<double>(B)) / 1048576.0 << " MiB";
+  if (pm_cutoff) std::cout << " pm_cutoff=" << pm_cutoff;
+  std::cout << "\n";
+  std::vector<std::pair<std::string, roram::MemoryUsage>> rows;
+  if (per_tree)
+    for (size_t i = 0; i < r.trees.size(); ++i) rows.emplace_back("rORAM R" + std::to_string(i), r.trees[i]);
+  rows.emplace_back("rORAM", r);
+  rows.emplace_back("PathORAM", roram::project_path_oram_memory(params_path, stash_slack));
+  print_memory_usage(rows);
+  return 0;
+}
+
+// Regression check between two --json result files. Rows with samples are gated on the mean
+// and the metrics derived from it, by their 95% confidence intervals (mean_std_ci): a change is
+// significant only when the intervals do not overlap and it exceeds min_change. Their other
+// metrics (percentiles) have no interval and are printed for information only. Rows without
+// samples (closed-/open-loop) gate every latency and throughput metric on min_change alone.
+static int main_diff(int argc, char** argv) {
+  std::vector<std::string> files;
+  double min_change = 0.05;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--min-change" && i + 1 < argc) { min_change = std::stod(argv[++i]) / 100.0; continue; }
+    files.push_back(arg);
+  }
+  if (files.size() != 2) {
+    std::cerr << "Usage: diff base.json new.json [--min-change PCT]\n";
+    return 1;
+  }
+  const roram::ResultSet base = roram::read_results_json(files[0]);
+  const roram::ResultSet cur = roram::read_results_json(files[1]);
+  std::cout << "base: " << files[0] << " (" << base.command << ", rev " << base.git_rev << ", " << base.backend << ", "
+            << base.crypto << ")\n";
+  std::cout << "new:  " << files[1] << " (" << cur.command << ", rev " << cur.git_rev << ", " << cur.backend << ", "
+            << cur.crypto << ")\n";
+  if (base.command != cur.command || base.backend != cur.backend || base.crypto != cur.crypto)
+    std::cout << "warning: command, backend or crypto differ; results may not be comparable\n";
+  for (const auto& kv : cur.config) {
+    for (const auto& bkv : base.config)
+      if (bkv.first == kv.first && bkv.second != kv.second)
+        std::cout << "warning: config " << kv.first << " differs (" << bkv.second << " -> " << kv.second << ")\n";
+  }
+
+  // Latency-like metrics (*_ms) regress upwards, throughput downwards. max_ms is a single
+  // sample and std_ms a spread, both too noisy to gate on.
+  auto gated = [](const std::string& name) {
+    if (name == "max_ms" || name == "std_ms") return false;
+    const bool latency = name.size() > 3 && name.compare(name.size() - 3, 3, "_ms") == 0;
+    return latency || name == "qps" || name == "achieved_qps" || name == "mbps";
+  };
+  // Positive = worse.
+  auto worse_by = [](const std::string& name, double b, double n) -> double {
+    if (!(b > 0)) return 0.0;
+    const bool throughput = name == "qps" || name == "achieved_qps" || name == "mbps";
+    return throughput ? (b - n) / b : (n - b) / b;
+  };
+  // The mean and the metrics computed from it, which the samples' confidence intervals cover.
+  auto from_mean = [](const std::string& name) {
+    return name == "mean_ms" || name == "qps" || name == "mbps" || name == "time_per_block_ms";
+  };
+
+  std::cout << std::string(132, '-') << "\n";
+  std::cout << std::setw(16) << "scheme" << std::setw(34) << "case" << std::setw(22) << "metric"
+            << std::setw(14) << "base" << std::setw(14) << "new" << std::setw(12) << "change_%"
+            << std::setw(20) << "verdict" << "\n";
+  std::cout << std::string(132, '-') << "\n";
+  std::cout << std::fixed << std::setprecision(3);
+  int regressions = 0;
+  for (const auto& n : cur.results) {
+    const roram::ResultRecord* b = base.find(n.scheme, n.label);
+    if (!b) {
+      std::cout << std::setw(16) << n.scheme << std::setw(34) << n.label << std::setw(22) << "-" << std::setw(14) << "-"
+                << std::setw(14) << "-" << std::setw(12) << "-" << std::setw(20) << "new" << "\n";
+      continue;
+    }
+    const bool same_params = b->params.N == n.params.N && b->params.L == n.params.L && b->params.Z == n.params.Z &&
+                             b->params.B == n.params.B;
+    // A row counts once, however many of its metrics (often views of one mean) regressed.
+    bool regressed = false;
+    auto print = [&](const std::string& metric, double bv, double nv, std::string verdict) {
+      if (!same_params) verdict += " params!";
+      if (verdict.compare(0, 10, "REGRESSION") == 0) regressed = true;
+      const double change = bv != 0 ? (nv - bv) / bv : 0.0;
+      std::cout << std::setw(16) << n.scheme << std::setw(34) << n.label << std::setw(22) << metric << std::setw(14)
+                << bv << std::setw(14) << nv << std::setw(12) << change * 100.0 << std::setw(20) << verdict << "\n";
+    };
+    // With samples on both sides, metrics of the mean regress only when the 95% intervals do
+    // not overlap and the change beats the threshold, and the rest are only shown ("info").
+    // Without samples every metric is gated on the threshold alone ("(thr)").
+    const bool sampled = b->samples_ms.size() >= 2 && n.samples_ms.size() >= 2;
+    double bm = 0, nm = 0, sd = 0, blo = 0, bhi = 0, nlo = 0, nhi = 0;
+    if (sampled) {
+      mean_std_ci(b->samples_ms, bm, sd, blo, bhi);
+      mean_std_ci(n.samples_ms, nm, sd, nlo, nhi);
+    }
+    auto ci_verdict = [&](double w) {
+      if (nlo > bhi && w > min_change) return "REGRESSION";
+      if (nhi < blo && -w > min_change) return "improved";
+      return "ok";
+    };
+    if (sampled) print("mean_ms", bm, nm, ci_verdict(worse_by("mean_ms", bm, nm)));
+    for (const auto& m : n.metrics) {
+      const double* bv = b->metric(m.first);
+      if (!bv || !gated(m.first) || (sampled && m.first == "mean_ms")) continue;
+      const double w = worse_by(m.first, *bv, m.second);
+      if (sampled && from_mean(m.first))
+        print(m.first, *bv, m.second, ci_verdict(w));
+      else if (sampled)
+        print(m.first, *bv, m.second, "info");
+      else
+        print(m.first, *bv, m.second, w > min_change ? "REGRESSION (thr)" : (w < -min_change ? "improved (thr)" : "ok (thr)"));
+    }
+    regressions += regressed;
+  }
+  for (const auto& b : base.results)
+    if (!cur.find(b.scheme, b.label))
+      std::cout << std::setw(16) << b.scheme << std::setw(34) << b.label << "  (missing from new)\n";
+  std::cout << regressions << " row(s) regressed beyond " << min_change * 100.0 << "%";
+  std::cout << (regressions ? "\n" : "; no significant slowdowns\n");
+  return regressions ? 2 : 0;
+}
+
 int main(int argc, char** argv) {
   if (argc < 2) { usage(argv[0]); return 1; }
   std::string cmd = argv[1];
@@ -538,6 +2074,12 @@ int main(int argc, char** argv) {
   if (cmd == "write") return main_write(argc, argv);
   if (cmd == "compare") return main_compare(argc, argv);
   if (cmd == "workload") return main_workload(argc, argv);
+  if (cmd == "scan") return main_scan(argc, argv);
+  if (cmd == "tune") return main_tune(argc, argv);
+  if (cmd == "replay-io") return main_replay_io(argc, argv);
+  if (cmd == "trace-convert") return main_trace_convert(argc, argv);
+  if (cmd == "diff") return main_diff(argc, argv);
+  if (cmd == "footprint") return main_footprint(argc, argv);
   usage(argv[0]);
   return 1;
 }
@@ -0,0 +1,94 @@
+#include "roram/memory_usage.hpp"
+#include "roram/block.hpp"
+#include "roram/position_map.hpp"
+#include <algorithm>
+
+namespace roram {
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+  position_map += other.position_map;
+  stash_blocks += other.stash_blocks;
+  stash_payload += other.stash_payload;
+  scratch += other.scratch;
+  evict_buffers = std::max(evict_buffers, other.evict_buffers);
+  stashed += other.stashed;
+  return *this;
+}
+
+uint64_t MemoryUsage::block_bytes(const Params& params) {
+  return sizeof(Block) + params.B + static_cast<uint64_t>(params.ell + 1) * sizeof(uint64_t);
+}
+
+uint64_t MemoryUsage::bucket_bytes(const Params& params) {
+  return sizeof(Bucket) + static_cast<uint64_t>(params.Z) * block_bytes(params);
+}
+
+void MemoryUsage::add_stash(uint64_t blocks, const Params& params) {
+  stash_blocks += blocks * (block_bytes(params) - params.B);
+  stash_payload += blocks * params.B;
+  stashed += blocks;
+}
+
+uint64_t eviction_buckets(uint64_t k, int h) {
+  uint64_t total = 0;
+  for (int j = 0; j <= h; ++j) total += std::min<uint64_t>(k, 1ULL << j);
+  return total;
+}
+
+namespace {
+
+// Real blocks on the buckets of k evicted paths at the tree's average occupancy, N blocks
+// over (2N-1)*Z slots. Stale copies and blocks already stashed make the merge smaller in
+// practice, so this errs high.
+uint64_t expected_real_blocks(const Params& params, uint64_t k) {
+  const double fill = static_cast<double>(params.N) / (2.0 * static_cast<double>(params.N) - 1.0);
+  return static_cast<uint64_t>(static_cast<double>(eviction_buckets(k, params.h)) * fill + 0.5);
+}
+
+// Read buffer of the largest single-level run (MemoryStorage scratch; FileStorage allocates
+// the same per call).
+uint64_t projected_scratch(const Params& params, uint64_t k) {
+  const uint64_t serialized = Bucket(params.Z, params.B, params.ell + 1).serialized_size(params);
+  return std::min<uint64_t>(k, 1ULL << params.h) * serialized;
+}
+
+}  // namespace
+
+MemoryUsage project_path_oram_memory(const Params& params, uint64_t stash_slack) {
+  MemoryUsage m;
+  m.position_map = PositionMap::packed_bytes(params.N, 0);
+  m.add_stash(expected_real_blocks(params, 1) + stash_slack, params);
+  m.scratch = projected_scratch(params, 1);
+  m.evict_buffers = eviction_buckets(1, params.h) * MemoryUsage::bucket_bytes(params);
+  return m;
+}
+
+MemoryUsage project_roram_memory(const Params& params, uint64_t pm_cutoff, uint64_t stash_slack,
+                                 bool parallel_evict) {
+  MemoryUsage m;
+  uint64_t evict_sum = 0;
+  bool outsourced = false;
+  const uint64_t k = 2 * (1ULL << params.ell);  // largest range: two ranges of 2^ℓ staged
+  for (int i = 0; i <= params.ell; ++i) {
+    MemoryUsage tree;
+    const uint64_t stride = 1ULL << i;
+    if (pm_cutoff > 0 && (params.N + stride - 1) / stride > pm_cutoff) {
+      const Params pm_params(PositionMap::backing_blocks(params.N, i, params.B), 1, params.Z, params.B);
+      tree.position_map = project_path_oram_memory(pm_params, stash_slack).total();
+      outsourced = true;
+    } else {
+      tree.position_map = PositionMap::packed_bytes(params.N, i);
+    }
+    tree.add_stash(k + expected_real_blocks(params, k) + stash_slack, params);
+    tree.scratch = projected_scratch(params, k);
+    tree.evict_buffers = eviction_buckets(k, params.h) * MemoryUsage::bucket_bytes(params);
+    evict_sum += tree.evict_buffers;
+    m += tree;
+    m.trees.push_back(tree);
+  }
+  // rORAM evicts one tree at a time while a position map is outsourced.
+  if (parallel_evict && !outsourced) m.evict_buffers = evict_sum;
+  return m;
+}
+
+}  // namespace roram
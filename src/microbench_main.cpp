@@ -0,0 +1,406 @@
+#include "roram/basic_sub_oram.hpp"
+#include "roram/bit_reverse.hpp"
+#include "roram/block.hpp"
+#include "roram/crypto.hpp"
+#include "roram/header_scan.hpp"
+#include "roram/huge_pages.hpp"
+#include "roram/path_oram.hpp"
+#include "roram/position_map.hpp"
+#include "roram/roram.hpp"
+#include "roram/storage.hpp"
+#include "roram/sub_oram.hpp"
+#include "roram/types.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Hot-path kernels timed in isolation. Every case runs its op in growing batches until
+// --min-ms has elapsed and reports ns/op and (where an op moves bytes) MB/s.
+
+namespace {
+
+struct Options {
+  double min_ms = 50.0;
+  std::string filter;
+  std::string csv_path;
+  std::string file_dir = "/tmp";
+  int tlb_h = 18;  // tree height of the huge-page path-read case
+};
+
+struct Result {
+  std::string kernel;
+  std::string params;
+  double ns_per_op;
+  double mb_per_s;
+};
+
+volatile uint64_t g_sink = 0;  // keeps results observable so loops are not optimized away
+
+uint64_t lcg(uint64_t& state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 11;
+}
+
+class Runner {
+ public:
+  explicit Runner(const Options& opts) : opts_(opts) {}
+
+  bool enabled(const std::string& kernel) const {
+    return opts_.filter.empty() || kernel.find(opts_.filter) != std::string::npos;
+  }
+  // Calls of op made by the last run(), warm-up included.
+  uint64_t last_calls() const { return last_calls_; }
+
+  // op runs once per call; bytes_per_op = 0 omits MB/s.
+  void run(const std::string& kernel, const std::string& params, uint64_t bytes_per_op,
+           const std::function<void()>& op) {
+    if (!enabled(kernel)) return;
+    op();  // warm-up
+    uint64_t iters = 0;
+    uint64_t batch = 1;
+    double elapsed_ms = 0;
+    while (elapsed_ms < opts_.min_ms) {
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t k = 0; k < batch; ++k) op();
+      auto end = std::chrono::steady_clock::now();
+      elapsed_ms += std::chrono::duration<double, std::milli>(end - start).count();
+      iters += batch;
+      if (batch < (1ULL << 20)) batch *= 2;
+    }
+    last_calls_ = iters + 1;
+    const double ns = elapsed_ms * 1e6 / static_cast<double>(iters);
+    const double mbps = bytes_per_op > 0 ? (bytes_per_op / 1048576.0) / (ns / 1e9) : 0.0;
+    results_.push_back(Result{kernel, params, ns, mbps});
+    std::cout << std::setw(22) << kernel << std::setw(30) << params << std::setw(14) << ns;
+    if (bytes_per_op > 0) std::cout << std::setw(14) << mbps;
+    std::cout << "\n";
+  }
+
+  void write_csv() const {
+    if (opts_.csv_path.empty()) return;
+    std::ofstream csv(opts_.csv_path);
+    if (!csv) return;
+    csv << "kernel,params,ns_per_op,mb_per_s\n";
+    for (const auto& r : results_) csv << r.kernel << ",\"" << r.params << "\"," << r.ns_per_op << "," << r.mb_per_s << "\n";
+    std::cout << "Wrote " << opts_.csv_path << "\n";
+  }
+
+ private:
+  Options opts_;
+  std::vector<Result> results_;
+  uint64_t last_calls_ = 0;
+};
+
+// A bucket of Z valid blocks with distinct addresses and patterned payloads.
+roram::Bucket full_bucket(const roram::Params& params, uint64_t first_addr) {
+  roram::Bucket b(params.Z, params.B, params.ell + 1);
+  for (int z = 0; z < params.Z; ++z) {
+    roram::Block& blk = b.blocks[static_cast<size_t>(z)];
+    blk.a = first_addr + static_cast<uint64_t>(z);
+    blk.ver = 0;
+    for (size_t k = 0; k < blk.data.size(); ++k) blk.data[k] = static_cast<uint8_t>(k + z);
+  }
+  return b;
+}
+
+std::string grid(const roram::Params& p) {
+  return "Z=" + std::to_string(p.Z) + " B=" + std::to_string(p.B) + " ell=" + std::to_string(p.ell);
+}
+
+void bench_serialize(Runner& run) {
+  for (int Z : {4, 8}) {
+    for (size_t B : {512, 4096}) {
+      for (uint64_t L : {1, 16, 256}) {
+        roram::Params params(1 << 16, L, Z, B);
+        roram::Bucket bucket = full_bucket(params, 0);
+        std::vector<uint8_t> buf(bucket.serialized_size(params));
+        run.run("bucket_serialize", grid(params), buf.size(), [&] {
+          bucket.serialize(buf.data(), params);
+          g_sink = g_sink + buf[buf.size() / 2];
+        });
+        run.run("bucket_deserialize", grid(params), buf.size(), [&] {
+          bucket.deserialize(buf.data(), params);
+          g_sink = g_sink + bucket.blocks[0].a;
+        });
+      }
+    }
+  }
+}
+
+// Merging a bucket whose blocks are already stashed (the common duplicate case): the
+// position-map check plus a scan of the stash per block; the stash does not grow.
+void bench_merge(Runner& run) {
+  for (size_t stash_size : {0, 64, 512, 4096}) {
+    roram::Params params(1 << 16, 1, 4, 4096);
+    roram::MemoryStorage storage(params);
+    roram::NoOpCrypto crypto;
+    roram::SubORAM sub(params, 0, &storage, &crypto);
+    const uint64_t base = 1000;
+    roram::Bucket bucket = full_bucket(params, base);
+    for (auto& blk : bucket.blocks) blk.p[0] = 0;  // position map entries start at 0
+    for (size_t s = 0; s < stash_size; ++s) {
+      roram::Block blk(params.B, params.ell + 1);
+      blk.a = base + params.Z + s;
+      sub.stash().push_back(blk);
+    }
+    for (const auto& blk : bucket.blocks) sub.stash().push_back(blk);
+    std::vector<roram::Bucket> buckets{bucket};
+    run.run("merge_into_stash", "Z=4 B=4096 stash=" + std::to_string(stash_size), 0, [&] {
+      sub.merge_into_stash(buckets);
+      g_sink = g_sink + sub.stash().size();
+    });
+  }
+}
+
+// ISAs the header-scan cases are repeated under; the dispatch is restored afterwards.
+std::vector<roram::ScanIsa> scan_isas() {
+  std::vector<roram::ScanIsa> out;
+  for (roram::ScanIsa isa : {roram::ScanIsa::Scalar, roram::ScanIsa::AVX2, roram::ScanIsa::AVX512})
+    if (roram::scan_isa_supported(isa)) out.push_back(isa);
+  return out;
+}
+
+// One level's write-phase assignment (count buckets) over a stash of random tags; the
+// chosen blocks are put back so the stash keeps its size across iterations.
+void bench_assign(Runner& run) {
+  const roram::ScanIsa saved = roram::scan_isa();
+  for (roram::ScanIsa isa : scan_isas()) {
+    roram::set_scan_isa(isa);
+    for (size_t stash_size : {16, 128, 1024}) {
+      for (int level : {4, 12}) {
+        roram::Params params(1 << 16, 1, 4, 64);
+        std::vector<roram::Block> stash;
+        uint64_t seed = 7;
+        for (size_t s = 0; s < stash_size; ++s) {
+          roram::Block blk(params.B, params.ell + 1);
+          blk.a = s;
+          blk.p[0] = lcg(seed) % params.N;
+          stash.push_back(blk);
+        }
+        const uint64_t n_buckets = 1ULL << level;
+        const uint64_t count = std::min<uint64_t>(n_buckets, 64);
+        std::vector<roram::Bucket> dst(static_cast<size_t>(count), roram::Bucket(params.Z, params.B, params.ell + 1));
+        uint64_t r = 0;
+        run.run("batch_evict_assign",
+                std::string(roram::scan_isa_name(isa)) + " Z=4 B=64 level=" + std::to_string(level) +
+                    " stash=" + std::to_string(stash_size),
+                0, [&] {
+                  roram::SubORAM::assign_level(stash, 0, n_buckets, r, count, params.Z, dst.data());
+                  for (auto& bucket : dst)
+                    for (auto& blk : bucket.blocks)
+                      if (blk.valid()) stash.push_back(std::move(blk));
+                  r = (r + count) % n_buckets;
+                  g_sink = g_sink + stash.size();
+                });
+      }
+    }
+  }
+  roram::set_scan_isa(saved);
+}
+
+// The packed-header filters on their own: address range (ReadRange), tag match (assignment)
+// and address lookup (stash merge), over n headers.
+void bench_header_scan(Runner& run) {
+  const roram::ScanIsa saved = roram::scan_isa();
+  for (roram::ScanIsa isa : scan_isas()) {
+    roram::set_scan_isa(isa);
+    for (size_t n : {64, 1024, 16384}) {
+      std::vector<uint64_t> v(n);
+      uint64_t seed = 5;
+      for (auto& x : v) x = lcg(seed) % (1 << 20);
+      std::vector<uint64_t> mask(roram::mask_words(n));
+      const std::string p = std::string(roram::scan_isa_name(isa)) + " n=" + std::to_string(n);
+      const uint64_t bytes = n * sizeof(uint64_t);
+      run.run("scan_in_range", p, bytes, [&] {
+        g_sink = g_sink + roram::scan_in_range(v.data(), n, 1000, 1064, mask.data());
+      });
+      uint64_t r = 0;
+      run.run("scan_tag_match", p, bytes, [&] {
+        g_sink = g_sink + roram::scan_masked_equal(v.data(), n, 4095, r++ & 4095, mask.data());
+      });
+      run.run("scan_find", p, bytes, [&] { g_sink = g_sink + roram::scan_find(v.data(), n, 1ULL << 21); });
+    }
+  }
+  roram::set_scan_isa(saved);
+}
+
+// Whole in-memory accesses (ReadRange on every tree plus BatchEvict) on the dynamic and the
+// compile-time specialized sub-ORAM core.
+void bench_sub_oram_core(Runner& run) {
+  if (!run.enabled("roram_access")) return;
+  for (bool specialized : {false, true}) {
+    roram::set_sub_oram_specialization(specialized);
+    roram::Params params(1 << 14, 16, 4, 256);
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+    uint64_t seed = 13;
+    for (uint64_t r : {1, 16}) {
+      const std::string p = std::string(specialized ? "specialized" : "generic") + " " + grid(params) +
+                            " r=" + std::to_string(r);
+      run.run("roram_access", p, r * params.B, [&] {
+        g_sink = g_sink + ram.Access(lcg(seed) % (params.N - r), r, "read").size();
+      });
+    }
+  }
+  roram::set_sub_oram_specialization(true);
+}
+
+void bench_position_map(Runner& run) {
+  for (uint64_t N : {1ULL << 16, 1ULL << 20, 1ULL << 24}) {
+    roram::PositionMap pm(N, 0);
+    uint64_t seed = 3;
+    const std::string p = "N=2^" + std::to_string(roram::Params::range_exponent(N));
+    run.run("position_map_query", p, 0, [&] { g_sink = g_sink + pm.query(lcg(seed) % N); });
+    run.run("position_map_update", p, 0, [&] {
+      const uint64_t x = lcg(seed);
+      pm.update(x % N, (x >> 20) % N);
+    });
+  }
+}
+
+void bench_bit_reverse(Runner& run) {
+  for (int bits : {10, 20, 30}) {
+    uint64_t x = 0;
+    run.run("bit_reverse", "bits=" + std::to_string(bits), 0, [&] { g_sink = g_sink + roram::bit_reverse(x++, bits); });
+  }
+}
+
+// Runs of count consecutive buckets on the deepest level, at random offsets.
+void bench_storage(Runner& run, const Options& opts) {
+  roram::Params params(1 << 14, 1, 4, 4096);
+  const std::string file = opts.file_dir + "/roram_microbench_storage";
+  for (int backend = 0; backend < 2; ++backend) {
+    std::unique_ptr<roram::StorageBackend> storage;
+    if (backend == 0)
+      storage = std::make_unique<roram::MemoryStorage>(params);
+    else
+      storage = std::make_unique<roram::FileStorage>(params, file);
+    const std::string name = backend == 0 ? "memory" : "file";
+    const uint64_t n_buckets = 1ULL << params.h;
+    std::vector<roram::Bucket> init(static_cast<size_t>(n_buckets), roram::Bucket(params.Z, params.B, params.ell + 1));
+    for (auto& b : init)
+      for (auto& blk : b.blocks) blk.set_dummy();
+    storage->write_buckets(params.h, 0, init);
+    for (uint64_t count : {1, 16, 256}) {
+      std::vector<roram::Bucket> out;
+      std::vector<roram::Bucket> in(static_cast<size_t>(count), init[0]);
+      uint64_t seed = 11;
+      const uint64_t bytes = count * storage->bucket_byte_size();
+      const std::string p = name + " run=" + std::to_string(count);
+      run.run("storage_read_run", p, bytes, [&] {
+        out.clear();
+        storage->read_buckets(params.h, lcg(seed) % (n_buckets - count + 1), count, out);
+        g_sink = g_sink + out.size();
+      });
+      run.run("storage_write_run", p, bytes, [&] {
+        storage->write_buckets(params.h, lcg(seed) % (n_buckets - count + 1), in);
+      });
+    }
+  }
+  std::remove(file.c_str());
+}
+
+// Random root-to-leaf paths over a tree far larger than the TLB reach of 4 KiB pages, once
+// per huge-page mode. Every page is written first, so the timed loop takes TLB refills, not
+// first-touch faults; dTLB misses per path (when a PMU is exposed) show what 2 MiB pages save.
+void bench_huge_pages(Runner& run, const Options& opts) {
+  if (!run.enabled("storage_path_read")) return;
+  roram::Params params(1ULL << opts.tlb_h, 1, 4, 256);
+  for (roram::HugePages mode : {roram::HugePages::Off, roram::HugePages::Transparent, roram::HugePages::Explicit}) {
+    roram::MemoryStorage storage(params, nullptr, mode);
+    for (int j = 0; j <= params.h; ++j) {
+      const uint64_t level_buckets = 1ULL << j;
+      const uint64_t chunk = std::min<uint64_t>(level_buckets, 4096);
+      std::vector<roram::Bucket> fill(static_cast<size_t>(chunk), roram::Bucket(params.Z, params.B, params.ell + 1));
+      for (auto& b : fill)
+        for (auto& blk : b.blocks) blk.set_dummy();
+      for (uint64_t start = 0; start < level_buckets; start += chunk) storage.write_buckets(j, start, fill);
+    }
+    std::vector<roram::BucketExtent> path(static_cast<size_t>(params.h + 1));
+    std::vector<roram::Bucket> out;
+    uint64_t seed = 17;
+    const std::string p = "h=" + std::to_string(params.h) + " huge=" + roram::huge_pages_name(mode) + "->" +
+                          roram::huge_pages_name(storage.huge_pages());
+    roram::TlbCounters counters;
+    counters.start();
+    run.run("storage_path_read", p, (params.h + 1) * storage.bucket_byte_size(), [&] {
+      const uint64_t leaf = lcg(seed) & ((1ULL << params.h) - 1);
+      for (int j = 0; j <= params.h; ++j) path[static_cast<size_t>(j)] = {j, leaf >> (params.h - j), 1};
+      storage.read_extents(path, out);
+      g_sink = g_sink + out.size();
+    });
+    counters.stop();
+    const double calls = static_cast<double>(std::max<uint64_t>(run.last_calls(), 1));
+    std::cout << std::setw(52) << "dtlb_misses/op=";
+    if (counters.has_dtlb())
+      std::cout << counters.dtlb_misses() / calls;
+    else
+      std::cout << "n/a";
+    std::cout << " page_faults/op=" << (counters.has_faults() ? counters.page_faults() / calls : 0.0)
+              << " huge_MB=" << roram::process_huge_page_bytes() / 1048576.0 << "\n";
+  }
+}
+
+void bench_crypto(Runner& run) {
+  std::vector<std::pair<std::string, std::unique_ptr<roram::CryptoProvider>>> providers;
+  providers.emplace_back("noop", std::make_unique<roram::NoOpCrypto>());
+#ifdef RORAM_USE_OPENSSL
+  providers.emplace_back("aes-gcm", std::make_unique<roram::OpenSSLCrypto>(std::vector<uint8_t>(16, 0x42)));
+#endif
+  for (auto& [name, crypto] : providers) {
+    for (size_t len : {4096, 16384, 65536}) {
+      std::vector<uint8_t> buf(len, 0x5a);
+      std::vector<uint8_t> tag(16, 0);
+      uint64_t id = 0;
+      const std::string p = name + " bytes=" + std::to_string(len);
+      run.run("encrypt_decrypt", p, len, [&] {
+        crypto->encrypt(buf.data(), len, id, tag.data());
+        crypto->decrypt(buf.data(), len, id, tag.data());
+        ++id;
+        g_sink = g_sink + buf[0];
+      });
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--min-ms" && i + 1 < argc) { opts.min_ms = std::stod(argv[++i]); continue; }
+    if (arg == "--filter" && i + 1 < argc) { opts.filter = argv[++i]; continue; }
+    if (arg == "--csv" && i + 1 < argc) { opts.csv_path = argv[++i]; continue; }
+    if (arg == "--dir" && i + 1 < argc) { opts.file_dir = argv[++i]; continue; }
+    if (arg == "--tlb-h" && i + 1 < argc) { opts.tlb_h = std::stoi(argv[++i]); continue; }
+    std::cerr << "Usage: " << argv[0] << " [--min-ms T] [--filter SUBSTR] [--csv path] [--dir DIR] [--tlb-h H]\n";
+    return 1;
+  }
+  Runner run(opts);
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(22) << "kernel" << std::setw(30) << "params" << std::setw(14) << "ns/op" << std::setw(14) << "MB/s"
+            << "\n" << std::string(80, '-') << "\n";
+  try {
+    bench_serialize(run);
+    bench_merge(run);
+    bench_assign(run);
+    bench_header_scan(run);
+    bench_sub_oram_core(run);
+    bench_position_map(run);
+    bench_bit_reverse(run);
+    bench_storage(run, opts);
+    bench_huge_pages(run, opts);
+    bench_crypto(run);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  run.write_csv();
+  return 0;
+}
@@ -5,38 +5,79 @@
 
 namespace roram {
 
+static StorageFactory checked_local_factory(bool use_memory_storage, const std::string& file_path,
+                                            bool count_seeks) {
+  if (!use_memory_storage && file_path.empty())
+    throw std::runtime_error("PathORAM: file_path required for file storage");
+  return local_storage_factory(use_memory_storage, file_path, count_seeks);
+}
+
+// Backing ORAM for the position map of an N-block PathORAM, or null when the packed map
+// already fits the client budget. The backing ORAM recurses with the same budget.
+static std::unique_ptr<PathORAM> position_map_backing(const Params& params, CryptoProvider* crypto,
+                                                      const StorageFactory& storage, uint64_t budget,
+                                                      size_t block_size) {
+  if (budget == 0 || PositionMap::packed_bytes(params.N, 0) <= budget) return nullptr;
+  const size_t B = block_size ? block_size : params.B;
+  const uint64_t blocks = PositionMap::backing_blocks(params.N, 0, B);
+  if (blocks >= params.N) throw std::runtime_error("PathORAM: position-map block size too small to recurse");
+  StorageFactory pm_storage = [storage](const Params& p, const std::string& name, CryptoProvider* c) {
+    return storage(p, "_pm" + name, c);
+  };
+  return std::make_unique<PathORAM>(Params(blocks, 1, params.Z, B), std::make_unique<CryptoRef>(crypto),
+                                    pm_storage, budget, block_size);
+}
+
 PathORAM::PathORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto,
-                   bool use_memory_storage, const std::string& file_path, bool count_seeks)
-    : params_(params), crypto_(std::move(crypto)) {
+                   bool use_memory_storage, const std::string& file_path, bool count_seeks,
+                   uint64_t pm_client_budget, size_t pm_block_size)
+    : PathORAM(params, std::move(crypto), checked_local_factory(use_memory_storage, file_path, count_seeks),
+               pm_client_budget, pm_block_size) {}
+
+PathORAM::PathORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto,
+                   const StorageFactory& storage, uint64_t pm_client_budget, size_t pm_block_size)
+    : params_(params), crypto_(std::move(crypto)),
+      position_map_(params.N, 0,
+                    position_map_backing(params, crypto_.get(), storage, pm_client_budget, pm_block_size)) {
   if (params_.L != 1) {
     throw std::runtime_error("PathORAM: expected L=1");
   }
   if (params_.N == 0) {
     throw std::runtime_error("PathORAM: N must be > 0");
   }
-  position_map_.assign(params_.N, 0);
-  for (uint64_t a = 0; a < params_.N; ++a) {
-    position_map_[a] = crypto_->random_path(params_.N);
-  }
-  if (use_memory_storage) {
-    storage_ = std::make_unique<MemoryStorage>(params_, crypto_.get());
-  } else {
-    if (file_path.empty()) throw std::runtime_error("PathORAM: file_path required for file storage");
-    storage_ = std::make_unique<FileStorage>(params_, file_path, count_seeks, crypto_.get());
-  }
+  position_map_.fill([this] { return crypto_->random_path(params_.N); });
+  storage_ = storage(params_, "", crypto_.get());
+  storage_->set_stats(&stats_);
 }
 
-bool PathORAM::block_on_path(uint64_t block_leaf, uint64_t access_leaf, int level, int h) {
-  (void)h;
-  return (block_leaf % (1ULL << level)) == (access_leaf % (1ULL << level));
+std::vector<BucketExtent> PathORAM::path_extents(const std::vector<uint64_t>& leaves) const {
+  std::vector<BucketExtent> extents;
+  std::vector<uint64_t> buckets;
+  for (int level = 0; level <= params_.h; ++level) {
+    buckets.clear();
+    for (uint64_t leaf : leaves) buckets.push_back(leaf % (1ULL << level));
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    for (uint64_t b : buckets) {
+      BucketExtent* last = extents.empty() ? nullptr : &extents.back();
+      if (last && last->level == level && last->start + last->count == b)
+        ++last->count;
+      else
+        extents.push_back(BucketExtent{level, b, 1});
+    }
+  }
+  return extents;
 }
 
-void PathORAM::read_path_into_stash(uint64_t leaf) {
-  for (int level = 0; level <= params_.h; ++level) {
-    uint64_t bucket = leaf % (1ULL << level);
-    std::vector<Bucket> fetched;
-    storage_->read_buckets(level, bucket, 1, fetched);
-    for (const Block& b : fetched[0].blocks) {
+void PathORAM::read_paths_into_stash(const std::vector<BucketExtent>& extents) {
+  std::vector<Bucket> fetched;
+  {
+    ScopedPhase t(&stats_, Phase::ReadRange, 0);
+    storage_->read_extents(extents, fetched);
+  }
+  ScopedPhase t(&stats_, Phase::StashMerge);
+  for (const Bucket& bucket : fetched) {
+    for (const Block& b : bucket.blocks) {
       if (!b.valid()) continue;
       auto it = std::find_if(stash_.begin(), stash_.end(), [&b](const Block& x) { return x.a == b.a; });
       if (it == stash_.end()) stash_.push_back(b);
@@ -44,65 +85,183 @@ void PathORAM::read_path_into_stash(uint64_t leaf) {
   }
 }
 
-void PathORAM::evict_path(uint64_t leaf) {
-  for (int level = params_.h; level >= 0; --level) {
-    Bucket out(params_.Z, params_.B, params_.ell + 1);
-    size_t inserted = 0;
-    for (auto it = stash_.begin(); it != stash_.end() && inserted < static_cast<size_t>(params_.Z);) {
-      uint64_t b_leaf = it->p[0];
-      if (block_on_path(b_leaf, leaf, level, params_.h)) {
-        out.blocks[inserted++] = *it;
-        it = stash_.erase(it);
-      } else {
-        ++it;
+// Greedy eviction, deepest buckets first (extents are in path_extents' root-first order).
+void PathORAM::evict_paths(const std::vector<BucketExtent>& extents) {
+  std::vector<size_t> first(extents.size() + 1, 0);
+  for (size_t k = 0; k < extents.size(); ++k) first[k + 1] = first[k] + static_cast<size_t>(extents[k].count);
+  // The stash is at its largest here, and path is the size the read buffer was.
+  peak_stash_ = std::max(peak_stash_, stash_.size());
+  peak_path_buckets_ = std::max<uint64_t>(peak_path_buckets_, first.back());
+  std::vector<Bucket> path(first.back(), Bucket(params_.Z, params_.B, params_.ell + 1));
+  {
+    ScopedPhase t(&stats_, Phase::EvictAssign);
+    for (size_t k = extents.size(); k-- > 0;) {
+      const BucketExtent& e = extents[k];
+      const uint64_t n_buckets = 1ULL << e.level;
+      for (uint64_t b = e.start; b < e.start + e.count; ++b) {
+        Bucket& out = path[first[k] + static_cast<size_t>(b - e.start)];
+        size_t inserted = 0;
+        for (auto it = stash_.begin(); it != stash_.end() && inserted < static_cast<size_t>(params_.Z);) {
+          if (it->p[0] % n_buckets == b) {
+            out.blocks[inserted++] = *it;
+            it = stash_.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        for (size_t i = inserted; i < out.blocks.size(); ++i) out.blocks[i].set_dummy();
       }
     }
-    for (size_t i = inserted; i < out.blocks.size(); ++i) out.blocks[i].set_dummy();
-    uint64_t bucket = leaf % (1ULL << level);
-    std::vector<Bucket> one{out};
-    storage_->write_buckets(level, bucket, one);
   }
+  ScopedPhase t(&stats_, Phase::EvictWrite);
+  storage_->write_extents(extents, path);
 }
 
-std::vector<uint8_t> PathORAM::Access(uint64_t block_id, const std::string& op,
-                                      const std::vector<uint8_t>* write_data) {
-  if (block_id >= params_.N) throw std::runtime_error("PathORAM::Access: block_id out of bounds");
-  if (op != "read" && op != "write") throw std::runtime_error("PathORAM::Access: op must be read/write");
-  uint64_t old_leaf = position_map_[block_id];
-  uint64_t new_leaf = crypto_->random_path(params_.N);
-  position_map_[block_id] = new_leaf;
-
-  read_path_into_stash(old_leaf);
-
+std::vector<Block>::iterator PathORAM::stash_block(uint64_t block_id) {
   auto it = std::find_if(stash_.begin(), stash_.end(), [block_id](const Block& b) { return b.a == block_id; });
   if (it == stash_.end()) {
     Block b(params_.B, params_.ell + 1);
     b.a = block_id;
-    b.p[0] = old_leaf;
     stash_.push_back(b);
     it = stash_.end() - 1;
   }
+  return it;
+}
 
-  std::vector<uint8_t> result = it->data;
-  if (op == "write") {
-    if (!write_data || write_data->size() != params_.B)
-      throw std::runtime_error("PathORAM::Access: write_data must have size B");
-    std::memcpy(it->data.data(), write_data->data(), params_.B);
-    result = it->data;
-  }
+// Remap block_id to a fresh leaf, pull its old path into the stash and return the
+// stash entry (created zero-filled on first access). Caller must evict old_leaf.
+std::vector<Block>::iterator PathORAM::fetch_block(uint64_t block_id, uint64_t& old_leaf) {
+  ++accesses_;
+  uint64_t new_leaf = crypto_->random_path(params_.N);
+  old_leaf = position_map_.exchange(block_id, new_leaf);
+
+  read_paths_into_stash(path_extents({old_leaf}));
+
+  auto it = stash_block(block_id);
   it->p[0] = new_leaf;
+  return it;
+}
+
+std::vector<uint8_t> PathORAM::Access(uint64_t block_id, const std::string& op,
+                                      const std::vector<uint8_t>* write_data) {
+  if (block_id >= params_.N) throw std::runtime_error("PathORAM::Access: block_id out of bounds");
+  if (op != "read" && op != "write") throw std::runtime_error("PathORAM::Access: op must be read/write");
+  if (op == "write" && (!write_data || write_data->size() != params_.B))
+    throw std::runtime_error("PathORAM::Access: write_data must have size B");
+  uint64_t old_leaf = 0;
+  auto it = fetch_block(block_id, old_leaf);
+
+  if (op == "write")
+    std::memcpy(it->data.data(), write_data->data(), params_.B);
+  std::vector<uint8_t> result = it->data;
 
-  evict_path(old_leaf);
+  evict_paths(path_extents({old_leaf}));
   return result;
 }
 
+std::vector<std::vector<uint8_t>> PathORAM::AccessBatch(const std::vector<uint64_t>& ids, const std::string& op,
+                                                        const std::vector<std::vector<uint8_t>>* write_data) {
+  if (op != "read" && op != "write") throw std::runtime_error("PathORAM::AccessBatch: op must be read/write");
+  if (op == "write" && (!write_data || write_data->size() != ids.size()))
+    throw std::runtime_error("PathORAM::AccessBatch: write_data must have one entry per id");
+  for (size_t k = 0; k < ids.size(); ++k) {
+    if (ids[k] >= params_.N) throw std::runtime_error("PathORAM::AccessBatch: block_id out of bounds");
+    if (op == "write" && (*write_data)[k].size() != params_.B)
+      throw std::runtime_error("PathORAM::AccessBatch: write_data must have size B");
+  }
+  std::vector<uint64_t> old_leaves(ids.size()), new_leaves(ids.size());
+  for (size_t k = 0; k < ids.size(); ++k) {
+    new_leaves[k] = crypto_->random_path(params_.N);
+    old_leaves[k] = position_map_.exchange(ids[k], new_leaves[k]);
+  }
+  // A repeated id also fetches its first new leaf: harmless, and the block is already stashed.
+  const std::vector<BucketExtent> extents = path_extents(old_leaves);
+  read_paths_into_stash(extents);
+
+  std::vector<std::vector<uint8_t>> results;
+  results.reserve(ids.size());
+  for (size_t k = 0; k < ids.size(); ++k) {
+    auto it = stash_block(ids[k]);
+    it->p[0] = new_leaves[k];
+    if (op == "write") std::memcpy(it->data.data(), (*write_data)[k].data(), params_.B);
+    results.push_back(it->data);
+  }
+  accesses_ += ids.size();
+  evict_paths(extents);
+  return results;
+}
+
+void PathORAM::Update(uint64_t block_id, const std::function<void(std::vector<uint8_t>&)>& fn) {
+  if (block_id >= params_.N) throw std::runtime_error("PathORAM::Update: block_id out of bounds");
+  uint64_t old_leaf = 0;
+  auto it = fetch_block(block_id, old_leaf);
+  fn(it->data);
+  if (it->data.size() != params_.B) throw std::runtime_error("PathORAM::Update: payload size changed");
+  evict_paths(path_extents({old_leaf}));
+}
+
 uint64_t PathORAM::get_seek_count() const {
-  return storage_->get_seek_count();
+  return storage_->get_seek_count() + position_map_.backing_seek_count();
+}
+
+int PathORAM::recursion_depth() const {
+  const PathORAM* backing = position_map_.backing();
+  return backing ? 1 + backing->recursion_depth() : 0;
+}
+
+uint64_t PathORAM::position_map_accesses() const {
+  const PathORAM* backing = position_map_.backing();
+  return backing ? backing->access_count() + backing->position_map_accesses() : 0;
+}
+
+StatsSnapshot PathORAM::stats() const {
+  StatsSnapshot total = stats_.snapshot();
+  if (const PathORAM* backing = position_map_.backing()) total += backing->stats();
+  return total;
+}
+
+void PathORAM::reset_stats() {
+  stats_.reset();
+  if (PathORAM* backing = position_map_.backing()) backing->reset_stats();
+}
+
+uint64_t PathORAM::client_bytes() const {
+  return position_map_.client_bytes() + stash_.size() * Block::serialized_size(params_);
+}
+
+MemoryUsage PathORAM::memory_usage() const {
+  MemoryUsage m;
+  const PathORAM* pm = position_map_.backing();
+  m.position_map = pm ? pm->memory_usage().total() : position_map_.client_bytes();
+  m.add_stash(stash_.size(), params_);
+  m.scratch = storage_->scratch_bytes();
+  return m;
+}
+
+MemoryUsage PathORAM::peak_memory_usage() const {
+  MemoryUsage m;
+  const PathORAM* pm = position_map_.backing();
+  m.position_map = pm ? pm->peak_memory_usage().total() : position_map_.client_bytes();
+  m.add_stash(peak_stash_, params_);
+  m.scratch = storage_->scratch_bytes();
+  m.evict_buffers = peak_path_buckets_ * MemoryUsage::bucket_bytes(params_);
+  return m;
+}
+
+void PathORAM::reset_peak_memory() {
+  peak_stash_ = stash_.size();
+  peak_path_buckets_ = 0;
+  if (PathORAM* pm = position_map_.backing()) pm->reset_peak_memory();
+}
+
+void PathORAM::sync() {
+  storage_->sync();
+  if (PathORAM* pm = position_map_.backing()) pm->sync();
 }
 
 uint64_t PathORAM::debug_position(uint64_t block_id) const {
-  if (block_id >= position_map_.size()) throw std::runtime_error("PathORAM::debug_position: block_id out of bounds");
-  return position_map_[block_id];
+  if (block_id >= params_.N) throw std::runtime_error("PathORAM::debug_position: block_id out of bounds");
+  return position_map_.query(block_id);
 }
 
 }  // namespace roram
@@ -1,24 +1,187 @@
 #include "roram/position_map.hpp"
+#include "roram/path_oram.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 namespace roram {
 
-PositionMap::PositionMap(uint64_t N, int range_exp) : range_exp_(range_exp) {
+// Packed layout: entry idx occupies bits [idx*w, idx*w + w) of a little-endian word array
+// and may straddle two words. Words are accessed through memcpy so the same helpers work
+// on the client array and on raw ORAM block payloads.
+static inline uint64_t load_word(const uint8_t* base, uint64_t word) {
+  uint64_t v;
+  std::memcpy(&v, base + word * sizeof(uint64_t), sizeof(uint64_t));
+  return v;
+}
+
+static inline void store_word(uint8_t* base, uint64_t word, uint64_t v) {
+  std::memcpy(base + word * sizeof(uint64_t), &v, sizeof(uint64_t));
+}
+
+static inline uint64_t get_packed(const uint8_t* base, uint64_t idx, int w) {
+  const uint64_t mask = (w == 64) ? ~0ULL : ((1ULL << w) - 1);
+  const uint64_t bit = idx * static_cast<uint64_t>(w);
+  const uint64_t word = bit >> 6;
+  const unsigned sh = static_cast<unsigned>(bit & 63);
+  uint64_t v = load_word(base, word) >> sh;
+  if (sh + static_cast<unsigned>(w) > 64) v |= load_word(base, word + 1) << (64 - sh);
+  return v & mask;
+}
+
+static inline void set_packed(uint8_t* base, uint64_t idx, int w, uint64_t value) {
+  const uint64_t mask = (w == 64) ? ~0ULL : ((1ULL << w) - 1);
+  const uint64_t bit = idx * static_cast<uint64_t>(w);
+  const uint64_t word = bit >> 6;
+  const unsigned sh = static_cast<unsigned>(bit & 63);
+  uint64_t lo = load_word(base, word);
+  lo = (lo & ~(mask << sh)) | ((value & mask) << sh);
+  store_word(base, word, lo);
+  if (sh + static_cast<unsigned>(w) > 64) {
+    const unsigned spill = sh + static_cast<unsigned>(w) - 64;
+    uint64_t hi = load_word(base, word + 1);
+    hi = (hi & ~((1ULL << spill) - 1)) | ((value & mask) >> (64 - sh));
+    store_word(base, word + 1, hi);
+  }
+}
+
+static uint64_t entries_for(uint64_t N, int range_exp) {
   uint64_t stride = 1ULL << range_exp;
   uint64_t num_entries = (N + stride - 1) / stride;
-  if (num_entries == 0) num_entries = 1;
-  positions_.assign(num_entries, 0);
+  return num_entries == 0 ? 1 : num_entries;
+}
+
+static int width_for(uint64_t N) {
+  int w = Params::range_exponent(N);  // ceil(log2 N): leaf indices are < N
+  return w == 0 ? 1 : w;
+}
+
+static uint64_t entries_per_block(size_t B, int w) {
+  return (B / sizeof(uint64_t)) * 64 / static_cast<uint64_t>(w);
+}
+
+uint64_t PositionMap::backing_blocks(uint64_t N, int range_exp, size_t B) {
+  uint64_t per_block = entries_per_block(B, width_for(N));
+  if (per_block == 0) throw std::runtime_error("PositionMap: block too small for outsourced map");
+  return (entries_for(N, range_exp) + per_block - 1) / per_block;
+}
+
+uint64_t PositionMap::packed_bytes(uint64_t N, int range_exp) {
+  return (entries_for(N, range_exp) * static_cast<uint64_t>(width_for(N)) + 63) / 64 * sizeof(uint64_t);
+}
+
+PositionMap::PositionMap(uint64_t N, int range_exp, std::unique_ptr<PathORAM> backing)
+    : range_exp_(range_exp), width_(width_for(N)), num_entries_(entries_for(N, range_exp)),
+      backing_(std::move(backing)) {
+  if (!backing_) {
+    words_.assign((num_entries_ * static_cast<uint64_t>(width_) + 63) / 64, 0);
+    return;
+  }
+  entries_per_block_ = entries_per_block(backing_->block_size(), width_);
+  if (entries_per_block_ == 0 || backing_->num_blocks() * entries_per_block_ < num_entries_)
+    throw std::runtime_error("PositionMap: backing ORAM too small");
 }
 
+PositionMap::~PositionMap() = default;
+PositionMap::PositionMap(PositionMap&&) noexcept = default;
+PositionMap& PositionMap::operator=(PositionMap&&) noexcept = default;
+
 uint64_t PositionMap::query(uint64_t range_start) const {
   uint64_t idx = range_start >> range_exp_;
-  if (idx >= positions_.size()) return 0;
-  return positions_[idx];
+  if (idx >= num_entries_) {
+    dummy_access();
+    return 0;
+  }
+  if (!backing_) return get_packed(reinterpret_cast<const uint8_t*>(words_.data()), idx, width_);
+  std::vector<uint8_t> blk = backing_->Access(idx / entries_per_block_, "read");
+  return get_packed(blk.data(), idx % entries_per_block_, width_);
 }
 
 void PositionMap::update(uint64_t range_start, uint64_t leaf_index) {
   uint64_t idx = range_start >> range_exp_;
-  if (idx < positions_.size())
-    positions_[idx] = leaf_index;
+  if (idx >= num_entries_) {
+    dummy_access();
+    return;
+  }
+  if (width_ < 64 && (leaf_index >> width_) != 0)
+    throw std::runtime_error("PositionMap::update: leaf index does not fit entry width");
+  if (!backing_) {
+    set_packed(reinterpret_cast<uint8_t*>(words_.data()), idx, width_, leaf_index);
+    return;
+  }
+  const uint64_t slot = idx % entries_per_block_;
+  const int w = width_;
+  backing_->Update(idx / entries_per_block_, [slot, w, leaf_index](std::vector<uint8_t>& blk) {
+    set_packed(blk.data(), slot, w, leaf_index);
+  });
+}
+
+uint64_t PositionMap::exchange(uint64_t range_start, uint64_t leaf_index) {
+  uint64_t idx = range_start >> range_exp_;
+  if (idx >= num_entries_) {
+    dummy_access();
+    return 0;
+  }
+  if (width_ < 64 && (leaf_index >> width_) != 0)
+    throw std::runtime_error("PositionMap::exchange: leaf index does not fit entry width");
+  if (!backing_) {
+    uint8_t* base = reinterpret_cast<uint8_t*>(words_.data());
+    uint64_t old = get_packed(base, idx, width_);
+    set_packed(base, idx, width_, leaf_index);
+    return old;
+  }
+  const uint64_t slot = idx % entries_per_block_;
+  const int w = width_;
+  uint64_t old = 0;
+  backing_->Update(idx / entries_per_block_, [slot, w, leaf_index, &old](std::vector<uint8_t>& blk) {
+    old = get_packed(blk.data(), slot, w);
+    set_packed(blk.data(), slot, w, leaf_index);
+  });
+  return old;
+}
+
+void PositionMap::fill(const std::function<uint64_t()>& next_leaf) {
+  if (!backing_) {
+    for (uint64_t idx = 0; idx < num_entries_; ++idx)
+      set_packed(reinterpret_cast<uint8_t*>(words_.data()), idx, width_, next_leaf());
+    return;
+  }
+  const int w = width_;
+  for (uint64_t first = 0; first < num_entries_; first += entries_per_block_) {
+    const uint64_t n = std::min(entries_per_block_, num_entries_ - first);
+    backing_->Update(first / entries_per_block_, [n, w, &next_leaf](std::vector<uint8_t>& blk) {
+      for (uint64_t slot = 0; slot < n; ++slot) set_packed(blk.data(), slot, w, next_leaf());
+    });
+  }
+}
+
+void PositionMap::dummy_access() const {
+  // Any block will do: a PathORAM access reads and evicts a uniformly random path.
+  if (backing_) backing_->Access(0, "read");
+}
+
+uint64_t PositionMap::client_bytes() const {
+  if (!backing_) return words_.size() * sizeof(uint64_t);
+  return backing_->client_bytes();
+}
+
+const std::vector<uint64_t>& PositionMap::packed() const {
+  if (backing_) throw std::runtime_error("PositionMap::packed: map is outsourced");
+  return words_;
+}
+
+void PositionMap::load_packed(const std::vector<uint64_t>& words) {
+  if (backing_) throw std::runtime_error("PositionMap::load_packed: map is outsourced");
+  if (words.size() != words_.size()) throw std::runtime_error("PositionMap::load_packed: size mismatch");
+  words_ = words;
+}
+
+uint64_t PositionMap::backing_accesses() const {
+  return backing_ ? backing_->access_count() : 0;
+}
+
+uint64_t PositionMap::backing_seek_count() const {
+  return backing_ ? backing_->get_seek_count() : 0;
 }
 
 }  // namespace roram
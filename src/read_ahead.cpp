@@ -0,0 +1,189 @@
+#include "roram/read_ahead.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace roram {
+
+ReadAheadORAM::ReadAheadORAM(rORAM& oram, ReadAheadOptions opts) : oram_(oram), opts_(opts) {
+  if (opts_.max_streams == 0) opts_.max_streams = 1;
+  if (opts_.max_buffer_blocks == 0)
+    opts_.max_buffer_blocks = static_cast<uint64_t>(opts_.depth) * oram_.params().L * opts_.max_streams;
+  worker_ = std::thread([this] { run(); });
+}
+
+ReadAheadORAM::~ReadAheadORAM() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = true;
+    for (auto& job : queue_) job->cancelled = true;
+  }
+  work_cv_.notify_all();
+  worker_.join();
+}
+
+void ReadAheadORAM::run() {
+  std::unique_lock<std::mutex> lk(mu_);
+  for (;;) {
+    work_cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;  // stop_ with nothing left
+    std::shared_ptr<Job> job = std::move(queue_.front());
+    queue_.pop_front();
+    if (job->cancelled) {
+      job->done.set_value(Result());
+      if (queue_.empty()) idle_cv_.notify_all();
+      continue;
+    }
+    running_ = true;
+    lk.unlock();
+    try {
+      job->done.set_value(oram_.Access(job->a, job->r, "read"));
+    } catch (...) {
+      job->done.set_exception(std::current_exception());
+    }
+    lk.lock();
+    running_ = false;
+    if (queue_.empty()) idle_cv_.notify_all();
+  }
+}
+
+void ReadAheadORAM::drain() {
+  std::unique_lock<std::mutex> lk(mu_);
+  idle_cv_.wait(lk, [this] { return queue_.empty() && !running_; });
+}
+
+uint64_t ReadAheadORAM::buffered_blocks() const {
+  uint64_t total = 0;
+  for (const Stream& s : streams_)
+    for (const Chunk& c : s.chunks) total += c.end - c.start;
+  return total;
+}
+
+void ReadAheadORAM::drop(Chunk& c) {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    c.job->cancelled = true;  // skipped if still queued; a running one finishes unread
+  }
+  if (!c.used) ++stats_.wasted;
+}
+
+void ReadAheadORAM::drop_overlapping(uint64_t a, uint64_t end) {
+  // The chunks after an overlapping one go too, so each stream's buffer stays contiguous.
+  for (Stream& s : streams_) {
+    auto it = std::find_if(s.chunks.begin(), s.chunks.end(),
+                           [&](const Chunk& c) { return c.start < end && a < c.end; });
+    for (auto k = it; k != s.chunks.end(); ++k) drop(*k);
+    s.chunks.erase(it, s.chunks.end());
+  }
+}
+
+ReadAheadORAM::Stream& ReadAheadORAM::stream_for(uint64_t a) {
+  for (Stream& s : streams_) {
+    if (s.next == a) return s;
+    for (const Chunk& c : s.chunks)
+      if (c.start <= a && a < c.end) return s;
+  }
+  if (streams_.size() >= opts_.max_streams) {
+    auto lru = std::min_element(streams_.begin(), streams_.end(),
+                                [](const Stream& x, const Stream& y) { return x.last_use < y.last_use; });
+    for (Chunk& c : lru->chunks) drop(c);
+    streams_.erase(lru);
+  }
+  Stream s;
+  s.next = a;
+  s.last_r = 0;
+  streams_.push_back(std::move(s));
+  return streams_.back();
+}
+
+void ReadAheadORAM::top_up(Stream& s) {
+  const Params& params = oram_.params();
+  const uint64_t len = std::min<uint64_t>(s.last_r, params.L);
+  if (len == 0) return;
+  uint64_t window = s.chunks.empty() ? s.next : s.chunks.back().end;
+  uint64_t buffered = buffered_blocks();
+  while (s.chunks.size() < opts_.depth && window < params.N) {
+    const uint64_t n = std::min(len, params.N - window);
+    if (buffered + n > opts_.max_buffer_blocks) break;
+    auto job = std::make_shared<Job>();
+    job->a = window;
+    job->r = n;
+    Chunk c{window, window + n, job, job->done.get_future().share(), false};
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      queue_.push_back(job);
+    }
+    work_cv_.notify_one();
+    s.chunks.push_back(std::move(c));
+    ++stats_.prefetches;
+    window += n;
+    buffered += n;
+  }
+  stats_.peak_buffered = std::max(stats_.peak_buffered, buffered);
+}
+
+ReadAheadORAM::Result ReadAheadORAM::Access(uint64_t a, uint64_t r, const std::string& op,
+                                            const std::vector<std::vector<uint8_t>>* D) {
+  if (op != "read") {
+    if (op == "write" && r > 0) {
+      ++stats_.writes;
+      drop_overlapping(a, a + r);
+    }
+    return oram_.Access(a, r, op, D);
+  }
+  if (r == 0) return {};
+  const Params& params = oram_.params();
+  if (r > params.L) throw std::runtime_error("ReadAheadORAM::Access: r > L");
+  if (a + r > params.N) throw std::runtime_error("ReadAheadORAM::Access: range out of bounds");
+  ++stats_.reads;
+  Stream& s = stream_for(a);
+
+  Result result;
+  result.reserve(static_cast<size_t>(r));
+  uint64_t pos = a;
+  for (auto it = s.chunks.begin(); it != s.chunks.end(); ++it) {
+    Chunk& c = *it;
+    if (pos == a + r || c.start > pos) break;
+    if (c.end <= pos) continue;
+    const Result* fetched = nullptr;
+    try {
+      fetched = &c.data.get();  // waits for the prefetch
+    } catch (...) {
+      // Nobody asked for the failed prefetch, so its error is not this read's: drop it
+      // (and the chunks after it, keeping the buffer contiguous) and read on demand below.
+      ++stats_.failed;
+      for (auto k = it; k != s.chunks.end(); ++k) drop(*k);
+      s.chunks.erase(it, s.chunks.end());
+      break;
+    }
+    const Result& data = *fetched;
+    const uint64_t take = std::min(c.end, a + r) - pos;
+    for (uint64_t k = 0; k < take; ++k) result.push_back(data[static_cast<size_t>(pos - c.start + k)]);
+    c.used = true;
+    stats_.hit_blocks += take;
+    pos += take;
+  }
+  if (pos < a + r) {
+    Result rest = oram_.Access(pos, a + r - pos, "read");
+    stats_.miss_blocks += rest.size();
+    for (auto& blk : rest) result.push_back(std::move(blk));
+  }
+
+  ++s.run;
+  s.next = a + r;
+  s.last_r = r;
+  s.last_use = ++clock_;
+  while (!s.chunks.empty() && s.chunks.front().end <= s.next) {
+    drop(s.chunks.front());
+    s.chunks.pop_front();
+  }
+  if (!s.chunks.empty() && s.chunks.front().start > s.next) {
+    // The read ended short of the buffer; it is no longer the stream's continuation.
+    for (Chunk& c : s.chunks) drop(c);
+    s.chunks.clear();
+  }
+  if (s.run >= opts_.trigger) top_up(s);
+  return result;
+}
+
+}  // namespace roram
@@ -0,0 +1,490 @@
+#include "roram/remote_storage.hpp"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace roram {
+
+namespace {
+
+const size_t kHeaderSize = 9;  // u8 op/status + u64 payload length
+// Largest frame accepted before OPEN (a name of up to 64 KiB plus the params), and largest
+// reply a client accepts beyond the bucket bytes it asked for (error text, seek count).
+const uint64_t kSmallFrame = 1ULL << 17;
+// WRITEs a client sends before it waits for their replies. Each reply is a 9-byte header,
+// so this many always fit in the socket buffers and neither side can block the other.
+const uint64_t kMaxPendingWrites = 64;
+// OPEN rejects trees with more levels than this (a 2^40-leaf tree is far past any device).
+const int kMaxTreeHeight = 40;
+
+void put_u16(std::vector<uint8_t>& out, uint16_t v) {
+  for (int i = 0; i < 2; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+  for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+// Bounds-checked little-endian reader over a received payload.
+struct Reader {
+  const uint8_t* p;
+  size_t left;
+  uint64_t get(int bytes) {
+    if (left < static_cast<size_t>(bytes)) throw std::runtime_error("StorageServer: truncated request");
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    p += bytes;
+    left -= static_cast<size_t>(bytes);
+    return v;
+  }
+};
+
+bool read_all(int fd, uint8_t* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::recv(fd, buf, len, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buf += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool write_all(int fd, const uint8_t* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::send(fd, buf, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buf += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool send_frame(int fd, uint8_t code, const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> header;
+  header.push_back(code);
+  put_u64(header, payload.size());
+  return write_all(fd, header.data(), header.size()) && write_all(fd, payload.data(), payload.size());
+}
+
+enum class Frame { Ok, Closed, TooLarge };
+
+// Reads one frame whose payload may be at most max_len bytes. On TooLarge the payload is
+// left unread, so the stream cannot be resynchronized: reply and close.
+Frame recv_frame(int fd, uint8_t& code, std::vector<uint8_t>& payload, uint64_t max_len) {
+  uint8_t header[kHeaderSize];
+  if (!read_all(fd, header, kHeaderSize)) return Frame::Closed;
+  code = header[0];
+  Reader r{header + 1, 8};
+  const uint64_t len = r.get(8);
+  if (len > max_len) return Frame::TooLarge;
+  payload.resize(static_cast<size_t>(len));
+  return read_all(fd, payload.data(), payload.size()) ? Frame::Ok : Frame::Closed;
+}
+
+void split_host_port(const std::string& rest, std::string& host, std::string& port) {
+  size_t colon = rest.rfind(':');
+  if (colon == std::string::npos) {
+    host.clear();
+    port = rest;
+  } else {
+    host = rest.substr(0, colon);
+    port = rest.substr(colon + 1);
+  }
+}
+
+int open_socket(const std::string& address, bool listening) {
+  if (address.rfind("unix:", 0) == 0) {
+    const std::string path = address.substr(5);
+    sockaddr_un sa{};
+    if (path.empty() || path.size() >= sizeof(sa.sun_path))
+      throw std::runtime_error("storage address: bad unix socket path: " + path);
+    sa.sun_family = AF_UNIX;
+    std::memcpy(sa.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw std::runtime_error("storage address: socket failed");
+    int rc;
+    if (listening) {
+      ::unlink(path.c_str());
+      rc = ::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+      if (rc == 0) rc = ::listen(fd, 64);
+    } else {
+      rc = ::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    }
+    if (rc != 0) {
+      ::close(fd);
+      throw std::runtime_error(std::string("storage address: ") + (listening ? "listen" : "connect") +
+                               " failed: " + address);
+    }
+    return fd;
+  }
+  if (address.rfind("tcp:", 0) == 0) {
+    std::string host, port;
+    split_host_port(address.substr(4), host, port);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (listening) hints.ai_flags = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+      throw std::runtime_error("storage address: cannot resolve " + address);
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+      fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      int one = 1;
+      int rc;
+      if (listening) {
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        rc = ::bind(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc == 0) rc = ::listen(fd, 64);
+      } else {
+        rc = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc == 0) ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+      if (rc == 0) break;
+      ::close(fd);
+      fd = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd < 0)
+      throw std::runtime_error(std::string("storage address: ") + (listening ? "listen" : "connect") +
+                               " failed: " + address);
+    return fd;
+  }
+  throw std::runtime_error("storage address: expected unix:<path> or tcp:<host>:<port>, got " + address);
+}
+
+void put_extents(std::vector<uint8_t>& out, const std::vector<BucketExtent>& extents) {
+  put_u32(out, static_cast<uint32_t>(extents.size()));
+  for (const BucketExtent& e : extents) {
+    put_u32(out, static_cast<uint32_t>(e.level));
+    put_u64(out, e.start);
+    put_u64(out, e.count);
+  }
+}
+
+}  // namespace
+
+int connect_storage_address(const std::string& address) {
+  return open_socket(address, false);
+}
+
+// ---------------------------------------------------------------------------
+// RemoteStorage
+// ---------------------------------------------------------------------------
+
+RemoteStorage::RemoteStorage(const Params& params, const std::string& address, const std::string& name,
+                             CryptoProvider* crypto, uint64_t rtt_us)
+    : params_(params), crypto_(crypto), rtt_us_(rtt_us), fd_(-1) {
+  Bucket b(params.Z, params.B, params.ell + 1);
+  bucket_plain_size_ = b.serialized_size(params_);
+  const size_t tag_size = crypto ? crypto->tag_size() : 0;
+  bucket_storage_size_ = bucket_plain_size_ + tag_size;
+  fd_ = connect_storage_address(address);
+  std::vector<uint8_t> open;
+  put_u16(open, static_cast<uint16_t>(name.size()));
+  open.insert(open.end(), name.begin(), name.end());
+  put_u64(open, params_.N);
+  put_u64(open, params_.L);
+  put_u32(open, static_cast<uint32_t>(params_.Z));
+  put_u64(open, params_.B);
+  put_u32(open, static_cast<uint32_t>(tag_size));
+  try {
+    call(StorageOp::Open, open);
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+}
+
+RemoteStorage::~RemoteStorage() {
+  if (fd_ < 0) return;
+  try {
+    drain_writes();  // the server has applied every WRITE once this returns
+  } catch (...) {
+    // Nothing to report to from a destructor.
+  }
+  ::close(fd_);
+}
+
+std::vector<uint8_t> RemoteStorage::await_reply(uint64_t max_len) const {
+  uint8_t status = 0;
+  std::vector<uint8_t> reply;
+  const Frame f = recv_frame(fd_, status, reply, std::max(max_len, kSmallFrame));
+  if (f == Frame::Closed) throw std::runtime_error("RemoteStorage: connection closed by server");
+  if (f == Frame::TooLarge) throw std::runtime_error("RemoteStorage: oversized reply");
+  if (status != 0)
+    throw std::runtime_error("RemoteStorage: " + std::string(reply.begin(), reply.end()));
+  return reply;
+}
+
+void RemoteStorage::drain_writes() const {
+  // Replies come back in request order; a failed WRITE surfaces here.
+  for (; pending_writes_ > 0; --pending_writes_) await_reply(0);
+}
+
+std::vector<uint8_t> RemoteStorage::call(StorageOp op, const std::vector<uint8_t>& payload,
+                                         uint64_t max_reply) const {
+  drain_writes();
+  if (!send_frame(fd_, static_cast<uint8_t>(op), payload))
+    throw std::runtime_error("RemoteStorage: send failed");
+  return await_reply(max_reply);
+}
+
+void RemoteStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count,
+                                 std::vector<Bucket>& out) {
+  read_extents({BucketExtent{level, start_bucket, count}}, out);
+}
+
+void RemoteStorage::write_buckets(int level, uint64_t start_bucket, const std::vector<Bucket>& buckets) {
+  write_extents({BucketExtent{level, start_bucket, buckets.size()}}, buckets);
+}
+
+void RemoteStorage::read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) {
+  std::vector<uint8_t> req;
+  put_extents(req, extents);
+  uint64_t total = 0;
+  for (const BucketExtent& e : extents) total += e.count;
+  for (const BucketExtent& e : extents)
+    account_io(e.level, false, (((1ULL << e.level) - 1) + e.start) * bucket_storage_size_, e.count);
+  std::vector<uint8_t> reply;
+  {
+    ScopedPhase t(stats_, Phase::RawIO);
+    if (rtt_us_) std::this_thread::sleep_for(std::chrono::microseconds(rtt_us_));
+    reply = call(StorageOp::Read, req, total * bucket_storage_size_);
+  }
+  ++round_trips_;
+
+  if (reply.size() != total * bucket_storage_size_)
+    throw std::runtime_error("RemoteStorage: short read reply");
+  if (crypto_) {
+    ScopedPhase t(stats_, Phase::Decrypt);
+    t.set_count(total);
+    size_t idx = 0;
+    for (const BucketExtent& e : extents) {
+      for (uint64_t i = 0; i < e.count; ++i, ++idx) {
+        uint8_t* bucket_ptr = reply.data() + idx * bucket_storage_size_;
+        uint64_t bucket_id = ((1ULL << e.level) - 1) + e.start + i;
+        crypto_->decrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+      }
+    }
+  }
+  ScopedPhase t(stats_, Phase::Serialize);
+  t.set_count(total);
+  out.assign(total, Bucket(params_.Z, params_.B, params_.ell + 1));
+  for (size_t idx = 0; idx < total; ++idx)
+    out[idx].deserialize(reply.data() + idx * bucket_storage_size_, params_);
+}
+
+void RemoteStorage::write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) {
+  std::vector<uint8_t> req;
+  put_extents(req, extents);
+  const size_t header = req.size();
+  uint64_t total = 0;
+  for (const BucketExtent& e : extents) total += e.count;
+  if (total > buckets.size()) throw std::runtime_error("RemoteStorage: extents exceed buckets");
+  if (total != buckets.size()) throw std::runtime_error("RemoteStorage: extents do not cover buckets");
+  req.resize(header + buckets.size() * bucket_storage_size_);
+  {
+    ScopedPhase t(stats_, Phase::Serialize);
+    t.set_count(total);
+    for (size_t idx = 0; idx < buckets.size(); ++idx)
+      buckets[idx].serialize(req.data() + header + idx * bucket_storage_size_, params_);
+  }
+  if (crypto_) {
+    ScopedPhase t(stats_, Phase::Encrypt);
+    t.set_count(total);
+    size_t idx = 0;
+    for (const BucketExtent& e : extents) {
+      for (uint64_t i = 0; i < e.count; ++i, ++idx) {
+        uint8_t* bucket_ptr = req.data() + header + idx * bucket_storage_size_;
+        uint64_t bucket_id = ((1ULL << e.level) - 1) + e.start + i;
+        crypto_->encrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+      }
+    }
+  }
+  for (const BucketExtent& e : extents)
+    account_io(e.level, true, (((1ULL << e.level) - 1) + e.start) * bucket_storage_size_, e.count);
+  {
+    // Pipelined: the reply is collected before this connection's next request, so the
+    // write costs no wait of its own (and no injected rtt_us).
+    ScopedPhase t(stats_, Phase::RawIO);
+    if (pending_writes_ >= kMaxPendingWrites) drain_writes();
+    if (!send_frame(fd_, static_cast<uint8_t>(StorageOp::Write), req))
+      throw std::runtime_error("RemoteStorage: send failed");
+    ++pending_writes_;
+  }
+  ++round_trips_;
+}
+
+void RemoteStorage::sync() {
+  ScopedPhase t(stats_, Phase::Sync);
+  if (rtt_us_) std::this_thread::sleep_for(std::chrono::microseconds(rtt_us_));
+  call(StorageOp::Sync, {});
+}
+
+uint64_t RemoteStorage::get_seek_count() const {
+  std::vector<uint8_t> reply = call(StorageOp::Seeks, {});
+  Reader r{reply.data(), reply.size()};
+  return r.get(8);
+}
+
+// ---------------------------------------------------------------------------
+// StorageServer
+// ---------------------------------------------------------------------------
+
+StorageServer::StorageServer(const std::string& address, const std::string& dir, bool count_seeks)
+    : address_(address), dir_(dir), count_seeks_(count_seeks), listen_fd_(open_socket(address, true)) {}
+
+StorageServer::~StorageServer() {
+  stop();
+}
+
+void StorageServer::start() {
+  acceptor_ = std::thread([this]() { serve(); });
+}
+
+void StorageServer::serve() {
+  while (!stop_) {
+    int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      break;  // listener closed by stop()
+    }
+    std::lock_guard<std::mutex> lk(mu_);
+    if (stop_) {
+      ::close(fd);
+      break;
+    }
+    conn_fds_.push_back(fd);
+    std::thread([this, fd]() {
+      handle(fd);
+      std::lock_guard<std::mutex> done(mu_);
+      conn_fds_.erase(std::find(conn_fds_.begin(), conn_fds_.end(), fd));
+      ::close(fd);
+      idle_cv_.notify_all();
+    }).detach();
+  }
+}
+
+void StorageServer::stop() {
+  if (stop_.exchange(true)) return;
+  if (listen_fd_ >= 0) {
+    ::shutdown(listen_fd_, SHUT_RDWR);  // wakes a blocked accept()
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (acceptor_.joinable()) acceptor_.join();
+  {
+    std::unique_lock<std::mutex> lk(mu_);
+    for (int fd : conn_fds_) ::shutdown(fd, SHUT_RDWR);  // handlers see EOF and exit
+    idle_cv_.wait(lk, [this]() { return conn_fds_.empty(); });
+  }
+  if (address_.rfind("unix:", 0) == 0) ::unlink(address_.substr(5).c_str());
+}
+
+void StorageServer::handle(int fd) {
+  std::unique_ptr<FileStorage> store;
+  Params params(1, 1, 1, 1);
+  uint64_t max_frame = kSmallFrame;  // raised by OPEN to the largest batch the tree allows
+  uint64_t tree_buckets = 0;
+  uint8_t code = 0;
+  std::vector<uint8_t> req;
+  for (;;) {
+    std::vector<uint8_t> reply;
+    uint8_t status = 0;
+    bool close_after = false;
+    try {
+      const Frame f = recv_frame(fd, code, req, max_frame);
+      if (f == Frame::Closed) break;
+      if (f == Frame::TooLarge) {
+        close_after = true;
+        throw std::runtime_error("StorageServer: frame exceeds " + std::to_string(max_frame) + " bytes");
+      }
+      Reader r{req.data(), req.size()};
+      const StorageOp op = static_cast<StorageOp>(code);
+      if (op == StorageOp::Open) {
+        const size_t len = static_cast<size_t>(r.get(2));
+        if (r.left < len) throw std::runtime_error("StorageServer: truncated request");
+        std::string name(reinterpret_cast<const char*>(r.p), len);
+        r.p += len;
+        r.left -= len;
+        if (name.empty() || name.find('/') != std::string::npos || name == "." || name == "..")
+          throw std::runtime_error("StorageServer: bad tree name: " + name);
+        const uint64_t N = r.get(8), L = r.get(8);
+        const int Z = static_cast<int>(r.get(4));
+        const size_t B = static_cast<size_t>(r.get(8));
+        const size_t tag_size = static_cast<size_t>(r.get(4));
+        const Params p(N, L, Z, B);
+        if (N == 0 || L == 0 || Z < 1 || Z > 64 || B == 0 || B > (1ULL << 24) || tag_size > 1024 ||
+            p.h > kMaxTreeHeight)
+          throw std::runtime_error("StorageServer: bad tree parameters");
+        params = p;
+        store = FileStorage::opaque(params, dir_ + "/" + name, count_seeks_, tag_size);
+        // A READ/WRITE names at most every bucket of the tree, each extent at least one.
+        tree_buckets = (1ULL << (params.h + 1)) - 1;
+        max_frame = 4 + tree_buckets * (20 + store->bucket_byte_size());
+      } else if (!store) {
+        throw std::runtime_error("StorageServer: OPEN required first");
+      } else if (op == StorageOp::Read || op == StorageOp::Write) {
+        const uint64_t n = r.get(4);
+        std::vector<BucketExtent> extents;
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+          BucketExtent e{static_cast<int>(r.get(4)), r.get(8), 0};
+          e.count = r.get(8);
+          if (e.level < 0 || e.level > params.h || e.start > (1ULL << e.level) ||
+              e.count > (1ULL << e.level) - e.start)
+            throw std::runtime_error("StorageServer: extent out of range");
+          extents.push_back(e);
+          total += e.count;
+          if (total > tree_buckets) throw std::runtime_error("StorageServer: batch larger than the tree");
+        }
+        const uint64_t bsz = store->bucket_byte_size();
+        if (op == StorageOp::Read) {
+          reply.resize(total * bsz);
+          uint8_t* dst = reply.data();
+          for (const BucketExtent& e : extents) {
+            store->read_raw(e.level, e.start, e.count, dst);
+            dst += e.count * bsz;
+          }
+        } else {
+          if (r.left != total * bsz) throw std::runtime_error("StorageServer: write payload size mismatch");
+          const uint8_t* src = r.p;
+          for (const BucketExtent& e : extents) {
+            store->write_raw(e.level, e.start, e.count, src);
+            src += e.count * bsz;
+          }
+        }
+      } else if (op == StorageOp::Seeks) {
+        put_u64(reply, store->get_seek_count());
+      } else if (op == StorageOp::Sync) {
+        store->sync();
+      } else {
+        throw std::runtime_error("StorageServer: unknown op " + std::to_string(code));
+      }
+    } catch (const std::exception& e) {  // includes bad_alloc: one request fails, not the server
+      status = 1;
+      const std::string msg = e.what();
+      reply.assign(msg.begin(), msg.end());
+    }
+    ++requests_;
+    if (!send_frame(fd, status, reply) || close_after) break;
+  }
+}
+
+}  // namespace roram
@@ -0,0 +1,298 @@
+#include "roram/results.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef RORAM_GIT_REV
+#define RORAM_GIT_REV "unknown"
+#endif
+
+namespace roram {
+
+namespace {
+
+const char* kSchema = "roram-results/1";
+
+std::string quote(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+          out += buf;
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out + "\"";
+}
+
+std::string number(double v) {
+  if (!std::isfinite(v)) return "null";
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.17g", v);
+  return buf;
+}
+
+// Minimal JSON DOM, enough for the results schema.
+struct Json {
+  enum Kind { Null, Bool, Number, String, Array, Object } kind = Null;
+  bool b = false;
+  double num = 0;
+  std::string str;
+  std::vector<Json> items;
+  std::map<std::string, Json> fields;
+
+  const Json* get(const std::string& key) const {
+    auto it = fields.find(key);
+    return it == fields.end() ? nullptr : &it->second;
+  }
+};
+
+class JsonParser {
+ public:
+  explicit JsonParser(const std::string& text) : s_(text) {}
+
+  Json parse() {
+    Json v = value();
+    ws();
+    if (pos_ != s_.size()) fail("trailing characters");
+    return v;
+  }
+
+ private:
+  const std::string& s_;
+  size_t pos_ = 0;
+
+  [[noreturn]] void fail(const std::string& msg) const {
+    throw std::runtime_error("read_results_json: " + msg + " at offset " + std::to_string(pos_));
+  }
+  void ws() {
+    while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\n' || s_[pos_] == '\r' || s_[pos_] == '\t')) ++pos_;
+  }
+  bool consume(char c) {
+    ws();
+    if (pos_ < s_.size() && s_[pos_] == c) { ++pos_; return true; }
+    return false;
+  }
+  void expect(char c) {
+    if (!consume(c)) fail(std::string("expected '") + c + "'");
+  }
+  bool literal(const char* word) {
+    const size_t n = std::char_traits<char>::length(word);
+    if (s_.compare(pos_, n, word) != 0) return false;
+    pos_ += n;
+    return true;
+  }
+
+  Json value() {
+    ws();
+    if (pos_ >= s_.size()) fail("unexpected end");
+    Json v;
+    const char c = s_[pos_];
+    if (c == '{') {
+      v.kind = Json::Object;
+      ++pos_;
+      if (consume('}')) return v;
+      do {
+        ws();
+        std::string key = string();
+        expect(':');
+        v.fields[key] = value();
+      } while (consume(','));
+      expect('}');
+    } else if (c == '[') {
+      v.kind = Json::Array;
+      ++pos_;
+      if (consume(']')) return v;
+      do { v.items.push_back(value()); } while (consume(','));
+      expect(']');
+    } else if (c == '"') {
+      v.kind = Json::String;
+      v.str = string();
+    } else if (literal("true")) {
+      v.kind = Json::Bool;
+      v.b = true;
+    } else if (literal("false")) {
+      v.kind = Json::Bool;
+    } else if (literal("null")) {
+      v.kind = Json::Null;
+    } else {
+      const char* begin = s_.c_str() + pos_;
+      char* end = nullptr;
+      v.kind = Json::Number;
+      v.num = std::strtod(begin, &end);
+      if (end == begin) fail("unexpected character");
+      pos_ += static_cast<size_t>(end - begin);
+    }
+    return v;
+  }
+
+  // The four hex digits of a \u escape.
+  unsigned hex4() {
+    if (pos_ + 4 > s_.size()) fail("bad \\u escape");
+    unsigned v = 0;
+    for (int i = 0; i < 4; ++i) {
+      const char c = s_[pos_++];
+      v <<= 4;
+      if (c >= '0' && c <= '9') v |= static_cast<unsigned>(c - '0');
+      else if (c >= 'a' && c <= 'f') v |= static_cast<unsigned>(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') v |= static_cast<unsigned>(c - 'A' + 10);
+      else fail("bad \\u escape");
+    }
+    return v;
+  }
+
+  std::string string() {
+    if (pos_ >= s_.size() || s_[pos_] != '"') fail("expected string");
+    ++pos_;
+    std::string out;
+    while (pos_ < s_.size() && s_[pos_] != '"') {
+      char c = s_[pos_++];
+      if (c != '\\') { out += c; continue; }
+      if (pos_ >= s_.size()) break;
+      c = s_[pos_++];
+      switch (c) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          unsigned cp = hex4();
+          if (cp >= 0xDC00 && cp <= 0xDFFF) fail("unpaired surrogate in \\u escape");
+          if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (s_.compare(pos_, 2, "\\u") != 0) fail("unpaired surrogate in \\u escape");
+            pos_ += 2;
+            const unsigned lo = hex4();
+            if (lo < 0xDC00 || lo > 0xDFFF) fail("unpaired surrogate in \\u escape");
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+          }
+          if (cp < 0x80) {
+            out += static_cast<char>(cp);
+          } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+          } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+          } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+          }
+          break;
+        }
+        default: out += c;  // \" \\ \/
+      }
+    }
+    if (pos_ >= s_.size()) fail("unterminated string");
+    ++pos_;
+    return out;
+  }
+};
+
+const Json& require(const Json& obj, const std::string& key, Json::Kind kind) {
+  const Json* v = obj.get(key);
+  if (!v || v->kind != kind) throw std::runtime_error("read_results_json: missing or mistyped \"" + key + "\"");
+  return *v;
+}
+
+double as_number(const Json& v) {
+  return v.kind == Json::Number ? v.num : std::numeric_limits<double>::quiet_NaN();
+}
+
+}  // namespace
+
+const double* ResultRecord::metric(const std::string& name) const {
+  for (const auto& m : metrics)
+    if (m.first == name) return &m.second;
+  return nullptr;
+}
+
+const ResultRecord* ResultSet::find(const std::string& scheme, const std::string& label) const {
+  for (const auto& r : results)
+    if (r.scheme == scheme && r.label == label) return &r;
+  return nullptr;
+}
+
+std::string git_revision() {
+  const char* env = std::getenv("RORAM_GIT_REV");
+  if (env && *env) return env;
+  return RORAM_GIT_REV;
+}
+
+void write_results_json(const std::string& path, const ResultSet& rs) {
+  std::ofstream out(path);
+  if (!out) throw std::runtime_error("write_results_json: cannot open " + path);
+  out << "{\n  \"schema\": " << quote(kSchema) << ",\n  \"command\": " << quote(rs.command)
+      << ",\n  \"git_rev\": " << quote(rs.git_rev) << ",\n  \"backend\": " << quote(rs.backend)
+      << ",\n  \"crypto\": " << quote(rs.crypto) << ",\n  \"config\": {";
+  for (size_t i = 0; i < rs.config.size(); ++i)
+    out << (i ? ", " : "") << quote(rs.config[i].first) << ": " << quote(rs.config[i].second);
+  out << "},\n  \"results\": [";
+  for (size_t i = 0; i < rs.results.size(); ++i) {
+    const ResultRecord& r = rs.results[i];
+    const Params& p = r.params;
+    out << (i ? "," : "") << "\n    {\"scheme\": " << quote(r.scheme) << ", \"case\": " << quote(r.label)
+        << ",\n     \"params\": {\"N\": " << p.N << ", \"L\": " << p.L << ", \"Z\": " << p.Z << ", \"B\": " << p.B
+        << ", \"ell\": " << p.ell << ", \"h\": " << p.h << "},\n     \"metrics\": {";
+    for (size_t k = 0; k < r.metrics.size(); ++k)
+      out << (k ? ", " : "") << quote(r.metrics[k].first) << ": " << number(r.metrics[k].second);
+    out << "},\n     \"samples_ms\": [";
+    for (size_t k = 0; k < r.samples_ms.size(); ++k) out << (k ? "," : "") << number(r.samples_ms[k]);
+    out << "]}";
+  }
+  out << "\n  ]\n}\n";
+  if (!out) throw std::runtime_error("write_results_json: write failed: " + path);
+}
+
+ResultSet read_results_json(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("read_results_json: cannot open " + path);
+  std::stringstream buf;
+  buf << in.rdbuf();
+  const std::string text = buf.str();
+  const Json root = JsonParser(text).parse();
+  if (root.kind != Json::Object) throw std::runtime_error("read_results_json: top level is not an object");
+  if (require(root, "schema", Json::String).str != kSchema)
+    throw std::runtime_error("read_results_json: unsupported schema in " + path);
+
+  ResultSet rs;
+  rs.command = require(root, "command", Json::String).str;
+  rs.git_rev = require(root, "git_rev", Json::String).str;
+  rs.backend = require(root, "backend", Json::String).str;
+  rs.crypto = require(root, "crypto", Json::String).str;
+  for (const auto& kv : require(root, "config", Json::Object).fields)
+    rs.config.emplace_back(kv.first, kv.second.kind == Json::String ? kv.second.str : "");
+  for (const Json& r : require(root, "results", Json::Array).items) {
+    const Json& p = require(r, "params", Json::Object);
+    const Params params(static_cast<uint64_t>(require(p, "N", Json::Number).num),
+                        static_cast<uint64_t>(require(p, "L", Json::Number).num),
+                        static_cast<int>(require(p, "Z", Json::Number).num),
+                        static_cast<size_t>(require(p, "B", Json::Number).num));
+    ResultRecord rec(require(r, "scheme", Json::String).str, require(r, "case", Json::String).str, params);
+    // Metric order is not preserved through the map; rows are matched by name anyway.
+    for (const auto& kv : require(r, "metrics", Json::Object).fields) rec.metrics.emplace_back(kv.first, as_number(kv.second));
+    if (const Json* s = r.get("samples_ms"))
+      for (const Json& v : s->items) rec.samples_ms.push_back(as_number(v));
+    rs.results.push_back(std::move(rec));
+  }
+  return rs;
+}
+
+}  // namespace roram
@@ -0,0 +1,191 @@
+#include "roram/ring_oram.hpp"
+#include "roram/path_oram.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace roram {
+
+// Tree height for ~N/Z leaves (at least one): Z-slot buckets then hold about as many
+// real slots as blocks, as in the paper's parameterisation.
+static int ring_height(const Params& params) {
+  int h = params.h;
+  for (int z = params.Z; z > 1 && h > 0; z >>= 1) --h;
+  return h;
+}
+
+static StorageFactory checked_local_factory(bool use_memory_storage, const std::string& file_path,
+                                            bool count_seeks) {
+  if (!use_memory_storage && file_path.empty())
+    throw std::runtime_error("RingORAM: file_path required for file storage");
+  return local_storage_factory(use_memory_storage, file_path, count_seeks);
+}
+
+RingORAM::RingORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, RingOptions opts,
+                   bool use_memory_storage, const std::string& file_path, bool count_seeks)
+    : RingORAM(params, std::move(crypto), opts, checked_local_factory(use_memory_storage, file_path, count_seeks)) {}
+
+RingORAM::RingORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, RingOptions opts,
+                   const StorageFactory& storage)
+    : params_(params), opts_(opts), crypto_(std::move(crypto)), h_(ring_height(params)),
+      slot_params_(1ULL << h_, 1, 1, params.B),
+      position_map_(params.N, 0) {
+  if (params_.L != 1) throw std::runtime_error("RingORAM: expected L=1");
+  if (params_.N == 0) throw std::runtime_error("RingORAM: N must be > 0");
+  if (opts_.S < 1 || opts_.A < 1) throw std::runtime_error("RingORAM: S and A must be >= 1");
+  for (uint64_t a = 0; a < params_.N; ++a)
+    position_map_.update(a, crypto_->random_path(1ULL << h_));
+  for (int s = 0; s < slots_per_bucket(); ++s)
+    slots_.push_back(storage(slot_params_, "_slot" + std::to_string(s), crypto_.get()));
+  const size_t num_buckets = bucket_id(h_ + 1, 0);  // 2^(h_+1) - 1
+  slot_addr_.assign(num_buckets * static_cast<size_t>(slots_per_bucket()), INVALID_ADDR);
+  slot_valid_.assign(slot_addr_.size(), 1);
+  reads_.assign(num_buckets, 0);
+}
+
+Block RingORAM::read_slot(int level, uint64_t b, int s) {
+  std::vector<Bucket> one;
+  slots_[static_cast<size_t>(s)]->read_buckets(level, b, 1, one);
+  ++total_blocks_;
+  const size_t meta = bucket_id(level, b) * static_cast<size_t>(slots_per_bucket()) + static_cast<size_t>(s);
+  slot_valid_[meta] = 0;
+  ++reads_[bucket_id(level, b)];
+  return one[0].blocks[0];
+}
+
+void RingORAM::read_path(uint64_t leaf, uint64_t block_id) {
+  const int n = slots_per_bucket();
+  for (int level = 0; level <= h_; ++level) {
+    const uint64_t b = leaf % (1ULL << level);
+    const size_t base = bucket_id(level, b) * static_cast<size_t>(n);
+    int slot = -1;
+    for (int s = 0; s < n && slot < 0; ++s)
+      if (slot_valid_[base + s] && slot_addr_[base + s] == block_id) slot = s;
+    if (slot < 0) {
+      // Not here: read a random dummy that has not been read since the last rewrite.
+      std::vector<int> fresh;
+      for (int s = 0; s < n; ++s)
+        if (slot_valid_[base + s] && slot_addr_[base + s] == INVALID_ADDR) fresh.push_back(s);
+      if (fresh.empty()) throw std::runtime_error("RingORAM: bucket out of dummies (reshuffle missed)");
+      slot = fresh[static_cast<size_t>(crypto_->random_path(fresh.size()))];
+    }
+    const bool real = slot_addr_[base + static_cast<size_t>(slot)] != INVALID_ADDR;
+    Block blk = read_slot(level, b, slot);
+    ++online_blocks_;
+    if (real) stash_.push_back(std::move(blk));
+  }
+}
+
+void RingORAM::read_bucket_into_stash(int level, uint64_t b) {
+  // Always Z slot reads: the remaining real blocks, padded with dummies.
+  const int n = slots_per_bucket();
+  const size_t base = bucket_id(level, b) * static_cast<size_t>(n);
+  int budget = params_.Z;
+  for (int s = 0; s < n && budget > 0; ++s) {
+    if (!slot_valid_[base + s] || slot_addr_[base + s] == INVALID_ADDR) continue;
+    stash_.push_back(read_slot(level, b, s));
+    --budget;
+  }
+  for (int s = 0; s < n && budget > 0; ++s) {
+    if (!slot_valid_[base + s]) continue;
+    read_slot(level, b, s);
+    --budget;
+  }
+}
+
+void RingORAM::write_bucket(int level, uint64_t b) {
+  const int n = slots_per_bucket();
+  const uint64_t mask = 1ULL << level;
+  std::vector<Block> chosen;
+  for (auto it = stash_.begin(); it != stash_.end() && chosen.size() < static_cast<size_t>(params_.Z);) {
+    if (it->p[0] % mask == b) {
+      chosen.push_back(std::move(*it));
+      it = stash_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Random slot order: Fisher-Yates over the Z + S slots.
+  std::vector<int> perm(static_cast<size_t>(n));
+  for (int s = 0; s < n; ++s) perm[static_cast<size_t>(s)] = s;
+  for (int s = n - 1; s > 0; --s)
+    std::swap(perm[static_cast<size_t>(s)], perm[static_cast<size_t>(crypto_->random_path(static_cast<uint64_t>(s) + 1))]);
+
+  const size_t base = bucket_id(level, b) * static_cast<size_t>(n);
+  std::vector<Bucket> one(1, Bucket(1, params_.B, 1));
+  for (int k = 0; k < n; ++k) {
+    const int s = perm[static_cast<size_t>(k)];
+    Block& dst = one[0].blocks[0];
+    if (static_cast<size_t>(k) < chosen.size()) {
+      dst = chosen[static_cast<size_t>(k)];
+    } else {
+      dst = Block(params_.B, 1);
+      dst.set_dummy();
+    }
+    slot_addr_[base + static_cast<size_t>(s)] = dst.a;
+    slot_valid_[base + static_cast<size_t>(s)] = 1;
+    slots_[static_cast<size_t>(s)]->write_buckets(level, b, one);
+  }
+  total_blocks_ += static_cast<uint64_t>(n);
+  reads_[bucket_id(level, b)] = 0;
+}
+
+void RingORAM::evict_path() {
+  const uint64_t leaf = evict_next_++ % (1ULL << h_);
+  for (int level = 0; level <= h_; ++level)
+    read_bucket_into_stash(level, leaf % (1ULL << level));
+  for (int level = h_; level >= 0; --level)
+    write_bucket(level, leaf % (1ULL << level));
+  ++evictions_;
+}
+
+void RingORAM::early_reshuffle(uint64_t leaf) {
+  for (int level = 0; level <= h_; ++level) {
+    const uint64_t b = leaf % (1ULL << level);
+    if (reads_[bucket_id(level, b)] < static_cast<uint32_t>(opts_.S)) continue;
+    read_bucket_into_stash(level, b);
+    write_bucket(level, b);
+    ++reshuffles_;
+  }
+}
+
+std::vector<uint8_t> RingORAM::Access(uint64_t block_id, const std::string& op,
+                                      const std::vector<uint8_t>* write_data) {
+  if (block_id >= params_.N) throw std::runtime_error("RingORAM::Access: block_id out of bounds");
+  if (op != "read" && op != "write") throw std::runtime_error("RingORAM::Access: op must be read/write");
+  if (op == "write" && (!write_data || write_data->size() != params_.B))
+    throw std::runtime_error("RingORAM::Access: write_data must have size B");
+
+  const uint64_t leaf = position_map_.query(block_id);
+  const uint64_t new_leaf = crypto_->random_path(1ULL << h_);
+  position_map_.update(block_id, new_leaf);
+  read_path(leaf, block_id);
+
+  auto it = std::find_if(stash_.begin(), stash_.end(), [block_id](const Block& b) { return b.a == block_id; });
+  if (it == stash_.end()) {
+    Block b(params_.B, 1);
+    b.a = block_id;
+    stash_.push_back(b);
+    it = stash_.end() - 1;
+  }
+  it->p[0] = new_leaf;
+  if (op == "write") std::memcpy(it->data.data(), write_data->data(), params_.B);
+  std::vector<uint8_t> result = it->data;
+
+  if (++round_ % static_cast<uint64_t>(opts_.A) == 0) evict_path();
+  early_reshuffle(leaf);
+  return result;
+}
+
+uint64_t RingORAM::get_seek_count() const {
+  uint64_t total = 0;
+  for (const auto& s : slots_) total += s->get_seek_count();
+  return total;
+}
+
+uint64_t RingORAM::client_bytes() const {
+  return position_map_.client_bytes() + stash_.size() * Block::serialized_size(params_) + slot_addr_.size() * 8 +
+         slot_valid_.size() + reads_.size() * 4;
+}
+
+}  // namespace roram
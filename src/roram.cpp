@@ -1,35 +1,389 @@
 #include "roram/roram.hpp"
+#include "roram/basic_sub_oram.hpp"
 #include "roram/storage.hpp"
+#include "roram/path_oram.hpp"
 #include <stdexcept>
 #include <algorithm>
 #include <cstring>
+#include <future>
 #include <unordered_map>
 
 namespace roram {
 
+static StorageFactory checked_local_factory(bool use_memory_storage, const std::string& file_path,
+                                            bool count_seeks) {
+  if (!use_memory_storage && file_path.empty())
+    throw std::runtime_error("rORAM: file_path required for file storage");
+  return local_storage_factory(use_memory_storage, file_path, count_seeks);
+}
+
 rORAM::rORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto,
-             bool use_memory_storage, const std::string& file_path, bool count_seeks)
+             bool use_memory_storage, const std::string& file_path, bool count_seeks,
+             uint64_t pm_cutoff)
+    : rORAM(params, std::move(crypto), checked_local_factory(use_memory_storage, file_path, count_seeks),
+            pm_cutoff) {}
+
+rORAM::rORAM(const Params& params, std::unique_ptr<CryptoProvider> crypto, const StorageFactory& storage,
+             uint64_t pm_cutoff)
     : params_(params), crypto_(std::move(crypto)) {
   int num_orams = params_.ell + 1;
+  pm_dirty_.resize(static_cast<size_t>(num_orams));
   storages_.reserve(static_cast<size_t>(num_orams));
   sub_orams_.reserve(static_cast<size_t>(num_orams));
   for (int i = 0; i < num_orams; ++i) {
-    if (use_memory_storage) {
-      storages_.push_back(std::make_unique<MemoryStorage>(params_, crypto_.get()));
-    } else {
-      if (file_path.empty()) throw std::runtime_error("rORAM: file_path required for file storage");
-      storages_.push_back(std::make_unique<FileStorage>(params_, file_path + "_tree" + std::to_string(i),
-                                                        count_seeks, crypto_.get()));
+    storages_.push_back(storage(params_, "_tree" + std::to_string(i), crypto_.get()));
+    std::unique_ptr<PathORAM> pm_backing;
+    const uint64_t stride = 1ULL << i;
+    if (pm_cutoff > 0 && (params_.N + stride - 1) / stride > pm_cutoff) {
+      Params pm_params(PositionMap::backing_blocks(params_.N, i, params_.B), 1, params_.Z, params_.B);
+      const std::string pm_name = "_pm" + std::to_string(i);
+      StorageFactory pm_storage = [storage, pm_name](const Params& p, const std::string& name, CryptoProvider* c) {
+        return storage(p, pm_name + name, c);
+      };
+      pm_backing = std::make_unique<PathORAM>(pm_params, std::make_unique<CryptoRef>(crypto_.get()), pm_storage);
+      pm_outsourced_ = true;
+    }
+    sub_orams_.push_back(make_sub_oram(params_, i, storages_.back().get(), crypto_.get(), std::move(pm_backing)));
+    storages_.back()->set_stats(&stats_);
+    sub_orams_.back()->set_stats(&stats_);
+  }
+}
+
+void rORAM::check_range(uint64_t a, uint64_t r) const {
+  if (r > params_.L) throw std::runtime_error("rORAM::Access: r > L");
+  if (a + r > params_.N) throw std::runtime_error("rORAM::Access: range out of bounds");
+}
+
+rORAM::~rORAM() {
+  if (evictor_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      stop_ = true;
+    }
+    debt_cv_.notify_all();
+    evictor_.join();
+  }
+  try {
+    std::unique_lock<std::mutex> lk(mu_);
+    commit_locked(lk);
+  } catch (...) {
+    // Nothing to report to from a destructor; the log ends at the previous commit.
+  }
+}
+
+void rORAM::set_durability(Durability mode, const std::string& wal_path, uint64_t group_size) {
+  if (mode != Durability::None && wal_path.empty())
+    throw std::runtime_error("rORAM::set_durability: wal_path required");
+  if (group_size == 0) throw std::runtime_error("rORAM::set_durability: group_size must be >= 1");
+  std::unique_lock<std::mutex> lk(mu_);
+  if (mode != Durability::None) check_durable();
+  commit_locked(lk);
+  if (background_) space_cv_.wait(lk, [this]() { return debt_.empty(); });
+  if (mode == Durability::None) {
+    unbuffer_trees();
+    wal_.reset();
+  } else {
+    // Writes made before the mode was on went straight to the trees: sync them, so the
+    // snapshot describes what is on disk.
+    sync_trees();
+    wal_ = std::make_unique<ClientStateLog>(wal_path, params_, crypto_.get(), snapshot_record());
+    buffer_trees();
+  }
+  for (auto& dirty : pm_dirty_) dirty.clear();
+  durability_ = mode;
+  group_size_ = group_size;
+  uncommitted_ = 0;
+}
+
+uint64_t rORAM::recover(const std::string& wal_path, Durability mode, uint64_t group_size) {
+  if (mode == Durability::None) throw std::runtime_error("rORAM::recover: mode must be access or group");
+  if (group_size == 0) throw std::runtime_error("rORAM::recover: group_size must be >= 1");
+  std::unique_lock<std::mutex> lk(mu_);
+  check_durable();
+  if (cnt_ != 0 || version_ != 0 || durability_ != Durability::None)
+    throw std::runtime_error("rORAM::recover: needs a freshly constructed rORAM");
+  const std::vector<ClientStateRecord> log = ClientStateLog::read(wal_path, params_, crypto_.get());
+  if (log.empty() || !log.front().snapshot) throw std::runtime_error("rORAM::recover: no snapshot in " + wal_path);
+  // Position maps: the snapshot, then every later record's remaps in order.
+  for (const ClientStateRecord& rec : log) {
+    for (size_t j = 0; j < sub_orams_.size(); ++j) {
+      PositionMap& pm = sub_orams_[j]->position_map();
+      const TreeState& t = rec.trees[j];
+      if (rec.snapshot) {
+        pm.load_packed(t.pm_words);
+        continue;
+      }
+      for (const auto& u : t.pm_updates) {
+        if (u.first >= pm.num_entries() || u.second >= params_.N)
+          throw std::runtime_error("rORAM::recover: bad position-map entry in " + wal_path);
+        pm.update(u.first << j, u.second);
+      }
+    }
+  }
+  // Stashes and counters come from the newest record alone. Its bucket writes may have
+  // been cut short by the crash; every older record's were synced before it was logged.
+  const ClientStateRecord& last = log.back();
+  for (size_t j = 0; j < sub_orams_.size(); ++j) {
+    sub_orams_[j]->stash() = last.trees[j].stash;
+    sub_orams_[j]->reset_peaks();
+    write_heap_buckets(*storages_[j], last.trees[j].bucket_ids, last.trees[j].buckets);
+  }
+  cnt_ = last.cnt;
+  version_ = last.version;
+  seq_ = last.seq;
+  sync_trees();
+  wal_ = std::make_unique<ClientStateLog>(wal_path, params_, crypto_.get(), snapshot_record());
+  buffer_trees();
+  durability_ = mode;
+  group_size_ = group_size;
+  uncommitted_ = 0;
+  return seq_;
+}
+
+Durability rORAM::durability() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return durability_;
+}
+
+void rORAM::commit() {
+  std::unique_lock<std::mutex> lk(mu_);
+  commit_locked(lk);
+}
+
+uint64_t rORAM::commits() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return wal_ ? wal_->appended() : 0;
+}
+
+void rORAM::after_accesses(std::unique_lock<std::mutex>& lk, uint64_t accesses) {
+  if (durability_ == Durability::None) return;
+  uncommitted_ += accesses;
+  if (durability_ == Durability::Access || uncommitted_ >= group_size_) commit_locked(lk);
+}
+
+void rORAM::commit_locked(std::unique_lock<std::mutex>& lk) {
+  if (durability_ == Durability::None) return;
+  // Buckets still buffered after a commit whose tree writes failed are retried.
+  bool pending = uncommitted_ > 0;
+  for (const BufferedStorage* b : buffers_) pending = pending || !b->empty();
+  if (!pending) return;
+  if (background_) space_cv_.wait(lk, [this]() { return debt_.empty(); });
+  ClientStateRecord rec;
+  rec.seq = seq_ + 1;
+  rec.cnt = cnt_;
+  rec.version = version_;
+  rec.accesses = uncommitted_;
+  rec.trees.resize(sub_orams_.size());
+  for (size_t j = 0; j < sub_orams_.size(); ++j) {
+    TreeState& t = rec.trees[j];
+    std::vector<uint64_t>& dirty = pm_dirty_[j];
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    const PositionMap& pm = sub_orams_[j]->position_map();
+    t.pm_updates.reserve(dirty.size());
+    for (uint64_t idx : dirty) t.pm_updates.emplace_back(idx, pm.query(idx << j));
+    t.stash = sub_orams_[j]->stash();
+    buffers_[j]->pending(t.bucket_ids, t.buckets);
+  }
+  {
+    // If the append fails nothing has changed: the buckets are still buffered and the
+    // remapped entries still dirty, so the next commit logs them again.
+    ScopedPhase t(&stats_, Phase::Sync);
+    wal_->append(rec);  // the commit point
+  }
+  seq_ = rec.seq;
+  uncommitted_ = 0;
+  for (auto& dirty : pm_dirty_) dirty.clear();
+  for (size_t j = 0; j < sub_orams_.size(); ++j)
+    write_heap_buckets(buffers_[j]->inner(), rec.trees[j].bucket_ids, rec.trees[j].buckets);
+  sync_trees();
+  for (BufferedStorage* b : buffers_) b->clear_pending();
+  // Recovery only needs the newest snapshot and the records after it, so once those
+  // outgrow the snapshot a few times over, restart the log from a fresh one.
+  if (wal_->bytes() > 4 * wal_->base_bytes() + (1ULL << 20)) wal_->reset(snapshot_record());
+}
+
+void rORAM::check_durable() const {
+  if (pm_outsourced_)
+    throw std::runtime_error("rORAM: durability needs client-side position maps (pm_cutoff 0)");
+  for (const auto& sub : sub_orams_)
+    if (sub->specialized()) throw std::runtime_error("rORAM: durability needs file or remote trees");
+}
+
+void rORAM::buffer_trees() {
+  if (!buffers_.empty()) return;
+  for (size_t j = 0; j < storages_.size(); ++j) {
+    auto buffered = std::make_unique<BufferedStorage>(std::move(storages_[j]), params_);
+    buffers_.push_back(buffered.get());
+    sub_orams_[j]->set_storage(buffered.get());
+    storages_[j] = std::move(buffered);
+  }
+}
+
+void rORAM::unbuffer_trees() {
+  for (size_t j = 0; j < buffers_.size(); ++j) {
+    storages_[j] = buffers_[j]->release();
+    sub_orams_[j]->set_storage(storages_[j].get());
+  }
+  buffers_.clear();
+}
+
+void rORAM::sync_trees() {
+  // Each tree's fdatasync waits on its own device flush; issuing them together lets the
+  // file system and device merge the flushes, as parallel eviction does for the writes.
+  if (parallel_evict_ && params_.ell > 0) {
+    std::vector<std::future<void>> pending;
+    pending.reserve(static_cast<size_t>(params_.ell));
+    for (size_t j = 1; j < storages_.size(); ++j) {
+      StorageBackend* s = storages_[j].get();
+      pending.push_back(std::async(std::launch::async, [s]() { s->sync(); }));
     }
-    sub_orams_.push_back(std::make_unique<SubORAM>(params_, i, storages_.back().get(), crypto_.get()));
+    storages_[0]->sync();
+    for (auto& f : pending) f.get();
+  } else {
+    for (auto& s : storages_) s->sync();
+  }
+}
+
+ClientStateRecord rORAM::snapshot_record() const {
+  ClientStateRecord rec;
+  rec.seq = seq_;
+  rec.cnt = cnt_;
+  rec.version = version_;
+  rec.snapshot = true;
+  rec.trees.resize(sub_orams_.size());
+  for (size_t j = 0; j < sub_orams_.size(); ++j) {
+    rec.trees[j].pm_words = sub_orams_[j]->position_map().packed();
+    rec.trees[j].stash = sub_orams_[j]->stash();
+  }
+  return rec;
+}
+
+void rORAM::enable_background_eviction(size_t stash_limit) {
+  std::lock_guard<std::mutex> lk(mu_);
+  stash_limit_ = stash_limit;
+  if (background_) return;
+  background_ = true;
+  evictor_ = std::thread([this]() { run_evictor(); });
+}
+
+void rORAM::drain_evictions() {
+  std::unique_lock<std::mutex> lk(mu_);
+  space_cv_.wait(lk, [this]() { return debt_.empty(); });
+}
+
+size_t rORAM::max_stash_size() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return max_stash_size_locked();
+}
+
+int rORAM::specialized_trees() const {
+  int n = 0;
+  for (const auto& sub : sub_orams_) n += sub->specialized();
+  return n;
+}
+
+size_t rORAM::max_stash_size_locked() const {
+  size_t m = 0;
+  for (const auto& sub : sub_orams_) m = std::max(m, sub->stash().size());
+  return m;
+}
+
+void rORAM::wait_for_stash_space(std::unique_lock<std::mutex>& lk) {
+  if (!background_) return;
+  space_cv_.wait(lk, [this]() { return debt_.empty() || max_stash_size_locked() <= stash_limit_; });
+}
+
+void rORAM::run_evictor() {
+  std::unique_lock<std::mutex> lk(mu_);
+  for (;;) {
+    debt_cv_.wait(lk, [this]() { return stop_ || !debt_.empty(); });
+    if (debt_.empty()) return;  // stop_ with nothing owed
+    const uint64_t k = debt_.front().first;
+    const uint64_t cnt = debt_.front().second;
+    // A tree's BatchEvict runs under the lock from its read to its last write-back (its
+    // stash is inconsistent in between); the lock is released between trees so a waiting
+    // read phase can run there. Each tree still sees its evictions in cnt order.
+    for (int j = 0; j <= params_.ell; ++j) {
+      sub_orams_[static_cast<size_t>(j)]->BatchEvict(k, cnt);
+      lk.unlock();
+      std::this_thread::yield();
+      lk.lock();
+    }
+    debt_.pop_front();
+    space_cv_.notify_all();
   }
 }
 
 std::vector<std::vector<uint8_t>> rORAM::Access(uint64_t a, uint64_t r, const std::string& op,
                                                 const std::vector<std::vector<uint8_t>>* D) {
   if (r == 0) return {};
-  if (r > params_.L) throw std::runtime_error("rORAM::Access: r > L");
-  if (a + r > params_.N) throw std::runtime_error("rORAM::Access: range out of bounds");
+  check_range(a, r);
+  std::unique_lock<std::mutex> lk(mu_);
+  wait_for_stash_space(lk);
+  std::vector<std::vector<uint8_t>> result;
+  uint64_t k = read_and_stage(a, r, op, D, result);
+  evict_all(k);
+  after_accesses(lk, 1);
+  return result;
+}
+
+std::vector<std::vector<std::vector<uint8_t>>> rORAM::access_batch(const std::vector<RangeRequest>& reqs) {
+  for (const RangeRequest& q : reqs) {
+    if (q.r == 0) continue;
+    check_range(q.a, q.r);
+  }
+  std::unique_lock<std::mutex> lk(mu_);
+  wait_for_stash_space(lk);
+  std::vector<std::vector<std::vector<uint8_t>>> results(reqs.size());
+  uint64_t k = 0;
+  uint64_t served = 0;
+  for (size_t n = 0; n < reqs.size(); ++n) {
+    const RangeRequest& q = reqs[n];
+    if (q.r == 0) continue;
+    k += read_and_stage(q.a, q.r, q.op, q.op == "write" ? &q.data : nullptr, results[n]);
+    ++served;
+  }
+  if (k > 0) evict_all(k);
+  after_accesses(lk, served);
+  return results;
+}
+
+uint64_t rORAM::scan(uint64_t a, uint64_t r, const ScanCallback& deliver) {
+  if (a > params_.N || r > params_.N - a) throw std::runtime_error("rORAM::scan: range out of bounds");
+  const uint64_t end = a + r;
+  const uint64_t window = 1ULL << params_.ell;
+  // Access(pos, len) reads the two ranges starting at floor(pos / 2^ℓ) * 2^ℓ, so a chunk
+  // may run to the end of the second one at no extra cost.
+  auto chunk_len = [end, window](uint64_t pos) { return std::min(end, (pos / window) * window + 2 * window) - pos; };
+  auto fetch = [this](uint64_t pos, uint64_t len) {
+    std::unique_lock<std::mutex> lk(mu_);
+    wait_for_stash_space(lk);
+    std::vector<std::vector<uint8_t>> out;
+    uint64_t k = read_and_stage(pos, len, "read", nullptr, out);
+    evict_all(k);
+    after_accesses(lk, 1);
+    return out;
+  };
+
+  uint64_t accesses = 0;
+  uint64_t pos = a;
+  std::future<std::vector<std::vector<uint8_t>>> next;
+  if (pos < end) next = std::async(std::launch::async, fetch, pos, chunk_len(pos));
+  while (pos < end) {
+    std::vector<std::vector<uint8_t>> cur = next.get();
+    ++accesses;
+    const uint64_t next_pos = pos + cur.size();
+    if (next_pos < end) next = std::async(std::launch::async, fetch, next_pos, chunk_len(next_pos));
+    for (size_t k = 0; k < cur.size(); ++k) deliver(pos + k, cur[k]);
+    pos = next_pos;
+  }
+  return accesses;
+}
+
+uint64_t rORAM::read_and_stage(uint64_t a, uint64_t r, const std::string& op,
+                               const std::vector<std::vector<uint8_t>>* D,
+                               std::vector<std::vector<uint8_t>>& out) {
   int i = Params::range_exponent(r);
   if (i > params_.ell) i = params_.ell;
   uint64_t range_size = 1ULL << i;  // 2^i
@@ -40,11 +394,19 @@ std::vector<std::vector<uint8_t>> rORAM::Access(uint64_t a, uint64_t r, const st
   SubORAM& Ri = *sub_orams_[static_cast<size_t>(i)];
   std::vector<Block> blocks_a0, blocks_a1;
   uint64_t p0_prime = 0, p1_prime = 0;
-  Ri.ReadRange(a0, blocks_a0, p0_prime);
-  if (a1 != a0)
-    Ri.ReadRange(a1, blocks_a1, p1_prime);
-  else
+  if (a1 != a0) {
+    Ri.ReadRangePair(a0, a1, blocks_a0, p0_prime, blocks_a1, p1_prime);
+  } else {
+    Ri.ReadRange(a0, blocks_a0, p0_prime);
     p1_prime = p0_prime;
+  }
+  if (durability_ != Durability::None) {
+    // Both ranges moved to fresh paths in R_i: their map entries go in the next commit. A
+    // second range starting at N has no entry.
+    std::vector<uint64_t>& dirty = pm_dirty_[static_cast<size_t>(i)];
+    dirty.push_back(a0 >> i);
+    if (a1 != a0 && a1 < params_.N) dirty.push_back(a1 >> i);
+  }
 
   std::vector<Block> all_blocks;
   all_blocks.reserve(blocks_a0.size() + blocks_a1.size());
@@ -65,29 +427,44 @@ std::vector<std::vector<uint8_t>> rORAM::Access(uint64_t a, uint64_t r, const st
   by_addr.reserve(all_blocks.size() + 8);
   for (size_t idx = 0; idx < all_blocks.size(); ++idx) by_addr.emplace(all_blocks[idx].a, idx);
 
-  std::vector<std::unordered_map<uint64_t, uint64_t>> pm_cache(static_cast<size_t>(params_.ell + 1));
-  for (Block& b : all_blocks) {
-    // Keep path tags consistent across all sub-ORAMs, not only the active one.
-    // This prevents stale copies from later being treated as current during merges.
-    for (int j = 0; j <= params_.ell; ++j) {
-      const uint64_t len_j = 1ULL << j;
-      const uint64_t start_j = (b.a / len_j) * len_j;
-      auto& cache_j = pm_cache[static_cast<size_t>(j)];
-      uint64_t base_j = 0;
-      auto itc = cache_j.find(start_j);
-      if (itc != cache_j.end()) {
-        base_j = itc->second;
-      } else {
-        base_j = sub_orams_[static_cast<size_t>(j)]->position_map().query(start_j);
-        cache_j.emplace(start_j, base_j);
+  {
+    ScopedPhase t(&stats_, Phase::PathTags);
+    std::vector<std::unordered_map<uint64_t, uint64_t>> pm_cache(static_cast<size_t>(params_.ell + 1));
+    const uint64_t ver = ++version_;
+    for (Block& b : all_blocks) {
+      b.ver = ver;
+      // Keep path tags consistent across all sub-ORAMs, not only the active one.
+      // This prevents stale copies from later being treated as current during merges.
+      for (int j = 0; j <= params_.ell; ++j) {
+        const uint64_t len_j = 1ULL << j;
+        const uint64_t start_j = (b.a / len_j) * len_j;
+        auto& cache_j = pm_cache[static_cast<size_t>(j)];
+        uint64_t base_j = 0;
+        auto itc = cache_j.find(start_j);
+        if (itc != cache_j.end()) {
+          base_j = itc->second;
+        } else {
+          base_j = sub_orams_[static_cast<size_t>(j)]->position_map().query(start_j);
+          cache_j.emplace(start_j, base_j);
+        }
+        b.p[static_cast<size_t>(j)] = base_j + (b.a - start_j);
       }
-      b.p[static_cast<size_t>(j)] = base_j + (b.a - start_j);
+      // Active level gets freshly sampled path starts from this access.
+      if (b.a >= a0 && b.a < a0 + range_size)
+        b.p[static_cast<size_t>(i)] = p0_prime + (b.a - a0);
+      else if (b.a >= a1 && b.a < a1 + range_size)
+        b.p[static_cast<size_t>(i)] = p1_prime + (b.a - a1);
+    }
+    // An outsourced map is padded to the lookups the ranges could need (2^(i-j) entries of
+    // R_j per range for j <= i, one above), so their number does not depend on where the
+    // ranges fall.
+    const uint64_t ranges = a1 != a0 ? 2 : 1;
+    for (int j = 0; j <= params_.ell; ++j) {
+      const PositionMap& pm = sub_orams_[static_cast<size_t>(j)]->position_map();
+      if (!pm.outsourced()) continue;
+      const uint64_t need = j <= i ? ranges << (i - j) : ranges;
+      for (uint64_t n = pm_cache[static_cast<size_t>(j)].size(); n < need; ++n) pm.dummy_access();
     }
-    // Active level gets freshly sampled path starts from this access.
-    if (b.a >= a0 && b.a < a0 + range_size)
-      b.p[static_cast<size_t>(i)] = p0_prime + (b.a - a0);
-    else if (b.a >= a1 && b.a < a1 + range_size)
-      b.p[static_cast<size_t>(i)] = p1_prime + (b.a - a1);
   }
 
   if (op == "write" && D) {
@@ -101,38 +478,148 @@ std::vector<std::vector<uint8_t>> rORAM::Access(uint64_t a, uint64_t r, const st
     }
   }
 
-  for (int j = 0; j <= params_.ell; ++j) {
-    SubORAM& Rj = *sub_orams_[static_cast<size_t>(j)];
-    auto& stash = Rj.stash();
-    stash.erase(std::remove_if(stash.begin(), stash.end(),
-      [a0, range_size](const Block& b) {
-        return b.a >= a0 && b.a < a0 + 2 * range_size;
-      }), stash.end());
-    for (Block& b : all_blocks)
-      stash.push_back(b);
-    Rj.BatchEvict(2 * range_size, cnt_);
+  {
+    ScopedPhase t(&stats_, Phase::StashMerge);
+    for (int j = 0; j <= params_.ell; ++j) {
+      auto& stash = sub_orams_[static_cast<size_t>(j)]->stash();
+      stash.erase(std::remove_if(stash.begin(), stash.end(),
+        [a0, range_size](const Block& b) {
+          return b.a >= a0 && b.a < a0 + 2 * range_size;
+        }), stash.end());
+      for (Block& b : all_blocks)
+        stash.push_back(b);
+    }
   }
-  cnt_ += 2 * range_size;
 
+  out.clear();
   if (op == "read") {
-    std::vector<std::vector<uint8_t>> result;
-    result.reserve(r);
+    out.reserve(r);
     for (uint64_t addr = a; addr < a + r; ++addr) {
       auto it = by_addr.find(addr);
       if (it != by_addr.end())
-        result.push_back(all_blocks[it->second].data);
+        out.push_back(all_blocks[it->second].data);
       else
-        result.push_back(std::vector<uint8_t>(params_.B, 0));
+        out.push_back(std::vector<uint8_t>(params_.B, 0));
+    }
+  }
+  return 2 * range_size;
+}
+
+void rORAM::evict_all(uint64_t k) {
+  for (auto& sub : sub_orams_) sub->note_stash_peak();  // everything just staged
+  if (background_) {
+    debt_.emplace_back(k, cnt_);
+    cnt_ += k;
+    debt_cv_.notify_one();
+    return;
+  }
+  if (evicts_in_parallel()) {
+    // Trees are independent (own stash, map and storage), so their evictions overlap.
+    std::vector<std::future<void>> pending;
+    pending.reserve(static_cast<size_t>(params_.ell));
+    for (int j = 1; j <= params_.ell; ++j) {
+      SubORAM* Rj = sub_orams_[static_cast<size_t>(j)].get();
+      const uint64_t cnt = cnt_;
+      pending.push_back(std::async(std::launch::async, [Rj, k, cnt]() { Rj->BatchEvict(k, cnt); }));
     }
-    return result;
+    sub_orams_[0]->BatchEvict(k, cnt_);
+    for (auto& f : pending) f.get();
+  } else {
+    for (int j = 0; j <= params_.ell; ++j)
+      sub_orams_[static_cast<size_t>(j)]->BatchEvict(k, cnt_);
   }
-  return {};
+  cnt_ += k;
 }
 
 uint64_t rORAM::get_seek_count() const {
+  std::lock_guard<std::mutex> lk(mu_);
   uint64_t total = 0;
   for (const auto& s : storages_)
     total += s->get_seek_count();
+  for (const auto& sub : sub_orams_)
+    total += sub->position_map().backing_seek_count();
+  return total;
+}
+
+StatsSnapshot rORAM::stats() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  StatsSnapshot total = stats_.snapshot();
+  for (const auto& sub : sub_orams_)
+    if (const PathORAM* pm = sub->position_map().backing()) total += pm->stats();
+  return total;
+}
+
+void rORAM::reset_stats() {
+  std::lock_guard<std::mutex> lk(mu_);
+  stats_.reset();
+  for (auto& sub : sub_orams_)
+    if (PathORAM* pm = sub->position_map().backing()) pm->reset_stats();
+}
+
+IoStats rORAM::io_stats() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  IoStats total;
+  for (const auto& s : storages_) total += s->io_stats();
+  return total;
+}
+
+void rORAM::reset_io_stats() {
+  std::lock_guard<std::mutex> lk(mu_);
+  for (auto& s : storages_) s->reset_io_stats();
+}
+
+MemoryUsage rORAM::memory_usage_locked(bool peak) const {
+  MemoryUsage total;
+  uint64_t evict_sum = 0;
+  for (size_t i = 0; i < sub_orams_.size(); ++i) {
+    const SubORAM& sub = *sub_orams_[i];
+    MemoryUsage tree;
+    const PathORAM* pm = sub.position_map().backing();
+    tree.position_map = pm ? (peak ? pm->peak_memory_usage() : pm->memory_usage()).total()
+                           : sub.position_map().client_bytes();
+    tree.add_stash(peak ? sub.peak_stash_size() : sub.stash().size(), params_);
+    tree.scratch = storages_[i]->scratch_bytes();
+    if (peak) tree.evict_buffers = sub.peak_evict_buckets() * MemoryUsage::bucket_bytes(params_);
+    evict_sum += tree.evict_buffers;
+    total += tree;
+    total.trees.push_back(tree);
+  }
+  // Concurrent BatchEvicts hold every tree's buffers at once.
+  if (evicts_in_parallel()) total.evict_buffers = evict_sum;
+  return total;
+}
+
+MemoryUsage rORAM::memory_usage() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return memory_usage_locked(false);
+}
+
+MemoryUsage rORAM::peak_memory_usage() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return memory_usage_locked(true);
+}
+
+void rORAM::reset_peak_memory() {
+  std::lock_guard<std::mutex> lk(mu_);
+  for (auto& sub : sub_orams_) {
+    sub->reset_peaks();
+    if (PathORAM* pm = sub->position_map().backing()) pm->reset_peak_memory();
+  }
+}
+
+uint64_t rORAM::position_map_client_bytes() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  uint64_t total = 0;
+  for (const auto& sub : sub_orams_)
+    total += sub->position_map().client_bytes();
+  return total;
+}
+
+uint64_t rORAM::position_map_accesses() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  uint64_t total = 0;
+  for (const auto& sub : sub_orams_)
+    total += sub->position_map().backing_accesses();
   return total;
 }
 
@@ -0,0 +1,89 @@
+#include "roram/sharded_roram.hpp"
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+
+namespace roram {
+
+ShardedRORAM::ShardedRORAM(const Params& params, int shards, const CryptoFactory& crypto_factory,
+                           bool use_memory_storage, const std::string& file_path, bool count_seeks,
+                           FrontendOptions opts)
+    : params_(params), shard_len_(0) {
+  if (shards <= 0) throw std::runtime_error("ShardedRORAM: shards must be > 0");
+  if (params_.N == 0 || params_.L == 0) throw std::runtime_error("ShardedRORAM: N and L must be > 0");
+  // Round the even split up to a multiple of L so an L-range straddles at most one boundary.
+  uint64_t per = (params_.N + static_cast<uint64_t>(shards) - 1) / static_cast<uint64_t>(shards);
+  shard_len_ = ((per + params_.L - 1) / params_.L) * params_.L;
+  const uint64_t count = (params_.N + shard_len_ - 1) / shard_len_;
+  shards_.reserve(static_cast<size_t>(count));
+  for (uint64_t s = 0; s < count; ++s) {
+    const uint64_t len = std::min(shard_len_, params_.N - s * shard_len_);
+    Params p(len, std::min(params_.L, len), params_.Z, params_.B);
+    auto ram = std::make_unique<rORAM>(p, crypto_factory(static_cast<int>(s)), use_memory_storage,
+                                       file_path.empty() ? "" : file_path + "_shard" + std::to_string(s),
+                                       count_seeks);
+    shards_.push_back(std::make_unique<ORAMFrontend>(std::move(ram), opts));
+  }
+}
+
+std::future<ShardedRORAM::Result> ShardedRORAM::submit(uint64_t client, RangeRequest req) {
+  if (req.r > params_.L) throw std::runtime_error("ShardedRORAM::submit: r > L");
+  if (req.a > params_.N || req.r > params_.N - req.a)
+    throw std::runtime_error("ShardedRORAM::submit: range out of bounds");
+  if (req.op == "write" && req.data.size() != req.r)
+    throw std::runtime_error("ShardedRORAM::submit: write data must hold r blocks");
+  if (req.r == 0) {
+    // Nothing to access (a may be N, past the last shard).
+    std::promise<Result> none;
+    none.set_value(Result());
+    return none.get_future();
+  }
+  const int s0 = shard_of(req.a);
+  const int s1 = shard_of(req.a + req.r - 1);
+  const uint64_t base0 = static_cast<uint64_t>(s0) * shard_len_;
+  if (s0 == s1) {
+    req.a -= base0;
+    return shards_[static_cast<size_t>(s0)]->submit(client, std::move(req));
+  }
+
+  // Split at the shard boundary; the tail piece starts at offset 0 of the next shard.
+  const uint64_t boundary = static_cast<uint64_t>(s1) * shard_len_;
+  const uint64_t head_len = boundary - req.a;
+  RangeRequest head{req.a - base0, head_len, req.op, {}};
+  RangeRequest tail{0, req.r - head_len, req.op, {}};
+  if (req.op == "write") {
+    head.data.assign(std::make_move_iterator(req.data.begin()),
+                     std::make_move_iterator(req.data.begin() + static_cast<ptrdiff_t>(head_len)));
+    tail.data.assign(std::make_move_iterator(req.data.begin() + static_cast<ptrdiff_t>(head_len)),
+                     std::make_move_iterator(req.data.end()));
+  }
+  auto f0 = shards_[static_cast<size_t>(s0)]->submit(client, std::move(head));
+  auto f1 = shards_[static_cast<size_t>(s1)]->submit(client, std::move(tail));
+  // Deferred: the caller's get() waits for both pieces and concatenates them.
+  return std::async(std::launch::deferred, [](std::future<Result> a, std::future<Result> b) {
+    Result out = a.get();
+    Result rest = b.get();
+    out.insert(out.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+    return out;
+  }, std::move(f0), std::move(f1));
+}
+
+ShardedRORAM::Result ShardedRORAM::Access(uint64_t a, uint64_t r, const std::string& op,
+                                          const std::vector<std::vector<uint8_t>>* D) {
+  RangeRequest req{a, r, op, {}};
+  if (op == "write" && D) req.data = *D;
+  return submit(0, std::move(req)).get();
+}
+
+void ShardedRORAM::drain() {
+  for (auto& s : shards_) s->drain();
+}
+
+uint64_t ShardedRORAM::get_seek_count() {
+  uint64_t total = 0;
+  for (auto& s : shards_) total += s->oram().get_seek_count();
+  return total;
+}
+
+}  // namespace roram
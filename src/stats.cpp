@@ -0,0 +1,65 @@
+#include "roram/stats.hpp"
+
+namespace roram {
+
+const char* phase_name(Phase p) {
+  switch (p) {
+    case Phase::ReadRange: return "read_range";
+    case Phase::StashMerge: return "stash_merge";
+    case Phase::PathTags: return "path_tags";
+    case Phase::EvictRead: return "evict_read";
+    case Phase::EvictAssign: return "evict_assign";
+    case Phase::EvictWrite: return "evict_write";
+    case Phase::Serialize: return "serialize";
+    case Phase::Encrypt: return "encrypt";
+    case Phase::Decrypt: return "decrypt";
+    case Phase::RawIO: return "raw_io";
+    case Phase::Sync: return "sync";
+    case Phase::Count: break;
+  }
+  return "unknown";
+}
+
+StatsSnapshot& StatsSnapshot::operator+=(const StatsSnapshot& other) {
+  for (size_t k = 0; k < phases.size(); ++k) {
+    phases[k].count += other.phases[k].count;
+    phases[k].ns += other.phases[k].ns;
+  }
+  if (read_range_levels.size() < other.read_range_levels.size())
+    read_range_levels.resize(other.read_range_levels.size());
+  for (size_t j = 0; j < other.read_range_levels.size(); ++j) {
+    read_range_levels[j].count += other.read_range_levels[j].count;
+    read_range_levels[j].ns += other.read_range_levels[j].ns;
+  }
+  return *this;
+}
+
+#ifndef RORAM_NO_STATS
+
+StatsSnapshot Stats::snapshot() const {
+  StatsSnapshot s;
+  for (size_t k = 0; k < s.phases.size(); ++k) {
+    s.phases[k].count = count_[k].load(std::memory_order_relaxed);
+    s.phases[k].ns = ns_[k].load(std::memory_order_relaxed);
+  }
+  size_t levels = 0;
+  for (size_t j = 0; j < level_count_.size(); ++j)
+    if (level_count_[j].load(std::memory_order_relaxed) > 0) levels = j + 1;
+  s.read_range_levels.resize(levels);
+  for (size_t j = 0; j < levels; ++j) {
+    s.read_range_levels[j].count = level_count_[j].load(std::memory_order_relaxed);
+    s.read_range_levels[j].ns = level_ns_[j].load(std::memory_order_relaxed);
+  }
+  return s;
+}
+
+void Stats::reset() {
+  for (auto& c : count_) c.store(0, std::memory_order_relaxed);
+  for (auto& c : ns_) c.store(0, std::memory_order_relaxed);
+  for (auto& c : level_count_) c.store(0, std::memory_order_relaxed);
+  for (auto& c : level_ns_) c.store(0, std::memory_order_relaxed);
+}
+
+#endif  // RORAM_NO_STATS
+
+}  // namespace roram
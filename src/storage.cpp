@@ -0,0 +1,92 @@
+#include "roram/storage.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace roram {
+
+LevelIoStats& LevelIoStats::operator+=(const LevelIoStats& other) {
+  read_requests += other.read_requests;
+  write_requests += other.write_requests;
+  buckets_read += other.buckets_read;
+  buckets_written += other.buckets_written;
+  bytes_read += other.bytes_read;
+  bytes_written += other.bytes_written;
+  seeks += other.seeks;
+  seek_distance += other.seek_distance;
+  max_run_buckets = std::max(max_run_buckets, other.max_run_buckets);
+  return *this;
+}
+
+LevelIoStats IoStats::total() const {
+  LevelIoStats t;
+  for (const LevelIoStats& l : levels) t += l;
+  return t;
+}
+
+IoStats& IoStats::operator+=(const IoStats& other) {
+  if (levels.size() < other.levels.size()) levels.resize(other.levels.size());
+  for (size_t j = 0; j < other.levels.size(); ++j) levels[j] += other.levels[j];
+  return *this;
+}
+
+void StorageBackend::reset_io_stats() {
+  io_ = IoStats();
+  last_end_ = UINT64_MAX;
+  run_buckets_ = 0;
+}
+
+bool StorageBackend::account_io(int level, bool write, uint64_t off, uint64_t count) {
+  if (level < 0) return false;
+  if (io_.levels.size() <= static_cast<size_t>(level)) io_.levels.resize(static_cast<size_t>(level) + 1);
+  LevelIoStats& l = io_.levels[static_cast<size_t>(level)];
+  const uint64_t bytes = count * bucket_byte_size();
+  if (write) {
+    ++l.write_requests;
+    l.buckets_written += count;
+    l.bytes_written += bytes;
+  } else {
+    ++l.read_requests;
+    l.buckets_read += count;
+    l.bytes_read += bytes;
+  }
+  const bool seek = last_end_ != UINT64_MAX && off != last_end_;
+  if (seek) {
+    ++l.seeks;
+    l.seek_distance += off > last_end_ ? off - last_end_ : last_end_ - off;
+  }
+  run_buckets_ = seek ? count : run_buckets_ + count;
+  l.max_run_buckets = std::max(l.max_run_buckets, run_buckets_);
+  last_end_ = off + bytes;
+  return seek;
+}
+
+void StorageBackend::read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) {
+  out.clear();
+  for (const BucketExtent& e : extents) {
+    std::vector<Bucket> part;  // fresh each time: read_buckets deserializes into existing entries
+    read_buckets(e.level, e.start, e.count, part);
+    out.insert(out.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+  }
+}
+
+void StorageBackend::write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) {
+  size_t pos = 0;
+  std::vector<Bucket> part;
+  for (const BucketExtent& e : extents) {
+    part.assign(buckets.begin() + static_cast<ptrdiff_t>(pos),
+                buckets.begin() + static_cast<ptrdiff_t>(pos + e.count));
+    write_buckets(e.level, e.start, part);
+    pos += e.count;
+  }
+}
+
+StorageFactory local_storage_factory(bool use_memory_storage, const std::string& path_prefix,
+                                     bool count_seeks, HugePages huge_pages) {
+  return [use_memory_storage, path_prefix, count_seeks, huge_pages](
+             const Params& params, const std::string& name, CryptoProvider* crypto) -> std::unique_ptr<StorageBackend> {
+    if (use_memory_storage) return std::make_unique<MemoryStorage>(params, crypto, huge_pages);
+    return std::make_unique<FileStorage>(params, path_prefix + name, count_seeks, crypto);
+  };
+}
+
+}  // namespace roram
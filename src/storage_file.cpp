@@ -19,13 +19,21 @@ void FileStorage::ensure_open() {
   fd_ = open(path_.c_str(), O_RDWR | O_CREAT, 0666);
   if (fd_ < 0)
     throw std::runtime_error("FileStorage: open failed: " + path_);
-  last_offset_ = UINT64_MAX;
 }
 
 FileStorage::FileStorage(const Params& params, const std::string& path, bool count_seeks,
                          CryptoProvider* crypto)
-    : params_(params), tag_size_(crypto ? crypto->tag_size() : 0), crypto_(crypto), path_(path),
-      count_seeks_(count_seeks), seek_count_(0), fd_(-1), last_offset_(UINT64_MAX) {
+    : FileStorage(params, path, count_seeks, crypto, crypto ? crypto->tag_size() : 0) {}
+
+std::unique_ptr<FileStorage> FileStorage::opaque(const Params& params, const std::string& path,
+                                                 bool count_seeks, size_t tag_size) {
+  return std::unique_ptr<FileStorage>(new FileStorage(params, path, count_seeks, nullptr, tag_size));
+}
+
+FileStorage::FileStorage(const Params& params, const std::string& path, bool count_seeks,
+                         CryptoProvider* crypto, size_t tag_size)
+    : params_(params), tag_size_(tag_size), crypto_(crypto), path_(path),
+      count_seeks_(count_seeks), seek_count_(0), fd_(-1) {
   Bucket b(params.Z, params.B, params.ell + 1);
   bucket_plain_size_ = b.serialized_size(params_);
   bucket_storage_size_ = bucket_plain_size_ + tag_size_;
@@ -43,45 +51,75 @@ FileStorage::~FileStorage() {
   if (fd_ >= 0) { close(fd_); fd_ = -1; }
 }
 
-void FileStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count,
-                              std::vector<Bucket>& out) {
+void FileStorage::read_raw(int level, uint64_t start_bucket, uint64_t count, uint8_t* out) {
   ensure_open();
   uint64_t off = level_offset(level) + start_bucket * bucket_storage_size_;
-  if (count_seeks_ && off != last_offset_ && last_offset_ != UINT64_MAX)
-    ++seek_count_;
-  last_offset_ = off + count * bucket_storage_size_;
+  if (account_io(level, false, off, count) && count_seeks_) ++seek_count_;
+  const size_t len = count * bucket_storage_size_;
+  ssize_t n = pread(fd_, out, len, static_cast<off_t>(off));
+  if (n != static_cast<ssize_t>(len))
+    throw std::runtime_error("FileStorage: pread failed");
+}
+
+void FileStorage::write_raw(int level, uint64_t start_bucket, uint64_t count, const uint8_t* in) {
+  ensure_open();
+  uint64_t off = level_offset(level) + start_bucket * bucket_storage_size_;
+  if (account_io(level, true, off, count) && count_seeks_) ++seek_count_;
+  const size_t len = count * bucket_storage_size_;
+  ssize_t n = pwrite(fd_, in, len, static_cast<off_t>(off));
+  if (n != static_cast<ssize_t>(len))
+    throw std::runtime_error("FileStorage: pwrite failed");
+}
 
+void FileStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count,
+                              std::vector<Bucket>& out) {
   out.resize(count, Bucket(params_.Z, params_.B, params_.ell + 1));
   std::vector<uint8_t> buf(count * bucket_storage_size_);
-  ssize_t n = pread(fd_, buf.data(), buf.size(), static_cast<off_t>(off));
-  if (n != static_cast<ssize_t>(buf.size()))
-    throw std::runtime_error("FileStorage: pread failed");
-  for (uint64_t i = 0; i < count; ++i) {
-    uint8_t* bucket_ptr = buf.data() + i * bucket_storage_size_;
-    uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + i;
-    if (crypto_) crypto_->decrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
-    out[i].deserialize(bucket_ptr, params_);
+  {
+    ScopedPhase t(stats_, Phase::RawIO);
+    read_raw(level, start_bucket, count, buf.data());
   }
+  if (crypto_) {
+    ScopedPhase t(stats_, Phase::Decrypt);
+    t.set_count(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      uint8_t* bucket_ptr = buf.data() + i * bucket_storage_size_;
+      uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + i;
+      crypto_->decrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+    }
+  }
+  ScopedPhase t(stats_, Phase::Serialize);
+  t.set_count(count);
+  for (uint64_t i = 0; i < count; ++i)
+    out[i].deserialize(buf.data() + i * bucket_storage_size_, params_);
 }
 
 void FileStorage::write_buckets(int level, uint64_t start_bucket,
                                const std::vector<Bucket>& buckets) {
-  ensure_open();
-  uint64_t off = level_offset(level) + start_bucket * bucket_storage_size_;
-  if (count_seeks_ && off != last_offset_ && last_offset_ != UINT64_MAX)
-    ++seek_count_;
-  last_offset_ = off + buckets.size() * bucket_storage_size_;
-
   std::vector<uint8_t> buf(buckets.size() * bucket_storage_size_);
-  for (size_t i = 0; i < buckets.size(); ++i) {
-    uint8_t* bucket_ptr = buf.data() + i * bucket_storage_size_;
-    buckets[i].serialize(bucket_ptr, params_);
-    uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + static_cast<uint64_t>(i);
-    if (crypto_) crypto_->encrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+  {
+    ScopedPhase t(stats_, Phase::Serialize);
+    t.set_count(buckets.size());
+    for (size_t i = 0; i < buckets.size(); ++i)
+      buckets[i].serialize(buf.data() + i * bucket_storage_size_, params_);
   }
-  ssize_t n = pwrite(fd_, buf.data(), buf.size(), static_cast<off_t>(off));
-  if (n != static_cast<ssize_t>(buf.size()))
-    throw std::runtime_error("FileStorage: pwrite failed");
+  if (crypto_) {
+    ScopedPhase t(stats_, Phase::Encrypt);
+    t.set_count(buckets.size());
+    for (size_t i = 0; i < buckets.size(); ++i) {
+      uint8_t* bucket_ptr = buf.data() + i * bucket_storage_size_;
+      uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + static_cast<uint64_t>(i);
+      crypto_->encrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+    }
+  }
+  ScopedPhase t(stats_, Phase::RawIO);
+  write_raw(level, start_bucket, buckets.size(), buf.data());
+}
+
+void FileStorage::sync() {
+  ensure_open();
+  ScopedPhase t(stats_, Phase::Sync);
+  if (fdatasync(fd_) != 0) throw std::runtime_error("FileStorage: fdatasync failed: " + path_);
 }
 
 }  // namespace roram
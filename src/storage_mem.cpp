@@ -1,4 +1,5 @@
 #include "roram/storage.hpp"
+#include <algorithm>
 #include <cstring>
 
 namespace roram {
@@ -8,7 +9,7 @@ uint64_t MemoryStorage::level_offset(int j) const {
   return level_offsets_[static_cast<size_t>(j)];
 }
 
-MemoryStorage::MemoryStorage(const Params& params, CryptoProvider* crypto)
+MemoryStorage::MemoryStorage(const Params& params, CryptoProvider* crypto, HugePages huge_pages)
     : params_(params), tag_size_(crypto ? crypto->tag_size() : 0), crypto_(crypto) {
   Bucket b(params.Z, params.B, params.ell + 1);
   bucket_plain_size_ = b.serialized_size(params_);
@@ -19,53 +20,86 @@ MemoryStorage::MemoryStorage(const Params& params, CryptoProvider* crypto)
   for (int j = 1; j <= params_.h + 1; ++j)
     level_offsets_[static_cast<size_t>(j)] =
         level_offsets_[static_cast<size_t>(j - 1)] + (1ULL << (j - 1)) * bucket_storage_size_;
-  level_data_.resize(static_cast<size_t>(params_.h + 1));
-  for (int j = 0; j <= params_.h; ++j) {
-    uint64_t num_buckets = 1ULL << j;
-    level_data_[static_cast<size_t>(j)].resize(num_buckets * bucket_storage_size_, 0);
+  arena_ = PageBuffer(level_offsets_.back(), huge_pages);
+  // Opt 4: allocate scratch buffer once; reused (and grown to the largest run) by every read.
+  scratch_ = PageBuffer(bucket_storage_size_, huge_pages);
+}
+
+uint64_t MemoryStorage::fetch_run(int level, uint64_t start_bucket, uint64_t count, uint8_t* dst) {
+  account_io(level, false, level_offset(level) + start_bucket * bucket_storage_size_, count);
+  const uint64_t avail = 1ULL << level;
+  const uint64_t n = start_bucket < avail ? std::min(count, avail - start_bucket) : 0;
+  {
+    ScopedPhase t(stats_, Phase::RawIO);
+    std::memcpy(dst, arena_.data() + level_offset(level) + start_bucket * bucket_storage_size_,
+                n * bucket_storage_size_);
   }
-  // Opt 4: allocate scratch buffer once; reused for every bucket read.
-  scratch_.resize(bucket_storage_size_, 0);
+  if (crypto_) {
+    ScopedPhase t(stats_, Phase::Decrypt);
+    t.set_count(n);
+    for (uint64_t i = 0; i < n; ++i) {
+      uint8_t* bucket_ptr = dst + i * bucket_storage_size_;
+      uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + i;
+      crypto_->decrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+    }
+  }
+  return n;
 }
 
 void MemoryStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count,
                                  std::vector<Bucket>& out) {
-  uint64_t off = level_offset(level) + start_bucket * bucket_storage_size_;
-  uint64_t request_size = count * bucket_storage_size_;
-  if (last_offset_ != static_cast<uint64_t>(-1) && off != last_offset_)
-    ++seek_count_;
-  last_offset_ = off + request_size;
-
   out.resize(count, Bucket(params_.Z, params_.B, params_.ell + 1));
-  std::vector<uint8_t>& data = level_data_[static_cast<size_t>(level)];
-  for (uint64_t i = 0; i < count; ++i) {
-    size_t pos = (start_bucket + i) * bucket_storage_size_;
-    if (pos + bucket_storage_size_ > data.size()) break;
-    // Opt 4: reuse pre-allocated scratch buffer; no heap alloc per bucket.
-    std::memcpy(scratch_.data(), data.data() + pos, bucket_storage_size_);
-    uint8_t* bucket_ptr = scratch_.data();
-    uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + i;
-    if (crypto_) crypto_->decrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
-    out[i].deserialize(bucket_ptr, params_);
+  // Opt 4: reuse the scratch buffer (grown to the largest run seen); no heap alloc per bucket.
+  scratch_.grow(count * bucket_storage_size_);
+  // One pass per phase, so each is timed once per call rather than per bucket.
+  const uint64_t n = fetch_run(level, start_bucket, count, scratch_.data());
+  ScopedPhase t(stats_, Phase::Serialize);
+  t.set_count(n);
+  for (uint64_t i = 0; i < n; ++i)
+    out[i].deserialize(scratch_.data() + i * bucket_storage_size_, params_);
+}
+
+const uint8_t* MemoryStorage::read_plain(const std::vector<BucketExtent>& extents) {
+  uint64_t total = 0;
+  for (const BucketExtent& e : extents) total += e.count;
+  scratch_.grow(total * bucket_storage_size_);
+  uint64_t pos = 0;
+  for (const BucketExtent& e : extents) {
+    fetch_run(e.level, e.start, e.count, scratch_.data() + pos * bucket_storage_size_);
+    pos += e.count;
   }
+  return scratch_.data();
 }
 
 void MemoryStorage::write_buckets(int level, uint64_t start_bucket,
                                   const std::vector<Bucket>& buckets) {
-  uint64_t off = level_offset(level) + start_bucket * bucket_storage_size_;
-  uint64_t request_size = buckets.size() * bucket_storage_size_;
-  if (last_offset_ != static_cast<uint64_t>(-1) && off != last_offset_)
-    ++seek_count_;
-  last_offset_ = off + request_size;
+  const uint64_t avail = 1ULL << level;
+  const uint64_t n = start_bucket < avail ? std::min<uint64_t>(buckets.size(), avail - start_bucket) : 0;
+  // Sealed in place: a memory write has no separate RawIO step.
+  uint8_t* base = plain_run(level, start_bucket, buckets.size());
+  {
+    ScopedPhase t(stats_, Phase::Serialize);
+    t.set_count(n);
+    for (uint64_t i = 0; i < n; ++i)
+      buckets[static_cast<size_t>(i)].serialize(base + i * bucket_storage_size_, params_);
+  }
+  seal_run(level, start_bucket, n);
+}
 
-  std::vector<uint8_t>& data = level_data_[static_cast<size_t>(level)];
-  for (size_t i = 0; i < buckets.size(); ++i) {
-    size_t pos = (start_bucket + i) * bucket_storage_size_;
-    if (pos + bucket_storage_size_ > data.size()) break;
-    uint8_t* bucket_ptr = data.data() + pos;
-    buckets[i].serialize(bucket_ptr, params_);
-    uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + static_cast<uint64_t>(i);
-    if (crypto_) crypto_->encrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
+uint8_t* MemoryStorage::plain_run(int level, uint64_t start_bucket, uint64_t count) {
+  account_io(level, true, level_offset(level) + start_bucket * bucket_storage_size_, count);
+  return arena_.data() + level_offset(level) + start_bucket * bucket_storage_size_;
+}
+
+void MemoryStorage::seal_run(int level, uint64_t start_bucket, uint64_t count) {
+  if (!crypto_) return;
+  uint8_t* base = arena_.data() + level_offset(level) + start_bucket * bucket_storage_size_;
+  ScopedPhase t(stats_, Phase::Encrypt);
+  t.set_count(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    uint8_t* bucket_ptr = base + i * bucket_storage_size_;
+    uint64_t bucket_id = ((1ULL << level) - 1) + start_bucket + i;
+    crypto_->encrypt(bucket_ptr, bucket_plain_size_, bucket_id, bucket_ptr + bucket_plain_size_);
   }
 }
 
@@ -0,0 +1,27 @@
+#include "roram/remote_storage.hpp"
+#include <iostream>
+#include <string>
+
+// Storage server for RemoteStorage clients: serves tree files from a directory.
+int main(int argc, char** argv) {
+  std::string listen = "unix:/tmp/roram_storage.sock";
+  std::string dir = ".";
+  bool count_seeks = true;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--listen" && i + 1 < argc) { listen = argv[++i]; continue; }
+    if (arg == "--dir" && i + 1 < argc) { dir = argv[++i]; continue; }
+    if (arg == "--no-seeks") { count_seeks = false; continue; }
+    std::cerr << "Usage: " << argv[0] << " [--listen unix:PATH|tcp:[HOST:]PORT] [--dir DIR] [--no-seeks]\n";
+    return 1;
+  }
+  try {
+    roram::StorageServer server(listen, dir, count_seeks);
+    std::cout << "Serving " << dir << " on " << listen << "\n" << std::flush;
+    server.serve();
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -1,170 +1,286 @@
 #include "roram/sub_oram.hpp"
 #include "roram/bit_reverse.hpp"
+#include "roram/header_scan.hpp"
+#include "roram/path_oram.hpp"
 #include <algorithm>
 #include <unordered_map>
-#include <unordered_set>
 #include <cstring>
 
 namespace roram {
 
-SubORAM::SubORAM(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto)
+namespace {
+
+// Headers per assign_level scan call.
+constexpr size_t kAssignChunk = 512;
+
+void pack_addresses(const std::vector<Block>& blocks, std::vector<uint64_t>& out) {
+  out.clear();
+  out.reserve(blocks.size());
+  for (const Block& b : blocks) out.push_back(b.a);
+}
+
+}  // namespace
+
+SubORAM::SubORAM(const Params& params, int i, StorageBackend* storage, CryptoProvider* crypto,
+                 std::unique_ptr<PathORAM> pm_backing)
     : params_(params), i_(i), storage_(storage), crypto_(crypto),
-      pm_(params.N, i), stash_() {}
+      pm_(params.N, i, std::move(pm_backing)), stash_() {}
 
-void SubORAM::merge_bucket_into_stash(std::vector<Block>& stash, const Bucket& bucket) {
+void SubORAM::merge_bucket_into_stash(std::vector<Block>& stash, std::vector<uint64_t>& addrs,
+                                      const Bucket& bucket, MergeLookup& lookup) {
   const uint64_t range_size = 1ULL << i_;
-  // Opt 6: cache the last (a0, pm value) pair to avoid redundant PM queries
-  // for blocks in the same range (they share the same a0).
-  uint64_t cached_a0 = UINT64_MAX;
-  uint64_t cached_pm_val = 0;
   for (const Block& b : bucket.blocks) {
-    if (!b.valid()) continue;
+    if (!b.valid()) {
+      lookup.skip();
+      continue;
+    }
     // Stale-copy check: discard blocks whose path tag no longer matches the
     // current position map.  Without this, a block re-assigned to a new path
     // can leave a ghost copy in the tree that later overwrites the live copy.
     uint64_t a0     = (b.a / range_size) * range_size;
     uint64_t offset = b.a - a0;
-    if (a0 != cached_a0) {
-      cached_a0 = a0;
-      cached_pm_val = pm_.query(a0);
+    if (b.p[static_cast<size_t>(i_)] != lookup.query(a0) + offset) continue;
+    // A copy written back with an unchanged tag (the block was updated through another
+    // sub-ORAM) can still sit elsewhere on its path; keep whichever copy is newer.
+    const size_t at = scan_find(addrs.data(), addrs.size(), b.a);
+    if (at == addrs.size()) {
+      stash.push_back(b);
+      addrs.push_back(b.a);
+    } else if (b.ver > stash[at].ver) {
+      stash[at] = b;
     }
-    if (b.p[static_cast<size_t>(i_)] != cached_pm_val + offset) continue;
-    auto it = std::find_if(stash.begin(), stash.end(), [&b](const Block& s) { return s.a == b.a; });
-    if (it != stash.end()) continue;  // keep existing (e.g. from higher level)
-    stash.push_back(b);
   }
 }
 
 void SubORAM::merge_into_stash(const std::vector<Bucket>& buckets) {
+  // Stash addresses packed once for the whole merge, so each lookup is a vector scan.
+  std::vector<uint64_t> addrs;
+  addrs.reserve(stash_.size() + buckets.size() * static_cast<size_t>(params_.Z));
+  for (const Block& s : stash_) addrs.push_back(s.a);
+  // Opt 6: the lookup caches the last (a0, pm value) pair; blocks of one range share it.
+  MergeLookup lookup(pm_);
   for (const Bucket& b : buckets)
-    merge_bucket_into_stash(stash_, b);
+    merge_bucket_into_stash(stash_, addrs, b, lookup);
 }
 
-void SubORAM::read_paths_level(uint64_t p, uint64_t count, int j, std::vector<Bucket>& out) {
+void SubORAM::add_level_extents(uint64_t p, uint64_t count, int j, std::vector<BucketExtent>& out) const {
   uint64_t n_buckets = num_buckets_at_level(j);
   uint64_t start = p % n_buckets;
   uint64_t num_needed = std::min(count, n_buckets);
   if (start + num_needed <= n_buckets) {
-    storage_->read_buckets(j, start, num_needed, out);
+    out.push_back(BucketExtent{j, start, num_needed});
   } else {
-    std::vector<Bucket> part1, part2;
-    storage_->read_buckets(j, start, n_buckets - start, part1);
-    storage_->read_buckets(j, 0, num_needed - (n_buckets - start), part2);
-    out = std::move(part1);
-    // Opt 5: move instead of copy when merging wrap-around part.
-    out.insert(out.end(), std::make_move_iterator(part2.begin()),
-                          std::make_move_iterator(part2.end()));
+    // Wrap-around: the run continues at bucket 0 of the same level.
+    out.push_back(BucketExtent{j, start, n_buckets - start});
+    out.push_back(BucketExtent{j, 0, num_needed - (n_buckets - start)});
   }
 }
 
-void SubORAM::ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start) {
-  const uint64_t range_len = 1ULL << i_;
-  const uint64_t U_end = a + range_len;
-
-  result.clear();
-  std::unordered_set<uint64_t> seen;
-  seen.reserve(static_cast<size_t>(range_len) * 2 + 8);
-  for (const Block& b : stash_) {
-    if (b.a >= a && b.a < U_end) {
-      result.push_back(b);
-      seen.insert(b.a);
-    }
-  }
+void SubORAM::stash_range(uint64_t a, uint64_t end, std::vector<Block>& result, RangeIndex& seen) const {
+  std::vector<uint64_t> addrs;
+  pack_addresses(stash_, addrs);
+  std::vector<uint64_t> mask(mask_words(addrs.size()));
+  if (scan_in_range(addrs.data(), addrs.size(), a, end, mask.data()) == 0) return;
+  for_each_match(mask.data(), mask.size(), [&](size_t k) {
+    seen.emplace(stash_[k].a, result.size());
+    result.push_back(stash_[k]);
+  });
+}
 
-  uint64_t p = pm_.query(a);
+uint64_t SubORAM::remap_range(uint64_t a, uint64_t& new_path_start) {
+  const uint64_t p = pm_.query(a);
   new_path_start = crypto_->random_path(params_.N);
   pm_.update(a, new_path_start);
+  return p;
+}
 
-  for (int j = 0; j <= params_.h; ++j) {
-    std::vector<Bucket> buckets;
-    read_paths_level(p, range_len, j, buckets);
-    for (const Bucket& bucket : buckets) {
-      for (const Block& b : bucket.blocks) {
-        if (!b.valid() || b.a < a || b.a >= U_end) continue;
-        if (seen.find(b.a) == seen.end()) {
-          result.push_back(b);
-          seen.insert(b.a);
-        }
-      }
-    }
-  }
-
-  // Synthesize zero-initialized blocks for any address in [a, U_end) not yet found.
+void SubORAM::complete_range(uint64_t a, uint64_t end, uint64_t new_path_start, std::vector<Block>& result,
+                             RangeIndex& seen) const {
+  // Synthesize zero-initialized blocks for any address in [a, end) not yet found.
   // Mirrors PathORAM's "create block on first access" behaviour.
   // Set p[i_] correctly so the stale-copy check passes on subsequent BatchEvict merges.
-  for (uint64_t addr = a; addr < U_end; ++addr) {
+  for (uint64_t addr = a; addr < end; ++addr) {
     if (seen.find(addr) == seen.end()) {
       Block b(params_.B, params_.ell + 1);
       b.a = addr;
       b.p[static_cast<size_t>(i_)] = new_path_start + (addr - a);
+      seen.emplace(addr, result.size());
       result.push_back(b);
-      seen.insert(addr);
     }
   }
 
   std::sort(result.begin(), result.end(), [](const Block& x, const Block& y) { return x.a < y.a; });
 }
 
+void SubORAM::collect_range(const Bucket* buckets, size_t count, uint64_t a, uint64_t end,
+                            std::vector<Block>& result, RangeIndex& seen) const {
+  // Every fetched header in one pass; dummies (INVALID_ADDR) fall outside [a, end).
+  std::vector<uint64_t> addrs;
+  for (size_t n = 0; n < count; ++n)
+    for (const Block& b : buckets[n].blocks) addrs.push_back(b.a);
+  std::vector<uint64_t> mask(mask_words(addrs.size()));
+  if (scan_in_range(addrs.data(), addrs.size(), a, end, mask.data()) == 0) return;
+  const size_t Z = static_cast<size_t>(params_.Z);
+  for_each_match(mask.data(), mask.size(), [&](size_t k) {
+    const Block& b = buckets[k / Z].blocks[k % Z];
+    auto it = seen.find(b.a);
+    if (it == seen.end()) {
+      seen.emplace(b.a, result.size());
+      result.push_back(b);
+    } else if (b.ver > result[it->second].ver) {
+      result[it->second] = b;  // an older copy was met first (see merge_bucket_into_stash)
+    }
+  });
+}
+
+void SubORAM::ReadRange(uint64_t a, std::vector<Block>& result, uint64_t& new_path_start) {
+  ScopedPhase timer(stats_, Phase::ReadRange, i_);
+  const uint64_t range_len = 1ULL << i_;
+  const uint64_t U_end = a + range_len;
+
+  result.clear();
+  RangeIndex seen;  // address -> index in result
+  seen.reserve(static_cast<size_t>(range_len) * 2 + 8);
+  stash_range(a, U_end, result, seen);
+  const uint64_t p = remap_range(a, new_path_start);
+
+  // All levels in one batched request (a single round trip on remote storage).
+  std::vector<BucketExtent> extents;
+  for (int j = 0; j <= params_.h; ++j) add_level_extents(p, range_len, j, extents);
+  std::vector<Bucket> buckets;
+  storage_->read_extents(extents, buckets);
+  collect_range(buckets.data(), buckets.size(), a, U_end, result, seen);
+  complete_range(a, U_end, new_path_start, result, seen);
+}
+
+void SubORAM::ReadRangePair(uint64_t a0, uint64_t a1, std::vector<Block>& result0, uint64_t& new_path0,
+                            std::vector<Block>& result1, uint64_t& new_path1) {
+  ScopedPhase timer(stats_, Phase::ReadRange, i_);
+  timer.set_count(2);
+  const uint64_t range_len = 1ULL << i_;
+
+  // Same steps and random draws as ReadRange(a0) then ReadRange(a1): neither range's
+  // stash copy or remap depends on the other's fetched blocks.
+  result0.clear();
+  result1.clear();
+  RangeIndex seen0, seen1;
+  seen0.reserve(static_cast<size_t>(range_len) * 2 + 8);
+  seen1.reserve(static_cast<size_t>(range_len) * 2 + 8);
+  stash_range(a0, a0 + range_len, result0, seen0);
+  const uint64_t p0 = remap_range(a0, new_path0);
+  stash_range(a1, a1 + range_len, result1, seen1);
+  const uint64_t p1 = remap_range(a1, new_path1);
+
+  std::vector<BucketExtent> extents;
+  for (int j = 0; j <= params_.h; ++j) add_level_extents(p0, range_len, j, extents);
+  size_t first_buckets = 0;
+  for (const BucketExtent& e : extents) first_buckets += static_cast<size_t>(e.count);
+  for (int j = 0; j <= params_.h; ++j) add_level_extents(p1, range_len, j, extents);
+  std::vector<Bucket> buckets;
+  storage_->read_extents(extents, buckets);
+  collect_range(buckets.data(), first_buckets, a0, a0 + range_len, result0, seen0);
+  collect_range(buckets.data() + first_buckets, buckets.size() - first_buckets, a1, a1 + range_len, result1, seen1);
+  complete_range(a0, a0 + range_len, new_path0, result0, seen0);
+  complete_range(a1, a1 + range_len, new_path1, result1, seen1);
+}
+
+void SubORAM::assign_bucket(std::vector<Block>& stash, int i, uint64_t n_buckets, uint64_t r, int Z,
+                            Bucket& dst) {
+  assign_level(stash, i, n_buckets, r, 1, Z, &dst);
+}
+
+void SubORAM::assign_level(std::vector<Block>& stash, int i, uint64_t n_buckets, uint64_t first, uint64_t count,
+                           int Z, Bucket* dst) {
+  const size_t n = stash.size();
+  std::vector<uint64_t> tags(n);
+  for (size_t s = 0; s < n; ++s) tags[s] = stash[s].p[static_cast<size_t>(i)];
+  std::vector<uint64_t> taken(mask_words(n), 0);
+  std::vector<size_t> slots(static_cast<size_t>(count) * static_cast<size_t>(Z));
+  select_level(tags.data(), n, n_buckets, first, count, Z, taken.data(), slots.data());
+  for (uint64_t b = 0; b < count; ++b) {
+    for (size_t z = 0; z < static_cast<size_t>(Z); ++z) {
+      const size_t s = slots[static_cast<size_t>(b) * static_cast<size_t>(Z) + z];
+      if (s == kNoSlot)
+        dst[b].blocks[z].set_dummy();
+      else
+        dst[b].blocks[z] = std::move(stash[s]);
+    }
+  }
+  remove_taken(stash, taken.data());
+}
+
+void SubORAM::select_level(const uint64_t* tags, size_t n, uint64_t n_buckets, uint64_t first, uint64_t count, int Z,
+                           uint64_t* taken, size_t* slots) {
+  // Each bucket is a masked-equal scan over the packed tags. Blocks taken by an earlier
+  // call (a deeper level) are masked out; within the level a block's tag passes exactly
+  // one of the count distinct buckets, so it cannot be chosen twice.
+  std::vector<uint64_t> mask(mask_words(kAssignChunk));
+  const uint64_t sel = n_buckets - 1;
+  for (uint64_t b = 0; b < count; ++b) {
+    const uint64_t r = (first + b) % n_buckets;
+    size_t* slot = slots + static_cast<size_t>(b) * static_cast<size_t>(Z);
+    size_t chosen = 0;
+    // Chunked so a bucket that fills early stops scanning; picks the first Z matches in
+    // stash order, as the one-block-at-a-time loop did.
+    for (size_t off = 0; off < n && chosen < static_cast<size_t>(Z); off += kAssignChunk) {
+      const size_t len = std::min(kAssignChunk, n - off);
+      if (scan_masked_equal(tags + off, len, sel, r, mask.data()) == 0) continue;
+      for (size_t w = 0; w < mask_words(len); ++w) mask[w] &= ~taken[off / 64 + w];
+      for_each_match(mask.data(), mask_words(len), [&](size_t k) {
+        if (chosen == static_cast<size_t>(Z)) return;
+        slot[chosen++] = off + k;
+        taken[(off + k) / 64] |= 1ULL << ((off + k) % 64);
+      });
+    }
+    for (size_t z = chosen; z < static_cast<size_t>(Z); ++z) slot[z] = kNoSlot;
+  }
+}
+
+void SubORAM::remove_taken(std::vector<Block>& stash, const uint64_t* taken) {
+  // Opt 1: O(n) compaction instead of O(n²) erase-in-loop.
+  size_t write_pos = 0;
+  for (size_t s = 0; s < stash.size(); ++s) {
+    if (taken[s / 64] >> (s % 64) & 1) continue;
+    if (write_pos != s) stash[write_pos] = std::move(stash[s]);
+    ++write_pos;
+  }
+  stash.erase(stash.begin() + static_cast<std::ptrdiff_t>(write_pos), stash.end());
+}
+
 void SubORAM::BatchEvict(uint64_t k, uint64_t cnt) {
   const int h = params_.h;
-  const int Z = params_.Z;
 
-  for (int j = 0; j <= h; ++j) {
-    uint64_t n_buckets = num_buckets_at_level(j);
-    uint64_t start = cnt % n_buckets;
-    uint64_t num_needed = std::min(k, n_buckets);
+  // Read phase: every level's run of k buckets in one batched request.
+  std::vector<BucketExtent> extents;
+  for (int j = 0; j <= h; ++j) add_level_extents(cnt, k, j, extents);
+  {
     std::vector<Bucket> buckets;
-    if (start + num_needed <= n_buckets) {
-      storage_->read_buckets(j, start, num_needed, buckets);
-    } else {
-      std::vector<Bucket> part1, part2;
-      storage_->read_buckets(j, start, n_buckets - start, part1);
-      storage_->read_buckets(j, 0, num_needed - (n_buckets - start), part2);
-      buckets = std::move(part1);
-      // Opt 5: move instead of copy for wrap-around part.
-      buckets.insert(buckets.end(), std::make_move_iterator(part2.begin()),
-                                    std::make_move_iterator(part2.end()));
+    {
+      ScopedPhase t(stats_, Phase::EvictRead);
+      storage_->read_extents(extents, buckets);
     }
+    ScopedPhase t(stats_, Phase::StashMerge);
     merge_into_stash(buckets);
+    note_stash_peak();
+    peak_evict_buckets_ = std::max<uint64_t>(peak_evict_buckets_, buckets.size());
   }
 
-  for (int j = h; j >= 0; --j) {
-    uint64_t n_buckets = num_buckets_at_level(j);
-    uint64_t start = cnt % n_buckets;
-    uint64_t num_needed = std::min(k, n_buckets);
-    std::vector<Bucket> to_write(num_needed, Bucket(params_.Z, params_.B, params_.ell + 1));
-    for (uint64_t i = 0; i < num_needed; ++i) {
-      uint64_t path_idx = cnt + i;
-      uint64_t r = path_idx % n_buckets;
-      std::vector<Block> chosen;
-      // Opt 1: O(n) partition instead of O(n²) erase-in-loop.
-      // Single pass: move matching blocks into chosen, compact stash in-place.
-      auto write_pos = stash_.begin();
-      for (auto read_pos = stash_.begin(); read_pos != stash_.end(); ++read_pos) {
-        uint64_t block_path = read_pos->p[static_cast<size_t>(i_)];
-        if (chosen.size() < static_cast<size_t>(Z) && (block_path % n_buckets) == r) {
-          chosen.push_back(std::move(*read_pos));
-        } else {
-          if (write_pos != read_pos) *write_pos = std::move(*read_pos);
-          ++write_pos;
-        }
-      }
-      stash_.erase(write_pos, stash_.end());
-      for (size_t z = 0; z < chosen.size(); ++z)
-        to_write[i].blocks[z] = chosen[z];
-      for (size_t z = chosen.size(); z < static_cast<size_t>(Z); ++z)
-        to_write[i].blocks[z].set_dummy();
-    }
-    if (start + num_needed <= n_buckets) {
-      storage_->write_buckets(j, start, to_write);
-    } else {
-      uint64_t first_count = n_buckets - start;
-      std::vector<Bucket> part1(to_write.begin(), to_write.begin() + static_cast<ptrdiff_t>(first_count));
-      std::vector<Bucket> part2(to_write.begin() + static_cast<ptrdiff_t>(first_count), to_write.end());
-      storage_->write_buckets(j, start, part1);
-      storage_->write_buckets(j, 0, part2);
+  // Write phase: fill leaves first, then write all levels back in one batched request.
+  extents.clear();
+  std::vector<Bucket> to_write;
+  {
+    ScopedPhase t(stats_, Phase::EvictAssign);
+    for (int j = h; j >= 0; --j) {
+      uint64_t n_buckets = num_buckets_at_level(j);
+      uint64_t num_needed = std::min(k, n_buckets);
+      const size_t base = to_write.size();
+      to_write.resize(base + num_needed, Bucket(params_.Z, params_.B, params_.ell + 1));
+      assign_level(stash_, i_, n_buckets, cnt % n_buckets, num_needed, params_.Z, &to_write[base]);
+      add_level_extents(cnt, k, j, extents);
     }
   }
+  ScopedPhase t(stats_, Phase::EvictWrite);
+  storage_->write_extents(extents, to_write);
 }
 
 }  // namespace roram
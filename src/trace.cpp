@@ -0,0 +1,308 @@
+#include "roram/trace.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace roram {
+
+namespace {
+
+const char kIoMagic[8] = {'R', 'O', 'R', 'A', 'M', 'I', 'O', '1'};
+const char kLogicalMagic[8] = {'R', 'O', 'R', 'A', 'M', 'L', 'T', '1'};
+constexpr size_t kIoRecordSize = 32;
+constexpr size_t kLogicalRecordSize = 16;
+constexpr size_t kFlushBytes = 1 << 20;
+
+uint64_t now_ns() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void put_le(uint8_t* p, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint64_t get_le(const uint8_t* p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+bool has_magic(const std::string& path, const char (&magic)[8]) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return false;
+  char head[8];
+  const bool ok = std::fread(head, 1, 8, f) == 8 && std::memcmp(head, magic, 8) == 0;
+  std::fclose(f);
+  return ok;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// IoTraceWriter / TracingStorage
+// ---------------------------------------------------------------------------
+
+IoTraceWriter::IoTraceWriter(const std::string& path) : f_(std::fopen(path.c_str(), "wb")), t0_ns_(now_ns()) {
+  if (!f_) throw std::runtime_error("IoTraceWriter: cannot open " + path);
+  buf_.resize(sizeof(kIoMagic));
+  std::memcpy(buf_.data(), kIoMagic, sizeof(kIoMagic));
+}
+
+IoTraceWriter::~IoTraceWriter() {
+  flush();
+  std::fclose(f_);
+}
+
+void IoTraceWriter::put_record(const IoTraceRecord& r) {
+  uint8_t rec[kIoRecordSize];
+  put_le(rec, r.t_ns, 8);
+  put_le(rec + 8, r.start, 8);
+  put_le(rec + 16, r.bytes, 8);
+  put_le(rec + 24, r.count, 4);
+  put_le(rec + 28, r.tree, 2);
+  rec[30] = r.level;
+  rec[31] = static_cast<uint8_t>(r.op);
+  buf_.insert(buf_.end(), rec, rec + kIoRecordSize);
+  if (buf_.size() >= kFlushBytes) {
+    std::fwrite(buf_.data(), 1, buf_.size(), f_);
+    buf_.clear();
+  }
+}
+
+uint16_t IoTraceWriter::register_tree(const std::string& name) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (next_tree_ == UINT16_MAX) throw std::runtime_error("IoTraceWriter: too many trees");
+  const uint16_t id = next_tree_++;
+  put_record(IoTraceRecord{now_ns() - t0_ns_, 0, 0, static_cast<uint32_t>(name.size()), id, 0, IoTraceOp::Name});
+  buf_.insert(buf_.end(), name.begin(), name.end());
+  buf_.resize(buf_.size() + (8 - name.size() % 8) % 8, 0);
+  return id;
+}
+
+void IoTraceWriter::record(uint16_t tree, IoTraceOp op, int level, uint64_t start, uint64_t count, uint64_t bytes) {
+  const uint64_t t = now_ns() - t0_ns_;
+  std::lock_guard<std::mutex> lk(mu_);
+  put_record(IoTraceRecord{t, start, bytes, static_cast<uint32_t>(count), tree, static_cast<uint8_t>(level), op});
+  ++records_;
+}
+
+void IoTraceWriter::flush() {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!buf_.empty()) std::fwrite(buf_.data(), 1, buf_.size(), f_);
+  buf_.clear();
+  std::fflush(f_);
+}
+
+uint64_t IoTraceWriter::records() const {
+  std::lock_guard<std::mutex> lk(mu_);
+  return records_;
+}
+
+TracingStorage::TracingStorage(std::unique_ptr<StorageBackend> inner, std::shared_ptr<IoTraceWriter> writer,
+                               const std::string& name)
+    : inner_(std::move(inner)), writer_(std::move(writer)), tree_(writer_->register_tree(name)) {}
+
+void TracingStorage::record(IoTraceOp op, int level, uint64_t start, uint64_t count) {
+  writer_->record(tree_, op, level, start, count, count * inner_->bucket_byte_size());
+}
+
+void TracingStorage::read_buckets(int level, uint64_t start_bucket, uint64_t count, std::vector<Bucket>& out) {
+  record(IoTraceOp::Read, level, start_bucket, count);
+  inner_->read_buckets(level, start_bucket, count, out);
+}
+
+void TracingStorage::write_buckets(int level, uint64_t start_bucket, const std::vector<Bucket>& buckets) {
+  record(IoTraceOp::Write, level, start_bucket, buckets.size());
+  inner_->write_buckets(level, start_bucket, buckets);
+}
+
+void TracingStorage::read_extents(const std::vector<BucketExtent>& extents, std::vector<Bucket>& out) {
+  for (const BucketExtent& e : extents) record(IoTraceOp::Read, e.level, e.start, e.count);
+  inner_->read_extents(extents, out);
+}
+
+void TracingStorage::write_extents(const std::vector<BucketExtent>& extents, const std::vector<Bucket>& buckets) {
+  for (const BucketExtent& e : extents) record(IoTraceOp::Write, e.level, e.start, e.count);
+  inner_->write_extents(extents, buckets);
+}
+
+void TracingStorage::sync() {
+  writer_->record(tree_, IoTraceOp::Sync, 0, 0, 0, 0);
+  inner_->sync();
+}
+
+StorageFactory tracing_storage_factory(StorageFactory inner, std::shared_ptr<IoTraceWriter> writer,
+                                       const std::string& prefix) {
+  return [inner, writer, prefix](const Params& params, const std::string& name,
+                                 CryptoProvider* crypto) -> std::unique_ptr<StorageBackend> {
+    return std::make_unique<TracingStorage>(inner(params, name, crypto), writer, prefix + name);
+  };
+}
+
+// ---------------------------------------------------------------------------
+// Reading and replaying I/O traces
+// ---------------------------------------------------------------------------
+
+IoTrace read_io_trace(const std::string& path) {
+  std::FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("read_io_trace: cannot open " + path);
+  std::vector<uint8_t> data;
+  uint8_t chunk[1 << 16];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+  std::fclose(f);
+  if (data.size() < 8 || std::memcmp(data.data(), kIoMagic, 8) != 0)
+    throw std::runtime_error("read_io_trace: not an I/O trace: " + path);
+
+  IoTrace trace;
+  size_t pos = 8;
+  while (pos + kIoRecordSize <= data.size()) {
+    const uint8_t* p = data.data() + pos;
+    IoTraceRecord r{get_le(p, 8), get_le(p + 8, 8), get_le(p + 16, 8), static_cast<uint32_t>(get_le(p + 24, 4)),
+                    static_cast<uint16_t>(get_le(p + 28, 2)), p[30], static_cast<IoTraceOp>(p[31])};
+    pos += kIoRecordSize;
+    if (r.op == IoTraceOp::Name) {
+      const size_t padded = (r.count + 7) / 8 * 8;
+      if (pos + padded > data.size()) throw std::runtime_error("read_io_trace: truncated name record");
+      if (trace.tree_names.size() <= r.tree) trace.tree_names.resize(static_cast<size_t>(r.tree) + 1);
+      trace.tree_names[r.tree].assign(reinterpret_cast<const char*>(data.data() + pos), r.count);
+      pos += padded;
+    } else if (r.op == IoTraceOp::Read || r.op == IoTraceOp::Write || r.op == IoTraceOp::Sync) {
+      if (r.tree >= trace.tree_names.size()) throw std::runtime_error("read_io_trace: record for unnamed tree");
+      if (r.level >= 64) throw std::runtime_error("read_io_trace: bad record level");
+      trace.records.push_back(r);
+    } else {
+      throw std::runtime_error("read_io_trace: bad record op");
+    }
+  }
+  return trace;
+}
+
+IoReplayResult replay_io_trace(const IoTrace& trace, const std::string& target, const IoReplayOptions& opts) {
+  // Lay the selected trees out back to back.
+  std::vector<uint8_t> selected(trace.tree_names.size(), 0);
+  for (size_t t = 0; t < trace.tree_names.size(); ++t)
+    selected[t] = trace.tree_names[t].find(opts.trees) != std::string::npos;
+  std::vector<uint64_t> tree_bytes(trace.tree_names.size(), 0);
+  uint64_t max_run = 0;
+  for (const IoTraceRecord& r : trace.records) {
+    if (!selected[r.tree]) continue;
+    tree_bytes[r.tree] = std::max(tree_bytes[r.tree], r.offset() + r.bytes);
+    max_run = std::max(max_run, r.bytes);
+  }
+  std::vector<uint64_t> base(tree_bytes.size(), 0);
+  IoReplayResult res;
+  for (size_t t = 0; t < tree_bytes.size(); ++t) {
+    base[t] = res.target_bytes;
+    res.target_bytes += tree_bytes[t];
+  }
+
+  int flags = O_RDWR | O_CREAT;
+  if (opts.sync) flags |= O_DSYNC;
+  const int fd = open(target.c_str(), flags, 0666);
+  if (fd < 0) throw std::runtime_error("replay_io_trace: cannot open " + target);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && static_cast<uint64_t>(st.st_size) < res.target_bytes &&
+      ftruncate(fd, static_cast<off_t>(res.target_bytes)) != 0) {
+    close(fd);
+    throw std::runtime_error("replay_io_trace: ftruncate failed");
+  }
+
+  std::vector<uint8_t> buf(static_cast<size_t>(max_run), 0x5a);
+  const auto start = std::chrono::steady_clock::now();
+  for (const IoTraceRecord& r : trace.records) {
+    if (!selected[r.tree]) continue;
+    if (opts.timed) std::this_thread::sleep_until(start + std::chrono::nanoseconds(r.t_ns));
+    if (r.op == IoTraceOp::Sync) {
+      if (!opts.sync && fdatasync(fd) != 0) {
+        close(fd);
+        throw std::runtime_error("replay_io_trace: fdatasync failed on " + target);
+      }
+      ++res.syncs;
+      continue;
+    }
+    const off_t off = static_cast<off_t>(base[r.tree] + r.offset());
+    const auto t0 = std::chrono::steady_clock::now();
+    const ssize_t n = r.op == IoTraceOp::Write ? pwrite(fd, buf.data(), r.bytes, off) : pread(fd, buf.data(), r.bytes, off);
+    const auto t1 = std::chrono::steady_clock::now();
+    if (n != static_cast<ssize_t>(r.bytes)) {
+      close(fd);
+      throw std::runtime_error("replay_io_trace: short I/O on " + target);
+    }
+    res.latency_us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+    if (r.op == IoTraceOp::Write) {
+      ++res.writes;
+      res.bytes_written += r.bytes;
+    } else {
+      ++res.reads;
+      res.bytes_read += r.bytes;
+    }
+  }
+  res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  close(fd);
+  return res;
+}
+
+// ---------------------------------------------------------------------------
+// Binary logical traces
+// ---------------------------------------------------------------------------
+
+void write_logical_trace(const std::string& path, const std::vector<LogicalOp>& ops) {
+  std::vector<uint8_t> out(16 + ops.size() * kLogicalRecordSize);
+  std::memcpy(out.data(), kLogicalMagic, 8);
+  put_le(out.data() + 8, ops.size(), 8);
+  uint8_t* p = out.data() + 16;
+  for (const LogicalOp& op : ops) {
+    if (op.r > UINT32_MAX) throw std::runtime_error("write_logical_trace: range too long");
+    put_le(p, op.a, 8);
+    put_le(p + 8, op.r, 4);
+    put_le(p + 12, op.is_write ? 1 : 0, 4);
+    p += kLogicalRecordSize;
+  }
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) throw std::runtime_error("write_logical_trace: cannot open " + path);
+  const bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+  if (std::fclose(f) != 0 || !ok) throw std::runtime_error("write_logical_trace: write failed: " + path);
+}
+
+bool MappedLogicalTrace::is_binary(const std::string& path) { return has_magic(path, kLogicalMagic); }
+
+MappedLogicalTrace::MappedLogicalTrace(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("MappedLogicalTrace: cannot open " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 16) {
+    close(fd);
+    throw std::runtime_error("MappedLogicalTrace: not a logical trace: " + path);
+  }
+  len_ = static_cast<size_t>(st.st_size);
+  void* m = mmap(nullptr, len_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) throw std::runtime_error("MappedLogicalTrace: mmap failed: " + path);
+  data_ = static_cast<const uint8_t*>(m);
+  madvise(m, len_, MADV_SEQUENTIAL);
+  n_ = get_le(data_ + 8, 8);
+  if (std::memcmp(data_, kLogicalMagic, 8) != 0 || (len_ - 16) / kLogicalRecordSize < n_) {
+    munmap(m, len_);
+    throw std::runtime_error("MappedLogicalTrace: bad header or truncated: " + path);
+  }
+}
+
+MappedLogicalTrace::~MappedLogicalTrace() {
+  if (data_) munmap(const_cast<uint8_t*>(data_), len_);
+}
+
+LogicalOp MappedLogicalTrace::operator[](uint64_t i) const {
+  const uint8_t* p = data_ + 16 + i * kLogicalRecordSize;
+  return LogicalOp{get_le(p, 8), get_le(p + 8, 4), (get_le(p + 12, 4) & 1) != 0};
+}
+
+}  // namespace roram
@@ -1,11 +1,31 @@
+#include "roram/basic_sub_oram.hpp"
 #include "roram/block.hpp"
+#include "roram/durability.hpp"
+#include "roram/frontend.hpp"
+#include "roram/header_scan.hpp"
+#include "roram/histogram.hpp"
+#include "roram/huge_pages.hpp"
+#include "roram/memory_usage.hpp"
 #include "roram/path_oram.hpp"
 #include "roram/position_map.hpp"
+#include "roram/read_ahead.hpp"
+#include "roram/remote_storage.hpp"
+#include "roram/results.hpp"
+#include "roram/ring_oram.hpp"
 #include "roram/roram.hpp"
+#include "roram/sharded_roram.hpp"
+#include "roram/stats.hpp"
+#include "roram/trace.hpp"
 #include "roram/crypto.hpp"
 #include "roram/storage.hpp"
 #include "roram/types.hpp"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <csignal>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -13,8 +33,10 @@
 #include <functional>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 static std::vector<uint8_t> make_data(size_t n, uint8_t seed) {
@@ -33,6 +55,45 @@ static void expect_throw(const std::function<void()>& fn) {
   assert(threw);
 }
 
+// Keyed XOR stream with a checksum tag: a stand-in cipher for tests that must see bytes
+// sealed, and opened only under the same key. A zero tag marks a never-written bucket of a
+// fresh tree file, which reads as zeros as under NoOpCrypto.
+class XorCrypto : public roram::CryptoProvider {
+ public:
+  explicit XorCrypto(uint64_t key) : key_(key) {}
+  size_t tag_size() const override { return 8; }
+  void encrypt(uint8_t* data, size_t len, uint64_t block_id, uint8_t* tag_out) override {
+    const uint64_t sum = checksum(data, len, block_id);
+    apply(data, len, block_id);
+    std::memcpy(tag_out, &sum, sizeof(sum));
+  }
+  void decrypt(uint8_t* data, size_t len, uint64_t block_id, const uint8_t* tag_in) override {
+    uint64_t sum;
+    std::memcpy(&sum, tag_in, sizeof(sum));
+    if (sum == 0) return;
+    apply(data, len, block_id);
+    if (sum != checksum(data, len, block_id)) throw std::runtime_error("XorCrypto: bad tag");
+  }
+  uint64_t random_path(uint64_t N) override { return rng_.random_path(N); }
+
+ private:
+  uint64_t key_;
+  roram::NoOpCrypto rng_;
+
+  void apply(uint8_t* data, size_t len, uint64_t block_id) const {
+    uint64_t s = key_ ^ (block_id * 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < len; ++i) {
+      s = s * 6364136223846793005ULL + 1442695040888963407ULL;
+      data[i] ^= static_cast<uint8_t>(s >> 56);
+    }
+  }
+  uint64_t checksum(const uint8_t* data, size_t len, uint64_t block_id) const {
+    uint64_t h = key_ ^ block_id;
+    for (size_t i = 0; i < len; ++i) h = (h ^ data[i]) * 0x100000001b3ULL;
+    return h;
+  }
+};
+
 static bool eq_block(const roram::Block& a, const roram::Block& b) {
   return a.a == b.a && a.data == b.data && a.p == b.p;
 }
@@ -85,6 +146,24 @@ static void test_position_map_basic() {
   assert(pm.query(1000) == 0);
 }
 
+static void test_position_map_packed() {
+  const uint64_t N = 1ULL << 20;
+  roram::PositionMap pm(N, 0);
+  assert(pm.bits_per_entry() == 20);
+  assert(pm.client_bytes() * 3 <= N * sizeof(uint64_t));
+  uint64_t rng = 0x9e3779b97f4a7c15ULL;
+  std::vector<uint64_t> ref(4096, 0);
+  for (uint64_t i = 0; i < ref.size(); ++i) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    ref[i] = rng % N;
+    pm.update(i, ref[i]);  // consecutive 20-bit fields straddle word boundaries
+  }
+  pm.update(N - 1, N - 1);
+  for (uint64_t i = 0; i < ref.size(); ++i) assert(pm.query(i) == ref[i]);
+  assert(pm.query(N - 1) == N - 1);
+  expect_throw([&]() { pm.update(5, N * 2); });
+}
+
 static void test_memory_storage_roundtrip() {
   roram::Params p(32, 8, 4, 64);
   roram::MemoryStorage storage(p);
@@ -169,6 +248,70 @@ static void test_stash_resilience_hot_blocks() {
   assert(poram.Access(21, "read") == cold);
 }
 
+static void test_storage_io_stats() {
+  roram::Params params(16, 1, 4, 32);
+  roram::MemoryStorage storage(params);
+  const uint64_t bs = storage.bucket_byte_size();
+  std::vector<roram::Bucket> four(4, roram::Bucket(params.Z, params.B, params.ell + 1));
+  std::vector<roram::Bucket> out;
+  storage.write_buckets(2, 0, four);       // bytes [3bs, 7bs): first request, no seek
+  storage.read_buckets(3, 0, 2, out);      // starts at 7bs: sequential, run of 6
+  storage.read_buckets(2, 1, 1, out);      // back to 4bs: one seek of 5 buckets
+  const roram::IoStats& io = storage.io_stats();
+  assert(io.levels.size() == 4);
+  const roram::LevelIoStats& l2 = io.levels[2];
+  assert(l2.write_requests == 1 && l2.buckets_written == 4 && l2.bytes_written == 4 * bs);
+  assert(l2.read_requests == 1 && l2.buckets_read == 1 && l2.seeks == 1 && l2.seek_distance == 5 * bs);
+  assert(l2.max_run_buckets == 4);
+  assert(io.levels[3].buckets_read == 2 && io.levels[3].seeks == 0 && io.levels[3].max_run_buckets == 6);
+  assert(io.total().seeks == storage.get_seek_count() && io.total().bytes_read == 3 * bs);
+  storage.reset_io_stats();
+  assert(storage.io_stats().levels.empty() && storage.get_seek_count() == 0);
+}
+
+static void test_io_trace_record_and_replay() {
+  const std::string path = "/tmp/roram_tests_io.trace";
+  const std::string target = "/tmp/roram_tests_io.img";
+  roram::Params params(64, 1, 4, 32);
+  {
+    auto writer = std::make_shared<roram::IoTraceWriter>(path);
+    roram::PathORAM ram(params, std::make_unique<roram::NoOpCrypto>(),
+                        roram::tracing_storage_factory(roram::local_storage_factory(true, ""), writer, "path"));
+    auto w = make_data(params.B, 9);
+    ram.Access(5, "write", &w);
+    assert(ram.Access(5, "read") == w);  // decorator is transparent
+    assert(writer->records() == 4 * static_cast<uint64_t>(params.h + 1));  // one extent per level, 2 reads + 2 writes
+  }
+  roram::IoTrace trace = roram::read_io_trace(path);
+  assert(trace.tree_names.size() == 1 && trace.tree_names[0] == "path");
+  assert(trace.records.size() == 4 * static_cast<size_t>(params.h + 1));
+  assert(trace.records[0].op == roram::IoTraceOp::Read && trace.records[0].level == 0 && trace.records[0].count == 1);
+  for (size_t k = 1; k < trace.records.size(); ++k) assert(trace.records[k].t_ns >= trace.records[k - 1].t_ns);
+  roram::IoReplayResult res = roram::replay_io_trace(trace, target, roram::IoReplayOptions());
+  assert(res.reads == 2 * static_cast<uint64_t>(params.h + 1) && res.writes == res.reads);
+  assert(res.latency_us.size() == trace.records.size());
+  expect_throw([&] { roram::read_io_trace(target); });
+  {
+    // A corrupt level byte is rejected rather than shifted: magic, Name record, "path" padded to 8.
+    std::FILE* f = std::fopen(path.c_str(), "r+b");
+    std::fseek(f, 8 + 32 + 8 + 30, SEEK_SET);
+    std::fputc(64, f);
+    std::fclose(f);
+    expect_throw([&] { roram::read_io_trace(path); });
+  }
+
+  // Binary logical traces round-trip through mmap.
+  std::vector<roram::LogicalOp> ops{{0, 8, false}, {100, 16, true}, {1ULL << 40, 1, false}};
+  roram::write_logical_trace(path, ops);
+  assert(roram::MappedLogicalTrace::is_binary(path));
+  roram::MappedLogicalTrace mapped(path);
+  assert(mapped.size() == ops.size());
+  for (size_t k = 0; k < ops.size(); ++k)
+    assert(mapped[k].a == ops[k].a && mapped[k].r == ops[k].r && mapped[k].is_write == ops[k].is_write);
+  std::remove(path.c_str());
+  std::remove(target.c_str());
+}
+
 static void test_backend_parity() {
   roram::Params params(32, 1, 4, 64);
   std::string path = "/tmp/roram_tests_backend.bin";
@@ -192,6 +335,58 @@ static void test_backend_parity() {
   std::remove(path.c_str());
 }
 
+static void test_path_oram_recursive_position_map() {
+  roram::Params params(1024, 1, 4, 32);
+  roram::PathORAM flat(params, std::make_unique<roram::NoOpCrypto>());
+  // 1024 x 10-bit entries -> 41 blocks of 25; their 6-bit map (32 bytes) recurses once more.
+  roram::PathORAM ram(params, std::make_unique<roram::NoOpCrypto>(), true, "", false, 16, 32);
+  assert(ram.recursion_depth() == 2);
+  assert(ram.position_map_bytes() < flat.position_map_bytes());
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  for (uint64_t op = 0; op < 600; ++op) {
+    uint64_t a = (op * 131 + op / 7) % params.N;
+    uint64_t before = ram.position_map_accesses();
+    if (op % 2 == 0) {
+      ref[a] = make_data(params.B, static_cast<uint8_t>(op));
+      ram.Access(a, "write", &ref[a]);
+    } else {
+      assert(ram.Access(a, "read") == ref[a]);
+    }
+    // One read-modify-write per recursion level.
+    assert(ram.position_map_accesses() - before == static_cast<uint64_t>(ram.recursion_depth()));
+  }
+  expect_throw([&] { roram::PathORAM bad(params, std::make_unique<roram::NoOpCrypto>(), true, "", false, 16, 4); });
+}
+
+static void test_path_oram_access_batch() {
+  roram::Params params(512, 1, 4, 32);
+  roram::PathORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  for (uint64_t op = 0; op < 60; ++op) {
+    const uint64_t r = 1 + (op * 5) % 24;
+    const uint64_t a = (op * 67) % (params.N - r);
+    std::vector<uint64_t> ids;
+    for (uint64_t k = 0; k < r; ++k) ids.push_back(a + k);
+    if (op % 3 == 0) ids.push_back(a);  // repeated id in one batch
+    if (op % 2 == 0) {
+      std::vector<std::vector<uint8_t>> D;
+      for (size_t k = 0; k < ids.size(); ++k) D.push_back(make_data(params.B, static_cast<uint8_t>(op * 3 + k)));
+      auto out = ram.AccessBatch(ids, "write", &D);
+      for (size_t k = 0; k < ids.size(); ++k) {
+        ref[ids[k]] = D[k];
+        assert(out[k] == D[k]);
+      }
+    } else {
+      auto out = ram.AccessBatch(ids, "read");
+      for (size_t k = 0; k < ids.size(); ++k) assert(out[k] == ref[ids[k]]);
+    }
+    // Single accesses see the batched writes.
+    assert(ram.Access(a + r / 2, "read") == ref[a + r / 2]);
+  }
+  expect_throw([&] { ram.AccessBatch({params.N}, "read"); });
+  expect_throw([&] { ram.AccessBatch({1, 2}, "write", nullptr); });
+}
+
 static void test_path_oram_errors() {
   roram::Params params(16, 1, 4, 32);
   auto crypto = std::make_unique<roram::NoOpCrypto>();
@@ -289,10 +484,911 @@ static void test_roram_reference_model_random() {
   }
 }
 
+static void test_roram_outsourced_position_map() {
+  roram::Params params(64, 8, 4, 32);
+  auto crypto_a = std::make_unique<roram::NoOpCrypto>();
+  auto crypto_b = std::make_unique<roram::NoOpCrypto>();
+  roram::rORAM local(params, std::move(crypto_a), true);
+  roram::rORAM remote(params, std::move(crypto_b), true, "", false, 16);
+  assert(remote.position_map_client_bytes() < local.position_map_client_bytes());
+
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  uint64_t rng = 0x0123456789abcdefULL;
+  for (int op = 0; op < 80; ++op) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    uint64_t r = 1ULL << (rng % 4);
+    uint64_t a = (rng >> 8) % (params.N - r);
+    if ((rng >> 20) % 2 == 0) {
+      std::vector<std::vector<uint8_t>> D(r);
+      for (uint64_t k = 0; k < r; ++k) {
+        D[k] = make_data(params.B, static_cast<uint8_t>(op + k));
+        ref[a + k] = D[k];
+      }
+      remote.Access(a, r, "write", &D);
+    } else {
+      auto out = remote.Access(a, r, "read");
+      for (uint64_t k = 0; k < r; ++k) assert(out[k] == ref[a + k]);
+    }
+  }
+  assert(remote.position_map_accesses() > 0);
+  assert(local.position_map_accesses() == 0);
+}
+
+static void test_roram_outsourced_map_accesses_oblivious() {
+  // Same range sizes and ops, different addresses: one sequence keeps hitting the start
+  // of the array (full, clustered buckets), the other roams it, the last range included.
+  roram::Params params(64, 8, 4, 32);
+  roram::rORAM hot(params, std::make_unique<roram::NoOpCrypto>(), true, "", false, 4);
+  roram::rORAM spread(params, std::make_unique<roram::NoOpCrypto>(), true, "", false, 4);
+  uint64_t rng = 0x9e3779b97f4a7c15ULL;
+  for (int op = 0; op < 120; ++op) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    const uint64_t r = 1ULL << (rng % 4);
+    const uint64_t a_hot = (op % 3) * r % 8;
+    const uint64_t a_spread = (rng >> 8) % (params.N - r + 1);
+    if (op % 2 == 0) {
+      std::vector<std::vector<uint8_t>> D(r, make_data(params.B, static_cast<uint8_t>(op)));
+      hot.Access(a_hot, r, "write", &D);
+      spread.Access(a_spread, r, "write", &D);
+    } else {
+      hot.Access(a_hot, r, "read");
+      spread.Access(a_spread, r, "read");
+    }
+    assert(hot.position_map_accesses() == spread.position_map_accesses());
+  }
+  assert(hot.position_map_accesses() > 0);
+}
+
+static void test_roram_access_batch() {
+  roram::Params params(128, 16, 4, 32);
+  auto crypto = std::make_unique<roram::NoOpCrypto>();
+  roram::rORAM ram(params, std::move(crypto), true);
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  uint64_t rng = 0xfeedfacecafebeefULL;
+  for (int round = 0; round < 30; ++round) {
+    std::vector<roram::RangeRequest> reqs;
+    for (int n = 0; n < 4; ++n) {
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      uint64_t r = 1 + rng % params.L;
+      uint64_t a = (rng >> 16) % (params.N - r + 1);
+      roram::RangeRequest q{a, r, ((rng >> 40) % 2) ? "write" : "read", {}};
+      if (q.op == "write")
+        for (uint64_t k = 0; k < r; ++k) q.data.push_back(make_data(params.B, static_cast<uint8_t>(round * 4 + n + k)));
+      reqs.push_back(q);
+    }
+    auto out = ram.access_batch(reqs);
+    assert(out.size() == reqs.size());
+    // Requests apply in order, so a read sees every earlier write in the same batch.
+    for (size_t n = 0; n < reqs.size(); ++n) {
+      const auto& q = reqs[n];
+      if (q.op == "write") {
+        for (uint64_t k = 0; k < q.r; ++k) ref[q.a + k] = q.data[k];
+        assert(out[n].empty());
+      } else {
+        assert(out[n].size() == q.r);
+        for (uint64_t k = 0; k < q.r; ++k) assert(out[n][k] == ref[q.a + k]);
+      }
+    }
+  }
+  for (uint64_t a = 0; a < params.N; a += params.L) {
+    auto out = ram.Access(a, params.L, "read");
+    for (uint64_t k = 0; k < params.L; ++k) assert(out[k] == ref[a + k]);
+  }
+  expect_throw([&]() { ram.access_batch({roram::RangeRequest{0, 1, "read", {}}, roram::RangeRequest{0, 17, "read", {}}}); });
+}
+
+static void test_frontend_concurrent_clients() {
+  roram::Params params(256, 16, 4, 32);
+  auto ram = std::make_unique<roram::rORAM>(params, std::make_unique<roram::NoOpCrypto>(), true);
+  roram::FrontendOptions opts;
+  opts.max_batch = 4;
+  opts.max_per_client = 1;
+  roram::ORAMFrontend fe(std::move(ram), opts);
+
+  // Each client owns a disjoint 64-block region and checks its own writes.
+  const int clients = 4;
+  std::vector<std::thread> threads;
+  std::vector<int> failures(clients, 0);
+  for (int c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c]() {
+      const uint64_t base = static_cast<uint64_t>(c) * 64;
+      std::vector<std::vector<uint8_t>> ref(64, std::vector<uint8_t>(params.B, 0));
+      for (int op = 0; op < 20; ++op) {
+        uint64_t r = 1 + (op * 5 + c) % 16;
+        uint64_t a = (op * 11 + c * 3) % (64 - r + 1);
+        if (op % 2 == 0) {
+          std::vector<std::vector<uint8_t>> D(r);
+          for (uint64_t k = 0; k < r; ++k) {
+            D[k] = make_data(params.B, static_cast<uint8_t>(c * 50 + op + k));
+            ref[a + k] = D[k];
+          }
+          fe.Access(static_cast<uint64_t>(c), base + a, r, "write", &D);
+        } else {
+          auto out = fe.Access(static_cast<uint64_t>(c), base + a, r, "read");
+          for (uint64_t k = 0; k < r; ++k)
+            if (out[k] != ref[a + k]) ++failures[static_cast<size_t>(c)];
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  for (int f : failures) assert(f == 0);
+  fe.drain();
+  assert(fe.requests_served() == static_cast<uint64_t>(clients * 20));
+  assert(fe.batches_served() <= fe.requests_served());
+  expect_throw([&]() { fe.submit(0, roram::RangeRequest{250, 10, "read", {}}); });
+}
+
+static void test_roram_background_eviction() {
+  roram::Params params(128, 16, 4, 32);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), true);
+  ram.enable_background_eviction(64);
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  uint64_t rng = 0x1234abcd5678ef90ULL;
+  for (int op = 0; op < 200; ++op) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    uint64_t r = 1 + rng % params.L;
+    uint64_t a = (rng >> 16) % (params.N - r + 1);
+    if ((rng >> 40) % 2 == 0) {
+      std::vector<std::vector<uint8_t>> D(r);
+      for (uint64_t k = 0; k < r; ++k) {
+        D[k] = make_data(params.B, static_cast<uint8_t>(op + k));
+        ref[a + k] = D[k];
+      }
+      ram.Access(a, r, "write", &D);
+    } else {
+      auto out = ram.Access(a, r, "read");
+      for (uint64_t k = 0; k < r; ++k) assert(out[k] == ref[a + k]);
+    }
+  }
+  ram.drain_evictions();
+  for (uint64_t a = 0; a < params.N; a += params.L) {
+    auto out = ram.Access(a, params.L, "read");
+    for (uint64_t k = 0; k < params.L; ++k) assert(out[k] == ref[a + k]);
+  }
+}
+
+static void test_sharded_roram_straddling_ranges() {
+  // N=200, 3 shards of L=16 -> shard length 80, last shard holds only 40 blocks.
+  roram::Params params(200, 16, 4, 32);
+  roram::ShardedRORAM ram(params, 3, [](int) { return std::make_unique<roram::NoOpCrypto>(); });
+  assert(ram.num_shards() == 3);
+  assert(ram.shard_length() % params.L == 0);
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  uint64_t rng = 0x9e3779b97f4a7c15ULL;
+  for (int op = 0; op < 150; ++op) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    uint64_t r = 1 + rng % params.L;
+    // Every third op is forced across the first shard boundary.
+    uint64_t a = op % 3 == 0 ? ram.shard_length() - r / 2 - 1 : (rng >> 16) % (params.N - r + 1);
+    if ((rng >> 40) % 2 == 0) {
+      std::vector<std::vector<uint8_t>> D(r);
+      for (uint64_t k = 0; k < r; ++k) {
+        D[k] = make_data(params.B, static_cast<uint8_t>(op + k));
+        ref[a + k] = D[k];
+      }
+      ram.Access(a, r, "write", &D);
+    } else {
+      auto out = ram.Access(a, r, "read");
+      assert(out.size() == r);
+      for (uint64_t k = 0; k < r; ++k) assert(out[k] == ref[a + k]);
+    }
+  }
+  ram.drain();
+  expect_throw([&]() { ram.submit(0, roram::RangeRequest{190, 11, "read", {}}); });
+  expect_throw([&]() { ram.submit(0, roram::RangeRequest{0, 17, "read", {}}); });
+  assert(ram.submit(0, roram::RangeRequest{params.N, 0, "read", {}}).get().empty());
+  expect_throw([&]() { ram.submit(0, roram::RangeRequest{params.N + 1, 0, "read", {}}); });
+  expect_throw([&]() { ram.submit(0, roram::RangeRequest{UINT64_MAX, 2, "read", {}}); });
+}
+
+static void test_remote_storage_roundtrips() {
+  const std::string dir = "/tmp/roram_remote_test";
+  std::system(("mkdir -p " + dir).c_str());
+  const std::string addr = "unix:" + dir + "/sock";
+  roram::StorageServer server(addr, dir);
+  server.start();
+
+  roram::Params params(128, 16, 4, 32);
+  std::vector<roram::RemoteStorage*> links;
+  roram::StorageFactory remote = [&](const roram::Params& p, const std::string& name, roram::CryptoProvider* c) {
+    auto s = std::make_unique<roram::RemoteStorage>(p, addr, "r" + name, c);
+    links.push_back(s.get());
+    return std::unique_ptr<roram::StorageBackend>(std::move(s));
+  };
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), remote);
+    assert(links.size() == static_cast<size_t>(params.ell + 1));
+    std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+    for (int op = 0; op < 40; ++op) {
+      uint64_t r = 1 + (op * 7) % params.L;
+      uint64_t a = (op * 29) % (params.N - r + 1);
+      uint64_t before = 0, after = 0;
+      for (auto* l : links) before += l->round_trips();
+      if (op % 2 == 0) {
+        std::vector<std::vector<uint8_t>> D(r);
+        for (uint64_t k = 0; k < r; ++k) {
+          D[k] = make_data(params.B, static_cast<uint8_t>(op + k));
+          ref[a + k] = D[k];
+        }
+        ram.Access(a, r, "write", &D);
+      } else {
+        auto out = ram.Access(a, r, "read");
+        for (uint64_t k = 0; k < r; ++k) assert(out[k] == ref[a + k]);
+      }
+      for (auto* l : links) after += l->round_trips();
+      // Both ReadRanges in one read, plus one read and one (pipelined) write per tree for
+      // eviction, independent of the tree height.
+      assert(after - before <= 1 + 2 * static_cast<uint64_t>(params.ell + 1));
+    }
+    assert(ram.get_seek_count() > 0);
+  }
+  expect_throw([&]() { roram::RemoteStorage bad(params, addr, "../escape"); });
+  expect_throw([&]() { roram::RemoteStorage bad(params, "bogus:addr", "x"); });
+  {
+    // A frame claiming 2^64-1 bytes gets an error reply and a closed connection; the
+    // server keeps serving.
+    const int fd = roram::connect_storage_address(addr);
+    uint8_t frame[9];
+    std::memset(frame, 0xff, sizeof(frame));
+    frame[0] = static_cast<uint8_t>(roram::StorageOp::Read);
+    assert(::send(fd, frame, sizeof(frame), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(frame)));
+    uint8_t status = 0;
+    assert(::recv(fd, &status, 1, MSG_WAITALL) == 1 && status == 1);
+    ::close(fd);
+    roram::RemoteStorage after(params, addr, "after_bad_frame");
+    std::vector<roram::Bucket> root;
+    after.read_buckets(0, 0, 1, root);
+    assert(root.size() == 1);
+  }
+  server.stop();
+  assert(server.requests_served() > 0);
+}
+
+static void test_roram_scan_beyond_L() {
+  roram::Params params(200, 16, 4, 32);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), true);
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  for (uint64_t a = 0; a < params.N; a += params.L) {
+    const uint64_t r = std::min<uint64_t>(params.L, params.N - a);
+    std::vector<std::vector<uint8_t>> D(r);
+    for (uint64_t k = 0; k < r; ++k) {
+      D[k] = make_data(params.B, static_cast<uint8_t>(a + k));
+      ref[a + k] = D[k];
+    }
+    ram.Access(a, r, "write", &D);
+  }
+  for (int bg = 0; bg < 2; ++bg) {
+    if (bg) ram.enable_background_eviction(64);
+    // Unaligned start and end, many times L: blocks arrive once each, in order.
+    uint64_t expect = 5;
+    const uint64_t accesses = ram.scan(5, 190, [&](uint64_t addr, const std::vector<uint8_t>& d) {
+      assert(addr == expect);
+      assert(d == ref[addr]);
+      ++expect;
+    });
+    assert(expect == 195);
+    // Each access delivers up to two L-ranges.
+    assert(accesses <= 190 / (2 * params.L) + 2);
+  }
+  ram.drain_evictions();
+  auto out = ram.Access(100, 16, "read");
+  for (uint64_t k = 0; k < 16; ++k) assert(out[k] == ref[100 + k]);
+  assert(ram.scan(10, 0, [](uint64_t, const std::vector<uint8_t>&) { assert(false); }) == 0);
+  expect_throw([&]() { ram.scan(150, 51, [](uint64_t, const std::vector<uint8_t>&) {}); });
+}
+
+static void test_latency_histogram() {
+  roram::LatencyHistogram h;
+  assert(h.count() == 0 && h.value_at(0.99) == 0);
+  for (uint64_t v = 1; v <= 100; ++v) h.record(v);  // exact below 128
+  assert(h.count() == 100 && h.min() == 1 && h.max() == 100);
+  assert(h.value_at(0.5) == 50 && h.value_at(0.99) == 99 && h.value_at(1.0) == 100);
+  roram::LatencyHistogram big;
+  big.record(1000000, 999);
+  big.record(50000000);
+  // Log buckets: within 1/64 of the recorded value, and max is exact.
+  const uint64_t p50 = big.value_at(0.5);
+  assert(p50 >= 1000000 && p50 <= 1000000 + 1000000 / 64);
+  assert(big.value_at(0.999) == p50 && big.value_at(1.0) == 50000000 && big.max() == 50000000);
+  h += big;
+  assert(h.count() == 1100 && h.min() == 1 && h.max() == 50000000);
+  uint64_t total = 0;
+  for (const auto& b : h.buckets()) {
+    assert(b.lo <= b.hi);
+    total += b.count;
+  }
+  assert(total == h.count());
+}
+
+static void test_results_json_roundtrip() {
+  roram::ResultSet rs;
+  rs.command = "compare";
+  rs.git_rev = roram::git_revision();
+  rs.backend = "memory";
+  rs.crypto = "noop";
+  rs.config = {{"trials", "3"}, {"note", "quote \" and\\slash"}};
+  roram::ResultRecord rec("rORAM", "r=8", roram::Params(256, 16, 4, 4096));
+  rec.metrics = {{"mean_ms", 1.25}, {"qps", 800.0}};
+  rec.samples_ms = {1.0, 1.5, 1.25};
+  rs.results.push_back(rec);
+  rs.results.emplace_back("PathORAM", "r=8", roram::Params(256, 1, 4, 4096));
+  const std::string path = "/tmp/roram_results_test.json";
+  roram::write_results_json(path, rs);
+  const roram::ResultSet back = roram::read_results_json(path);
+  assert(back.command == "compare" && back.git_rev == rs.git_rev && back.backend == "memory");
+  assert(back.config.size() == 2);
+  const roram::ResultRecord* r = back.find("rORAM", "r=8");
+  assert(r && r->params.L == 16 && r->params.ell == 4 && r->params.h == 8);
+  assert(r->metric("mean_ms") && *r->metric("mean_ms") == 1.25 && !r->metric("p99_ms"));
+  assert(r->samples_ms == rec.samples_ms);
+  assert(back.find("PathORAM", "r=8")->samples_ms.empty() && !back.find("RingORAM", "r=8"));
+
+  // \u escapes: hex parsed by hand, surrogate pairs combined, malformed or lone ones rejected.
+  std::string text;
+  {
+    std::ifstream in(path);
+    text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  const size_t at = text.find("\"compare\"");
+  assert(at != std::string::npos);
+  auto with_command = [&](const std::string& quoted) {
+    std::ofstream out(path);
+    out << text.substr(0, at) << quoted << text.substr(at + 9);
+  };
+  with_command("\"\\u00e9\\uD83D\\uDE00\"");
+  assert(roram::read_results_json(path).command == "\xC3\xA9\xF0\x9F\x98\x80");
+  for (const char* bad : {"\"\\u00zz\"", "\"\\uD83D\"", "\"\\uDE00\"", "\"\\uD83D\\u0041\"", "\"\\u12\""}) {
+    with_command(bad);
+    expect_throw([&]() { roram::read_results_json(path); });
+  }
+  {
+    std::ofstream bad(path);
+    bad << "{\"schema\": \"other\"}";
+  }
+  expect_throw([&]() { roram::read_results_json(path); });
+  std::remove(path.c_str());
+}
+
+static void test_memory_usage() {
+  roram::Params params(256, 8, 4, 64);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+  ram.reset_peak_memory();
+  for (uint64_t a = 0; a + 8 <= 64; a += 8) ram.Access(a, 8, "read");
+  const roram::MemoryUsage now = ram.memory_usage();
+  const roram::MemoryUsage peak = ram.peak_memory_usage();
+  assert(now.trees.size() == static_cast<size_t>(params.ell + 1));
+  assert(peak.trees.size() == now.trees.size());
+  assert(now.position_map > 0 && now.evict_buffers == 0);
+  assert(peak.total() >= now.total() && peak.stashed >= now.stashed && peak.evict_buffers > 0);
+
+  roram::PathORAM poram(roram::Params(256, 1, 4, 64), std::make_unique<roram::NoOpCrypto>(), true);
+  poram.Access(5, "read");
+  assert(poram.peak_memory_usage().stashed > 0 && poram.peak_memory_usage().evict_buffers > 0);
+  poram.reset_peak_memory();
+  assert(poram.peak_memory_usage().total() == poram.memory_usage().total());
+
+  const roram::MemoryUsage proj = roram::project_roram_memory(params);
+  assert(proj.trees.size() == static_cast<size_t>(params.ell + 1));
+  uint64_t stash = 0, evict = 0;
+  for (const auto& t : proj.trees) {
+    assert(t.position_map > 0 && t.stashed > 0 && t.scratch > 0);
+    stash += t.stash_payload;
+    evict = std::max(evict, t.evict_buffers);
+  }
+  assert(stash == proj.stash_payload && evict == proj.evict_buffers);
+  assert(roram::eviction_buckets(1, params.h) == static_cast<uint64_t>(params.h) + 1);
+
+  // Concurrent evictions hold every tree's buffers at once.
+  roram::rORAM par(params, std::make_unique<roram::NoOpCrypto>());
+  par.set_parallel_evict(true);
+  for (uint64_t a = 0; a + 8 <= 64; a += 8) par.Access(a, 8, "read");
+  const roram::MemoryUsage par_peak = par.peak_memory_usage();
+  uint64_t par_sum = 0, par_max = 0;
+  for (const auto& t : par_peak.trees) {
+    par_sum += t.evict_buffers;
+    par_max = std::max(par_max, t.evict_buffers);
+  }
+  assert(par_peak.evict_buffers == par_sum && par_sum > par_max);
+  assert(peak.evict_buffers < par_peak.evict_buffers);
+  const roram::MemoryUsage par_proj = roram::project_roram_memory(params, 0, 64, true);
+  assert(par_proj.evict_buffers == static_cast<uint64_t>(params.ell + 1) * proj.evict_buffers);
+  assert(roram::project_roram_memory(params, 16, 64, true).evict_buffers == proj.evict_buffers);
+}
+
+static void test_durable_commits() {
+  roram::NoOpCrypto noop;
+  const std::string prefix = "/tmp/roram_tests_durable";
+  const std::string wal = prefix + ".wal";
+  std::remove(wal.c_str());
+  roram::Params params(64, 4, 4, 32);
+  auto w = make_data(params.B, 3);
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), false, prefix);
+    expect_throw([&] { ram.set_durability(roram::Durability::Access); });
+    ram.set_durability(roram::Durability::Access, wal);
+    assert(ram.commits() == 1);  // base snapshot
+    std::vector<std::vector<uint8_t>> d(2, w);
+    ram.Access(8, 2, "write", &d);
+    ram.Access(8, 2, "read");
+    assert(ram.commits() == 3);
+
+    ram.set_durability(roram::Durability::Group, wal, 4);  // restarts the log
+    assert(ram.commits() == 1);
+    for (int k = 0; k < 3; ++k) ram.Access(0, 1, "read");
+    assert(ram.commits() == 1);
+    ram.Access(0, 1, "read");  // fourth access fills the group
+    assert(ram.commits() == 2);
+    ram.Access(0, 1, "read");
+    ram.commit();
+    ram.commit();  // nothing pending
+    assert(ram.commits() == 3);
+    assert(ram.Access(8, 2, "read")[1] == w);
+  }  // the destructor commits the last read
+
+  std::vector<roram::ClientStateRecord> log = roram::ClientStateLog::read(wal, params, &noop);
+  assert(log.size() == 4);
+  assert(log[0].snapshot && log[0].seq == 2 && log[0].accesses == 0);  // after the two access-mode commits
+  for (size_t k = 0; k < log.size(); ++k) {
+    assert(log[k].seq == log[0].seq + k && log[k].trees.size() == static_cast<size_t>(params.ell + 1));
+    if (k == 0) continue;
+    assert(!log[k].snapshot && log[k].cnt > log[k - 1].cnt && log[k].version > log[k - 1].version);
+    size_t remapped = 0, buckets = 0;
+    for (const roram::TreeState& t : log[k].trees) {
+      remapped += t.pm_updates.size();
+      buckets += t.buckets.size();
+      assert(t.bucket_ids.size() == t.buckets.size() && std::is_sorted(t.bucket_ids.begin(), t.bucket_ids.end()));
+    }
+    assert(remapped > 0 && buckets > 0);
+  }
+  assert(log[1].accesses == 4 && log[2].accesses == 1 && log[3].accesses == 1);
+  {
+    std::ofstream torn(wal, std::ios::app | std::ios::binary);
+    torn << "partial record";
+  }
+  assert(roram::ClientStateLog::read(wal, params, &noop).size() == log.size());
+  assert(roram::parse_durability("group") == roram::Durability::Group);
+  expect_throw([] { roram::parse_durability("fsync"); });
+
+  // Outsourced position maps are not logged, and memory trees have nothing to recover.
+  roram::rORAM outsourced(params, std::make_unique<roram::NoOpCrypto>(), false, prefix, false, 4);
+  expect_throw([&] { outsourced.set_durability(roram::Durability::Access, wal); });
+  roram::rORAM memory(params, std::make_unique<roram::NoOpCrypto>());
+  if (memory.specialized_trees() > 0) expect_throw([&] { memory.set_durability(roram::Durability::Access, wal); });
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) {
+    std::remove((prefix + "_tree" + std::to_string(i)).c_str());
+    std::remove((prefix + "_pm" + std::to_string(i)).c_str());
+  }
+}
+
+// A crash is an rORAM abandoned without its destructor (which would commit): recovery on
+// a fresh one over the same files must see every committed write and nothing later.
+static void test_durable_recovery() {
+  roram::NoOpCrypto noop;
+  const std::string prefix = "/tmp/roram_tests_recover";
+  const std::string wal = prefix + ".wal";
+  roram::Params params(64, 4, 4, 32);
+  const roram::StorageFactory storage = roram::local_storage_factory(false, prefix);
+  auto tree_path = [&](int i) { return prefix + "_tree" + std::to_string(i); };
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) std::remove(tree_path(i).c_str());
+  const std::vector<std::vector<uint8_t>> d1(4, make_data(params.B, 11)), d2(2, make_data(params.B, 12)),
+      d3(2, make_data(params.B, 13));
+
+  auto* crashed = new roram::rORAM(params, std::make_unique<roram::NoOpCrypto>(), storage);
+  crashed->set_durability(roram::Durability::Access, wal);
+  crashed->Access(8, 4, "write", &d1);
+  for (uint64_t k = 0; k < 80; ++k) crashed->Access((k * 5) % 60, 4, "read");  // enough to compact the log
+  crashed->Access(40, 2, "write", &d2);
+  std::vector<roram::ClientStateRecord> log = roram::ClientStateLog::read(wal, params, &noop);
+  // One seq per commit after the base snapshot (seq 0); a compacted log starts later.
+  assert(log.front().snapshot && log.front().seq > 1 && log.back().seq == crashed->commits() - 1);
+
+  // As if the crash hit before the last commit's bucket writes reached the trees.
+  const roram::ClientStateRecord& last = log.back();
+  for (int i = 0; i <= params.ell; ++i) {
+    roram::FileStorage tree(params, tree_path(i));
+    const std::vector<uint8_t> zeros(tree.bucket_byte_size(), 0);
+    for (uint64_t id : last.trees[static_cast<size_t>(i)].bucket_ids) {
+      int level = 0;
+      while (((2ULL << level) - 1) <= id) ++level;
+      tree.write_raw(level, id - ((1ULL << level) - 1), 1, zeros.data());
+    }
+  }
+
+  auto* second = new roram::rORAM(params, std::make_unique<roram::NoOpCrypto>(), storage);
+  expect_throw([&] { second->recover(wal, roram::Durability::None); });
+  assert(second->recover(wal, roram::Durability::Group, 100) == last.seq);
+  size_t largest_stash = 0;
+  for (const roram::TreeState& t : last.trees) largest_stash = std::max(largest_stash, t.stash.size());
+  assert(largest_stash > 0 && second->max_stash_size() == largest_stash);
+  assert(second->Access(8, 4, "read") == d1);
+  assert(second->Access(40, 2, "read") == d2);
+  second->commit();
+  second->Access(40, 2, "write", &d3);  // never committed
+  expect_throw([&] { second->recover(wal); });  // not a fresh rORAM
+
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), storage);
+    ram.recover(wal);
+    assert(ram.Access(40, 2, "read") == d2);
+    assert(ram.Access(8, 4, "read") == d1);
+  }
+  // crashed and second are deliberately leaked: destroying them would commit.
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) std::remove(tree_path(i).c_str());
+}
+
+static void test_durable_log_sealed() {
+  const std::string prefix = "/tmp/roram_tests_sealed";
+  const std::string wal = prefix + ".wal";
+  roram::Params params(64, 4, 4, 32);
+  const roram::StorageFactory storage = roram::local_storage_factory(false, prefix);
+  const std::vector<std::vector<uint8_t>> d(4, make_data(params.B, 0x40));
+  {
+    roram::rORAM ram(params, std::make_unique<XorCrypto>(7), storage);
+    ram.set_durability(roram::Durability::Access, wal);
+    ram.Access(8, 4, "write", &d);
+    ram.Access(20, 1, "read");
+  }
+  // The written payload is in the records (stash or buckets) but never in the file.
+  std::ifstream in(wal, std::ios::binary);
+  const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  assert(std::search(bytes.begin(), bytes.end(), d[0].begin(), d[0].end()) == bytes.end());
+  XorCrypto key(7), other(8);
+  const std::vector<roram::ClientStateRecord> log = roram::ClientStateLog::read(wal, params, &key);
+  assert(log.size() == 3);
+  bool found = false;
+  for (const roram::TreeState& t : log[1].trees) {
+    for (const roram::Block& b : t.stash) found = found || (b.a == 8 && b.data == d[0]);
+    for (const roram::Bucket& bk : t.buckets)
+      for (const roram::Block& b : bk.blocks) found = found || (b.a == 8 && b.data == d[0]);
+  }
+  assert(found);  // the write's own commit
+  expect_throw([&] { roram::ClientStateLog::read(wal, params, &other); });
+  {
+    roram::rORAM ram(params, std::make_unique<XorCrypto>(7), storage);
+    ram.recover(wal);
+    assert(ram.Access(8, 4, "read") == d);
+  }
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) std::remove((prefix + "_tree" + std::to_string(i)).c_str());
+}
+
+// A file-size limit on the log stands in for a full disk: the failed commit must leave the
+// live rORAM whole and the log at its last good record, and the next commit must log it.
+static void test_durable_append_failure() {
+  const std::string prefix = "/tmp/roram_tests_walfail";
+  const std::string wal = prefix + ".wal";
+  roram::Params params(64, 4, 4, 32);
+  const roram::StorageFactory storage = roram::local_storage_factory(false, prefix);
+  auto file_size = [](const std::string& path) {
+    struct stat st;
+    assert(::stat(path.c_str(), &st) == 0);
+    return static_cast<uint64_t>(st.st_size);
+  };
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), storage);
+    ram.set_durability(roram::Durability::Access, wal);
+    for (uint64_t k = 0; k < 16; ++k) {
+      const uint64_t a = (k * 7) % 60;
+      std::vector<std::vector<uint8_t>> D(4, make_data(params.B, static_cast<uint8_t>(k + 1)));
+      for (uint64_t j = 0; j < 4; ++j) ref[a + j] = D[j];
+      ram.Access(a, 4, "write", &D);
+    }
+    const uint64_t good = file_size(wal);
+    for (int i = 0; i <= params.ell; ++i) assert(file_size(prefix + "_tree" + std::to_string(i)) < good);
+    const uint64_t commits = ram.commits();
+
+    rlimit saved;
+    assert(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+    rlimit cap = saved;
+    cap.rlim_cur = good + 64;  // part of the next record fits
+    void (*handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+    assert(setrlimit(RLIMIT_FSIZE, &cap) == 0);
+    std::vector<std::vector<uint8_t>> D(4, make_data(params.B, 99));
+    expect_throw([&] { ram.Access(24, 4, "write", &D); });
+    assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+    std::signal(SIGXFSZ, handler);
+    for (uint64_t j = 0; j < 4; ++j) ref[24 + j] = D[j];  // applied in memory, not yet logged
+    assert(file_size(wal) == good && ram.commits() == commits);
+
+    for (uint64_t a = 0; a < params.N; a += 4) {
+      const auto out = ram.Access(a, 4, "read");
+      for (uint64_t j = 0; j < 4; ++j) assert(out[j] == ref[a + j]);
+    }
+    assert(ram.commits() > commits);
+  }
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), storage);
+    ram.recover(wal);
+    for (uint64_t a = 0; a < params.N; a += 4) {
+      const auto out = ram.Access(a, 4, "read");
+      for (uint64_t j = 0; j < 4; ++j) assert(out[j] == ref[a + j]);
+    }
+  }
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) std::remove((prefix + "_tree" + std::to_string(i)).c_str());
+}
+
+static void test_huge_page_buffers() {
+  roram::PageBuffer small(4096, roram::HugePages::Explicit);
+  assert(small.data() && small.backing() == roram::HugePages::Off);  // below 2 MiB: regular pages
+  roram::PageBuffer big(3 * roram::kHugePageSize / 2, roram::HugePages::Transparent);
+  assert(big.data() && big.size() == 3 * roram::kHugePageSize / 2 && big.data()[big.size() - 1] == 0);
+  if (big.backing() == roram::HugePages::Transparent)
+    assert(reinterpret_cast<uintptr_t>(big.data()) % roram::kHugePageSize == 0);
+  big.data()[7] = 42;
+  big.grow(5 * roram::kHugePageSize);
+  assert(big.size() == 5 * roram::kHugePageSize && big.data()[7] == 42 && big.data()[big.size() - 1] == 0);
+  roram::PageBuffer moved(std::move(big));
+  assert(moved.data()[7] == 42 && !big.data() && big.size() == 0);
+  expect_throw([] { roram::parse_huge_pages("1g"); });
+
+  // Explicit falls back when no huge pages are reserved; contents behave the same either way.
+  roram::Params params(1024, 8, 4, 512);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(),
+                   roram::local_storage_factory(true, "", false, roram::HugePages::Explicit));
+  std::vector<std::vector<uint8_t>> d{make_data(params.B, 5), make_data(params.B, 6)};
+  ram.Access(100, 2, "write", &d);
+  assert(ram.Access(100, 2, "read") == d);
+  roram::TlbCounters counters;
+  counters.start();
+  counters.stop();
+  if (!counters.has_dtlb()) assert(counters.dtlb_misses() == 0);
+}
+
+static void test_header_scan_kernels() {
+  // Every supported ISA against a plain loop, across lengths that leave vector tails and
+  // values around the unsigned sign boundary.
+  uint64_t seed = 99;
+  std::vector<uint64_t> v(203);
+  for (size_t k = 0; k < v.size(); ++k) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    v[k] = (k % 7 == 0) ? roram::INVALID_ADDR : (k % 5 == 0) ? (1ULL << 63) + (seed >> 60) : (seed >> 54);
+  }
+  const roram::ScanIsa saved = roram::scan_isa();
+  for (roram::ScanIsa isa : {roram::ScanIsa::Scalar, roram::ScanIsa::AVX2, roram::ScanIsa::AVX512}) {
+    if (roram::set_scan_isa(isa) != isa) continue;
+    for (size_t n : {0, 3, 8, 64, 65, 203}) {
+      std::vector<uint64_t> mask(roram::mask_words(n) + 1, ~0ULL);
+      const uint64_t lo = 100, hi = (1ULL << 63) + 4;
+      size_t hits = roram::scan_in_range(v.data(), n, lo, hi, mask.data());
+      size_t want = 0;
+      for (size_t k = 0; k < n; ++k) {
+        const bool in = v[k] >= lo && v[k] < hi;
+        want += in;
+        assert(((mask[k / 64] >> (k % 64)) & 1) == static_cast<uint64_t>(in));
+      }
+      assert(hits == want);
+      if (n % 64) assert((mask[n / 64] >> (n % 64)) == 0);  // bits past n cleared
+      hits = roram::scan_masked_equal(v.data(), n, 15, 6, mask.data());
+      want = 0;
+      for (size_t k = 0; k < n; ++k) {
+        const bool eq = (v[k] & 15) == 6;
+        want += eq;
+        assert(((mask[k / 64] >> (k % 64)) & 1) == static_cast<uint64_t>(eq));
+      }
+      assert(hits == want);
+      assert(roram::scan_find(v.data(), n, roram::INVALID_ADDR) == 0);  // v[0] is a dummy (or n == 0)
+      assert(roram::scan_find(v.data(), n, 12345678) == n);
+      if (n > 0) {
+        const auto first = std::find(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(n), v[n - 1]);
+        assert(roram::scan_find(v.data(), n, v[n - 1]) == static_cast<size_t>(first - v.begin()));
+      }
+    }
+
+    // A whole level assigned at once matches bucket-by-bucket assignment.
+    roram::Params params(1024, 1, 4, 16);
+    std::vector<roram::Block> a_stash;
+    for (uint64_t s = 0; s < 300; ++s) {
+      roram::Block b(params.B, params.ell + 1);
+      b.a = s;
+      b.p[0] = (s * 2654435761ULL) % params.N;
+      a_stash.push_back(b);
+    }
+    std::vector<roram::Block> b_stash = a_stash;
+    const uint64_t n_buckets = 64;
+    std::vector<roram::Bucket> level(40, roram::Bucket(params.Z, params.B, params.ell + 1));
+    roram::SubORAM::assign_level(a_stash, 0, n_buckets, 50, level.size(), params.Z, level.data());
+    for (size_t b = 0; b < level.size(); ++b) {
+      roram::Bucket one(params.Z, params.B, params.ell + 1);
+      roram::SubORAM::assign_bucket(b_stash, 0, n_buckets, (50 + b) % n_buckets, params.Z, one);
+      for (size_t z = 0; z < one.blocks.size(); ++z) assert(one.blocks[z].a == level[b].blocks[z].a);
+    }
+    assert(a_stash.size() == b_stash.size());
+    for (size_t s = 0; s < a_stash.size(); ++s) assert(a_stash[s].a == b_stash[s].a);
+  }
+  roram::set_scan_isa(saved);
+  expect_throw([] { roram::parse_scan_isa("neon"); });
+
+  // End to end on the scalar kernels.
+  roram::set_scan_isa(roram::ScanIsa::Scalar);
+  roram::Params params(256, 8, 4, 32);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+  std::vector<std::vector<uint8_t>> d;
+  for (int k = 0; k < 8; ++k) d.push_back(make_data(params.B, k + 40));
+  ram.Access(16, 8, "write", &d);
+  roram::set_scan_isa(saved);
+  assert(ram.Access(16, 8, "read") == d);
+}
+
+static void test_specialized_core() {
+  // The compile-time core must behave exactly like the dynamic one: same reads, same
+  // stashes and the same I/O, step by step.
+  roram::Params params(512, 8, 4, 48);
+  roram::rORAM fast(params, std::make_unique<roram::NoOpCrypto>());
+  roram::set_sub_oram_specialization(false);
+  roram::rORAM slow(params, std::make_unique<roram::NoOpCrypto>());
+  roram::set_sub_oram_specialization(true);
+  assert(fast.specialized_trees() == params.ell + 1 && slow.specialized_trees() == 0);
+  uint64_t seed = 21;
+  for (int q = 0; q < 60; ++q) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint64_t r = 1 + (seed >> 40) % params.L;
+    const uint64_t a = (seed >> 20) % (params.N - r);
+    if (q % 3 == 0) {
+      std::vector<std::vector<uint8_t>> d;
+      for (uint64_t k = 0; k < r; ++k) d.push_back(make_data(params.B, static_cast<int>(a + k + q)));
+      fast.Access(a, r, "write", &d);
+      slow.Access(a, r, "write", &d);
+    } else {
+      assert(fast.Access(a, r, "read") == slow.Access(a, r, "read"));
+    }
+    assert(fast.memory_usage().stashed == slow.memory_usage().stashed);
+  }
+  const roram::LevelIoStats f = fast.io_stats().total(), g = slow.io_stats().total();
+  assert(f.buckets_read == g.buckets_read && f.buckets_written == g.buckets_written && f.seeks == g.seeks);
+
+  // Configurations outside the pre-instantiated set fall back to the dynamic core.
+  roram::rORAM other(roram::Params(512, 8, 5, 48), std::make_unique<roram::NoOpCrypto>());
+  assert(other.specialized_trees() == 0);
+}
+
+static void test_read_ahead() {
+  roram::Params params(256, 8, 4, 32);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+  std::vector<std::vector<uint8_t>> ref;
+  for (uint64_t a = 0; a < params.N; ++a) ref.push_back(make_data(params.B, static_cast<int>(a)));
+  for (uint64_t a = 0; a < params.N; a += params.L) {
+    std::vector<std::vector<uint8_t>> d(ref.begin() + a, ref.begin() + a + params.L);
+    ram.Access(a, params.L, "write", &d);
+  }
+  auto expect = [&](uint64_t a, uint64_t r) {
+    return std::vector<std::vector<uint8_t>>(ref.begin() + a, ref.begin() + a + r);
+  };
+
+  roram::ReadAheadORAM ahead(ram, roram::ReadAheadOptions{2, 2, 2, 0});
+  // A stream of 8-block reads: the first two are on demand, then the buffer runs ahead.
+  for (uint64_t a = 0; a < 64; a += 8) {
+    assert(ahead.Access(a, 8, "read") == expect(a, 8));
+    assert(ahead.buffered_blocks() <= 2 * 8 * 2);
+  }
+  assert(ahead.stats().miss_blocks == 16 && ahead.stats().hit_blocks == 48);
+  // Reads that straddle prefetched ranges are stitched together.
+  assert(ahead.Access(64, 5, "read") == expect(64, 5));
+  assert(ahead.Access(69, 8, "read") == expect(69, 8));
+
+  // A write to a buffered range drops it, so the next read sees the new data.
+  ahead.drain();
+  std::vector<std::vector<uint8_t>> d;
+  for (uint64_t k = 0; k < 4; ++k) d.push_back(make_data(params.B, static_cast<int>(1000 + k)));
+  ahead.Access(79, 4, "write", &d);
+  std::copy(d.begin(), d.end(), ref.begin() + 79);
+  assert(ahead.Access(77, 8, "read") == expect(77, 8));
+
+  // Scattered reads still return the right data; unused prefetches are counted as wasted.
+  for (uint64_t q = 0; q < 20; ++q) {
+    const uint64_t a = (q * 73 + 11) % (params.N - 8);
+    assert(ahead.Access(a, 1 + q % 8, "read") == expect(a, 1 + q % 8));
+  }
+  const roram::ReadAheadStats& st = ahead.stats();
+  assert(st.reads == 31 && st.writes == 1 && st.prefetches > 0 && st.wasted > 0);
+  expect_throw([&] { ahead.Access(0, params.L + 1, "read"); });
+  expect_throw([&] { ahead.Access(params.N - 2, 4, "read"); });
+}
+
+static void test_read_ahead_failed_prefetch() {
+  // A prefetch whose group commit cannot be logged fails; the read that reaches it is
+  // served on demand instead of rethrowing that error.
+  const std::string prefix = "/tmp/roram_tests_rafail";
+  const std::string wal = prefix + ".wal";
+  roram::Params params(64, 8, 4, 32);
+  const roram::StorageFactory storage = roram::local_storage_factory(false, prefix);
+  {
+    roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>(), storage);
+    std::vector<std::vector<uint8_t>> ref;
+    for (uint64_t a = 0; a < params.N; ++a) ref.push_back(make_data(params.B, static_cast<int>(a)));
+    for (uint64_t a = 0; a < params.N; a += params.L) {
+      std::vector<std::vector<uint8_t>> d(ref.begin() + a, ref.begin() + a + params.L);
+      ram.Access(a, params.L, "write", &d);
+    }
+    ram.set_durability(roram::Durability::Group, wal, 3);
+    struct stat st;
+    assert(::stat(wal.c_str(), &st) == 0);
+
+    roram::ReadAheadORAM ahead(ram, roram::ReadAheadOptions{2, 1, 1, 0});
+    rlimit saved;
+    assert(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+    rlimit cap = saved;
+    cap.rlim_cur = static_cast<rlim_t>(st.st_size) + 64;
+    void (*handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+    assert(setrlimit(RLIMIT_FSIZE, &cap) == 0);
+    // Access 1 (on demand) and the first prefetch stay under the group; the second
+    // prefetch's commit fails.
+    assert(ahead.Access(0, 8, "read") == std::vector<std::vector<uint8_t>>(ref.begin(), ref.begin() + 8));
+    ahead.drain();
+    assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+    std::signal(SIGXFSZ, handler);
+
+    for (uint64_t a = 8; a < 40; a += 8)
+      assert(ahead.Access(a, 8, "read") == std::vector<std::vector<uint8_t>>(ref.begin() + a, ref.begin() + a + 8));
+    const roram::ReadAheadStats& st2 = ahead.stats();
+    assert(st2.failed == 1 && st2.hit_blocks > 0 && st2.miss_blocks >= 16);
+    assert(st2.peak_buffered == 2 * params.L);
+  }
+  std::remove(wal.c_str());
+  for (int i = 0; i <= params.ell; ++i) std::remove((prefix + "_tree" + std::to_string(i)).c_str());
+}
+
+static void test_phase_stats() {
+#ifndef RORAM_NO_STATS
+  roram::Params params(256, 8, 4, 32);
+  roram::rORAM ram(params, std::make_unique<roram::NoOpCrypto>());
+  for (uint64_t a = 0; a + 8 <= 64; a += 8) ram.Access(a, 8, "read");
+  ram.Access(3, 1, "read");
+  roram::StatsSnapshot s = ram.stats();
+  for (roram::Phase p : {roram::Phase::ReadRange, roram::Phase::StashMerge, roram::Phase::PathTags,
+                         roram::Phase::EvictRead, roram::Phase::EvictAssign, roram::Phase::EvictWrite,
+                         roram::Phase::Serialize, roram::Phase::Decrypt, roram::Phase::RawIO})
+    assert(s[p].count > 0);
+  // Two ReadRanges per access, split by sub-ORAM: 8 on R_3, 2 on R_0.
+  assert(s[roram::Phase::ReadRange].count == 18);
+  assert(s.read_range_levels.size() == 4 && s.read_range_levels[3].count == 16 && s.read_range_levels[0].count == 2);
+  ram.reset_stats();
+  assert(ram.stats()[roram::Phase::ReadRange].count == 0);
+
+  // PathORAM with a recursive map: the backing levels' phases are merged in.
+  roram::PathORAM path(roram::Params(512, 1, 4, 32), std::make_unique<roram::NoOpCrypto>(), true, "", false, 16, 32);
+  path.reset_stats();
+  path.Access(7, "read");
+  roram::StatsSnapshot ps = path.stats();
+  assert(ps[roram::Phase::ReadRange].count == static_cast<uint64_t>(1 + path.recursion_depth()));
+  assert(ps[roram::Phase::EvictWrite].count == ps[roram::Phase::ReadRange].count);
+  assert(ps[roram::Phase::PathTags].count == 0);
+#endif
+}
+
+static void test_ring_oram_reference() {
+  roram::Params params(256, 1, 4, 32);
+  roram::RingORAM ram(params, std::make_unique<roram::NoOpCrypto>(), roram::RingOptions{3, 2});
+  std::vector<std::vector<uint8_t>> ref(params.N, std::vector<uint8_t>(params.B, 0));
+  const uint64_t accesses = 1200;
+  for (uint64_t op = 0; op < accesses; ++op) {
+    uint64_t a = (op * 37 + op / 5) % params.N;
+    if (op % 3 == 0) {
+      ref[a] = make_data(params.B, static_cast<uint8_t>(op));
+      ram.Access(a, "write", &ref[a]);
+    } else {
+      assert(ram.Access(a, "read") == ref[a]);
+    }
+  }
+  // One slot per bucket online; evictions every A accesses; buckets reshuffled after S reads.
+  assert(ram.online_blocks() == accesses * static_cast<uint64_t>(ram.tree_height() + 1));
+  assert(ram.evictions() == accesses / 2);
+  assert(ram.early_reshuffles() > 0);
+  assert(ram.total_blocks() > ram.online_blocks());
+  expect_throw([&] { ram.Access(params.N, "read"); });
+  expect_throw([&] { roram::RingORAM bad(params, std::make_unique<roram::NoOpCrypto>(), roram::RingOptions{0, 3}); });
+}
+
 static void test_cli_smoke() {
   int rc1 = std::system("./roram_main read 16 8 0 1 >/dev/null");
   int rc2 = std::system("./roram_main write 16 8 0 1 >/dev/null");
   int rc3 = std::system("./roram_main compare --N 16 --L 8 --trials 1 >/dev/null");
+  int rc5 = std::system("./roram_main scan --N 64 --L 8 --a 3 >/dev/null");
   std::string trace = "/tmp/roram_workload_trace.csv";
   {
     std::ofstream out(trace);
@@ -302,10 +1398,35 @@ static void test_cli_smoke() {
     out << "read,4,2\n";
   }
   int rc4 = std::system("./roram_main workload --N 16 --L 8 --trace /tmp/roram_workload_trace.csv --csv /tmp/roram_workload_trace_out.csv >/dev/null");
+  int rc6 = std::system("./roram_main tune --N 32 --Z 3,4 --B 4096 --L 4,8 --trace /tmp/roram_workload_trace.csv "
+                        "--min-queries 1 --warmup 0 --budget-ms 1 >/dev/null");
+  int rc7 = std::system("./roram_main trace-convert /tmp/roram_workload_trace.csv /tmp/roram_workload_trace.bin >/dev/null && "
+                        "./roram_main workload --N 16 --L 8 --trace /tmp/roram_workload_trace.bin "
+                        "--io-trace /tmp/roram_workload_io.trace >/dev/null && "
+                        "./roram_main replay-io --trace /tmp/roram_workload_io.trace --target /tmp/roram_workload_io.img >/dev/null");
+  std::remove("/tmp/roram_workload_io.img");
+  int rc8 = std::system("./roram_main workload --N 16 --L 8 --trace /tmp/roram_workload_trace.csv --clients 1,3 >/dev/null && "
+                        "./roram_main workload --N 32 --L 8 --trace /tmp/roram_workload_trace.csv --clients 2 --shards 2 >/dev/null && "
+                        "./roram_main workload --N 16 --L 8 --trace /tmp/roram_workload_trace.csv --rate 50,200 --arrival fixed "
+                        "--slo-p99-ms 100 --hdr-csv /tmp/roram_workload_hdr.csv >/dev/null");
+  int rc9 = std::system("./roram_main compare --N 16 --L 8 --trials 3 --json /tmp/roram_compare.json >/dev/null && "
+                        "./roram_main diff /tmp/roram_compare.json /tmp/roram_compare.json >/dev/null");
+  int rc10 = std::system("./roram_main footprint --N 64 --L 8 --per-tree >/dev/null");
+  int rc11 = std::system("./roram_main workload --N 16 --L 8 --trace /tmp/roram_workload_trace.csv --file /tmp/roram_durable "
+                         "--durability none,access,group --group-size 2 >/dev/null");
+  int rc12 = std::system("./roram_main workload --mode videoserver --N 256 --L 8 --queries 20 --read-ahead 2 >/dev/null");
   assert(rc1 == 0);
   assert(rc2 == 0);
   assert(rc3 == 0);
   assert(rc4 == 0);
+  assert(rc5 == 0);
+  assert(rc6 == 0);
+  assert(rc7 == 0);
+  assert(rc8 == 0);
+  assert(rc9 == 0);
+  assert(rc10 == 0);
+  assert(rc11 == 0);
+  assert(rc12 == 0);
 }
 
 static void test_noop_encrypt_roundtrip() {
@@ -344,17 +1465,44 @@ int main() {
   test_params_helpers();
   test_block_bucket_roundtrip();
   test_position_map_basic();
+  test_position_map_packed();
   test_memory_storage_roundtrip();
   test_file_storage_roundtrip_and_seeks();
   test_path_oram_write_read();
   test_position_map_updates();
   test_path_oram_overwrite();
   test_stash_resilience_hot_blocks();
+  test_storage_io_stats();
   test_backend_parity();
+  test_io_trace_record_and_replay();
+  test_path_oram_recursive_position_map();
+  test_path_oram_access_batch();
   test_path_oram_errors();
   test_roram_boundaries();
   test_roram_errors_and_seek_counter();
   test_roram_reference_model_random();
+  test_roram_outsourced_position_map();
+  test_roram_outsourced_map_accesses_oblivious();
+  test_roram_access_batch();
+  test_frontend_concurrent_clients();
+  test_roram_background_eviction();
+  test_sharded_roram_straddling_ranges();
+  test_remote_storage_roundtrips();
+  test_roram_scan_beyond_L();
+  test_ring_oram_reference();
+  test_phase_stats();
+  test_latency_histogram();
+  test_results_json_roundtrip();
+  test_memory_usage();
+  test_durable_commits();
+  test_durable_recovery();
+  test_durable_log_sealed();
+  test_durable_append_failure();
+  test_huge_page_buffers();
+  test_header_scan_kernels();
+  test_specialized_core();
+  test_read_ahead();
+  test_read_ahead_failed_prefetch();
   test_noop_encrypt_roundtrip();
 #ifdef RORAM_USE_OPENSSL
   test_gcm_roundtrip_and_tamper();